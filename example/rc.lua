@@ -73,6 +73,12 @@ cream.keys.map (state.noedit, { "Shift" }, "T",
                cream.inputbox.focus ()
           end)
 
+-- Follow a link
+cream.keys.map (state.noedit, { }, "f",
+          function (w)
+               w:hints ()
+          end)
+
 -- Yank/Paste
 cream.keys.map (state.noedit, { }, "y",
           function (w)
@@ -103,6 +103,11 @@ static void cream_browser_init (CreamBrowser *self)
 
      self->cmdline   = TRUE;
      self->profile   = NULL;
+     self->history   = NULL;
+     self->search    = NULL;
+
+     self->frecency.uris     = NULL;
+     self->frecency.commands = NULL;
 
      self->log       = FALSE;
      self->version   = FALSE;
@@ -170,6 +175,30 @@ static void cream_browser_dispose (GObject *obj)
      g_hash_table_remove_all (self->protocols);
 
      lua_ctx_close ();
+
+     if (self->history)
+     {
+          history_close (self->history);
+          self->history = NULL;
+     }
+
+     if (self->search)
+     {
+          search_close (self->search);
+          self->search = NULL;
+     }
+
+     if (self->frecency.uris)
+     {
+          frecency_free (self->frecency.uris);
+          frecency_free (self->frecency.commands);
+          self->frecency.uris = self->frecency.commands = NULL;
+     }
+
+     /* stop evictions, then wait for pending writes */
+     quota_close ();
+     cache_close ();
+
      g_free (self->profile);
 
      if (self->flog) fclose (self->flog);
@@ -206,6 +235,15 @@ static void cream_browser_activate (GApplication *gapp)
 
           g_free (cmd);
      }
+     /* no URL given, restore the last session and record this one
+      * (with an URL, the last session is kept for the next launch) */
+     else
+     {
+          if (!session_restore (&error) && error != NULL)
+               CREAM_BROWSER_GET_CLASS (self)->error (self, FALSE, error);
+
+          session_start ();
+     }
 
      gtk_main ();
 }
@@ -341,6 +379,9 @@ static void cream_browser_startup (CreamBrowser *self)
           self->flog = fopen (path, "a");
      }
 
+     /* start the cache's writer, before the threads using it */
+     cache_init ();
+
      /* init modules */
      self->protocols = g_hash_table_new (g_str_hash, g_str_equal);
      modules_init ();
@@ -349,6 +390,32 @@ static void cream_browser_startup (CreamBrowser *self)
      if ((self->sock = socket_new (&error)) == NULL)
           CREAM_BROWSER_GET_CLASS (self)->error (self, FALSE, error);
 
+     /* cache's budgets, the commands history is already bounded */
+     quota_init ();
+     {
+          gchar *path = cache_path (CACHE_TYPE_COMMANDS, NULL);
+          quota_pin (path);
+          g_free (path);
+     }
+
+     /* open history */
+     if ((self->history = history_open (&error)) == NULL)
+          CREAM_BROWSER_GET_CLASS (self)->error (self, FALSE, error);
+
+     /* full-text search, loaded on first use */
+     self->search = search_open ();
+
+     /* frecency rankings, loaded on first use */
+     {
+          gchar *path = cache_path (CACHE_TYPE_NONE, "frecency-uris");
+          self->frecency.uris = frecency_new (path, TRUE);
+          g_free (path);
+
+          path = cache_path (CACHE_TYPE_NONE, "frecency-commands");
+          self->frecency.commands = frecency_new (path, FALSE);
+          g_free (path);
+     }
+
      /* init gui */
      self->theme = CREAM_THEME (g_object_new (CREAM_TYPE_THEME, NULL));
      ui_init ();
@@ -37,11 +37,20 @@
 
 #include "lua.h"
 #include "modules.h"
+#include "latency.h"
 #include "keybinds.h"
 #include "interface.h"
 #include "theme.h"
 #include "socket.h"
 #include "cache.h"
+#include "history.h"
+#include "frecency.h"
+#include "search.h"
+#include "session.h"
+#include "quota.h"
+#include "hints.h"
+#include "isearch.h"
+#include "luaprof.h"
 
 G_BEGIN_DECLS
 
@@ -84,6 +93,7 @@ struct _CreamBrowser
           GtkWidget *vimsplit;
           GtkWidget *statusbar;
           GtkWidget *inputbox;
+          GtkWidget *output;
           GtkWidget *box;
 
           GtkWidget *fwebview;
@@ -96,6 +106,14 @@ struct _CreamBrowser
      Socket *sock;            /*!< Socket server */
      Theme *theme;            /*!< Theme engine */
      lua_State *luavm;        /*!< Lua VM state */
+     History *history;        /*!< Browsing history */
+     SearchIndex *search;     /*!< Full-text search over visited pages */
+
+     struct
+     {
+          Frecency *uris;     /*!< Frecency of visited URIs */
+          Frecency *commands; /*!< Frecency of entered commands */
+     } frecency;
 };
 
 struct _CreamBrowserClass
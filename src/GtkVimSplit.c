@@ -175,6 +175,8 @@ void gtk_vim_split_add (GtkVimSplit *obj, GtkWidget *child, GtkOrientation o)
 
      obj->widgets = g_list_append (obj->widgets, GTK_WIDGET (g_object_ref (child)));
 
+     session_split (obj->focus ? CREAM_NOTEBOOK (obj->focus) : NULL, CREAM_NOTEBOOK (child), o);
+
      if (obj->focus)
      {
           GtkWidget *focus  = obj->focus;
@@ -228,6 +230,8 @@ void gtk_vim_split_close (GtkVimSplit *obj)
      g_return_if_fail (GTK_IS_VIM_SPLIT (obj));
      g_return_if_fail (obj->focus != NULL);
 
+     session_view_closed (CREAM_NOTEBOOK (obj->focus));
+
      parent = gtk_widget_get_parent (obj->focus);
      if (parent == GTK_WIDGET (obj))
      {
@@ -282,4 +286,35 @@ void gtk_vim_split_close (GtkVimSplit *obj)
      gtk_widget_grab_focus (obj->focus);
 }
 
+/*!
+ * \public \memberof GtkVimSplit
+ * @param obj An empty #GtkVimSplit widget.
+ * @param root Root of the layout: a #Notebook, or a tree of \class{GtkPaned} containing notebooks.
+ * @param notebooks List of the #Notebook widgets in \a root.
+ * @param focus The #Notebook to focus.
+ *
+ * Set a whole layout at once (used to restore a session).
+ *
+ * \see \ref focus-changed
+ */
+void gtk_vim_split_set_root (GtkVimSplit *obj, GtkWidget *root, GList *notebooks, GtkWidget *focus)
+{
+     GList *l;
+
+     g_return_if_fail (GTK_IS_VIM_SPLIT (obj));
+     g_return_if_fail (obj->widgets == NULL);
+     g_return_if_fail (CREAM_IS_NOTEBOOK (focus));
+
+     for (l = notebooks; l != NULL; l = l->next)
+     {
+          obj->widgets = g_list_append (obj->widgets, g_object_ref (l->data));
+          g_signal_connect (G_OBJECT (l->data), "grab-focus", G_CALLBACK (gtk_vim_split_grab_focus_cb), obj);
+     }
+
+     gtk_container_add (GTK_CONTAINER (obj), root);
+
+     obj->focus = focus;
+     gtk_widget_grab_focus (focus);
+}
+
 /*! @} */
@@ -77,6 +77,7 @@ void gtk_vim_split_set_focus (GtkVimSplit *obj, GtkWidget *nb);
 
 void gtk_vim_split_add (GtkVimSplit *obj, GtkWidget *child, GtkOrientation o);
 void gtk_vim_split_close (GtkVimSplit *obj);
+void gtk_vim_split_set_root (GtkVimSplit *obj, GtkWidget *root, GList *notebooks, GtkWidget *focus);
 
 G_END_DECLS
 
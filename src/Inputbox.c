@@ -34,10 +34,21 @@ static void inputbox_activate_cb (Inputbox *obj);
 static gboolean inputbox_keypress_cb (Inputbox *obj, GdkEvent *event);
 static void inputbox_focus_in_cb (Inputbox *obj, GdkEvent *event);
 static void inputbox_focus_out_cb (Inputbox *obj, GdkEvent *event);
+static void inputbox_changed_cb (Inputbox *obj);
+
+static void inputbox_finalize (GObject *obj);
 
 static void inputbox_check_mode (Inputbox *obj);
+static void inputbox_history_show (Inputbox *obj);
+static void inputbox_complete (Inputbox *obj, gboolean forward);
+static void inputbox_complete_reset (Inputbox *obj);
+static void inputbox_complete_show (Inputbox *obj);
+static void inputbox_history_add (Inputbox *obj, const gchar *str, gsize len);
 static void inputbox_cache_append (Inputbox *obj, gchar *txt);
 static void inputbox_cache_read (Inputbox *obj);
+static void inputbox_cache_compact (Inputbox *obj);
+
+#define INPUTBOX_HISTORY(obj,i)    (&(obj)->history.ring[((obj)->history.start + (i)) % (obj)->history.size])
 
 G_DEFINE_TYPE (Inputbox, inputbox, GTK_TYPE_ENTRY)
 
@@ -54,6 +65,7 @@ GtkWidget *inputbox_new (void)
      g_signal_connect (G_OBJECT (obj), "key-press-event", G_CALLBACK (inputbox_keypress_cb), NULL);
      g_signal_connect (G_OBJECT (obj), "focus-in-event", G_CALLBACK (inputbox_focus_in_cb), NULL);
      g_signal_connect (G_OBJECT (obj), "focus-out-event", G_CALLBACK (inputbox_focus_out_cb), NULL);
+     g_signal_connect (G_OBJECT (obj), "changed", G_CALLBACK (inputbox_changed_cb), NULL);
      return GTK_WIDGET (obj);
 }
 
@@ -65,7 +77,9 @@ GtkWidget *inputbox_new (void)
  */
 static void inputbox_class_init (InputboxClass *klass)
 {
-     return;
+     GObjectClass *gclass = G_OBJECT_CLASS (klass);
+
+     gclass->finalize = inputbox_finalize;
 }
 
 /*!
@@ -76,10 +90,40 @@ static void inputbox_class_init (InputboxClass *klass)
  */
 static void inputbox_init (Inputbox *self)
 {
-     self->history = NULL;
-     self->current = NULL;
+     self->cache    = NULL;
+     self->commands = g_string_chunk_new (1024);
+     self->current  = -1;
+
+     self->completion.engine  = NULL;
+     self->completion.head    = NULL;
+     self->completion.start   = 0;
+     self->completion.current = -1;
+     self->completion.setting = FALSE;
+
+     memset (&self->history, 0, sizeof (self->history));
+     self->history.size      = INPUTBOX_HISTORY_SIZE;
+     self->history.max_bytes = INPUTBOX_HISTORY_BYTES;
+}
 
-     inputbox_cache_read (self);
+/*!
+ * \fn static void inputbox_finalize (GObject *obj)
+ * @param obj The #Inputbox object.
+ * Free memory used by the object.
+ */
+static void inputbox_finalize (GObject *obj)
+{
+     Inputbox *self = CREAM_INPUTBOX (obj);
+
+     if (self->completion.engine != NULL)
+          inputbox_complete_reset (self);
+
+     g_free (self->history.ring);
+     g_string_chunk_free (self->commands);
+
+     if (self->cache != NULL)
+          cache_reader_unref (self->cache);
+
+     G_OBJECT_CLASS (inputbox_parent_class)->finalize (obj);
 }
 
 /*! @} */
@@ -96,21 +140,29 @@ static void inputbox_init (Inputbox *self)
  *
  * This function handles the signal <code>"activate"</code> which is
  * emitted when the user validate the entry by pressing <code>Enter</code>.
- * This handler is able to run a command, start a research (forward or backward),
- * and modify the commands history.
+ * This handler is able to run a command, end a research (forward or backward,
+ * see \ref isearch), and modify the commands history.
  */
 static void inputbox_activate_cb (Inputbox *obj)
 {
      GError *error = NULL;
      WebView *fwebview;
+     gboolean found = FALSE;
      gchar *txt;
 
      g_return_if_fail (gtk_entry_get_text_length (GTK_ENTRY (obj)) > 0);
      txt = g_strdup (gtk_entry_get_text (GTK_ENTRY (obj)));
-     gtk_entry_set_text (GTK_ENTRY (obj), "");
 
      fwebview = CREAM_WEBVIEW (cream_browser_get_focused_webview (app));
 
+     /* end the search on its current match, before the text is cleared */
+     if (txt[0] == '/' || txt[0] == '?')
+          found = isearch_finish (fwebview, txt + 1, (txt[0] == '/'));
+
+     inputbox_complete_reset (obj);
+     gtk_entry_set_text (GTK_ENTRY (obj), "");
+     ui_output (NULL);
+
      switch (txt[0])
      {
           case ':':
@@ -122,19 +174,9 @@ static void inputbox_activate_cb (Inputbox *obj)
 
                break;
 
-          case '/':
-               /* search forward */
-               if (!cream_module_search (CREAM_MODULE (webview_get_module (fwebview)), fwebview->child, txt + 1, TRUE))
-               {
-                    gchar *err = g_strdup_printf (_("No matches found for: %s"), txt + 1);
-                    gtk_entry_set_text (GTK_ENTRY (obj), err);
-                    g_free (err);
-               }
-               break;
-
-          case '?':
-               /* search backward */
-               if (!cream_module_search (CREAM_MODULE (webview_get_module (fwebview)), fwebview->child, txt + 1, FALSE))
+          case '/': /* search forward */
+          case '?': /* search backward */
+               if (!found)
                {
                     gchar *err = g_strdup_printf (_("No matches found for: %s"), txt + 1);
                     gtk_entry_set_text (GTK_ENTRY (obj), err);
@@ -159,42 +201,56 @@ static void inputbox_activate_cb (Inputbox *obj)
  * This function handles the signal <code>"key-press-event"</code> which is
  * emitted when the user press any key on the inputbox.
  * This handler is able to modify the Cream-Browser's state (see #CreamMode),
- * and to read the commands history.
+ * to read the commands history, and to complete the text.
+ * Its latency is recorded as the <code>&lt;inputbox&gt;</code> binding.
  */
 static gboolean inputbox_keypress_cb (Inputbox *obj, GdkEvent *event)
 {
+     static LatencyStats *stats = NULL;
+     gint64 start = g_get_monotonic_time ();
      GdkEventKey ekey = event->key;
      gchar *key = gdk_keyval_name (ekey.keyval);
+     gboolean tab = (g_str_equal (key, "Tab") || g_str_equal (key, "ISO_Left_Tab"));
      gboolean ret = TRUE;
 
+     if (stats == NULL)
+          stats = latency_stats_new ("<inputbox>");
+
+     latency_record_event (&stats->delay, ekey.time);
+
+     /* the completion follows the typed text (see inputbox_changed_cb ()) */
+     if (g_str_equal (key, "Escape") || g_str_equal (key, "Up") || g_str_equal (key, "Down"))
+          inputbox_complete_reset (obj);
+
      if (g_str_equal (key, "Escape"))
      {
           gtk_entry_set_text (GTK_ENTRY (obj), "");
+          ui_output (NULL);
           inputbox_check_mode (obj);
           statusbar_set_state (CREAM_STATUSBAR (app->gui.statusbar), CREAM_MODE_NORMAL);
      }
-     else if (g_str_equal (key, "Tab"))
-     {
-          /* completion */;
-     }
-     else if (g_str_equal (key, "Up") && obj->history != NULL)
+     else if (tab)
+          inputbox_complete (obj, g_str_equal (key, "Tab"));
+     else if (g_str_equal (key, "Up"))
      {
-          obj->current = (obj->current == NULL ? obj->history : obj->current->next);
+          inputbox_cache_read (obj);
 
-          if (obj->current != NULL)
+          if (obj->current + 1 < (gint) obj->history.len)
           {
-               gtk_entry_set_text (GTK_ENTRY (obj), (gchar *) obj->current->data);
-               inputbox_check_mode (obj);
+               obj->current++;
+               inputbox_history_show (obj);
           }
      }
-     else if (g_str_equal (key, "Down") && obj->history != NULL)
+     else if (g_str_equal (key, "Down"))
      {
-          obj->current = (obj->current == NULL ? obj->history : obj->current->prev);
+          inputbox_cache_read (obj);
 
-          if (obj->current != NULL)
+          if (obj->history.len > 0)
           {
-               gtk_entry_set_text (GTK_ENTRY (obj), (gchar *) obj->current->data);
-               inputbox_check_mode (obj);
+               obj->current = (obj->current < 0 ? 0 : obj->current - 1);
+
+               if (obj->current >= 0)
+                    inputbox_history_show (obj);
           }
      }
      else if (g_str_equal (key, "BackSpace"))
@@ -217,6 +273,8 @@ static gboolean inputbox_keypress_cb (Inputbox *obj, GdkEvent *event)
 
      if (ret) gtk_editable_set_position (GTK_EDITABLE (obj), -1);
 
+     latency_record (&stats->run, g_get_monotonic_time () - start);
+
      return ret;
 }
 
@@ -243,9 +301,44 @@ static void inputbox_focus_in_cb (Inputbox *obj, GdkEvent *event)
  */
 static void inputbox_focus_out_cb (Inputbox *obj, GdkEvent *event)
 {
+     inputbox_complete_reset (obj);
+     isearch_stop ();
      statusbar_set_state (CREAM_STATUSBAR (app->gui.statusbar), CREAM_MODE_NORMAL);
 }
 
+/*!
+ * \fn static void inputbox_changed_cb (Inputbox *obj)
+ * @param obj A #Inputbox object.
+ *
+ * This function handles the signal <code>"changed"</code> which is
+ * emitted when the text is modified. A research is updated as it is
+ * typed (see \ref isearch). During a completion, the candidates are
+ * narrowed to the typed text, unless the text before the completed
+ * argument was modified.
+ */
+static void inputbox_changed_cb (Inputbox *obj)
+{
+     const gchar *txt = gtk_entry_get_text (GTK_ENTRY (obj));
+
+     if ((txt[0] == '/' || txt[0] == '?') && txt[1] != '\0')
+          isearch_update (CREAM_WEBVIEW (cream_browser_get_focused_webview (app)), txt + 1, (txt[0] == '/'));
+     else
+          isearch_stop ();
+
+     if (obj->completion.engine == NULL || obj->completion.setting)
+          return;
+
+     if (!g_str_has_prefix (txt, obj->completion.head))
+     {
+          inputbox_complete_reset (obj);
+          return;
+     }
+
+     completion_filter (obj->completion.engine, txt + obj->completion.start);
+     obj->completion.current = -1;
+     inputbox_complete_show (obj);
+}
+
 /*! @} */
 
 /*!
@@ -286,6 +379,246 @@ static void inputbox_check_mode (Inputbox *obj)
      }
 }
 
+/*!
+ * \public \memberof Inputbox
+ * @param obj A #Inputbox object.
+ * @param size Maximum number of commands in history.
+ * @param max_bytes Maximum size of the commands in history.
+ *
+ * Set the limits of the commands history. If it is already loaded,
+ * the oldest commands are dropped.
+ */
+void inputbox_set_history_limit (Inputbox *obj, guint size, gsize max_bytes)
+{
+     InputboxCommand *ring;
+     guint i, len = 0;
+     gsize bytes = 0;
+
+     g_return_if_fail (CREAM_IS_INPUTBOX (obj));
+
+     if (obj->history.ring == NULL)
+     {
+          obj->history.size      = size;
+          obj->history.max_bytes = max_bytes;
+          return;
+     }
+
+     /* keep the most recent commands which fit */
+     ring = g_new (InputboxCommand, MAX (size, 1));
+
+     for (i = obj->history.len; i > 0 && len < size; --i)
+     {
+          InputboxCommand *cmd = INPUTBOX_HISTORY (obj, i - 1);
+
+          if (bytes + cmd->len > max_bytes)
+               break;
+
+          bytes += cmd->len;
+          ring[size - 1 - len++] = *cmd;
+     }
+
+     g_free (obj->history.ring);
+
+     obj->history.ring      = ring;
+     obj->history.size      = MAX (size, 1);
+     obj->history.start     = (size - len) % obj->history.size;
+     obj->history.len       = len;
+     obj->history.bytes     = bytes;
+     obj->history.max_bytes = max_bytes;
+     obj->current           = -1;
+}
+
+/*!
+ * \private \memberof Inputbox
+ * @param obj A #Inputbox object.
+ *
+ * Show the current command of the history.
+ */
+static void inputbox_history_show (Inputbox *obj)
+{
+     InputboxCommand *cmd = INPUTBOX_HISTORY (obj, obj->history.len - 1 - obj->current);
+     gchar *txt = g_strndup (cmd->str, cmd->len);
+
+     gtk_entry_set_text (GTK_ENTRY (obj), txt);
+     inputbox_check_mode (obj);
+     g_free (txt);
+}
+
+/*!
+ * @param c The #Completion of an #Inputbox.
+ * @param data The #Inputbox.
+ *
+ * Candidates were added in background: show them, unless one was
+ * already chosen.
+ */
+static void inputbox_complete_update (Completion *c, gpointer data)
+{
+     Inputbox *obj = data;
+
+     if (obj->completion.current < 0)
+          inputbox_complete_show (obj);
+}
+
+/*!
+ * \private \memberof Inputbox
+ * @param obj A #Inputbox object.
+ * @param forward \c TRUE for the next candidate, \c FALSE for the previous one.
+ *
+ * Replace the text (or the argument of <code>:open</code> and
+ * <code>:tabopen</code>) with the next candidate matching the typed
+ * text. The first call starts the completion, which lasts until the
+ * text is validated, or the text before the argument is modified.
+ */
+static void inputbox_complete (Inputbox *obj, gboolean forward)
+{
+     const CompletionCandidate *cand;
+     gchar *txt;
+     gint n;
+
+     if (obj->completion.engine == NULL)
+     {
+          const gchar *text = gtk_entry_get_text (GTK_ENTRY (obj));
+          CompletionKind kind = COMPLETION_COMMANDS;
+
+          if (text[0] != ':')
+               return;
+
+          obj->completion.start = 1;
+
+          if (g_str_has_prefix (text, ":open ") || g_str_has_prefix (text, ":tabopen "))
+          {
+               obj->completion.start = strchr (text, ' ') + 1 - text;
+               kind = COMPLETION_URIS;
+          }
+
+          obj->completion.head    = g_strndup (text, obj->completion.start);
+          obj->completion.engine  = completion_new (kind, inputbox_complete_update, obj);
+          obj->completion.current = -1;
+
+          completion_filter (obj->completion.engine, text + obj->completion.start);
+     }
+
+     if ((n = completion_count (obj->completion.engine)) == 0)
+     {
+          inputbox_complete_show (obj);
+          return;
+     }
+
+     if (obj->completion.current < 0 || obj->completion.current >= n)
+          obj->completion.current = (forward ? 0 : n - 1);
+     else
+          obj->completion.current = (obj->completion.current + (forward ? 1 : n - 1)) % n;
+
+     cand = completion_get (obj->completion.engine, obj->completion.current);
+     txt  = g_strconcat (obj->completion.head, cand->text, NULL);
+
+     obj->completion.setting = TRUE;
+     gtk_entry_set_text (GTK_ENTRY (obj), txt);
+     obj->completion.setting = FALSE;
+
+     inputbox_check_mode (obj);
+     inputbox_complete_show (obj);
+     g_free (txt);
+}
+
+/*!
+ * \private \memberof Inputbox
+ * @param obj A #Inputbox object.
+ *
+ * Show the page of candidates around the current one.
+ */
+static void inputbox_complete_show (Inputbox *obj)
+{
+     guint i, n = completion_count (obj->completion.engine);
+     guint first = (obj->completion.current > 0 ? obj->completion.current - obj->completion.current % COMPLETION_SHOWN : 0);
+     GString *output;
+
+     if (n == 0)
+     {
+          ui_output (_("No completion"));
+          return;
+     }
+
+     output = g_string_new (NULL);
+     g_string_printf (output, "%d/%u", obj->completion.current + 1, n);
+
+     for (i = first; i < n && i < first + COMPLETION_SHOWN; ++i)
+     {
+          const CompletionCandidate *cand = completion_get (obj->completion.engine, i);
+
+          g_string_append_printf (output, "\n%s %s%s%s", ((gint) i == obj->completion.current ? ">" : " "),
+                                  cand->text, (cand->desc ? "    " : ""), (cand->desc ? cand->desc : ""));
+     }
+
+     ui_output (output->str);
+     g_string_free (output, TRUE);
+}
+
+/*!
+ * \private \memberof Inputbox
+ * @param obj A #Inputbox object.
+ *
+ * Stop the current completion.
+ */
+static void inputbox_complete_reset (Inputbox *obj)
+{
+     completion_free (obj->completion.engine);
+     g_free (obj->completion.head);
+
+     obj->completion.engine  = NULL;
+     obj->completion.head    = NULL;
+     obj->completion.current = -1;
+}
+
+/*!
+ * \private \memberof Inputbox
+ * @param obj A #Inputbox object.
+ * @param str The command (must outlive the history).
+ * @param len Length of the command.
+ *
+ * Add a command to the history, as the most recent one. A previous
+ * occurrence is removed, and the oldest commands are dropped to
+ * respect the limits.
+ */
+static void inputbox_history_add (Inputbox *obj, const gchar *str, gsize len)
+{
+     InputboxCommand *cmd;
+     guint i;
+
+     /* collapse duplicates to the most recent occurrence */
+     for (i = 0; i < obj->history.len; ++i)
+     {
+          cmd = INPUTBOX_HISTORY (obj, i);
+
+          if (cmd->len == len && memcmp (cmd->str, str, len) == 0)
+          {
+               obj->history.bytes -= len;
+
+               for (; i + 1 < obj->history.len; ++i)
+                    *INPUTBOX_HISTORY (obj, i) = *INPUTBOX_HISTORY (obj, i + 1);
+
+               obj->history.len--;
+               break;
+          }
+     }
+
+     if (len > obj->history.max_bytes)
+          return;
+
+     /* drop the oldest commands */
+     while (obj->history.len >= obj->history.size || obj->history.bytes + len > obj->history.max_bytes)
+     {
+          obj->history.bytes -= INPUTBOX_HISTORY (obj, 0)->len;
+          obj->history.start = (obj->history.start + 1) % obj->history.size;
+          obj->history.len--;
+     }
+
+     cmd = INPUTBOX_HISTORY (obj, obj->history.len++);
+     cmd->str = str;
+     cmd->len = len;
+     obj->history.bytes += len;
+}
+
 /*
  * \private \memberof Inputbox
  * @param obj A #Inputbox object.
@@ -294,28 +627,150 @@ static void inputbox_check_mode (Inputbox *obj)
  */
 static void inputbox_cache_append (Inputbox *obj, gchar *txt)
 {
-     gchar *path = cache_path (CACHE_TYPE_COMMANDS, NULL);
+     gchar *path;
+     gsize len = strlen (txt);
+
+     inputbox_cache_read (obj);
+     inputbox_history_add (obj, g_string_chunk_insert_len (obj->commands, txt, len), len);
+     obj->current = -1;
+
+     path = cache_path (CACHE_TYPE_COMMANDS, NULL);
      cache_appendto (path, txt);
      g_free (path);
 
-     obj->history = g_list_prepend (obj->history, txt);
+     frecency_add (app->frecency.commands, txt, g_get_real_time ());
+
+     g_free (txt);
+
+     /* the cache contains at most twice the history */
+     if (++obj->history.appended >= obj->history.size)
+          inputbox_cache_compact (obj);
+}
+
+static guint inputbox_command_hash (gconstpointer key)
+{
+     const InputboxCommand *cmd = key;
+     guint h = 5381;
+     gsize i;
+
+     for (i = 0; i < cmd->len; ++i)
+          h = (h << 5) + h + (guchar) cmd->str[i];
+
+     return h;
+}
+
+static gboolean inputbox_command_equal (gconstpointer a, gconstpointer b)
+{
+     const InputboxCommand *ca = a, *cb = b;
+     return ca->len == cb->len && memcmp (ca->str, cb->str, ca->len) == 0;
 }
 
 /*
  * \private \memberof Inputbox
  * @param obj A #Inputbox object.
- * Read cache file and restore commands history.
+ * Map cache file and restore commands history, if it is not loaded yet.
+ * The cache is read backward, until the history is full. Commands are
+ * not copied, the mapping is kept alive by the #Inputbox until the next
+ * compaction.
  */
 static void inputbox_cache_read (Inputbox *obj)
 {
-     gchar *path = cache_path (CACHE_TYPE_COMMANDS, NULL);
-     gchar **commands = cache_read (path);
-     int i, len = g_strv_length (commands);
+     GError *error = NULL;
+     GHashTable *seen;
+     InputboxCommand cmd;
+     gchar *path;
+     guint skipped = 0;
+     gboolean full = FALSE;
+
+     if (obj->history.ring != NULL)
+          return;
+
+     obj->history.size = MAX (obj->history.size, 1);
+     obj->history.ring = g_new (InputboxCommand, obj->history.size);
+
+     path = cache_path (CACHE_TYPE_COMMANDS, NULL);
+     obj->cache = cache_reader_new (path, &error);
+     g_free (path);
+
+     if (obj->cache == NULL)
+     {
+          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+          return;
+     }
+
+     seen = g_hash_table_new (inputbox_command_hash, inputbox_command_equal);
+
+     while (cache_reader_prev (obj->cache, &cmd.str, &cmd.len))
+     {
+          InputboxCommand *slot;
+
+          /* a more recent occurrence is already loaded */
+          if (g_hash_table_lookup (seen, &cmd) != NULL)
+          {
+               skipped++;
+               continue;
+          }
+
+          if (obj->history.len >= obj->history.size || obj->history.bytes + cmd.len > obj->history.max_bytes)
+          {
+               full = TRUE;
+               break;
+          }
+
+          /* fill the ring from its end */
+          slot = &obj->history.ring[obj->history.size - 1 - obj->history.len++];
+          *slot = cmd;
+          obj->history.bytes += cmd.len;
+
+          g_hash_table_insert (seen, slot, slot);
+     }
+
+     g_hash_table_destroy (seen);
+
+     obj->history.start = (obj->history.size - obj->history.len) % obj->history.size;
+
+     if (full || skipped >= obj->history.size / 2)
+          inputbox_cache_compact (obj);
+}
+
+/*
+ * \private \memberof Inputbox
+ * @param obj A #Inputbox object.
+ * Replace the cache file with the content of the history. The file
+ * is written by the cache's writer thread. The commands are copied to
+ * a new string chunk, so the dropped ones and the mapping are freed.
+ */
+static void inputbox_cache_compact (Inputbox *obj)
+{
+     GString *data = g_string_sized_new (obj->history.bytes + obj->history.len * 2);
+     GStringChunk *commands = g_string_chunk_new (1024);
+     gchar *path;
+     guint i;
+
+     for (i = 0; i < obj->history.len; ++i)
+     {
+          InputboxCommand *cmd = INPUTBOX_HISTORY (obj, i);
+
+          g_string_append_len (data, cmd->str, cmd->len);
+          g_string_append (data, "\r\n");
+
+          cmd->str = g_string_chunk_insert_len (commands, cmd->str, cmd->len);
+     }
+
+     g_string_chunk_free (obj->commands);
+     obj->commands = commands;
+
+     if (obj->cache != NULL)
+     {
+          cache_reader_unref (obj->cache);
+          obj->cache = NULL;
+     }
 
+     path = cache_path (CACHE_TYPE_COMMANDS, NULL);
+     cache_rewrite (path, data);
      g_free (path);
 
-     for (i = 0; i < len; ++i)
-          obj->history = g_list_prepend (obj->history, commands[i]);
+     obj->history.appended = 0;
 }
 
 /*! @} */
@@ -31,12 +31,18 @@
  * \ingroup interface
  * Inputbox class definition
  *
- * \todo Completion
+ * <code>Tab</code> and <code>Shift-Tab</code> cycle through the commands
+ * (internal, lua and recent ones), or for the argument of
+ * <code>:open</code> and <code>:tabopen</code>, through the open tabs,
+ * the frecent URIs and the history (see \ref completion). Once started,
+ * the candidates are narrowed as the text is typed.
  *
  * @{
  */
 
 #include <gtk/gtk.h>
+#include "cache.h"
+#include "completion.h"
 
 G_BEGIN_DECLS
 
@@ -45,9 +51,24 @@ G_BEGIN_DECLS
 #define CREAM_IS_INPUTBOX(obj)          (G_TYPE_CHECK_INSTANCE_TYPE (obj, CREAM_TYPE_INPUTBOX))
 #define CREAM_INPUTBOX_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST (klass, CREAM_TYPE_INPUTBOX, InputboxClass))
 
+#define INPUTBOX_HISTORY_SIZE           500            /*!< Default maximum number of commands in history */
+#define INPUTBOX_HISTORY_BYTES          65536          /*!< Default maximum size of the commands in history */
+
 typedef struct _Inputbox Inputbox;
 typedef struct _InputboxClass InputboxClass;
 
+/*!
+ * \struct InputboxCommand
+ * A command of the history. It points either into the mapped
+ * commands cache or into the #Inputbox's string chunk, which holds all
+ * of them after a compaction.
+ */
+typedef struct
+{
+     const gchar *str;
+     gsize len;
+} InputboxCommand;
+
 /*!
  * \class Inputbox
  * Manage interactions with user.
@@ -56,8 +77,30 @@ struct _Inputbox
 {
      GtkEntry parent;
 
-     GList *history;
-     GList *current;
+     CacheReader *cache;           /*!< Mapped commands cache, until the first compaction */
+     GStringChunk *commands;       /*!< Commands of the history and the ones entered since the last compaction */
+
+     struct
+     {
+          InputboxCommand *ring;   /*!< Ring buffer of commands, loaded on first use */
+          guint size;              /*!< Maximum number of commands */
+          guint start;             /*!< Position of the oldest command in the ring */
+          guint len;               /*!< Number of commands */
+          gsize bytes;             /*!< Size of the commands */
+          gsize max_bytes;         /*!< Maximum size of the commands */
+          guint appended;          /*!< Commands appended to the cache since the last compaction */
+     } history;
+
+     gint current;                 /*!< Position in the history from the most recent one, or -1 */
+
+     struct
+     {
+          Completion *engine;      /*!< Current completion, or \c NULL */
+          gchar *head;             /*!< Text before the completed argument */
+          gsize start;             /*!< Length of \a head */
+          gint current;            /*!< Current candidate, or -1 */
+          gboolean setting;        /*!< The text is being replaced by a candidate */
+     } completion;
 };
 
 struct _InputboxClass
@@ -67,6 +110,7 @@ struct _InputboxClass
 
 GType inputbox_get_type (void);
 GtkWidget *inputbox_new (void);
+void inputbox_set_history_limit (Inputbox *obj, guint size, gsize max_bytes);
 
 G_END_DECLS
 
@@ -30,6 +30,7 @@
  * @{
  */
 
+static GtkWidget *notebook_append (Notebook *obj, GObject *module);
 static void notebook_switch_page_cb (Notebook *self, GtkWidget *webview, guint page_num);
 
 static void notebook_signal_title_changed_cb (WebView *webview, const gchar *title, Notebook *obj);
@@ -69,6 +70,9 @@ static void notebook_class_init (NotebookClass *klass)
  */
 static void notebook_init (Notebook *obj)
 {
+     static guint last_id = 0;
+
+     obj->id = ++last_id;
      obj->focus = NULL;
      obj->webviews = NULL;
 
@@ -125,26 +129,20 @@ void notebook_open (Notebook *obj, const gchar *url)
 }
 
 /*!
- * \public \memberof Notebook
+ * \private \memberof Notebook
  * @param obj A #Notebook object.
- * @param url URL to load.
+ * @param module The #CreamModule to use.
+ * @return A new #WebView object.
  *
- * Open URL in a new webview.
+ * Append a new webview to the notebook.
  */
-void notebook_tabopen (Notebook *obj, const gchar *url)
+static GtkWidget *notebook_append (Notebook *obj, GObject *module)
 {
-     GObject *module;
      GtkWidget *webview;
      GtkWidget *tablabel;
-     UriScheme u;
 
-     g_return_if_fail (CREAM_IS_NOTEBOOK (obj));
-     g_return_if_fail (uri_scheme_parse (&u, url));
-
-     module = cream_browser_get_protocol (app, u.scheme);
      webview = webview_new (module);
      CREAM_WEBVIEW (webview)->notebook = GTK_WIDGET (obj);
-     webview_load_uri (CREAM_WEBVIEW (webview), url);
 
      tablabel = g_object_new (CREAM_TYPE_NOTEBOOK_TAB_LABEL, NULL);
      gtk_widget_show_all (tablabel);
@@ -158,9 +156,64 @@ void notebook_tabopen (Notebook *obj, const gchar *url)
      g_signal_connect (G_OBJECT (webview), "title-changed",   G_CALLBACK (notebook_signal_title_changed_cb), obj);
      g_signal_connect (G_OBJECT (webview), "favicon-changed", G_CALLBACK (notebook_signal_favicon_changed_cb), obj);
 
+     return webview;
+}
+
+/*!
+ * \public \memberof Notebook
+ * @param obj A #Notebook object.
+ * @param url URL to load.
+ *
+ * Open URL in a new webview.
+ */
+void notebook_tabopen (Notebook *obj, const gchar *url)
+{
+     GObject *module;
+     GtkWidget *webview;
+     UriScheme u;
+
+     g_return_if_fail (CREAM_IS_NOTEBOOK (obj));
+     g_return_if_fail (uri_scheme_parse (&u, url));
+
+     module = cream_browser_get_protocol (app, u.scheme);
+     g_return_if_fail (module != NULL);
+
+     webview = notebook_append (obj, module);
+     session_tab_opened (obj, CREAM_WEBVIEW (webview), url);
+     webview_load_uri (CREAM_WEBVIEW (webview), url);
+
      gtk_widget_grab_focus (webview);
 }
 
+/*!
+ * \public \memberof Notebook
+ * @param obj A #Notebook object.
+ * @param items Back/forward list of the webview (see #CreamModuleHistoryItem).
+ * @param current Position of the item to load.
+ *
+ * Open a new webview with a back/forward list (used to restore a session).
+ */
+void notebook_tabrestore (Notebook *obj, GArray *items, guint current)
+{
+     CreamModuleHistoryItem *item;
+     GObject *module;
+     WebView *webview;
+     UriScheme u;
+
+     g_return_if_fail (CREAM_IS_NOTEBOOK (obj));
+     g_return_if_fail (current < items->len);
+
+     item = &g_array_index (items, CreamModuleHistoryItem, current);
+     g_return_if_fail (uri_scheme_parse (&u, item->uri));
+
+     module = cream_browser_get_protocol (app, u.scheme);
+     g_return_if_fail (module != NULL);
+
+     webview = CREAM_WEBVIEW (notebook_append (obj, module));
+     session_tab_opened (obj, webview, item->uri);
+     cream_module_set_history (CREAM_MODULE (webview->mod), webview->child, items, current);
+}
+
 /*!
  * \public \memberof Notebook
  * @param obj A #Notebook object.
@@ -172,6 +225,9 @@ void notebook_close (Notebook *obj, gint page)
 {
      GtkWidget *webview = g_object_ref (gtk_notebook_get_nth_page (GTK_NOTEBOOK (obj), page));
      GList *node = g_list_find (obj->webviews, webview);
+
+     session_tab_closed (CREAM_WEBVIEW (webview));
+
      obj->webviews = g_list_remove_link (obj->webviews, node);
      gtk_notebook_remove_page (GTK_NOTEBOOK (obj), page);
 
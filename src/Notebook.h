@@ -57,6 +57,7 @@ struct _Notebook
      /*< private >*/
      GtkNotebook parent;
 
+     guint id;           /*!< Identifier of the notebook in the session */
      GtkWidget *focus;   /*!< Focused widget */
      GList *webviews;    /*!< List of webviews opened */
 };
@@ -73,6 +74,7 @@ GtkWidget *notebook_new (void);
 GtkWidget *notebook_get_focus (Notebook *obj);
 void notebook_open (Notebook *obj, const gchar *url);
 void notebook_tabopen (Notebook *obj, const gchar *url);
+void notebook_tabrestore (Notebook *obj, GArray *items, guint current);
 void notebook_close (Notebook *obj, gint page);
 
 G_END_DECLS
@@ -39,6 +39,7 @@ struct _StatusbarPrivate
      GtkWidget *lstate;
      GtkWidget *llink;
      GtkWidget *lhistory;
+     GtkWidget *lmatches;
      GtkWidget *lscroll;
      GtkWidget *lprogress;
 };
@@ -77,6 +78,7 @@ static void statusbar_init (Statusbar *self)
      priv->lstate    = gtk_label_new (NULL);
      priv->llink     = gtk_label_new (NULL);
      priv->lhistory  = gtk_label_new (NULL);
+     priv->lmatches  = gtk_label_new (NULL);
      priv->lscroll   = gtk_label_new (NULL);
      priv->lprogress = gtk_progress_bar_new ();
 
@@ -85,6 +87,7 @@ static void statusbar_init (Statusbar *self)
      gtk_box_pack_start (GTK_BOX (priv->hbox), priv->lstate, FALSE, FALSE, 2);
      gtk_box_pack_start (GTK_BOX (priv->hbox), priv->llink, FALSE, FALSE, 2);
      gtk_box_pack_start (GTK_BOX (priv->hbox), priv->lhistory, FALSE, FALSE, 2);
+     gtk_box_pack_start (GTK_BOX (priv->hbox), priv->lmatches, FALSE, FALSE, 2);
      gtk_box_pack_end (GTK_BOX (priv->hbox), priv->lscroll, FALSE, FALSE, 2);
      gtk_box_pack_end (GTK_BOX (priv->hbox), priv->lprogress, FALSE, FALSE, 2);
      gtk_container_add (GTK_CONTAINER (self), priv->hbox);
@@ -108,6 +111,8 @@ static void statusbar_init (Statusbar *self)
 void statusbar_set_state (Statusbar *obj, CreamMode state)
 {
      StatusbarPrivate *priv;
+     const gchar *text;
+     gchar reg;
      g_return_if_fail (CREAM_IS_STATUSBAR (obj));
      priv = CREAM_STATUSBAR_GET_PRIVATE (obj);
 
@@ -115,30 +120,45 @@ void statusbar_set_state (Statusbar *obj, CreamMode state)
      switch (state)
      {
           case CREAM_MODE_INSERT:
-               gtk_label_set_text (GTK_LABEL (priv->lstate), _("-- INSERT --"));
+               text = _("-- INSERT --");
                break;
 
           case CREAM_MODE_SEARCH:
-               gtk_label_set_text (GTK_LABEL (priv->lstate), _("-- FIND --"));
+               text = _("-- FIND --");
                break;
 
           case CREAM_MODE_COMMAND:
-               gtk_label_set_text (GTK_LABEL (priv->lstate), _("-- CMD --"));
+               text = _("-- CMD --");
                break;
 
           case CREAM_MODE_EMBED:
-               gtk_label_set_text (GTK_LABEL (priv->lstate), _("-- EMBED --"));
+               text = _("-- EMBED --");
                break;
 
           case CREAM_MODE_CARET:
-               gtk_label_set_text (GTK_LABEL (priv->lstate), _("-- CARET --"));
+               text = _("-- CARET --");
+               break;
+
+          case CREAM_MODE_HINT:
+               text = _("-- HINT --");
                break;
 
           case CREAM_MODE_NORMAL:
           default:
-               gtk_label_set_text (GTK_LABEL (priv->lstate), NULL);
+               text = NULL;
                break;
      }
+
+     /* a macro is being recorded */
+     if ((reg = keybinds_recording ()) != 0)
+     {
+          gchar *str = (text ? g_strdup_printf (_("%s recording @%c"), text, reg) : g_strdup_printf (_("recording @%c"), reg));
+
+          gtk_label_set_text (GTK_LABEL (priv->lstate), str);
+          g_free (str);
+     }
+     else
+          gtk_label_set_text (GTK_LABEL (priv->lstate), text);
 }
 
 /*!
@@ -182,6 +202,32 @@ void statusbar_set_history (Statusbar *obj, gboolean can_go_back, gboolean can_g
           gtk_label_set_text (GTK_LABEL (priv->lhistory), NULL);
 }
 
+/*!
+ * \public \memberof Statusbar
+ * @param obj A #Statusbar object.
+ * @param n Number of matches of the search, or -1 to hide the counter.
+ * @param more \c TRUE if the matches were not all counted.
+ *
+ * Display the number of matches of the search in statusbar.
+ */
+void statusbar_set_matches (Statusbar *obj, gint n, gboolean more)
+{
+     StatusbarPrivate *priv;
+     gchar *txt;
+
+     g_return_if_fail (CREAM_IS_STATUSBAR (obj));
+     priv = CREAM_STATUSBAR_GET_PRIVATE (obj);
+
+     if (n >= 0)
+     {
+          txt = g_strdup_printf (ngettext ("[%d%s match]", "[%d%s matches]", n), n, (more ? "+" : ""));
+          gtk_label_set_text (GTK_LABEL (priv->lmatches), txt);
+          g_free (txt);
+     }
+     else
+          gtk_label_set_text (GTK_LABEL (priv->lmatches), NULL);
+}
+
 /*!
  * \public \memberof Statusbar
  * @param obj A #Statusbar object.
@@ -47,7 +47,8 @@ typedef enum
      CREAM_MODE_SEARCH  = 1 << 2,  /*!< Search mode (focus grabbed on #Inputbox) */
      CREAM_MODE_EMBED   = 1 << 3,  /*!< Embed mode (focus on a plugin from the #WebView) */
      CREAM_MODE_CARET   = 1 << 4,  /*!< Caret mode (focus on #WebView) */
-     CREAM_MODE_NORMAL  = 1 << 5   /*!< Normal mode */
+     CREAM_MODE_NORMAL  = 1 << 5,  /*!< Normal mode */
+     CREAM_MODE_HINT    = 1 << 6   /*!< Hint mode (labels on the clickable elements of the #WebView) */
 } CreamMode;
 
 G_BEGIN_DECLS
@@ -81,6 +82,7 @@ GtkWidget *statusbar_new (void);
 void statusbar_set_state (Statusbar *obj, CreamMode state);
 void statusbar_set_link (Statusbar *obj, const gchar *link);
 void statusbar_set_history (Statusbar *obj, gboolean can_go_back, gboolean can_go_forward);
+void statusbar_set_matches (Statusbar *obj, gint n, gboolean more);
 void statusbar_set_scroll (Statusbar *obj, gdouble progress);
 void statusbar_set_progress (Statusbar *obj, gdouble fraction);
 
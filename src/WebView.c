@@ -172,6 +172,9 @@ static void webview_class_init (WebViewClass *klass)
  */
 static void webview_init (WebView *obj)
 {
+     static guint last_id = 0;
+
+     obj->id    = ++last_id;
      obj->mod   = NULL;
      obj->child = NULL;
      obj->has_focus = FALSE;
@@ -410,6 +413,8 @@ static void webview_signal_uri_changed_cb (CreamModule *self, GtkWidget *webview
 
           if (w->uri) g_free (w->uri);
           w->uri = g_strdup (uri);
+
+          session_navigated (w);
      }
 
      if (GTK_WIDGET (w) == cream_browser_get_focused_webview (app))
@@ -430,6 +435,7 @@ static void webview_signal_uri_changed_cb (CreamModule *self, GtkWidget *webview
  * This function handles the signal <code>"title-changed"</code> which is emitted
  * when the loaded page changes its title.
  * This handler is able to modify the toplevel window and emit the signal \ref w-title-changed.
+ * The page is indexed for the full-text search.
  */
 static void webview_signal_title_changed_cb (CreamModule *self, GtkWidget *webview, const gchar *title, WebView *w)
 {
@@ -439,6 +445,11 @@ static void webview_signal_title_changed_cb (CreamModule *self, GtkWidget *webvi
 
           if (w->title) g_free (w->title);
           w->title = g_strdup (title);
+
+          session_navigated (w);
+
+          if (w->uri && app->search)
+               search_add (app->search, w->uri, w->title);
      }
 
      if (GTK_WIDGET (w) == cream_browser_get_focused_webview (app))
@@ -474,11 +485,21 @@ static void webview_signal_favicon_changed_cb (CreamModule *self, GtkWidget *web
  * This function handles the signal <code>"progress-changed"</code> which is emitted
  * on the page's loading.
  * This handler is able to modify the #Statusbar and emit the signal \ref w-status-changed.
+ * When the page is loaded, the visit is recorded in the history and the frecency ranking.
  */
 static void webview_signal_progress_changed_cb (CreamModule *self, GtkWidget *webview, gdouble progress, WebView *w)
 {
+     GError *error = NULL;
      gchar *status = NULL;
 
+     if (progress == 1 && webview == w->child && w->uri)
+     {
+          if (app->history && !history_add (app->history, w->uri, w->title, &error))
+               CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+
+          frecency_add (app->frecency.uris, w->uri, g_get_real_time ());
+     }
+
      if (progress == 0)
           status = g_strdup (_("Waiting for hostname..."));
      else if (progress == 1)
@@ -56,6 +56,7 @@ struct _WebView
      /*< private >*/
      GtkScrolledWindow parent;
 
+     guint id;
      gboolean has_focus;
      GObject *mod;
      GtkWidget *child;
@@ -0,0 +1,889 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+#include "archive.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/*!
+ * \addtogroup archive
+ * @{
+ */
+
+#define CREAM_ARCHIVE_ERROR        (cream_archive_error_quark ())
+
+typedef enum
+{
+     CREAM_ARCHIVE_ERROR_IO,
+     CREAM_ARCHIVE_ERROR_CORRUPT
+} CreamArchiveError;
+
+static GQuark cream_archive_error_quark (void)
+{
+     static GQuark domain = 0;
+
+     if (!domain)
+          domain = g_quark_from_string ("cream.history.archive");
+
+     return domain;
+}
+
+#define ARCHIVE_VERSION            1
+#define ARCHIVE_MAGIC              0x52414843     /* "CHAR" */
+
+#define ARCHIVE_BLOCK_SIZE         32768          /*!< Uncompressed bytes per block */
+#define ARCHIVE_BLOOM_BITS         10             /*!< Bits of the bloom filter per URI */
+#define ARCHIVE_BLOOM_PROBES       7              /*!< Bits set per URI */
+
+/*! Largest compressed size of \a n bytes (zlib's deflateBound) */
+#define ARCHIVE_BLOCK_BOUND(n)     ((n) + ((n) >> 12) + ((n) >> 14) + ((n) >> 25) + 13)
+
+/*!
+ * \struct ArchiveHeader
+ * Header of a segment. The compressed blocks follow, then the index:
+ * an #ArchiveBlock per block, the bloom filter and the first URI of
+ * each block (nul-terminated).
+ */
+typedef struct
+{
+     guint32 magic;      /*!< File's magic */
+     guint32 version;    /*!< Format version */
+     guint32 blocks;     /*!< Number of blocks */
+     guint32 records;    /*!< Number of visits */
+     guint64 index;      /*!< Offset of the index */
+     guint32 indexlen;   /*!< Length of the index */
+     guint32 bloom;      /*!< Length of the bloom filter (power of 2) */
+     gint64 oldest;      /*!< Time of the oldest visit */
+     gint64 newest;      /*!< Time of the newest visit */
+} ArchiveHeader;
+
+/*!
+ * \struct ArchiveBlock
+ * Entry of the index of a segment.
+ */
+typedef struct
+{
+     guint64 offset;     /*!< Offset of the compressed block */
+     guint32 size;       /*!< Compressed size */
+     guint32 length;     /*!< Uncompressed size */
+     guint32 key;        /*!< Offset of the block's first URI in the keys */
+     guint32 reserved;
+} ArchiveBlock;
+
+/*!
+ * \struct ArchiveRecord
+ * A visit in a block, followed by the URI and the title (both
+ * nul-terminated). Records are not aligned.
+ */
+typedef struct
+{
+     gint64 time;
+     guint32 hash;
+     guint32 visits;
+     guint32 urilen;
+     guint32 titlelen;
+} ArchiveRecord;
+
+/*!
+ * \struct ArchiveSegment
+ * A segment, and its index loaded in memory.
+ */
+typedef struct
+{
+     gchar *path;
+     guint seq;
+     gboolean gone;      /*!< The file was removed */
+
+     ArchiveHeader header;
+     gchar *index;
+     ArchiveBlock *blocks;
+     const guchar *bloom;
+     const gchar *keys;
+} ArchiveSegment;
+
+struct _HistoryArchive
+{
+     GPtrArray *segments;          /*!< Oldest first */
+     guint seq;                    /*!< Last sequence number */
+
+     /* last block decompressed by archive_lookup() */
+     ArchiveSegment *cseg;
+     guint cblock;
+     GByteArray *cdata;
+};
+
+#define ARCHIVE_SEGMENT(a,i)       ((ArchiveSegment *) g_ptr_array_index ((a)->segments, (i)))
+
+/* Compression */
+
+/*!
+ * @param conv A #GConverter.
+ * @param data Data to convert.
+ * @param len Length of \a data.
+ * @param out Array to append the result to.
+ * @param max Largest number of bytes to append.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Run a whole buffer through a converter, and reset it.
+ */
+static gboolean archive_convert (GConverter *conv, const guchar *data, gsize len, GByteArray *out, gsize max, GError **err)
+{
+     gsize start = out->len;
+
+     guchar buf[16384];
+     GConverterResult res;
+
+     do
+     {
+          gsize read = 0, written = 0;
+
+          res = g_converter_convert (conv, data, len, buf, sizeof (buf), G_CONVERTER_INPUT_AT_END, &read, &written, err);
+          if (res == G_CONVERTER_ERROR)
+          {
+               g_converter_reset (conv);
+               return FALSE;
+          }
+
+          if (out->len - start + written > max)
+          {
+               g_set_error (err, CREAM_ARCHIVE_ERROR, CREAM_ARCHIVE_ERROR_CORRUPT, _("Block too large"));
+               g_converter_reset (conv);
+               return FALSE;
+          }
+
+          g_byte_array_append (out, buf, written);
+          data += read;
+          len  -= read;
+     } while (res != G_CONVERTER_FINISHED);
+
+     g_converter_reset (conv);
+     return TRUE;
+}
+
+/* Bloom filter */
+
+/*!
+ * @param bloom The bloom filter.
+ * @param size Size of \a bloom in bytes (power of 2).
+ * @param hash Hash of the URI.
+ * @param set \c TRUE to add \a hash to the filter.
+ * @return \c TRUE if \a hash may be in the filter.
+ *
+ * Probe or fill the bloom filter, with double hashing.
+ */
+static gboolean archive_bloom (guchar *bloom, guint32 size, guint32 hash, gboolean set)
+{
+     guint32 mask = size * 8 - 1;
+     guint32 h2 = ((hash >> 16) | (hash << 16)) * 0x9E3779B1U | 1;
+     guint i;
+
+     for (i = 0; i < ARCHIVE_BLOOM_PROBES; ++i, hash += h2)
+     {
+          guint32 bit = hash & mask;
+
+          if (set)
+               bloom[bit >> 3] |= 1 << (bit & 7);
+          else if (!(bloom[bit >> 3] & (1 << (bit & 7))))
+               return FALSE;
+     }
+
+     return TRUE;
+}
+
+/* Writing */
+
+static gint archive_compare_uri (gconstpointer a, gconstpointer b, gpointer items)
+{
+     return strcmp (((const HistoryItem *) items)[*(guint *) a].uri, ((const HistoryItem *) items)[*(guint *) b].uri);
+}
+
+/*!
+ * @param title A title.
+ * @param max Largest length.
+ * @return Length of \a title, cut to \a max bytes on a character boundary.
+ */
+static guint32 archive_title_length (const gchar *title, gsize max)
+{
+     gsize len = strlen (title);
+
+     if (len <= max)
+          return len;
+
+     for (len = max; len > 0 && (title[len] & 0xC0) == 0x80; --len);
+
+     return len;
+}
+
+/*!
+ * @param conv A compressor.
+ * @param block Records of the current block.
+ * @param blocks Index of the blocks written so far.
+ * @param out The segment.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Compress the current block at the end of the segment.
+ */
+static gboolean archive_block_close (GConverter *conv, GByteArray *block, GArray *blocks, GByteArray *out, GError **err)
+{
+     ArchiveBlock *b = &g_array_index (blocks, ArchiveBlock, blocks->len - 1);
+
+     b->offset = out->len;
+     b->length = block->len;
+
+     if (!archive_convert (conv, block->data, block->len, out, G_MAXSIZE, err))
+          return FALSE;
+
+     b->size = out->len - b->offset;
+     g_byte_array_set_size (block, 0);
+
+     return TRUE;
+}
+
+/*!
+ * @param path Path of the new segment.
+ * @param items Visits to archive (one per URI).
+ * @param hashes Hash of the URI of each visit.
+ * @param n Number of visits.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Write a segment. Can be called from any thread. URIs must not be
+ * longer than #ARCHIVE_URI_MAX, titles are cut so that each record
+ * fits in a block.
+ */
+gboolean archive_write (const gchar *path, const HistoryItem *items, const guint32 *hashes, guint n, GError **err)
+{
+     ArchiveHeader header;
+     GArray *blocks = g_array_new (FALSE, FALSE, sizeof (ArchiveBlock));
+     GByteArray *out = g_byte_array_new ();
+     GByteArray *block = g_byte_array_sized_new (ARCHIVE_BLOCK_SIZE);
+     GString *keys = g_string_new (NULL);
+     GConverter *conv;
+     guchar *bloom;
+     guint *order;
+     guint i;
+     gboolean ret = FALSE;
+
+     g_return_val_if_fail (path != NULL, FALSE);
+     g_return_val_if_fail (n > 0, FALSE);
+
+     memset (&header, 0, sizeof (header));
+     header.magic   = ARCHIVE_MAGIC;
+     header.version = ARCHIVE_VERSION;
+     header.records = n;
+     header.oldest  = G_MAXINT64;
+     header.newest  = G_MININT64;
+
+     for (header.bloom = 64; header.bloom * 8 < (guint64) n * ARCHIVE_BLOOM_BITS; header.bloom *= 2);
+     bloom = g_malloc0 (header.bloom);
+
+     order = g_new (guint, n);
+     for (i = 0; i < n; ++i)
+          order[i] = i;
+     g_qsort_with_data (order, n, sizeof (guint), archive_compare_uri, (gpointer) items);
+
+     conv = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, -1));
+
+     /* room for the header */
+     g_byte_array_set_size (out, sizeof (ArchiveHeader));
+
+     for (i = 0; i < n; ++i)
+     {
+          const HistoryItem *item = &items[order[i]];
+          ArchiveRecord rec;
+
+          rec.time     = item->time;
+          rec.hash     = hashes[order[i]];
+          rec.visits   = item->visits;
+          rec.urilen   = MIN (strlen (item->uri), ARCHIVE_URI_MAX);
+          rec.titlelen = archive_title_length (item->title, ARCHIVE_BLOCK_SIZE - sizeof (rec) - rec.urilen - 2);
+
+          /* the record does not fit in the current block */
+          if (block->len > 0 && block->len + sizeof (rec) + rec.urilen + rec.titlelen + 2 > ARCHIVE_BLOCK_SIZE
+              && !archive_block_close (conv, block, blocks, out, err))
+               goto end;
+
+          /* new block, its first URI goes to the index */
+          if (block->len == 0)
+          {
+               ArchiveBlock b;
+
+               memset (&b, 0, sizeof (b));
+               b.key = keys->len;
+               g_string_append_len (keys, item->uri, rec.urilen);
+               g_string_append_c (keys, '\0');
+               g_array_append_val (blocks, b);
+          }
+
+          g_byte_array_append (block, (const guint8 *) &rec, sizeof (rec));
+          g_byte_array_append (block, (const guint8 *) item->uri, rec.urilen);
+          g_byte_array_append (block, (const guint8 *) "", 1);
+          g_byte_array_append (block, (const guint8 *) item->title, rec.titlelen);
+          g_byte_array_append (block, (const guint8 *) "", 1);
+
+          archive_bloom (bloom, header.bloom, rec.hash, TRUE);
+          header.oldest = MIN (header.oldest, item->time);
+          header.newest = MAX (header.newest, item->time);
+     }
+
+     if (!archive_block_close (conv, block, blocks, out, err))
+          goto end;
+
+     /* index */
+     header.blocks   = blocks->len;
+     header.index    = out->len;
+     header.indexlen = blocks->len * sizeof (ArchiveBlock) + header.bloom + keys->len;
+
+     g_byte_array_append (out, (const guint8 *) blocks->data, blocks->len * sizeof (ArchiveBlock));
+     g_byte_array_append (out, bloom, header.bloom);
+     g_byte_array_append (out, (const guint8 *) keys->str, keys->len);
+     memcpy (out->data, &header, sizeof (header));
+
+     if ((ret = g_file_set_contents (path, (const gchar *) out->data, out->len, err)))
+          quota_account (path, out->len);
+
+end:
+     g_object_unref (conv);
+     g_free (order);
+     g_free (bloom);
+     g_string_free (keys, TRUE);
+     g_byte_array_free (block, TRUE);
+     g_byte_array_free (out, TRUE);
+     g_array_free (blocks, TRUE);
+
+     return ret;
+}
+
+/* Reading */
+
+/*!
+ * @param s An #ArchiveSegment.
+ */
+static void archive_segment_free (ArchiveSegment *s)
+{
+     g_free (s->index);
+     g_free (s->path);
+     g_free (s);
+}
+
+/*!
+ * @param fd File descriptor.
+ * @param buf Buffer to fill.
+ * @param len Bytes to read.
+ * @param offset Offset in the file.
+ * @return \c TRUE if \a len bytes were read.
+ */
+static gboolean archive_pread (gint fd, gpointer buf, gsize len, guint64 offset)
+{
+     gsize done = 0;
+
+     while (done < len)
+     {
+          gssize ret = pread (fd, (gchar *) buf + done, len - done, offset + done);
+
+          if (ret < 0 && errno == EINTR)
+               continue;
+          else if (ret <= 0)
+               return FALSE;
+
+          done += ret;
+     }
+
+     return TRUE;
+}
+
+/*!
+ * @param s An #ArchiveSegment.
+ * @return \c TRUE if every block of \a s lies between the header and
+ * the index, and is not larger than a block written by archive_write().
+ */
+static gboolean archive_segment_check (ArchiveSegment *s)
+{
+     guint i;
+
+     for (i = 0; i < s->header.blocks; ++i)
+     {
+          ArchiveBlock *b = &s->blocks[i];
+
+          if (b->length == 0 || b->length > ARCHIVE_BLOCK_SIZE
+              || b->size == 0 || b->size > ARCHIVE_BLOCK_BOUND (b->length)
+              || b->offset < sizeof (ArchiveHeader)
+              || b->size > s->header.index || b->offset > s->header.index - b->size)
+               return FALSE;
+     }
+
+     return TRUE;
+}
+
+/*!
+ * @param path Path to the segment.
+ * @param seq Sequence number of the segment.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return A new #ArchiveSegment, or \c NULL on failure.
+ *
+ * Load the header and the index of a segment, and check that its
+ * blocks can be read safely.
+ */
+static ArchiveSegment *archive_segment_open (const gchar *path, guint seq, GError **err)
+{
+     ArchiveSegment *s = g_new0 (ArchiveSegment, 1);
+     ArchiveHeader *hd = &s->header;
+     struct stat st;
+     gint fd;
+
+     s->path = g_strdup (path);
+     s->seq  = seq;
+
+     if ((fd = open (path, O_RDONLY)) < 0)
+     {
+          g_set_error (err, CREAM_ARCHIVE_ERROR, CREAM_ARCHIVE_ERROR_IO, "%s: %s", path, g_strerror (errno));
+          archive_segment_free (s);
+          return NULL;
+     }
+
+     if (fstat (fd, &st) != 0 || !archive_pread (fd, hd, sizeof (ArchiveHeader), 0)
+         || hd->magic != ARCHIVE_MAGIC || hd->version != ARCHIVE_VERSION
+         || hd->blocks == 0 || hd->bloom == 0 || (hd->bloom & (hd->bloom - 1)) != 0
+         || hd->indexlen < (guint64) hd->blocks * sizeof (ArchiveBlock) + hd->bloom + 1
+         || hd->index < sizeof (ArchiveHeader) || hd->index > (guint64) st.st_size
+         || hd->indexlen > (guint64) st.st_size - hd->index)
+     {
+          g_set_error (err, CREAM_ARCHIVE_ERROR, CREAM_ARCHIVE_ERROR_CORRUPT, _("%s: Corrupted history segment"), path);
+          close (fd);
+          archive_segment_free (s);
+          return NULL;
+     }
+
+     s->index = g_malloc (hd->indexlen + 1);
+     if (!archive_pread (fd, s->index, hd->indexlen, hd->index))
+     {
+          g_set_error (err, CREAM_ARCHIVE_ERROR, CREAM_ARCHIVE_ERROR_CORRUPT, _("%s: Corrupted history segment"), path);
+          close (fd);
+          archive_segment_free (s);
+          return NULL;
+     }
+
+     close (fd);
+
+     /* keys are nul-terminated, even in a truncated index */
+     s->index[hd->indexlen] = '\0';
+
+     s->blocks = (ArchiveBlock *) s->index;
+     s->bloom  = (const guchar *) (s->index + hd->blocks * sizeof (ArchiveBlock));
+     s->keys   = (const gchar *) (s->bloom + hd->bloom);
+
+     if (!archive_segment_check (s))
+     {
+          g_set_error (err, CREAM_ARCHIVE_ERROR, CREAM_ARCHIVE_ERROR_CORRUPT, _("%s: Corrupted history segment"), path);
+          archive_segment_free (s);
+          return NULL;
+     }
+
+     return s;
+}
+
+/*!
+ * @param s An #ArchiveSegment.
+ * @param i A block of \a s.
+ * @return First URI of the block.
+ */
+static const gchar *archive_segment_key (ArchiveSegment *s, guint i)
+{
+     guint32 max = s->header.indexlen - (s->keys - s->index);
+
+     return s->keys + MIN (s->blocks[i].key, max);
+}
+
+/*!
+ * @param s An #ArchiveSegment.
+ * @param uri An URI.
+ * @return The last block whose first URI is not greater than \a uri,
+ * or -1 if \a uri comes before the first block.
+ */
+static gint archive_segment_find (ArchiveSegment *s, const gchar *uri)
+{
+     guint lo = 0, hi = s->header.blocks;
+
+     while (lo < hi)
+     {
+          guint mid = lo + (hi - lo) / 2;
+
+          if (strcmp (archive_segment_key (s, mid), uri) <= 0)
+               lo = mid + 1;
+          else
+               hi = mid;
+     }
+
+     return (gint) lo - 1;
+}
+
+/*!
+ * @param s An #ArchiveSegment.
+ * @param i A block of \a s.
+ * @param out Array to fill with the decompressed block.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Read and decompress a block. If the segment was removed, it is
+ * marked as gone and ignored from now on.
+ */
+static gboolean archive_segment_read (ArchiveSegment *s, guint i, GByteArray *out)
+{
+     ArchiveBlock *b = &s->blocks[i];
+     GConverter *conv;
+     GError *error = NULL;
+     gpointer buf;
+     gint fd;
+     gboolean ret;
+
+     g_byte_array_set_size (out, 0);
+
+     if ((fd = open (s->path, O_RDONLY)) < 0)
+     {
+          if (errno == ENOENT)
+               s->gone = TRUE;
+          return FALSE;
+     }
+
+     buf = g_malloc (b->size);
+
+     if (!archive_pread (fd, buf, b->size, b->offset))
+     {
+          close (fd);
+          g_free (buf);
+          return FALSE;
+     }
+
+     close (fd);
+
+     conv = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW));
+     ret = archive_convert (conv, buf, b->size, out, b->length, &error);
+     g_object_unref (conv);
+     g_free (buf);
+
+     if (!ret)
+     {
+          g_prefix_error (&error, "%s: ", s->path);
+          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+     }
+
+     return ret && out->len == b->length;
+}
+
+/*!
+ * @param p Start of a record.
+ * @param end End of the block.
+ * @param item The #HistoryItem to fill.
+ * @param hash Hash of the URI.
+ * @return The next record, or \c NULL if there is no valid record at \a p.
+ */
+static const gchar *archive_record (const gchar *p, const gchar *end, HistoryItem *item, guint32 *hash)
+{
+     ArchiveRecord rec;
+
+     if (end - p < (gssize) sizeof (rec))
+          return NULL;
+
+     memcpy (&rec, p, sizeof (rec));
+     p += sizeof (rec);
+
+     if ((guint64) (end - p) < (guint64) rec.urilen + rec.titlelen + 2)
+          return NULL;
+
+     item->uri    = p;
+     item->title  = p + rec.urilen + 1;
+     item->time   = rec.time;
+     item->visits = rec.visits;
+     *hash        = rec.hash;
+
+     return p + rec.urilen + rec.titlelen + 2;
+}
+
+/*!
+ * @param path Path to the segment.
+ * @return Sequence number of the segment, or 0 if \a path is not a segment.
+ */
+static guint archive_seq (const gchar *path)
+{
+     gchar *base = g_path_get_basename (path);
+     gchar *end = NULL;
+     guint64 seq = 0;
+
+     if (g_str_has_prefix (base, "archive-") && g_ascii_isdigit (base[8]))
+     {
+          seq = g_ascii_strtoull (base + 8, &end, 10);
+
+          if (*end != '\0' || seq > G_MAXUINT)
+               seq = 0;
+     }
+
+     g_free (base);
+     return seq;
+}
+
+static gint archive_compare_seq (gconstpointer a, gconstpointer b)
+{
+     guint sa = (*(ArchiveSegment **) a)->seq, sb = (*(ArchiveSegment **) b)->seq;
+
+     return (sa < sb ? -1 : sa > sb);
+}
+
+/*!
+ * @return A new #HistoryArchive.
+ *
+ * Load the index of every segment of the current profile. Corrupted
+ * segments are reported and ignored.
+ */
+HistoryArchive *archive_open (void)
+{
+     HistoryArchive *a = g_new0 (HistoryArchive, 1);
+     gchar *dirpath = cache_path (CACHE_TYPE_HISTORY, NULL);
+     GDir *dir;
+
+     a->segments = g_ptr_array_new_with_free_func ((GDestroyNotify) archive_segment_free);
+     a->cdata    = g_byte_array_new ();
+
+     if ((dir = g_dir_open (dirpath, 0, NULL)) != NULL)
+     {
+          const gchar *name;
+
+          while ((name = g_dir_read_name (dir)) != NULL)
+          {
+               gchar *path = g_build_filename (dirpath, name, NULL);
+               guint seq = archive_seq (path);
+               GError *error = NULL;
+
+               if (seq > 0)
+               {
+                    ArchiveSegment *s = archive_segment_open (path, seq, &error);
+
+                    if (s != NULL)
+                         g_ptr_array_add (a->segments, s);
+                    else
+                         CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+
+                    a->seq = MAX (a->seq, seq);
+               }
+
+               g_free (path);
+          }
+
+          g_dir_close (dir);
+     }
+
+     g_ptr_array_sort (a->segments, archive_compare_seq);
+     g_free (dirpath);
+
+     return a;
+}
+
+/*!
+ * @param a A #HistoryArchive.
+ */
+void archive_close (HistoryArchive *a)
+{
+     g_return_if_fail (a != NULL);
+
+     g_ptr_array_free (a->segments, TRUE);
+     g_byte_array_free (a->cdata, TRUE);
+     g_free (a);
+}
+
+/*!
+ * @param a A #HistoryArchive.
+ * @return Path of the next segment (must be freed).
+ */
+gchar *archive_next_path (HistoryArchive *a)
+{
+     gchar *name, *path;
+
+     g_return_val_if_fail (a != NULL, NULL);
+
+     name = g_strdup_printf ("archive-%08u", ++a->seq);
+     path = cache_path (CACHE_TYPE_HISTORY, name);
+     g_free (name);
+
+     return path;
+}
+
+/*!
+ * @param a A #HistoryArchive.
+ * @param path Path of a segment written by archive_write().
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Add a new segment, newer than all the others.
+ */
+gboolean archive_add (HistoryArchive *a, const gchar *path, GError **err)
+{
+     ArchiveSegment *s;
+
+     g_return_val_if_fail (a != NULL, FALSE);
+     g_return_val_if_fail (path != NULL, FALSE);
+
+     if ((s = archive_segment_open (path, archive_seq (path), err)) == NULL)
+          return FALSE;
+
+     g_ptr_array_add (a->segments, s);
+     return TRUE;
+}
+
+/*!
+ * @param a A #HistoryArchive.
+ * @return Number of segments, newest last.
+ */
+guint archive_segments (HistoryArchive *a)
+{
+     g_return_val_if_fail (a != NULL, 0);
+     return a->segments->len;
+}
+
+/*!
+ * @param a A #HistoryArchive.
+ * @param seg A segment.
+ * @return Time of the newest visit of the segment, or \c G_MININT64 if it was removed.
+ */
+gint64 archive_newest (HistoryArchive *a, guint seg)
+{
+     g_return_val_if_fail (a != NULL && seg < a->segments->len, G_MININT64);
+
+     return (ARCHIVE_SEGMENT (a, seg)->gone ? G_MININT64 : ARCHIVE_SEGMENT (a, seg)->header.newest);
+}
+
+/*!
+ * @param a A #HistoryArchive.
+ * @param above Oldest segment to look in.
+ * @param uri URI to look for.
+ * @param hash Hash of \a uri.
+ * @param item The #HistoryItem to fill, or \c NULL.
+ * @return \c TRUE if \a uri was found.
+ *
+ * Get the latest visit of an URI, looking in segments from the newest
+ * to \a above. Strings of \a item are valid until the next call.
+ */
+gboolean archive_lookup (HistoryArchive *a, guint above, const gchar *uri, guint32 hash, HistoryItem *item)
+{
+     guint i;
+
+     g_return_val_if_fail (a != NULL, FALSE);
+     g_return_val_if_fail (uri != NULL, FALSE);
+
+     for (i = a->segments->len; i > above; --i)
+     {
+          ArchiveSegment *s = ARCHIVE_SEGMENT (a, i - 1);
+          const gchar *p, *end;
+          gint b;
+
+          if (s->gone || !archive_bloom ((guchar *) s->bloom, s->header.bloom, hash, FALSE))
+               continue;
+
+          if ((b = archive_segment_find (s, uri)) < 0)
+               continue;
+
+          if (a->cseg != s || a->cblock != (guint) b)
+          {
+               a->cseg = NULL;
+
+               if (!archive_segment_read (s, b, a->cdata))
+                    continue;
+
+               a->cseg   = s;
+               a->cblock = b;
+          }
+
+          p   = (const gchar *) a->cdata->data;
+          end = p + a->cdata->len;
+
+          while (p != NULL && p < end)
+          {
+               HistoryItem found;
+               guint32 h;
+
+               if ((p = archive_record (p, end, &found, &h)) != NULL && h == hash && g_str_equal (found.uri, uri))
+               {
+                    if (item != NULL)
+                         *item = found;
+                    return TRUE;
+               }
+          }
+     }
+
+     return FALSE;
+}
+
+/*!
+ * @param a A #HistoryArchive.
+ * @param seg A segment.
+ * @param from First URI to iterate over, or \c NULL.
+ * @param func Function to call on each visit, sorted by URI.
+ * @param data User data for \a func.
+ *
+ * Iterate over the visits of a segment, starting at the block which
+ * may contain \a from (so \a func may see a few URIs before it).
+ */
+void archive_foreach (HistoryArchive *a, guint seg, const gchar *from, ArchiveForeachFunc func, gpointer data)
+{
+     ArchiveSegment *s;
+     GByteArray *buf;
+     guint i;
+     gint b = 0;
+
+     g_return_if_fail (a != NULL && seg < a->segments->len);
+     g_return_if_fail (func != NULL);
+
+     s = ARCHIVE_SEGMENT (a, seg);
+
+     if (s->gone)
+          return;
+
+     if (from != NULL)
+          b = MAX (archive_segment_find (s, from), 0);
+
+     buf = g_byte_array_new ();
+
+     for (i = b; i < s->header.blocks && archive_segment_read (s, i, buf); ++i)
+     {
+          const gchar *p = (const gchar *) buf->data;
+          const gchar *end = p + buf->len;
+          HistoryItem item;
+          guint32 hash;
+
+          while (p < end && (p = archive_record (p, end, &item, &hash)) != NULL)
+          {
+               if (!func (&item, hash, data))
+               {
+                    g_byte_array_free (buf, TRUE);
+                    return;
+               }
+          }
+     }
+
+     g_byte_array_free (buf, TRUE);
+}
+
+/*! @} */
@@ -0,0 +1,80 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __ARCHIVE_H
+#define __ARCHIVE_H
+
+/*!
+ * \defgroup archive Archive
+ * \ingroup history
+ * Cold segments of the browsing history.
+ *
+ * When the log of the history grows too big, its oldest visits are
+ * moved to a new segment, stored in the #CACHE_TYPE_HISTORY directory
+ * as <code>archive-NNNNNNNN</code>. A segment keeps the latest visit
+ * of each of its URIs, sorted by URI, in blocks compressed with zlib.
+ *
+ * Only a small index is kept in memory for each segment: the first URI
+ * of each block, and a bloom filter of the URIs' hashes. Thus, looking
+ * for an URI decompresses at most one block per segment, and usually
+ * none at all.
+ *
+ * Segments are never modified, the oldest ones may be removed by the
+ * quota manager.
+ *
+ * @{
+ */
+
+#include <glib.h>
+#include "history.h"
+
+#define ARCHIVE_URI_MAX            16384     /*!< Longest URI kept in a segment */
+
+typedef struct _HistoryArchive HistoryArchive;
+
+/*!
+ * \fn gboolean (*ArchiveForeachFunc) (const HistoryItem *item, guint32 hash, gpointer data)
+ * @param item The visit (strings are only valid during the call).
+ * @param hash Hash of the URI.
+ * @param data User data.
+ * @return \c FALSE to stop the iteration.
+ */
+typedef gboolean (*ArchiveForeachFunc) (const HistoryItem *item, guint32 hash, gpointer data);
+
+HistoryArchive *archive_open (void);
+void archive_close (HistoryArchive *a);
+
+gchar *archive_next_path (HistoryArchive *a);
+gboolean archive_write (const gchar *path, const HistoryItem *items, const guint32 *hashes, guint n, GError **err);
+gboolean archive_add (HistoryArchive *a, const gchar *path, GError **err);
+
+guint archive_segments (HistoryArchive *a);
+gint64 archive_newest (HistoryArchive *a, guint seg);
+gboolean archive_lookup (HistoryArchive *a, guint above, const gchar *uri, guint32 hash, HistoryItem *item);
+void archive_foreach (HistoryArchive *a, guint seg, const gchar *from, ArchiveForeachFunc func, gpointer data);
+
+/*! @} */
+
+#endif /* __ARCHIVE_H */
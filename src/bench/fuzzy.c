@@ -0,0 +1,155 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ * Microbenchmark of the fuzzy matcher (see \ref fuzzy).
+ *
+ *   bench-fuzzy [URIS]
+ *
+ * URIS is a file with one URI per line. Without it, 1M URIs are made up
+ * from a few hosts and words. Each pattern is run against the corpus:
+ * the masks are filtered by fuzzy_filter() and by a plain loop, then the
+ * candidates left are scored by fuzzy_match().
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../fuzzy.h"
+
+#define BENCH_CORPUS          1000000   /* URIs made up without a file */
+#define BENCH_ROUNDS          10        /* Runs of each pattern, the best one counts */
+
+static const gchar *hosts[] = { "github.com", "en.wikipedia.org", "news.ycombinator.com", "docs.python.org", "developer.mozilla.org", "www.youtube.com", "stackoverflow.com", "lwn.net" };
+static const gchar *words[] = { "index", "issues", "pulls", "wiki", "questions", "watch", "docs", "Reference", "getElementById", "library", "tags", "blob", "master", "src", "CHANGES" };
+static const gchar *patterns[] = { "gh", "wiki", "getelem", "ghissues", "soq", "lwnnet", "zzz" };
+
+static GPtrArray *bench_corpus (const gchar *path)
+{
+     GPtrArray *uris = g_ptr_array_new_with_free_func (g_free);
+     GRand *rand = g_rand_new_with_seed (42);
+     guint i;
+
+     if (path != NULL)
+     {
+          gchar *contents, **lines;
+          GError *error = NULL;
+
+          if (!g_file_get_contents (path, &contents, NULL, &error))
+          {
+               g_printerr ("%s\n", error->message);
+               exit (EXIT_FAILURE);
+          }
+
+          lines = g_strsplit (contents, "\n", -1);
+
+          for (i = 0; lines[i] != NULL; ++i)
+          {
+               if (*g_strchomp (lines[i]) != '\0')
+                    g_ptr_array_add (uris, g_strdup (lines[i]));
+          }
+
+          g_strfreev (lines);
+          g_free (contents);
+     }
+     else
+     {
+          for (i = 0; i < BENCH_CORPUS; ++i)
+          {
+               g_ptr_array_add (uris, g_strdup_printf ("https://%s/%s/%s/%u",
+                                                       hosts[g_rand_int_range (rand, 0, G_N_ELEMENTS (hosts))],
+                                                       words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))],
+                                                       words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))],
+                                                       g_rand_int (rand)));
+          }
+     }
+
+     g_rand_free (rand);
+     return uris;
+}
+
+int main (int argc, char **argv)
+{
+     GPtrArray *uris = bench_corpus (argc > 1 ? argv[1] : NULL);
+     guint64 *masks = g_new (guint64, uris->len);
+     guint *left = g_new (guint, uris->len);
+     GTimer *timer = g_timer_new ();
+     gdouble t;
+     guint i, j, r;
+
+     g_timer_start (timer);
+
+     for (i = 0; i < uris->len; ++i)
+          masks[i] = fuzzy_mask (g_ptr_array_index (uris, i));
+
+     t = g_timer_elapsed (timer, NULL);
+     printf ("%u URIs, masks in %.1f ms\n\n", uris->len, t * 1000);
+     printf ("%-10s %9s %9s %12s %12s %12s\n", "pattern", "left", "matches", "filter (ms)", "scalar (ms)", "match (ms)");
+
+     for (j = 0; j < G_N_ELEMENTS (patterns); ++j)
+     {
+          guint64 mask = fuzzy_mask (patterns[j]);
+          gdouble filter = G_MAXDOUBLE, scalar = G_MAXDOUBLE, match = G_MAXDOUBLE;
+          guint n = 0, k = 0, matches = 0;
+
+          for (r = 0; r < BENCH_ROUNDS; ++r)
+          {
+               g_timer_start (timer);
+               n = fuzzy_filter (masks, uris->len, mask, left);
+               filter = MIN (filter, g_timer_elapsed (timer, NULL));
+
+               /* what fuzzy_filter() does without SIMD */
+               g_timer_start (timer);
+               for (i = 0, k = 0; i < uris->len; ++i)
+               {
+                    if ((masks[i] & mask) == mask)
+                         left[k++] = i;
+               }
+               scalar = MIN (scalar, g_timer_elapsed (timer, NULL));
+
+               g_timer_start (timer);
+               for (i = 0, matches = 0; i < k; ++i)
+               {
+                    gint score;
+
+                    if (fuzzy_match (patterns[j], g_ptr_array_index (uris, left[i]), &score))
+                         matches++;
+               }
+               match = MIN (match, g_timer_elapsed (timer, NULL));
+          }
+
+          g_assert (n == k);
+          printf ("%-10s %9u %9u %12.2f %12.2f %12.2f\n", patterns[j], n, matches, filter * 1000, scalar * 1000, match * 1000);
+     }
+
+     g_timer_destroy (timer);
+     g_free (left);
+     g_free (masks);
+     g_ptr_array_free (uris, TRUE);
+
+     return EXIT_SUCCESS;
+}
@@ -0,0 +1,263 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ * Microbenchmark of the member dispatch of the bound types (see
+ * luaI_dispatch()).
+ *
+ *   bench-lua [ACCESSES]
+ *
+ * Each access is timed in a lua loop (10M times by default), on types
+ * registered by LUAL_REGISTER_DECL ("after") and on the same types
+ * registered with the previous handlers, copied below ("before"): a
+ * lookup in a table of getters or setters, then in the methods.
+ * The cost of the empty loop is subtracted.
+ */
+
+#include "../local.h"
+
+#define BENCH_ACCESSES        10000000  /* Default number of accesses */
+#define BENCH_ROUNDS          5         /* Runs of each loop, the best one counts */
+
+typedef struct
+{
+     gpointer obj;
+     int count;
+     gboolean flag;
+} BenchObject;
+
+static int bench_uri (lua_State *L)
+{
+     lua_pushliteral (L, "http://www.example.com/");
+     return 1;
+}
+
+/* "Object": getters, setters and methods */
+
+static const luaL_reg cream_object_methods[] =
+{
+     { "uri", bench_uri },
+     { NULL, NULL }
+};
+
+static const luaL_reg cream_object_meta[] =
+{
+     { NULL, NULL }
+};
+
+static const luaI_reg cream_object_getters[] =
+{
+     { "count", luaI_getint,  G_STRUCT_OFFSET (BenchObject, count) },
+     { "flag",  luaI_getbool, G_STRUCT_OFFSET (BenchObject, flag) },
+     { NULL, NULL, 0 }
+};
+
+static const luaI_reg cream_object_setters[] =
+{
+     { "count", luaI_setint,  G_STRUCT_OFFSET (BenchObject, count) },
+     { "flag",  luaI_setbool, G_STRUCT_OFFSET (BenchObject, flag) },
+     { NULL, NULL, 0 }
+};
+
+LUAL_REGISTER_DECL (object, "Object")
+
+/* "View": methods only, like WebView */
+
+#define cream_view_methods    cream_object_methods
+#define cream_view_meta       cream_object_meta
+
+static const luaI_reg cream_view_getters[] =
+{
+     { NULL, NULL, 0 }
+};
+
+#define cream_view_setters    cream_view_getters
+
+LUAL_REGISTER_DECL (view, "View")
+
+/* previous handlers */
+
+static void bench_old_add (lua_State *L, const luaI_reg *l)
+{
+     for (; l->name; ++l)
+     {
+          lua_pushstring (L, l->name);
+          lua_pushlightuserdata (L, (void*) l);
+          lua_settable (L, -3);
+     }
+}
+
+static int bench_old_call (lua_State *L)
+{
+     luaI_reg *m = (luaI_reg*) lua_touserdata (L, -1);
+     lua_pop (L, 1);
+     luaL_checktype (L, 1, LUA_TUSERDATA);
+     return m->func (L, (void *)((char *) lua_touserdata (L, 1) + m->offset));
+}
+
+static int bench_old_index (lua_State *L)
+{
+     lua_pushvalue (L, 2);
+     lua_rawget (L, lua_upvalueindex (1));
+     if (!lua_islightuserdata (L, -1))
+     {
+          lua_pop (L, 1);
+          lua_pushvalue (L, 2);
+          lua_gettable (L, lua_upvalueindex (2));
+          if (lua_isnil (L, -1))
+               luaL_error (L, "cannot get member '%s'", lua_tostring (L, 2));
+          return 1;
+     }
+
+     return bench_old_call (L);
+}
+
+static int bench_old_newindex (lua_State *L)
+{
+     lua_pushvalue (L, 2);
+     lua_rawget (L, lua_upvalueindex (1));
+     if (!lua_islightuserdata (L, -1))
+          luaL_error (L, "cannot set member '%s'", lua_tostring (L, 2));
+     return bench_old_call (L);
+}
+
+static void bench_old_register (lua_State *L, const char *tname, const luaI_reg *getters, const luaI_reg *setters)
+{
+     int metatable, methods;
+
+     luaL_openlib (L, tname, cream_object_methods, 0);
+     methods = lua_gettop (L);
+
+     luaL_newmetatable (L, tname);
+     metatable = lua_gettop (L);
+
+     lua_pushliteral (L, "__index");
+     lua_newtable (L);
+     bench_old_add (L, getters);
+     lua_pushvalue (L, methods);
+     lua_pushcclosure (L, bench_old_index, 2);
+     lua_rawset (L, metatable);
+
+     lua_pushliteral (L, "__newindex");
+     lua_newtable (L);
+     bench_old_add (L, setters);
+     lua_pushcclosure (L, bench_old_newindex, 1);
+     lua_rawset (L, metatable);
+
+     lua_pop (L, 2);
+}
+
+/* loops */
+
+static const struct
+{
+     const gchar *name;
+     const gchar *type;
+     const gchar *body;
+} accesses[] =
+{
+     { "w:uri ()",      "View",   "x = o:uri ()" },
+     { "o:uri ()",      "Object", "x = o:uri ()" },
+     { "o.count",       "Object", "x = o.count" },
+     { "o.count = i",   "Object", "o.count = i" }
+};
+
+/*!
+ * @return Best time of the loop, in seconds.
+ */
+static gdouble bench_loop (lua_State *L, const gchar *type, const gchar *body, guint n)
+{
+     GTimer *timer = g_timer_new ();
+     gchar *chunk = g_strdup_printf ("local o, n = ... local x for i = 1, n do %s end", body);
+     gdouble best = G_MAXDOUBLE;
+     BenchObject *obj;
+     guint r;
+
+     if (luaL_loadstring (L, chunk) != 0)
+          g_error ("%s", lua_tostring (L, -1));
+
+     for (r = 0; r < BENCH_ROUNDS; ++r)
+     {
+          lua_pushvalue (L, -1);
+
+          obj = lua_newuserdata (L, sizeof (BenchObject));
+          memset (obj, 0, sizeof (BenchObject));
+          luaL_getmetatable (L, type);
+          lua_setmetatable (L, -2);
+
+          lua_pushnumber (L, n);
+
+          g_timer_start (timer);
+          if (lua_pcall (L, 2, 0, 0) != 0)
+               g_error ("%s", lua_tostring (L, -1));
+          best = MIN (best, g_timer_elapsed (timer, NULL));
+     }
+
+     lua_pop (L, 1);
+     g_free (chunk);
+     g_timer_destroy (timer);
+
+     return best;
+}
+
+int main (int argc, char **argv)
+{
+     guint n = (argc > 1 ? strtoul (argv[1], NULL, 10) : BENCH_ACCESSES);
+     lua_State *before = luaL_newstate ();
+     lua_State *after = luaL_newstate ();
+     gdouble empty[2];
+     guint i;
+
+     luaL_openlibs (before);
+     luaL_openlibs (after);
+
+     bench_old_register (before, "Object", cream_object_getters, cream_object_setters);
+     bench_old_register (before, "View", cream_view_getters, cream_view_setters);
+
+     luaL_object_register (after);
+     luaL_view_register (after);
+     lua_settop (after, 0);
+
+     empty[0] = bench_loop (before, "Object", "", MAX (n, 1));
+     empty[1] = bench_loop (after, "Object", "", MAX (n, 1));
+
+     printf ("%u accesses, ns per access\n\n", n);
+     printf ("%-14s %10s %10s\n", "access", "before", "after");
+
+     for (i = 0; i < G_N_ELEMENTS (accesses); ++i)
+     {
+          gdouble t[2];
+
+          t[0] = bench_loop (before, accesses[i].type, accesses[i].body, MAX (n, 1)) - empty[0];
+          t[1] = bench_loop (after, accesses[i].type, accesses[i].body, MAX (n, 1)) - empty[1];
+
+          printf ("%-14s %10.2f %10.2f\n", accesses[i].name, t[0] * 1e9 / MAX (n, 1), t[1] * 1e9 / MAX (n, 1));
+     }
+
+     lua_close (before);
+     lua_close (after);
+
+     return EXIT_SUCCESS;
+}
@@ -25,6 +25,77 @@
 
 #include "local.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/*!
+ * \addtogroup cache
+ * @{
+ */
+
+#define CREAM_CACHE_ERROR          (cream_cache_error_quark ())
+
+typedef enum
+{
+     CREAM_CACHE_ERROR_IO,
+     CREAM_CACHE_ERROR_FAILED
+} CreamCacheError;
+
+static GQuark cream_cache_error_quark (void)
+{
+     static GQuark domain = 0;
+
+     if (!domain)
+          domain = g_quark_from_string ("cream.cache");
+
+     return domain;
+}
+
+#define CACHE_FLUSH_SIZE           65536          /*!< Pending bytes before flushing */
+#define CACHE_FLUSH_DELAY          1              /*!< Seconds before flushing pending data */
+
+typedef enum
+{
+     CACHE_JOB_APPEND,
+     CACHE_JOB_REWRITE,
+     CACHE_JOB_UNLINK
+} CacheJobType;
+
+/*!
+ * \struct CacheJob
+ * Data to append to a file, or to replace its content with, or a file
+ * to remove. A job without path stops the writer.
+ */
+typedef struct
+{
+     CacheJobType type;
+     gchar *path;
+     GString *data;
+} CacheJob;
+
+/*!
+ * \struct CacheFile
+ * A file opened by the writer.
+ */
+typedef struct
+{
+     gchar *path;
+     gint fd;
+     GString *pending;
+} CacheFile;
+
+static GThread *writer = NULL;
+static GAsyncQueue *jobs = NULL;
+static GAsyncQueue *errors = NULL;
+static gboolean sync_writes = FALSE;
+static gboolean closed = FALSE;
+static GStaticMutex writer_lock = G_STATIC_MUTEX_INIT;
+
+/*!
+ * @param type Category of the cache.
+ * @param file File's name in the category (ignored for #CACHE_TYPE_COMMANDS).
+ * @return Path to the cache file (must be freed).
+ */
 gchar *cache_path (CacheType type, const gchar *file)
 {
      gchar *ret = NULL;
@@ -56,56 +127,704 @@ gchar *cache_path (CacheType type, const gchar *file)
      return ret;
 }
 
-void cache_appendto (const gchar *path, const gchar *data)
+/*!
+ * @param data Unused.
+ * @return \c FALSE, to remove the source.
+ *
+ * Report the writer's errors from the main loop.
+ */
+static gboolean cache_report_errors (gpointer data)
 {
-     GError *error = NULL;
-     GFileOutputStream *cout;
-     GFile *f;
-     gchar *cleared;
+     GError *error;
+
+     if (errors == NULL)
+          return FALSE;
+
+     while ((error = g_async_queue_try_pop (errors)) != NULL)
+          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
 
-     f = g_file_new_for_path (path);
+     return FALSE;
+}
 
-     if (!g_file_query_exists (f, NULL))
-          g_file_make_directory_with_parents (g_file_get_parent (f), NULL, NULL);
+/*!
+ * @param error Error raised by the writer.
+ *
+ * Queue an error for the main loop.
+ */
+static void cache_push_error (GError *error)
+{
+     g_async_queue_push (errors, error);
+     g_idle_add (cache_report_errors, NULL);
+}
 
-     cout = g_file_append_to (f, G_FILE_CREATE_PRIVATE, NULL, &error);
+/*!
+ * @param fd A file descriptor.
+ * @param data Data to write.
+ * @param len Length of \a data.
+ * @return Number of bytes written, less than \a len on failure.
+ */
+static gsize cache_write_fd (gint fd, const gchar *data, gsize len)
+{
+     gsize done = 0;
 
-     if (error != NULL)
+     while (done < len)
      {
-          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+          gssize ret = write (fd, data + done, len - done);
+
+          if (ret < 0 && errno == EINTR)
+               continue;
+          else if (ret < 0)
+               break;
+
+          done += ret;
+     }
+
+     return done;
+}
+
+/*!
+ * @param f A #CacheFile.
+ *
+ * Write pending data to the file (and sync it if needed).
+ */
+static void cache_file_flush (CacheFile *f)
+{
+     gsize done = 0;
+
+     if (f->pending->len == 0)
           return;
+
+     if (f->fd < 0)
+     {
+          gchar *dir = g_path_get_dirname (f->path);
+
+          g_mkdir_with_parents (dir, 0700);
+          g_free (dir);
+
+          f->fd = open (f->path, O_WRONLY | O_APPEND | O_CREAT, 0600);
      }
 
-     cleared = g_strdup_printf ("%s\r\n", data);
-     if (g_output_stream_write (G_OUTPUT_STREAM (cout), cleared, strlen (cleared), NULL, &error) == -1 && error != NULL)
+     if (f->fd >= 0)
+          done = cache_write_fd (f->fd, f->pending->str, f->pending->len);
+
+     quota_account (f->path, done);
+
+     if (f->fd < 0 || done < f->pending->len || (sync_writes && fsync (f->fd) != 0))
      {
-          g_free (cleared);
-          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+          cache_push_error (g_error_new (CREAM_CACHE_ERROR, CREAM_CACHE_ERROR_IO, "%s: %s", f->path, g_strerror (errno)));
+
+          /* try to open it again next time */
+          if (f->fd >= 0)
+               close (f->fd);
+          f->fd = -1;
+     }
+
+     g_string_truncate (f->pending, 0);
+}
+
+/*!
+ * @param f A #CacheFile.
+ *
+ * Flush and close the file.
+ */
+static void cache_file_free (CacheFile *f)
+{
+     cache_file_flush (f);
+
+     if (f->fd >= 0)
+          close (f->fd);
+
+     g_string_free (f->pending, TRUE);
+     g_free (f->path);
+     g_free (f);
+}
+
+/*!
+ * @param f A #CacheFile.
+ * @param data New content of the file.
+ *
+ * Flush and close the file, then replace it atomically (the content
+ * is written to a temporary file, renamed over the old one).
+ */
+static void cache_file_rewrite (CacheFile *f, GString *data)
+{
+     gboolean ok;
+     gchar *tmp;
+     struct stat st;
+     gint fd, saved;
+
+     cache_file_flush (f);
+
+     if (f->fd >= 0)
+          close (f->fd);
+     f->fd = -1;
+
+     if (stat (f->path, &st) != 0)
+     {
+          gchar *dir = g_path_get_dirname (f->path);
+
+          g_mkdir_with_parents (dir, 0700);
+          g_free (dir);
+
+          st.st_size = 0;
+     }
+
+     /* private, as the files appended to */
+     tmp = g_strdup_printf ("%s.XXXXXX", f->path);
+
+     if ((fd = g_mkstemp_full (tmp, O_WRONLY, 0600)) < 0)
+     {
+          cache_push_error (g_error_new (CREAM_CACHE_ERROR, CREAM_CACHE_ERROR_IO, "%s: %s", tmp, g_strerror (errno)));
+          g_free (tmp);
           return;
      }
-     g_free (cleared);
 
-     if (!g_output_stream_close (G_OUTPUT_STREAM (cout), NULL, &error) && error != NULL)
+     ok = (cache_write_fd (fd, data->str, data->len) == data->len && fsync (fd) == 0);
+     saved = errno;
+
+     if (close (fd) != 0 && ok)
      {
-          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+          ok = FALSE;
+          saved = errno;
+     }
+
+     if (ok && rename (tmp, f->path) != 0)
+     {
+          ok = FALSE;
+          saved = errno;
+     }
+
+     if (ok)
+          quota_account (f->path, (gint64) data->len - st.st_size);
+     else
+     {
+          cache_push_error (g_error_new (CREAM_CACHE_ERROR, CREAM_CACHE_ERROR_IO, "%s: %s", f->path, g_strerror (saved)));
+          unlink (tmp);
+     }
+
+     g_free (tmp);
+}
+
+/*!
+ * @param f A #CacheFile.
+ *
+ * Drop the pending data, close and remove the file.
+ */
+static void cache_file_unlink (CacheFile *f)
+{
+     struct stat st;
+
+     g_string_truncate (f->pending, 0);
+
+     if (f->fd >= 0)
+          close (f->fd);
+     f->fd = -1;
+
+     if (stat (f->path, &st) != 0)
+          return;
+
+     if (unlink (f->path) == 0)
+          quota_account (f->path, -st.st_size);
+     else if (errno != ENOENT)
+          cache_push_error (g_error_new (CREAM_CACHE_ERROR, CREAM_CACHE_ERROR_IO, "%s: %s", f->path, g_strerror (errno)));
+}
+
+static void cache_file_flush_cb (gpointer key, gpointer value, gpointer data)
+{
+     cache_file_flush ((CacheFile *) value);
+}
+
+/*!
+ * @param files Opened #CacheFile, by path.
+ * @param job A #CacheJob (freed).
+ * @return Number of bytes appended to the pending data.
+ *
+ * Run a job.
+ */
+static gsize cache_run_job (GHashTable *files, CacheJob *job)
+{
+     gsize pending = 0;
+     CacheFile *f;
+
+     if ((f = g_hash_table_lookup (files, job->path)) == NULL)
+     {
+          f = g_new0 (CacheFile, 1);
+          f->path    = job->path;
+          f->fd      = -1;
+          f->pending = g_string_new (NULL);
+
+          g_hash_table_insert (files, f->path, f);
+     }
+     else
+          g_free (job->path);
+
+     switch (job->type)
+     {
+          case CACHE_JOB_APPEND:
+               g_string_append_len (f->pending, job->data->str, job->data->len);
+               pending = job->data->len;
+               break;
+
+          case CACHE_JOB_REWRITE:
+               cache_file_rewrite (f, job->data);
+               break;
+
+          case CACHE_JOB_UNLINK:
+               cache_file_unlink (f);
+               g_hash_table_remove (files, f->path);
+               break;
+     }
+
+     if (job->data != NULL)
+          g_string_free (job->data, TRUE);
+     g_free (job);
+
+     return pending;
+}
+
+/*!
+ * @param data Unused.
+ * @return \c NULL
+ *
+ * Writer thread: batch appends until #CACHE_FLUSH_SIZE bytes are
+ * pending, or for #CACHE_FLUSH_DELAY seconds after the first pending
+ * byte.
+ */
+static gpointer cache_writer (gpointer data)
+{
+     GHashTable *files = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) cache_file_free);
+     GTimeVal deadline = { 0, 0 };
+     gsize pending = 0;
+
+     while (TRUE)
+     {
+          CacheJob *job;
+
+          if (pending == 0)
+               job = g_async_queue_pop (jobs);
+          else
+          {
+               GTimeVal now;
+
+               g_get_current_time (&now);
+
+               /* a steady stream of jobs does not delay the flush */
+               if (now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_usec >= deadline.tv_usec)
+                   || (job = g_async_queue_timed_pop (jobs, &deadline)) == NULL)
+               {
+                    g_hash_table_foreach (files, cache_file_flush_cb, NULL);
+                    pending = 0;
+                    continue;
+               }
+          }
+
+          /* quit */
+          if (job->path == NULL)
+          {
+               g_free (job);
+               break;
+          }
+
+          if (pending == 0 && job->type == CACHE_JOB_APPEND)
+          {
+               g_get_current_time (&deadline);
+               g_time_val_add (&deadline, CACHE_FLUSH_DELAY * G_USEC_PER_SEC);
+          }
+
+          pending += cache_run_job (files, job);
+
+          if (pending >= CACHE_FLUSH_SIZE)
+          {
+               g_hash_table_foreach (files, cache_file_flush_cb, NULL);
+               pending = 0;
+          }
+     }
+
+     /* flush and close every file */
+     g_hash_table_destroy (files);
+     return NULL;
+}
+
+/*!
+ * @return \c TRUE if the writer runs.
+ *
+ * Start the writer, if it is not running yet.
+ * Must be called with the writer's lock held.
+ */
+static gboolean cache_start_writer (void)
+{
+     GError *error = NULL;
+
+     if (writer != NULL)
+          return TRUE;
+
+     if (jobs == NULL)
+          jobs = g_async_queue_new ();
+
+     if ((writer = g_thread_create (cache_writer, NULL, TRUE, &error)) == NULL)
+     {
+          cache_push_error (error);
+          return FALSE;
+     }
+
+     return TRUE;
+}
+
+/*!
+ * Start the writer. Must be called from the main thread, before any
+ * other thread uses the cache.
+ */
+void cache_init (void)
+{
+     g_static_mutex_lock (&writer_lock);
+
+     if (errors == NULL)
+          errors = g_async_queue_new ();
+
+     if (!closed)
+          cache_start_writer ();
+
+     g_static_mutex_unlock (&writer_lock);
+}
+
+/*!
+ * @param job A #CacheJob.
+ *
+ * Queue a job, start the writer if needed. Can be called from any
+ * thread. Once the cache is closed, or if the writer can not start, the
+ * job is run at once.
+ */
+static void cache_push_job (CacheJob *job)
+{
+     GHashTable *files;
+
+     g_static_mutex_lock (&writer_lock);
+
+     if (errors == NULL)
+          errors = g_async_queue_new ();
+
+     if (!closed && cache_start_writer ())
+     {
+          g_async_queue_push (jobs, job);
+          g_static_mutex_unlock (&writer_lock);
           return;
      }
+
+     g_static_mutex_unlock (&writer_lock);
+
+     files = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) cache_file_free);
+     cache_run_job (files, job);
+     g_hash_table_destroy (files);
+}
+
+/*!
+ * @param path Path to the file.
+ * @param data Data to append.
+ * @param len Length of \a data, or -1 if it is nul-terminated.
+ *
+ * Append raw data to a file. The write is done by the writer thread.
+ */
+void cache_write (const gchar *path, const gchar *data, gssize len)
+{
+     CacheJob *job;
+
+     g_return_if_fail (path != NULL);
+     g_return_if_fail (data != NULL);
+
+     job = g_new0 (CacheJob, 1);
+     job->path = g_strdup (path);
+     job->data = g_string_new_len (data, len);
+
+     cache_push_job (job);
 }
 
-gchar **cache_read (const gchar *path)
+/*!
+ * @param path Path to the file.
+ * @param data New content of the file (will be freed by the writer).
+ *
+ * Replace the content of a file, once the appends queued before are
+ * written. The file is written to a temporary file then renamed by the
+ * writer thread, so it is never seen half-written.
+ */
+void cache_rewrite (const gchar *path, GString *data)
+{
+     CacheJob *job;
+
+     g_return_if_fail (path != NULL);
+     g_return_if_fail (data != NULL);
+
+     job = g_new0 (CacheJob, 1);
+     job->type = CACHE_JOB_REWRITE;
+     job->path = g_strdup (path);
+     job->data = data;
+
+     cache_push_job (job);
+}
+
+/*!
+ * @param path Path to the file.
+ *
+ * Remove a file, once the writes queued before are done (they are
+ * dropped). The removal is done by the writer thread.
+ */
+void cache_unlink (const gchar *path)
+{
+     CacheJob *job;
+
+     g_return_if_fail (path != NULL);
+
+     job = g_new0 (CacheJob, 1);
+     job->type = CACHE_JOB_UNLINK;
+     job->path = g_strdup (path);
+
+     cache_push_job (job);
+}
+
+/*!
+ * @param path Path to the file.
+ * @param data Line to append.
+ *
+ * Append a line to a file. The write is done by the writer thread.
+ */
+void cache_appendto (const gchar *path, const gchar *data)
+{
+     CacheJob *job;
+
+     g_return_if_fail (path != NULL);
+     g_return_if_fail (data != NULL);
+
+     job = g_new0 (CacheJob, 1);
+     job->path = g_strdup (path);
+     job->data = g_string_new (data);
+     g_string_append (job->data, "\r\n");
+
+     cache_push_job (job);
+}
+
+/*!
+ * @param sync \c TRUE to sync files on disk after each flush.
+ *
+ * Enable or disable <code>fsync()</code> after writes, for crash safety.
+ */
+void cache_set_sync (gboolean sync)
+{
+     sync_writes = sync;
+}
+
+/*!
+ * Wait for pending writes, stop the writer and save the usage of the
+ * cache (see quota_save()). Later jobs are run synchronously.
+ */
+void cache_close (void)
+{
+     GThread *thread;
+
+     /* no job is queued after this */
+     g_static_mutex_lock (&writer_lock);
+     closed = TRUE;
+     thread = writer;
+     writer = NULL;
+     g_static_mutex_unlock (&writer_lock);
+
+     if (thread == NULL)
+     {
+          quota_save ();
+          return;
+     }
+
+     /* a job without path stops the writer */
+     g_async_queue_push (jobs, g_new0 (CacheJob, 1));
+     g_thread_join (thread);
+
+     cache_report_errors (NULL);
+
+     /* the errors of the later jobs are still reported */
+     g_async_queue_unref (jobs);
+     jobs = NULL;
+
+     quota_save ();
+}
+
+/*!
+ * \struct _CacheReader
+ * A mapped cache file, and the records not read yet.
+ */
+struct _CacheReader
+{
+     gint ref_count;
+     GMappedFile *file;
+
+     const gchar *head;  /*!< Start of the first unread record */
+     const gchar *tail;  /*!< End of the last unread record */
+};
+
+/*!
+ * @param path Path to the file.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return A new #CacheReader, or \c NULL on failure.
+ *
+ * Map a cache file in memory. A missing file is read as an empty one.
+ */
+CacheReader *cache_reader_new (const gchar *path, GError **err)
 {
      GError *error = NULL;
-     gchar *contents = NULL;
-     gchar **lines = NULL;
-     gsize length;
+     CacheReader *r;
+
+     g_return_val_if_fail (path != NULL, NULL);
+
+     r = g_new0 (CacheReader, 1);
+     r->ref_count = 1;
 
-     if (!g_file_get_contents (path, &contents, &length, &error) && error != NULL)
+     if ((r->file = g_mapped_file_new (path, FALSE, &error)) == NULL)
      {
-          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
-          return NULL;
+          if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+          {
+               g_propagate_error (err, error);
+               g_free (r);
+               return NULL;
+          }
+
+          g_error_free (error);
+          return r;
      }
 
-     lines = g_strsplit (contents, "\r\n", -1);
-     g_free (contents);
-     return lines;
+     r->head = g_mapped_file_get_contents (r->file);
+     r->tail = r->head + g_mapped_file_get_length (r->file);
+
+     return r;
+}
+
+/*!
+ * @param r A #CacheReader.
+ * @return \a r
+ *
+ * Increase the reference count of the reader, records stay mapped
+ * while a reference is held.
+ */
+CacheReader *cache_reader_ref (CacheReader *r)
+{
+     g_return_val_if_fail (r != NULL, NULL);
+
+     g_atomic_int_inc (&r->ref_count);
+     return r;
+}
+
+/*!
+ * @param r A #CacheReader.
+ *
+ * Decrease the reference count of the reader, unmap the file when
+ * it drops to zero.
+ */
+void cache_reader_unref (CacheReader *r)
+{
+     g_return_if_fail (r != NULL);
+
+     if (!g_atomic_int_dec_and_test (&r->ref_count))
+          return;
+
+     if (r->file != NULL)
+          g_mapped_file_unref (r->file);
+
+     g_free (r);
 }
+
+/*!
+ * @param r A #CacheReader.
+ * @param record Pointer to the first record (not nul-terminated).
+ * @param len Length of the record.
+ * @return \c FALSE if there is no more record.
+ *
+ * Read the first unread record. Empty records are skipped.
+ */
+gboolean cache_reader_next (CacheReader *r, const gchar **record, gsize *len)
+{
+     g_return_val_if_fail (r != NULL, FALSE);
+
+     while (r->head < r->tail)
+     {
+          const gchar *start = r->head;
+          const gchar *end = start;
+
+          /* look for CRLF */
+          while ((end = memchr (end, '\r', r->tail - end)) != NULL && (end + 1 >= r->tail || end[1] != '\n'))
+               ++end;
+
+          if (end == NULL)
+               end = r->head = r->tail;
+          else
+               r->head = end + 2;
+
+          if (end > start)
+          {
+               *record = start;
+               *len    = end - start;
+               return TRUE;
+          }
+     }
+
+     return FALSE;
+}
+
+/*!
+ * @param r A #CacheReader.
+ * @param record Pointer to the last record (not nul-terminated).
+ * @param len Length of the record.
+ * @return \c FALSE if there is no more record.
+ *
+ * Read the last unread record. Empty records are skipped.
+ */
+gboolean cache_reader_prev (CacheReader *r, const gchar **record, gsize *len)
+{
+     g_return_val_if_fail (r != NULL, FALSE);
+
+     while (r->head < r->tail)
+     {
+          const gchar *end = r->tail;
+          const gchar *start = end;
+
+          /* look for the CRLF ending the previous record */
+          while (start >= r->head + 2 && (start[-2] != '\r' || start[-1] != '\n'))
+               --start;
+
+          if (start < r->head + 2)
+               start = r->head;
+
+          r->tail = (start > r->head ? start - 2 : r->head);
+
+          if (end > start)
+          {
+               *record = start;
+               *len    = end - start;
+               return TRUE;
+          }
+     }
+
+     return FALSE;
+}
+
+/*!
+ * @param path Path to the file.
+ * @param func Function to call on each record, iteration stops if it returns \c FALSE.
+ * @param data User data for \a func.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Call a function on each record of a cache file. Records are only
+ * valid during the call.
+ */
+gboolean cache_foreach (const gchar *path, CacheForeachFunc func, gpointer data, GError **err)
+{
+     CacheReader *r = cache_reader_new (path, err);
+     const gchar *record;
+     gsize len;
+
+     if (r == NULL)
+          return FALSE;
+
+     while (cache_reader_next (r, &record, &len) && func (record, len, data));
+
+     cache_reader_unref (r);
+     return TRUE;
+}
+
+/*! @} */
@@ -26,6 +26,17 @@
 #ifndef __CACHE_H
 #define __CACHE_H
 
+/*!
+ * \defgroup cache Cache
+ * Cache files, stored in the profile's directory of the user's cache.
+ *
+ * Appends are queued to a writer thread, which keeps the files opened,
+ * batches pending data and flushes it when enough bytes are pending or
+ * after a short delay. Thus, a slow disk never blocks the GTK main loop.
+ *
+ * @{
+ */
+
 typedef enum
 {
      CACHE_TYPE_COMMANDS,
@@ -37,7 +48,38 @@ typedef enum
 } CacheType;
 
 gchar *cache_path (CacheType type, const gchar *file);
+void cache_init (void);
+void cache_write (const gchar *path, const gchar *data, gssize len);
 void cache_appendto (const gchar *path, const gchar *data);
-gchar **cache_read (const gchar *path);
+void cache_rewrite (const gchar *path, GString *data);
+void cache_unlink (const gchar *path);
+void cache_set_sync (gboolean sync);
+void cache_close (void);
+
+/*!
+ * \class CacheReader
+ * Iterate over the CRLF-delimited records of a memory-mapped cache file.
+ * Records are views over the mapping, they are not nul-terminated and
+ * must be copied to outlive the reader.
+ */
+typedef struct _CacheReader CacheReader;
+
+/*!
+ * \fn gboolean (*CacheForeachFunc) (const gchar *record, gsize len, gpointer data)
+ * @param record The record (not nul-terminated).
+ * @param len Length of the record.
+ * @param data User data.
+ * @return \c FALSE to stop the iteration.
+ */
+typedef gboolean (*CacheForeachFunc) (const gchar *record, gsize len, gpointer data);
+
+CacheReader *cache_reader_new (const gchar *path, GError **err);
+CacheReader *cache_reader_ref (CacheReader *r);
+void cache_reader_unref (CacheReader *r);
+gboolean cache_reader_next (CacheReader *r, const gchar **record, gsize *len);
+gboolean cache_reader_prev (CacheReader *r, const gchar **record, gsize *len);
+gboolean cache_foreach (const gchar *path, CacheForeachFunc func, gpointer data, GError **err);
+
+/*! @} */
 
 #endif /* __CACHE_H */
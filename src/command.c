@@ -39,6 +39,12 @@ static gboolean command_tabclose (gint argc, gchar **argv, GError **err);
 static gboolean command_split (gint argc, gchar **argv, GError **err);
 static gboolean command_vsplit (gint argc, gchar **argv, GError **err);
 static gboolean command_close (gint argc, gchar **argv, GError **err);
+static gboolean command_history_search (gint argc, gchar **argv, GError **err);
+static gboolean command_cache_stats (gint argc, gchar **argv, GError **err);
+static gboolean command_keystats (gint argc, gchar **argv, GError **err);
+static gboolean command_luaprof (gint argc, gchar **argv, GError **err);
+
+#define COMMAND_SEARCH_RESULTS     20             /*!< Results shown by \c history-search */
 
 #define CREAM_COMMAND_ERROR        (cream_command_error_quark ())
 
@@ -47,7 +53,8 @@ typedef enum
      CREAM_COMMAND_ERROR_ARGS,
      CREAM_COMMAND_ERROR_NOT_IMPLEMENTED,
      CREAM_COMMAND_ERROR_UNKNOW_CMD,
-     CREAM_COMMAND_ERROR_FAILED
+     CREAM_COMMAND_ERROR_FAILED,
+     CREAM_COMMAND_ERROR_EXISTS
 } CreamCommandError;
 
 static GQuark cream_command_error_quark (void)
@@ -81,9 +88,75 @@ static struct command_t internal_commands[] =
      { "split",     gettext_noop ("Split the current view"),               command_split },
      { "vsplit",    gettext_noop ("Split the current view vertically"),    command_vsplit },
      { "close",     gettext_noop ("Close the current view"),               command_close },
+     { "history-search", gettext_noop ("Search visited pages by words of their title or URI"), command_history_search },
+     { "cache-stats", gettext_noop ("Show the disk usage of the cache"),  command_cache_stats },
+     { "keystats",    gettext_noop ("Show the latency of the key bindings"), command_keystats },
+     { "luaprof",     gettext_noop ("Start or stop profiling the lua code"), command_luaprof },
      { NULL, NULL, NULL }
 };
 
+/*!
+ * \struct command_lua_t
+ * A command registered by lua.
+ */
+struct command_lua_t
+{
+     gchar *cmd;  /*!< Command's name */
+     gchar *desc; /*!< Description, or \c NULL */
+     int func;    /*!< Lua function to call */
+};
+
+static GPtrArray *lua_commands = NULL;
+
+/*!
+ * @param cmd Command's name.
+ * @return The lua command named \a cmd, or \c NULL.
+ */
+static struct command_lua_t *command_lua_lookup (const gchar *cmd)
+{
+     guint i;
+
+     for (i = 0; lua_commands != NULL && i < lua_commands->len; ++i)
+     {
+          struct command_lua_t *c = g_ptr_array_index (lua_commands, i);
+
+          if (g_str_equal (c->cmd, cmd))
+               return c;
+     }
+
+     return NULL;
+}
+
+/*!
+ * @param c A lua command.
+ * @param argc Number of arguments.
+ * @param argv Arguments list.
+ *
+ * Call the function of a lua command with the arguments as strings.
+ * A string returned by the function is shown as the output of the
+ * command.
+ */
+static void command_lua_call (struct command_lua_t *c, gint argc, gchar **argv)
+{
+     lua_State *L = app->luavm;
+     int top = lua_gettop (L);
+     gint i;
+
+     for (i = 1; i < argc; ++i)
+          lua_pushstring (L, argv[i]);
+
+     luaL_callnamed (L, c->func, argc - 1, 1, c->cmd);
+
+     /* nothing is left on error */
+     if (lua_gettop (L) > top)
+     {
+          if (lua_isstring (L, -1))
+               ui_output (lua_tostring (L, -1));
+
+          lua_settop (L, top);
+     }
+}
+
 /*!
  * @param cmd Command to execute
  * @param err \class{GError} pointer in order to follow possible errors.
@@ -93,6 +166,7 @@ static struct command_t internal_commands[] =
  */
 gboolean run_command (const char *cmd, GError **err)
 {
+     struct command_lua_t *c;
      gchar **argv;
      gint argc, i;
 
@@ -111,10 +185,84 @@ gboolean run_command (const char *cmd, GError **err)
           }
      }
 
+     if ((c = command_lua_lookup (argv[0])) != NULL)
+     {
+          command_lua_call (c, argc, argv);
+          g_strfreev (argv);
+          return TRUE;
+     }
+
      g_set_error (err, CREAM_COMMAND_ERROR, CREAM_COMMAND_ERROR_UNKNOW_CMD, _("Unknow command '%s'"), argv[0]);
      return FALSE;
 }
 
+/*!
+ * @param cmd Command's name.
+ * @param desc Description, or \c NULL.
+ * @param lua_func Reference on a lua function.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Register a command implemented in lua. Registering a lua command
+ * again replaces it, internal commands can not be replaced.
+ */
+gboolean command_register (const gchar *cmd, const gchar *desc, int lua_func, GError **err)
+{
+     struct command_lua_t *c;
+     gint i;
+
+     for (i = 0; internal_commands[i].cmd != NULL; ++i)
+     {
+          if (g_str_equal (internal_commands[i].cmd, cmd))
+          {
+               g_set_error (err, CREAM_COMMAND_ERROR, CREAM_COMMAND_ERROR_EXISTS, _("%s is an internal command"), cmd);
+               return FALSE;
+          }
+     }
+
+     if ((c = command_lua_lookup (cmd)) != NULL)
+     {
+          luaL_unref (app->luavm, LUA_REGISTRYINDEX, c->func);
+          g_free (c->desc);
+     }
+     else
+     {
+          c = g_new0 (struct command_lua_t, 1);
+          c->cmd = g_strdup (cmd);
+
+          if (lua_commands == NULL)
+               lua_commands = g_ptr_array_new ();
+
+          g_ptr_array_add (lua_commands, c);
+     }
+
+     c->desc = g_strdup (desc);
+     c->func = lua_func;
+
+     return TRUE;
+}
+
+/*!
+ * @param func Function to call on each command.
+ * @param data User data passed to \a func.
+ *
+ * Call \a func on the internal commands, then on the lua commands.
+ */
+void command_foreach (CommandForeachFunc func, gpointer data)
+{
+     guint i;
+
+     for (i = 0; internal_commands[i].cmd != NULL; ++i)
+          func (internal_commands[i].cmd, _(internal_commands[i].desc), data);
+
+     for (i = 0; lua_commands != NULL && i < lua_commands->len; ++i)
+     {
+          struct command_lua_t *c = g_ptr_array_index (lua_commands, i);
+
+          func (c->cmd, c->desc, data);
+     }
+}
+
 /*! @} */
 
 /*!
@@ -302,4 +450,148 @@ static gboolean command_close (gint argc, gchar **argv, GError **err)
      return TRUE;
 }
 
+/*!
+ * @param argc Number of arguments.
+ * @param argv Arguments list.
+ * @param err \class{Gerror} pointer.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Show the visited pages containing all the given words.
+ */
+static gboolean command_history_search (gint argc, gchar **argv, GError **err)
+{
+     SearchResult results[COMMAND_SEARCH_RESULTS];
+     GString *output;
+     gchar *query;
+     guint i, n;
+
+     if (argc < 2)
+     {
+          g_set_error (err, CREAM_COMMAND_ERROR, CREAM_COMMAND_ERROR_ARGS, _("history-search: Too few arguments"));
+          return FALSE;
+     }
+
+     query = g_strjoinv (" ", argv + 1);
+     n = search_query (app->search, query, COMMAND_SEARCH_RESULTS, results);
+
+     if (n == 0)
+     {
+          g_set_error (err, CREAM_COMMAND_ERROR, CREAM_COMMAND_ERROR_FAILED, _("No matches found for: %s"), query);
+          g_free (query);
+          return FALSE;
+     }
+
+     output = g_string_new (NULL);
+
+     for (i = 0; i < n; ++i)
+          g_string_append_printf (output, "%s%s\n    %s", (i ? "\n" : ""), (*results[i].title ? results[i].title : results[i].uri), results[i].uri);
+
+     ui_output (output->str);
+
+     g_string_free (output, TRUE);
+     search_results_clear (results, n);
+     g_free (query);
+
+     return TRUE;
+}
+
+/*!
+ * @param argc Number of arguments.
+ * @param argv Arguments list.
+ * @param err \class{Gerror} pointer.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Show the usage and the budget of each cache category.
+ */
+static gboolean command_cache_stats (gint argc, gchar **argv, GError **err)
+{
+     GString *output = g_string_new (NULL);
+     CacheType type;
+
+     for (type = 0; type <= CACHE_TYPE_NONE; ++type)
+     {
+          gint64 used, budget;
+          gchar *sused, *sbudget;
+
+          quota_get_usage (type, &used, &budget);
+          sused   = g_format_size_for_display (used);
+          sbudget = g_format_size_for_display (budget);
+
+          g_string_append_printf (output, "%s%-10s %10s / %-10s (%d%%)", (type ? "\n" : ""),
+                                  quota_category_name (type), sused, sbudget, (gint) (used * 100 / budget));
+
+          g_free (sused);
+          g_free (sbudget);
+     }
+
+     ui_output (output->str);
+     g_string_free (output, TRUE);
+
+     return TRUE;
+}
+
+/*!
+ * @param argc Number of arguments.
+ * @param argv Arguments list.
+ * @param err \class{Gerror} pointer.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Show the delay from the key press to the dispatch and the run time
+ * (median, 99th percentile and maximum) of the key bindings, the
+ * slowest first.
+ */
+static gboolean command_keystats (gint argc, gchar **argv, GError **err)
+{
+     GString *output = latency_report ();
+
+     ui_output (output->str);
+     g_string_free (output, TRUE);
+
+     return TRUE;
+}
+
+/*!
+ * @param argc Number of arguments.
+ * @param argv Arguments list.
+ * @param err \class{Gerror} pointer.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Start the lua profiler, or stop it and write the samples to the given
+ * file (<code>luaprof.folded</code> in the cache by default).
+ */
+static gboolean command_luaprof (gint argc, gchar **argv, GError **err)
+{
+     gboolean ret = FALSE;
+
+     if (argc < 2)
+     {
+          g_set_error (err, CREAM_COMMAND_ERROR, CREAM_COMMAND_ERROR_ARGS, _("luaprof: Too few arguments"));
+     }
+     else if (g_str_equal (argv[1], "start"))
+     {
+          if ((ret = luaprof_start (app->luavm, err)))
+               ui_output (_("Lua profiler started"));
+     }
+     else if (g_str_equal (argv[1], "stop"))
+     {
+          gchar *path = (argc > 2 ? g_strdup (argv[2]) : cache_path (CACHE_TYPE_NONE, "luaprof.folded"));
+          guint samples = 0;
+
+          if ((ret = luaprof_stop (app->luavm, path, &samples, err)))
+          {
+               gchar *output = g_strdup_printf (_("%u samples written to %s"), samples, path);
+               ui_output (output);
+               g_free (output);
+          }
+
+          g_free (path);
+     }
+     else
+     {
+          g_set_error (err, CREAM_COMMAND_ERROR, CREAM_COMMAND_ERROR_ARGS, _("luaprof: Unknown action: %s"), argv[1]);
+     }
+
+     return ret;
+}
+
 /*! @} */
@@ -0,0 +1,385 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+
+/*!
+ * \addtogroup completion
+ * @{
+ */
+
+#define COMPLETION_PREFIXES        4         /*!< Prefixes tried on the history for a partial URI */
+
+/*!
+ * \struct CompletionMatch
+ * A candidate matching the current text.
+ */
+typedef struct
+{
+     guint index;                  /*!< Index of the candidate */
+     gint score;                   /*!< Score of the candidate (see fuzzy_match()) */
+} CompletionMatch;
+
+struct _Completion
+{
+     CompletionKind kind;
+     GStringChunk *strings;
+     GArray *candidates;           /*!< Array of #CompletionCandidate */
+     GArray *masks;                /*!< Characters of the candidates (see fuzzy_mask()) */
+     GHashTable *seen;             /*!< Texts of the candidates */
+     GArray *matches;              /*!< Array of #CompletionMatch, best first */
+
+     gchar *text;                  /*!< Text being completed */
+     gchar *lower;                 /*!< \a text in lower case */
+     guint64 mask;                 /*!< Characters of \a lower */
+
+     guint async_source;           /*!< Source querying the history, or 0 */
+     guint async_step;             /*!< Next query of the history */
+
+     CompletionUpdateFunc func;
+     gpointer data;
+};
+
+/*!
+ * @param c A #Completion.
+ * @param i Index of a candidate.
+ * @return \c TRUE if the candidate matches the current text.
+ *
+ * Add the candidate to the matches (unsorted) if it matches.
+ */
+static gboolean completion_match (Completion *c, guint i)
+{
+     CompletionMatch m;
+
+     if ((g_array_index (c->masks, guint64, i) & c->mask) != c->mask
+         || !fuzzy_match (c->lower, g_array_index (c->candidates, CompletionCandidate, i).str, &m.score))
+          return FALSE;
+
+     m.index = i;
+     g_array_append_val (c->matches, m);
+     return TRUE;
+}
+
+static gint completion_compare_match (gconstpointer a, gconstpointer b)
+{
+     const CompletionMatch *ma = a, *mb = b;
+
+     if (ma->score != mb->score)
+          return (ma->score > mb->score ? -1 : 1);
+
+     /* the order of the sources */
+     return (ma->index < mb->index ? -1 : ma->index > mb->index);
+}
+
+/*!
+ * @param c A #Completion.
+ * @param text Text of the candidate.
+ * @param desc Description of the candidate, or \c NULL.
+ * @return \c TRUE if the candidate is new.
+ *
+ * Add a candidate, and check it against the current text. The matches
+ * must be sorted again.
+ */
+static gboolean completion_add (Completion *c, const gchar *text, const gchar *desc)
+{
+     CompletionCandidate cand;
+     gchar *str;
+     guint64 mask;
+
+     if (text == NULL || *text == '\0' || g_hash_table_lookup (c->seen, text) != NULL)
+          return FALSE;
+
+     cand.text = g_string_chunk_insert (c->strings, text);
+     cand.desc = (desc && *desc ? g_string_chunk_insert (c->strings, desc) : NULL);
+
+     /* not case folded: fuzzy_match() needs the case to find camelCase words */
+     str      = g_strconcat (text, " ", (cand.desc ? cand.desc : ""), NULL);
+     cand.str = g_string_chunk_insert (c->strings, str);
+     g_free (str);
+
+     mask = fuzzy_mask (cand.str);
+
+     g_hash_table_insert (c->seen, (gpointer) cand.text, GINT_TO_POINTER (1));
+     g_array_append_val (c->candidates, cand);
+     g_array_append_val (c->masks, mask);
+
+     if (c->lower != NULL)
+          completion_match (c, c->candidates->len - 1);
+
+     return TRUE;
+}
+
+static void completion_add_command (const gchar *cmd, const gchar *desc, gpointer data)
+{
+     completion_add (data, cmd, desc);
+}
+
+/*!
+ * @param c A #Completion.
+ *
+ * Add the candidates kept in memory.
+ */
+static void completion_add_sources (Completion *c)
+{
+     const FrecencyItem *items[FRECENCY_TOP_K];
+     guint i, n;
+
+     if (c->kind == COMPLETION_COMMANDS)
+     {
+          command_foreach (completion_add_command, c);
+
+          /* recent commands, without the colon */
+          n = frecency_query (app->frecency.commands, ":", FRECENCY_TOP_K, items);
+          for (i = 0; i < n; ++i)
+               completion_add (c, items[i]->key + 1, NULL);
+     }
+     else
+     {
+          GList *l;
+
+          /* open tabs */
+          for (l = GTK_VIM_SPLIT (app->gui.vimsplit)->widgets; l != NULL; l = l->next)
+          {
+               gint p, pages = gtk_notebook_get_n_pages (GTK_NOTEBOOK (l->data));
+
+               for (p = 0; p < pages; ++p)
+               {
+                    WebView *w = CREAM_WEBVIEW (gtk_notebook_get_nth_page (GTK_NOTEBOOK (l->data), p));
+
+                    completion_add (c, webview_get_uri (w), webview_get_title (w));
+               }
+          }
+
+          n = frecency_query (app->frecency.uris, "", FRECENCY_TOP_K, items);
+          for (i = 0; i < n; ++i)
+               completion_add (c, items[i]->key, NULL);
+     }
+}
+
+/*!
+ * @param data A #Completion.
+ * @return \c TRUE while queries are left.
+ *
+ * Run the next query of the history for the current text: the pages
+ * whose title or URI contain its words (from #SEARCH_MIN_WORD
+ * characters), then the URIs starting with it.
+ * The owner is notified when candidates were added.
+ */
+static gboolean completion_async (gpointer data)
+{
+     static const gchar *schemes[COMPLETION_PREFIXES] = { "http://", "https://", "http://www.", "https://www." };
+     Completion *c = data;
+     HistoryItem *items;
+     guint i, n, step = c->async_step++;
+     gboolean added = FALSE;
+
+     if (step == 0)
+     {
+          SearchResult *results;
+
+          /* shorter text would match most pages, leave it to the prefixes */
+          if (app->search == NULL || strlen (c->text) < SEARCH_MIN_WORD)
+               return TRUE;
+
+          results = g_new (SearchResult, COMPLETION_ASYNC_MAX);
+          n = search_query (app->search, c->text, COMPLETION_ASYNC_MAX, results);
+
+          for (i = 0; i < n; ++i)
+               added |= completion_add (c, results[i].uri, results[i].title);
+
+          search_results_clear (results, n);
+          g_free (results);
+     }
+     else if (step <= COMPLETION_PREFIXES && app->history != NULL)
+     {
+          gchar *prefix = NULL;
+
+          items = g_new (HistoryItem, COMPLETION_ASYNC_MAX);
+
+          if (*c->text == '\0')
+               n = (step == 1 ? history_recent (app->history, COMPLETION_ASYNC_MAX, items) : 0);
+          else if (strstr (c->text, "://") != NULL)
+               n = (step == 1 ? history_prefix (app->history, c->text, COMPLETION_ASYNC_MAX, items) : 0);
+          else
+          {
+               prefix = g_strconcat (schemes[step - 1], c->text, NULL);
+               n = history_prefix (app->history, prefix, COMPLETION_ASYNC_MAX, items);
+          }
+
+          for (i = 0; i < n; ++i)
+               added |= completion_add (c, items[i].uri, items[i].title);
+
+          g_free (prefix);
+          g_free (items);
+     }
+     else
+     {
+          c->async_source = 0;
+          return FALSE;
+     }
+
+     if (added)
+     {
+          g_array_sort (c->matches, completion_compare_match);
+
+          if (c->func != NULL)
+               c->func (c, c->data);
+     }
+
+     return TRUE;
+}
+
+/*!
+ * @param kind What is completed.
+ * @param func Function called when candidates are added in background, or \c NULL.
+ * @param data User data passed to \a func.
+ * @return A new #Completion (must be freed with completion_free()).
+ *
+ * Gather the candidates. Call completion_filter() to match them.
+ */
+Completion *completion_new (CompletionKind kind, CompletionUpdateFunc func, gpointer data)
+{
+     Completion *c = g_new0 (Completion, 1);
+
+     c->kind       = kind;
+     c->strings    = g_string_chunk_new (4096);
+     c->candidates = g_array_new (FALSE, FALSE, sizeof (CompletionCandidate));
+     c->masks      = g_array_new (FALSE, FALSE, sizeof (guint64));
+     c->seen       = g_hash_table_new (g_str_hash, g_str_equal);
+     c->matches    = g_array_new (FALSE, FALSE, sizeof (CompletionMatch));
+     c->func       = func;
+     c->data       = data;
+
+     completion_add_sources (c);
+     return c;
+}
+
+/*!
+ * @param c A #Completion.
+ *
+ * Cancel the queries of the history, and free the candidates.
+ */
+void completion_free (Completion *c)
+{
+     if (c == NULL)
+          return;
+
+     if (c->async_source != 0)
+          g_source_remove (c->async_source);
+
+     g_string_chunk_free (c->strings);
+     g_array_free (c->candidates, TRUE);
+     g_array_free (c->masks, TRUE);
+     g_hash_table_destroy (c->seen);
+     g_array_free (c->matches, TRUE);
+     g_free (c->text);
+     g_free (c->lower);
+     g_free (c);
+}
+
+/*!
+ * @param c A #Completion.
+ * @param text Text typed.
+ *
+ * Match the candidates with \a text. If \a text contains the previous
+ * text, only the previous matches are checked; otherwise all the masks
+ * are filtered first. The history is queried again in background (URIs
+ * only).
+ */
+void completion_filter (Completion *c, const gchar *text)
+{
+     gchar *lower = g_ascii_strdown (text, -1);
+     gboolean narrow = (c->lower != NULL && strstr (lower, c->lower) != NULL);
+     guint i, n;
+
+     if (c->lower != NULL && g_str_equal (lower, c->lower))
+     {
+          g_free (lower);
+          return;
+     }
+
+     g_free (c->text);
+     g_free (c->lower);
+     c->text  = g_strdup (text);
+     c->lower = lower;
+     c->mask  = fuzzy_mask (lower);
+
+     if (narrow)
+     {
+          GArray *previous = c->matches;
+
+          c->matches = g_array_sized_new (FALSE, FALSE, sizeof (CompletionMatch), previous->len);
+
+          for (i = 0; i < previous->len; ++i)
+               completion_match (c, g_array_index (previous, CompletionMatch, i).index);
+
+          g_array_free (previous, TRUE);
+     }
+     else
+     {
+          guint *left = g_new (guint, c->candidates->len);
+
+          n = fuzzy_filter ((guint64 *) c->masks->data, c->masks->len, c->mask, left);
+          g_array_set_size (c->matches, 0);
+
+          for (i = 0; i < n; ++i)
+               completion_match (c, left[i]);
+
+          g_free (left);
+     }
+
+     g_array_sort (c->matches, completion_compare_match);
+
+     if (c->kind != COMPLETION_URIS)
+          return;
+
+     if (c->async_source != 0)
+          g_source_remove (c->async_source);
+
+     c->async_step   = 0;
+     c->async_source = g_idle_add_full (G_PRIORITY_LOW, completion_async, c, NULL);
+}
+
+/*!
+ * @param c A #Completion.
+ * @return Number of candidates matching the current text.
+ */
+guint completion_count (Completion *c)
+{
+     return c->matches->len;
+}
+
+/*!
+ * @param c A #Completion.
+ * @param i Index of a match.
+ * @return The \a i th candidate matching the current text.
+ */
+const CompletionCandidate *completion_get (Completion *c, guint i)
+{
+     g_return_val_if_fail (i < c->matches->len, NULL);
+     return &g_array_index (c->candidates, CompletionCandidate, g_array_index (c->matches, CompletionMatch, i).index);
+}
+
+/*! @} */
@@ -0,0 +1,88 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __COMPLETION_H
+#define __COMPLETION_H
+
+/*!
+ * \defgroup completion Completion
+ * \ingroup inputbox
+ * Candidates of the inputbox completion.
+ *
+ * A completion gathers its candidates once: the internal and lua
+ * commands and the recent commands, or the open tabs and the frecent
+ * URIs. The history and its full-text index may block on the disk, so
+ * they are queried from a low priority idle source, one query at a
+ * time, cancelled when the text changes; their candidates are merged
+ * as they come.
+ *
+ * Candidates match when their text or description contains the typed
+ * characters in order (see \ref fuzzy), best score first. When the new
+ * text contains the previous one, only the previous matches are checked
+ * again; otherwise the masks of all the candidates are filtered first.
+ *
+ * @{
+ */
+
+#include <glib.h>
+#include "fuzzy.h"
+
+#define COMPLETION_ASYNC_MAX       1000      /*!< Candidates read by each query of the history */
+#define COMPLETION_SHOWN           10        /*!< Candidates shown at once */
+
+/*!
+ * \enum CompletionKind
+ * What is completed.
+ */
+typedef enum
+{
+     COMPLETION_COMMANDS,          /*!< A command */
+     COMPLETION_URIS               /*!< An URI (argument of <code>:open</code>) */
+} CompletionKind;
+
+/*!
+ * \struct CompletionCandidate
+ * A candidate.
+ */
+typedef struct
+{
+     const gchar *text;            /*!< Completed text */
+     const gchar *desc;            /*!< Description (title, help), or \c NULL */
+     const gchar *str;             /*!< Text and description, matched as is (see fuzzy_match()) */
+} CompletionCandidate;
+
+typedef struct _Completion Completion;
+typedef void (*CompletionUpdateFunc) (Completion *c, gpointer data);
+
+Completion *completion_new (CompletionKind kind, CompletionUpdateFunc func, gpointer data);
+void completion_free (Completion *c);
+
+void completion_filter (Completion *c, const gchar *text);
+guint completion_count (Completion *c);
+const CompletionCandidate *completion_get (Completion *c, guint i);
+
+/*! @} */
+
+#endif /* __COMPLETION_H */
@@ -0,0 +1,448 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+
+#include <math.h>
+
+/*!
+ * \addtogroup frecency
+ * @{
+ */
+
+#define FRECENCY_DECAY             (G_LN2 / FRECENCY_HALF_LIFE)  /*!< Decay rate, per second */
+#define FRECENCY_COMPACT_SLACK     64                            /*!< Stale journal lines allowed before rewriting it */
+
+typedef struct _FrecencyNode FrecencyNode;
+
+/*!
+ * \struct _FrecencyNode
+ * A node of the prefix tree.
+ */
+struct _FrecencyNode
+{
+     FrecencyNode *child;          /*!< First child */
+     FrecencyNode *next;           /*!< Next sibling */
+
+     FrecencyItem **top;           /*!< Best items below the node, by decreasing score */
+     guint ntop;
+
+     GPtrArray *items;             /*!< Every item below the node (at #FRECENCY_INDEX_DEPTH only) */
+     gchar c;
+};
+
+struct _Frecency
+{
+     gchar *path;                  /*!< Path to the journal */
+     gboolean uris;                /*!< \c TRUE if the keys are URIs */
+     gboolean loaded;              /*!< \c TRUE once the journal was read */
+     guint lines;                  /*!< Number of lines in the journal */
+
+     GHashTable *items;            /*!< Items by key */
+     FrecencyNode root;
+};
+
+static void frecency_item_free (FrecencyItem *item)
+{
+     g_free (item->key);
+     g_slice_free (FrecencyItem, item);
+}
+
+static void frecency_node_free (FrecencyNode *n)
+{
+     FrecencyNode *child, *next;
+
+     for (child = n->child; child != NULL; child = next)
+     {
+          next = child->next;
+          frecency_node_free (child);
+          g_slice_free (FrecencyNode, child);
+     }
+
+     if (n->items != NULL)
+          g_ptr_array_free (n->items, TRUE);
+
+     g_free (n->top);
+}
+
+/*!
+ * @param path Path to the journal.
+ * @param uris \c TRUE if the keys are URIs: their scheme and
+ * <code>www.</code> are not indexed.
+ * @return A new #Frecency. The journal is read on first use.
+ */
+Frecency *frecency_new (const gchar *path, gboolean uris)
+{
+     Frecency *f = g_new0 (Frecency, 1);
+
+     f->path  = g_strdup (path);
+     f->uris  = uris;
+     f->items = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) frecency_item_free);
+
+     return f;
+}
+
+/*!
+ * @param f A #Frecency.
+ */
+void frecency_free (Frecency *f)
+{
+     g_return_if_fail (f != NULL);
+
+     frecency_node_free (&f->root);
+     g_hash_table_destroy (f->items);
+     g_free (f->path);
+     g_free (f);
+}
+
+/*!
+ * @param f A #Frecency.
+ * @param key A key, or a prefix.
+ * @return The indexed part of \a key.
+ */
+static const gchar *frecency_name (Frecency *f, const gchar *key)
+{
+     const gchar *p;
+
+     if (!f->uris)
+          return key;
+
+     for (p = key; g_ascii_isalnum (*p) || *p == '+' || *p == '-' || *p == '.'; ++p);
+
+     if (p > key && g_str_has_prefix (p, "://"))
+          key = p + 3;
+
+     if (g_str_has_prefix (key, "www."))
+          key += 4;
+
+     return key;
+}
+
+/*!
+ * @param n A node.
+ * @param c Character of the child (lower case).
+ * @param create \c TRUE to create the child if needed.
+ * @return The child, or \c NULL.
+ */
+static FrecencyNode *frecency_node_child (FrecencyNode *n, gchar c, gboolean create)
+{
+     FrecencyNode *child;
+
+     for (child = n->child; child != NULL; child = child->next)
+     {
+          if (child->c == c)
+               return child;
+     }
+
+     if (!create)
+          return NULL;
+
+     child = g_slice_new0 (FrecencyNode);
+     child->c    = c;
+     child->next = n->child;
+     n->child    = child;
+
+     return child;
+}
+
+/*!
+ * @param n A node.
+ * @param item An item below \a n, whose score increased.
+ *
+ * Move the item up in the best items of the node. As scores only
+ * increase, an item is never moved down.
+ */
+static void frecency_node_update (FrecencyNode *n, FrecencyItem *item)
+{
+     guint i;
+
+     for (i = 0; i < n->ntop && n->top[i] != item; ++i);
+
+     if (i == n->ntop)
+     {
+          if (n->ntop == FRECENCY_TOP_K)
+          {
+               if (item->score <= n->top[FRECENCY_TOP_K - 1]->score)
+                    return;
+
+               i = FRECENCY_TOP_K - 1;
+          }
+          else
+          {
+               n->top = g_renew (FrecencyItem *, n->top, n->ntop + 1);
+               i = n->ntop++;
+          }
+     }
+
+     for (; i > 0 && n->top[i - 1]->score < item->score; --i)
+          n->top[i] = n->top[i - 1];
+
+     n->top[i] = item;
+}
+
+/*!
+ * @param f A #Frecency.
+ * @param key A key.
+ * @param score New score of the key.
+ * @return The item of the key.
+ *
+ * Raise the score of a key, and update the index.
+ */
+static FrecencyItem *frecency_set (Frecency *f, const gchar *key, gdouble score)
+{
+     FrecencyItem *item = g_hash_table_lookup (f->items, key);
+     FrecencyNode *n = &f->root;
+     gboolean created = FALSE;
+     const gchar *p;
+     guint depth;
+
+     if (item == NULL)
+     {
+          item = g_slice_new (FrecencyItem);
+          item->key   = g_strdup (key);
+          item->name  = frecency_name (f, item->key);
+          item->score = score;
+          created     = TRUE;
+
+          g_hash_table_insert (f->items, item->key, item);
+     }
+     else if (score > item->score)
+          item->score = score;
+     else
+          return item;
+
+     frecency_node_update (n, item);
+
+     for (p = item->name, depth = 0; *p != '\0' && depth < FRECENCY_INDEX_DEPTH; ++p, ++depth)
+     {
+          n = frecency_node_child (n, g_ascii_tolower (*p), TRUE);
+          frecency_node_update (n, item);
+     }
+
+     if (created && depth == FRECENCY_INDEX_DEPTH)
+     {
+          if (n->items == NULL)
+               n->items = g_ptr_array_new ();
+
+          g_ptr_array_add (n->items, item);
+     }
+
+     return item;
+}
+
+/*!
+ * @param item A #FrecencyItem.
+ * @return Journal line of the item (must be freed).
+ */
+static gchar *frecency_item_line (FrecencyItem *item)
+{
+     gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+     return g_strconcat (g_ascii_dtostr (buf, sizeof (buf), item->score), "\t", item->key, NULL);
+}
+
+/*!
+ * @param f A #Frecency.
+ *
+ * Rewrite the journal if it holds too many stale lines.
+ */
+static void frecency_compact (Frecency *f)
+{
+     GHashTableIter iter;
+     gpointer item;
+     GString *data;
+
+     if (f->lines <= 2 * g_hash_table_size (f->items) + FRECENCY_COMPACT_SLACK)
+          return;
+
+     data = g_string_new (NULL);
+
+     g_hash_table_iter_init (&iter, f->items);
+     while (g_hash_table_iter_next (&iter, NULL, &item))
+     {
+          gchar *line = frecency_item_line (item);
+          g_string_append_printf (data, "%s\r\n", line);
+          g_free (line);
+     }
+
+     cache_rewrite (f->path, data);
+     f->lines = g_hash_table_size (f->items);
+}
+
+static gboolean frecency_replay (const gchar *record, gsize len, gpointer data)
+{
+     Frecency *f = data;
+     gchar *line = g_strndup (record, len);
+     gchar *key = strchr (line, '\t');
+
+     if (key != NULL)
+     {
+          *key++ = '\0';
+          frecency_set (f, key, g_ascii_strtod (line, NULL));
+     }
+
+     f->lines++;
+     g_free (line);
+
+     return TRUE;
+}
+
+/*!
+ * @param f A #Frecency.
+ *
+ * Read the journal, if it is not loaded yet.
+ */
+static void frecency_load (Frecency *f)
+{
+     GError *error = NULL;
+
+     if (f->loaded)
+          return;
+
+     f->loaded = TRUE;
+
+     if (!cache_foreach (f->path, frecency_replay, f, &error))
+          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+
+     frecency_compact (f);
+}
+
+/*!
+ * @param f A #Frecency.
+ * @param key The used URI or command.
+ * @param time Time of use (microseconds since Epoch).
+ *
+ * Record a use of a key.
+ */
+void frecency_add (Frecency *f, const gchar *key, gint64 time)
+{
+     FrecencyItem *item;
+     gdouble score, old;
+     gchar *line;
+
+     g_return_if_fail (f != NULL);
+     g_return_if_fail (key != NULL && *key != '\0');
+
+     /* can not be journaled */
+     if (strpbrk (key, "\r\n") != NULL)
+          return;
+
+     frecency_load (f);
+
+     score = FRECENCY_DECAY * time / G_USEC_PER_SEC;
+
+     /* log (exp (old) + exp (score)) */
+     if ((item = g_hash_table_lookup (f->items, key)) != NULL)
+     {
+          old   = item->score;
+          score = MAX (old, score) + log1p (exp (MIN (old, score) - MAX (old, score)));
+     }
+
+     item = frecency_set (f, key, score);
+
+     line = frecency_item_line (item);
+     cache_appendto (f->path, line);
+     g_free (line);
+
+     f->lines++;
+     frecency_compact (f);
+}
+
+/*!
+ * @param f A #Frecency.
+ * @param prefix Prefix of the keys (for URIs, the scheme and <code>www.</code> are ignored).
+ * @param n Maximum number of items (at most #FRECENCY_TOP_K for short prefixes).
+ * @param items Array of at least \a n items to fill, by decreasing score.
+ * @return Number of items found.
+ *
+ * Find the best keys starting with a prefix (case insensitive).
+ */
+guint frecency_query (Frecency *f, const gchar *prefix, guint n, const FrecencyItem **items)
+{
+     FrecencyNode *node = &f->root;
+     const gchar *p;
+     gsize len;
+     guint depth, i, j, ret = 0;
+
+     g_return_val_if_fail (f != NULL, 0);
+     g_return_val_if_fail (prefix != NULL, 0);
+
+     frecency_load (f);
+     prefix = frecency_name (f, prefix);
+
+     for (p = prefix, depth = 0; *p != '\0' && depth < FRECENCY_INDEX_DEPTH; ++p, ++depth)
+     {
+          if ((node = frecency_node_child (node, g_ascii_tolower (*p), FALSE)) == NULL)
+               return 0;
+     }
+
+     if (*p == '\0')
+     {
+          ret = MIN (n, node->ntop);
+          memcpy (items, node->top, ret * sizeof (FrecencyItem *));
+          return ret;
+     }
+
+     /* deeper prefix: filter the items below the node */
+     if (node->items == NULL)
+          return 0;
+
+     len = strlen (prefix);
+
+     for (i = 0; i < node->items->len; ++i)
+     {
+          FrecencyItem *item = g_ptr_array_index (node->items, i);
+
+          if (g_ascii_strncasecmp (item->name, prefix, len) != 0)
+               continue;
+
+          if (ret == n && (n == 0 || item->score <= items[n - 1]->score))
+               continue;
+
+          if (ret < n)
+               ret++;
+
+          for (j = ret - 1; j > 0 && items[j - 1]->score < item->score; --j)
+               items[j] = items[j - 1];
+
+          items[j] = item;
+     }
+
+     return ret;
+}
+
+/*!
+ * @param item A #FrecencyItem.
+ * @param now Current time (microseconds since Epoch).
+ * @return Decayed weight of the uses of the item, at \a now.
+ */
+gdouble frecency_score (const FrecencyItem *item, gint64 now)
+{
+     g_return_val_if_fail (item != NULL, 0);
+
+     return exp (item->score - FRECENCY_DECAY * now / G_USEC_PER_SEC);
+}
+
+/*! @} */
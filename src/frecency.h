@@ -0,0 +1,75 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __FRECENCY_H
+#define __FRECENCY_H
+
+/*!
+ * \defgroup frecency Frecency
+ * Rank URIs and commands by frequency and recency of use.
+ *
+ * Each use of a key adds a weight which halves every
+ * #FRECENCY_HALF_LIFE seconds. The sum is kept as its logarithm,
+ * relative to the Epoch: it only grows, and the order between keys does
+ * not change over time, so rankings are never recomputed.
+ *
+ * Keys are indexed in a prefix tree whose nodes keep their
+ * #FRECENCY_TOP_K best keys, updated on each use: a "top-K for this
+ * prefix" query walks the prefix and copies the node's list.
+ *
+ * Scores are journaled in the cache, and loaded on first use.
+ *
+ * @{
+ */
+
+#include <glib.h>
+
+#define FRECENCY_HALF_LIFE         (30 * 24 * 3600)    /*!< Seconds for a use to lose half its weight */
+#define FRECENCY_TOP_K             16                  /*!< Best keys kept by each node of the index */
+#define FRECENCY_INDEX_DEPTH       12                  /*!< Depth of the index, deeper prefixes are filtered */
+
+typedef struct _Frecency Frecency;
+
+/*!
+ * \struct FrecencyItem
+ * A ranked key.
+ */
+typedef struct
+{
+     gchar *key;         /*!< URI or command */
+     const gchar *name;  /*!< Indexed part of the key */
+     gdouble score;      /*!< Logarithm of the weights, relative to the Epoch */
+} FrecencyItem;
+
+Frecency *frecency_new (const gchar *path, gboolean uris);
+void frecency_free (Frecency *f);
+
+void frecency_add (Frecency *f, const gchar *key, gint64 time);
+guint frecency_query (Frecency *f, const gchar *prefix, guint n, const FrecencyItem **items);
+gdouble frecency_score (const FrecencyItem *item, gint64 now);
+
+/*! @} */
+
+#endif /* __FRECENCY_H */
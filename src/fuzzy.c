@@ -0,0 +1,220 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+
+#if defined (__AVX2__)
+#    include <immintrin.h>
+#elif defined (__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+/*!
+ * \addtogroup fuzzy
+ * @{
+ */
+
+/*!
+ * @param c A character.
+ * @return Its bit in the masks: one per letter and digit, the other
+ * bytes share the remaining ones.
+ */
+static inline guint fuzzy_bit (guchar c)
+{
+     c = g_ascii_tolower (c);
+
+     if (c >= 'a' && c <= 'z')
+          return c - 'a';
+     else if (c >= '0' && c <= '9')
+          return 26 + c - '0';
+
+     return 36 + c % 28;
+}
+
+/*!
+ * @param str A string.
+ * @return The mask of the characters of \a str.
+ */
+guint64 fuzzy_mask (const gchar *str)
+{
+     guint64 mask = 0;
+
+     for (; *str != '\0'; ++str)
+          mask |= G_GUINT64_CONSTANT (1) << fuzzy_bit (*str);
+
+     return mask;
+}
+
+/*!
+ * @param masks Masks of the candidates.
+ * @param n Number of candidates.
+ * @param mask Mask of the pattern.
+ * @param out Array of at least \a n indexes, filled with the candidates left.
+ * @return Number of candidates containing all the characters of the pattern.
+ */
+guint fuzzy_filter (const guint64 *masks, guint n, guint64 mask, guint *out)
+{
+     guint i = 0, k = 0;
+
+#if defined (__AVX2__)
+     __m256i q = _mm256_set1_epi64x (mask);
+
+     for (; i + 4 <= n; i += 4)
+     {
+          __m256i m  = _mm256_loadu_si256 ((const __m256i *) (masks + i));
+          __m256i eq = _mm256_cmpeq_epi64 (_mm256_and_si256 (m, q), q);
+          gint bits  = _mm256_movemask_pd (_mm256_castsi256_pd (eq));
+
+          while (bits != 0)
+          {
+               out[k++] = i + g_bit_nth_lsf (bits, -1);
+               bits &= bits - 1;
+          }
+     }
+#elif defined (__SSE2__)
+     /* no 64-bits comparison in SSE2: both halves must be equal */
+     __m128i q = _mm_set1_epi64x (mask);
+
+     for (; i + 2 <= n; i += 2)
+     {
+          __m128i m = _mm_loadu_si128 ((const __m128i *) (masks + i));
+          gint bits = _mm_movemask_ps (_mm_castsi128_ps (_mm_cmpeq_epi32 (_mm_and_si128 (m, q), q)));
+
+          if ((bits & 0x3) == 0x3)
+               out[k++] = i;
+          if ((bits & 0xC) == 0xC)
+               out[k++] = i + 1;
+     }
+#endif
+
+     for (; i < n; ++i)
+     {
+          if ((masks[i] & mask) == mask)
+               out[k++] = i;
+     }
+
+     return k;
+}
+
+/*!
+ * @param str A string.
+ * @param i Position of a character in \a str.
+ * @return Bonus of the character if it starts a word.
+ */
+static inline gint fuzzy_boundary (const gchar *str, gsize i)
+{
+     guchar prev, c = str[i];
+
+     if (i == 0)
+          return FUZZY_BONUS_BOUNDARY;
+
+     prev = str[i - 1];
+
+     if (!g_ascii_isalnum (prev) && prev < 0x80)
+          return FUZZY_BONUS_BOUNDARY;
+
+     /* camelCase */
+     if (g_ascii_islower (prev) && g_ascii_isupper (c))
+          return FUZZY_BONUS_BOUNDARY - 1;
+
+     return 0;
+}
+
+/*!
+ * @param pattern Lower case pattern.
+ * @param str A candidate, as is: its case finds the camelCase words.
+ * @param score Set to the score of \a str if it matches.
+ * @return \c TRUE if \a str contains the characters of \a pattern, in order.
+ *
+ * The characters are first matched as early as possible, then again
+ * backward from the last one, to find a short window. The window is
+ * scored: each character of the pattern is worth #FUZZY_SCORE_MATCH,
+ * plus a bonus at the start of a word (doubled for the first one) or
+ * after a matched character, and each gap costs.
+ */
+gboolean fuzzy_match (const gchar *pattern, const gchar *str, gint *score)
+{
+     gsize plen = strlen (pattern), start = 0, end = 0, i, p = 0;
+     gint s = 0, run = 0, bonus;
+     gboolean gap = FALSE;
+
+     if (plen == 0)
+     {
+          *score = 0;
+          return TRUE;
+     }
+
+     /* forward: first end of a match */
+     for (i = 0; str[i] != '\0'; ++i)
+     {
+          if (g_ascii_tolower (str[i]) == pattern[p] && ++p == plen)
+          {
+               end = i + 1;
+               break;
+          }
+     }
+
+     if (p < plen)
+          return FALSE;
+
+     /* backward: latest start for this end */
+     for (i = end, p = plen; i-- > 0;)
+     {
+          if (g_ascii_tolower (str[i]) == pattern[p - 1] && --p == 0)
+          {
+               start = i;
+               break;
+          }
+     }
+
+     for (i = start, p = 0; i < end; ++i)
+     {
+          if (p < plen && g_ascii_tolower (str[i]) == pattern[p])
+          {
+               bonus = fuzzy_boundary (str, i);
+
+               if (run > 0)
+                    bonus = MAX (bonus, FUZZY_BONUS_CONSECUTIVE);
+               if (p == 0)
+                    bonus *= 2;
+
+               s += FUZZY_SCORE_MATCH + bonus;
+               run++;
+               p++;
+               gap = FALSE;
+          }
+          else
+          {
+               s -= (gap ? FUZZY_PENALTY_GAP : FUZZY_PENALTY_GAP_START);
+               run = 0;
+               gap = TRUE;
+          }
+     }
+
+     *score = s;
+     return TRUE;
+}
+
+/*! @} */
@@ -0,0 +1,60 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __FUZZY_H
+#define __FUZZY_H
+
+/*!
+ * \defgroup fuzzy Fuzzy matching
+ * Rank strings containing the characters of a pattern, in order.
+ *
+ * Each candidate has a 64-bits mask of the characters it contains
+ * (fuzzy_mask()). fuzzy_filter() rejects the candidates missing a
+ * character of the pattern by comparing the masks, several at a time
+ * with SSE2 or AVX2 when the compiler targets them. fuzzy_match() then
+ * scores the remaining ones: each matched character counts, more at
+ * the start of a word and in contiguous runs, and the gaps between
+ * them cost.
+ *
+ * Matching ignores the case of ASCII letters.
+ *
+ * @{
+ */
+
+#include <glib.h>
+
+#define FUZZY_SCORE_MATCH          16        /*!< Score of a matched character */
+#define FUZZY_BONUS_BOUNDARY       8         /*!< Bonus of a character starting a word */
+#define FUZZY_BONUS_CONSECUTIVE    4         /*!< Minimal bonus of a character following a matched one */
+#define FUZZY_PENALTY_GAP_START    3         /*!< Cost of the first skipped character of a gap */
+#define FUZZY_PENALTY_GAP          1         /*!< Cost of the next skipped characters */
+
+guint64 fuzzy_mask (const gchar *str);
+guint fuzzy_filter (const guint64 *masks, guint n, guint64 mask, guint *out);
+gboolean fuzzy_match (const gchar *pattern, const gchar *str, gint *score);
+
+/*! @} */
+
+#endif /* __FUZZY_H */
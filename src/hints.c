@@ -0,0 +1,211 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+
+/*!
+ * \addtogroup hints
+ * @{
+ */
+
+#define CREAM_HINTS_ERROR          (cream_hints_error_quark ())
+
+typedef enum
+{
+     CREAM_HINTS_ERROR_ALPHABET,
+     CREAM_HINTS_ERROR_NONE
+} CreamHintsError;
+
+static GQuark cream_hints_error_quark (void)
+{
+     static GQuark domain = 0;
+
+     if (!domain)
+          domain = g_quark_from_string ("cream.hints");
+
+     return domain;
+}
+
+static WebView *webview = NULL;    /*!< Hinted webview, or \c NULL */
+static gchar *alphabet = NULL;
+static GString *typed = NULL;      /*!< Characters typed so far */
+
+/*!
+ * @param chars Characters of the labels.
+ * @return \c TRUE if \a chars is a valid alphabet.
+ *
+ * The labels are sent to the page as they are, so only alphanumeric
+ * ASCII characters are allowed, each one once.
+ */
+static gboolean hints_check_alphabet (const gchar *chars)
+{
+     gboolean seen[128] = { FALSE };
+     const gchar *c;
+
+     for (c = chars; *c != '\0'; ++c)
+     {
+          if (!g_ascii_isalnum (*c) || seen[(guchar) *c])
+               return FALSE;
+
+          seen[(guchar) *c] = TRUE;
+     }
+
+     return (c - chars >= 2);
+}
+
+/*!
+ * @param w A #WebView object.
+ * @param chars Characters of the labels, or \c NULL for #HINTS_ALPHABET.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE if hints are shown, \c FALSE otherwise.
+ *
+ * Label the clickable elements of \a w, and enter hint mode.
+ */
+gboolean hints_start (WebView *w, const gchar *chars, GError **err)
+{
+     guint n;
+
+     if (chars == NULL)
+          chars = HINTS_ALPHABET;
+
+     if (!hints_check_alphabet (chars))
+     {
+          g_set_error (err, CREAM_HINTS_ERROR, CREAM_HINTS_ERROR_ALPHABET,
+                       _("Invalid hints alphabet '%s': expected at least 2 different letters or digits"), chars);
+          return FALSE;
+     }
+
+     hints_stop ();
+
+     n = cream_module_hints_show (CREAM_MODULE (webview_get_module (w)), webview_get_child (w), chars);
+     if (n == 0)
+     {
+          g_set_error (err, CREAM_HINTS_ERROR, CREAM_HINTS_ERROR_NONE, _("No element to follow"));
+          return FALSE;
+     }
+
+     webview = w;
+     g_object_add_weak_pointer (G_OBJECT (webview), (gpointer *) &webview);
+
+     g_free (alphabet);
+     alphabet = g_strdup (chars);
+
+     if (typed == NULL)
+          typed = g_string_new (NULL);
+     g_string_truncate (typed, 0);
+
+     statusbar_set_state (CREAM_STATUSBAR (app->gui.statusbar), CREAM_MODE_HINT);
+     return TRUE;
+}
+
+/*!
+ * Hide the hints, and go back to normal mode.
+ */
+void hints_stop (void)
+{
+     if (webview == NULL)
+          return;
+
+     cream_module_hints_hide (CREAM_MODULE (webview_get_module (webview)), webview_get_child (webview));
+
+     g_object_remove_weak_pointer (G_OBJECT (webview), (gpointer *) &webview);
+     webview = NULL;
+
+     if (app->mode == CREAM_MODE_HINT)
+          statusbar_set_state (CREAM_STATUSBAR (app->gui.statusbar), CREAM_MODE_NORMAL);
+}
+
+/*!
+ * @param ekey A key pressed in hint mode.
+ * @return \c TRUE, hint mode takes all the keys.
+ *
+ * Filter the hints with the typed characters, and follow the element
+ * once its hint is the only one left. Characters which match no hint
+ * are ignored.
+ */
+gboolean hints_keypress (GdkEventKey *ekey)
+{
+     CreamModule *mod;
+     GtkWidget *child;
+     gunichar c;
+     guint n;
+
+     /* the webview was closed */
+     if (webview == NULL)
+     {
+          statusbar_set_state (CREAM_STATUSBAR (app->gui.statusbar), CREAM_MODE_NORMAL);
+          return TRUE;
+     }
+
+     mod   = CREAM_MODULE (webview_get_module (webview));
+     child = webview_get_child (webview);
+
+     if (ekey->keyval == GDK_KEY_Escape)
+     {
+          hints_stop ();
+          return TRUE;
+     }
+
+     if (ekey->keyval == GDK_KEY_BackSpace)
+     {
+          if (typed->len > 0)
+          {
+               g_string_truncate (typed, typed->len - 1);
+               cream_module_hints_filter (mod, child, typed->str);
+          }
+
+          return TRUE;
+     }
+
+     c = gdk_keyval_to_unicode (ekey->keyval);
+     if (c == 0 || c >= 128 || strchr (alphabet, (gchar) c) == NULL)
+          return TRUE;
+
+     g_string_append_c (typed, (gchar) c);
+     n = cream_module_hints_filter (mod, child, typed->str);
+
+     if (n == 0)
+     {
+          /* no such label: show the previous hints again */
+          g_string_truncate (typed, typed->len - 1);
+          cream_module_hints_filter (mod, child, typed->str);
+     }
+     else if (n == 1)
+     {
+          gboolean editable = cream_module_hints_follow (mod, child);
+
+          /* the hints are only needed by the follow, release them now */
+          cream_module_hints_hide (mod, child);
+
+          g_object_remove_weak_pointer (G_OBJECT (webview), (gpointer *) &webview);
+          webview = NULL;
+
+          statusbar_set_state (CREAM_STATUSBAR (app->gui.statusbar), (editable ? CREAM_MODE_INSERT : CREAM_MODE_NORMAL));
+     }
+
+     return TRUE;
+}
+
+/*! @} */
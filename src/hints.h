@@ -0,0 +1,54 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __HINTS_H
+#define __HINTS_H
+
+/*!
+ * \defgroup hints Hints
+ * Follow links with the keyboard.
+ *
+ * Hint mode (#CREAM_MODE_HINT) labels the clickable elements visible in
+ * the focused #WebView. Typing the characters of a label filters the
+ * hints, and the element is activated as soon as a single hint is left:
+ * links are clicked, editable elements are focused (#CREAM_MODE_INSERT).
+ * Escape leaves the mode.
+ *
+ * @{
+ */
+
+#include <gtk/gtk.h>
+
+#include "WebView.h"
+
+#define HINTS_ALPHABET             "asdfghjkl"    /*!< Default characters of the labels */
+
+gboolean hints_start (WebView *w, const gchar *alphabet, GError **err);
+gboolean hints_keypress (GdkEventKey *ekey);
+void hints_stop (void);
+
+/*! @} */
+
+#endif /* __HINTS_H */
@@ -0,0 +1,1309 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+#include "archive.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*!
+ * \addtogroup history
+ * @{
+ */
+
+#define CREAM_HISTORY_ERROR        (cream_history_error_quark ())
+
+typedef enum
+{
+     CREAM_HISTORY_ERROR_IO,
+     CREAM_HISTORY_ERROR_FAILED
+} CreamHistoryError;
+
+static GQuark cream_history_error_quark (void)
+{
+     static GQuark domain = 0;
+
+     if (!domain)
+          domain = g_quark_from_string ("cream.history");
+
+     return domain;
+}
+
+#define HISTORY_VERSION            1
+
+#define HISTORY_MAGIC_LOG          0x474C4843     /* "CHLG" */
+#define HISTORY_MAGIC_INDEX        0x58494843     /* "CHIX" */
+#define HISTORY_MAGIC_HASH         0x53484843     /* "CHHS" */
+#define HISTORY_MAGIC_SORTED       0x54534843     /* "CHST" */
+
+#define HISTORY_HASH_MIN_SIZE      1024           /*!< Initial number of buckets */
+#define HISTORY_SORT_THRESHOLD     8192           /*!< Unsorted visits before merging the sorted index */
+#define HISTORY_HOT_SIZE           (8 << 20)      /*!< Bytes of log before moving its oldest half to the archive */
+
+#define HISTORY_ALIGN(n)           (((n) + 7) & ~((gsize) 7))
+
+/*!
+ * \struct HistoryHeader
+ * Header of each history file.
+ */
+typedef struct
+{
+     guint32 magic;      /*!< File's magic */
+     guint32 version;    /*!< Format version */
+     guint64 used;       /*!< Bytes (log) or elements (indexes) used */
+     guint64 extra;      /*!< Number of buckets (hash), or number of visits indexed (sorted) */
+     guint64 reserved;
+} HistoryHeader;
+
+/*!
+ * \struct HistoryRecord
+ * A visit in the log, followed by the URI and the title (both
+ * nul-terminated), padded to 8 bytes.
+ */
+typedef struct
+{
+     gint64 time;
+     guint32 hash;
+     guint32 urilen;
+     guint32 titlelen;
+     guint32 visits;     /*!< Visits of the URI, this one included (0 in old logs) */
+} HistoryRecord;
+
+/*!
+ * \struct HistoryEntry
+ * Entry of the visit index.
+ */
+typedef struct
+{
+     gint64 time;        /*!< Time of the visit */
+     guint64 offset;     /*!< Offset of the #HistoryRecord in the log */
+     guint32 hash;       /*!< URI's hash */
+     guint32 visits;     /*!< Visits of the URI, this one included */
+} HistoryEntry;
+
+/*!
+ * \struct HistoryBucket
+ * Bucket of the URI hash table.
+ */
+typedef struct
+{
+     guint32 hash;       /*!< URI's hash */
+     guint32 entry;      /*!< Latest visit + 1, or 0 if the bucket is empty */
+} HistoryBucket;
+
+/*!
+ * \struct HistoryFile
+ * A memory-mapped history file.
+ */
+typedef struct
+{
+     gchar *path;
+     gint fd;
+     gchar *data;
+     gsize length;
+} HistoryFile;
+
+/*!
+ * \struct HistoryRollover
+ * Oldest visits of the log being moved to a new segment of the archive.
+ */
+typedef struct
+{
+     History *h;
+     GThread *thread;
+     GError *error;
+
+     gchar *segment;     /*!< Path of the new segment */
+     gchar *newlog;      /*!< Path of the new log */
+
+     gchar *head;        /*!< Copy of the archived part of the log */
+     HistoryItem *items; /*!< Visits to archive, pointing in \a head */
+     guint32 *hashes;    /*!< Hashes of their URIs */
+     guint n;
+
+     GByteArray *tail;   /*!< New log: header and the visits kept */
+     guint64 end;        /*!< End of the log when the copy was done */
+} HistoryRollover;
+
+struct _History
+{
+     HistoryFile log;
+     HistoryFile index;
+     HistoryFile hash;
+     HistoryFile sorted;
+
+     HistoryArchive *archive;
+     HistoryRollover *rollover;
+     GStringChunk *strings;   /*!< Strings of the items read from the archive */
+};
+
+#define HISTORY_HEADER(f)          ((HistoryHeader *) (f)->data)
+#define HISTORY_RECORD(h,off)      ((HistoryRecord *) ((h)->log.data + (off)))
+#define HISTORY_RECORD_URI(r)      ((const gchar *) ((r) + 1))
+#define HISTORY_RECORD_TITLE(r)    (HISTORY_RECORD_URI (r) + (r)->urilen + 1)
+#define HISTORY_ENTRIES(h)         ((HistoryEntry *) ((h)->index.data + sizeof (HistoryHeader)))
+#define HISTORY_BUCKETS(h)         ((HistoryBucket *) ((h)->hash.data + sizeof (HistoryHeader)))
+#define HISTORY_SORTED(h)          ((guint32 *) ((h)->sorted.data + sizeof (HistoryHeader)))
+
+/*!
+ * @param str String to hash.
+ * @return 32-bits FNV-1a hash of \a str.
+ *
+ * The hash is stored on disk, so it must not depend on GLib's
+ * implementation of <code>g_str_hash()</code>.
+ */
+static guint32 history_hash (const gchar *str)
+{
+     guint32 h = 2166136261U;
+
+     for (; *str; ++str)
+          h = (h ^ (guchar) *str) * 16777619U;
+
+     return h;
+}
+
+/*!
+ * @param f A #HistoryFile.
+ * @param length New length of the file.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Resize and map the file again.
+ */
+static gboolean history_file_resize (HistoryFile *f, gsize length, GError **err)
+{
+     gsize old = f->length;
+
+     if (f->data != NULL)
+          munmap (f->data, f->length);
+
+     f->data = NULL;
+     f->length = 0;
+
+     if (ftruncate (f->fd, length) != 0)
+     {
+          g_set_error (err, CREAM_HISTORY_ERROR, CREAM_HISTORY_ERROR_IO, "%s: %s", f->path, g_strerror (errno));
+          return FALSE;
+     }
+
+     quota_account (f->path, (gint64) length - (gint64) old);
+
+     f->data = mmap (NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, f->fd, 0);
+     if (f->data == MAP_FAILED)
+     {
+          f->data = NULL;
+          g_set_error (err, CREAM_HISTORY_ERROR, CREAM_HISTORY_ERROR_IO, "%s: %s", f->path, g_strerror (errno));
+          return FALSE;
+     }
+
+     f->length = length;
+     return TRUE;
+}
+
+/*!
+ * @param f A #HistoryFile.
+ * @param length Minimal length needed.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Grow the file (at least twice its size) if it is smaller than \a length.
+ */
+static gboolean history_file_reserve (HistoryFile *f, gsize length, GError **err)
+{
+     gsize pagesize = sysconf (_SC_PAGESIZE);
+
+     if (length <= f->length)
+          return TRUE;
+
+     length = MAX (length, f->length * 2);
+     length = (length + pagesize - 1) & ~(pagesize - 1);
+
+     return history_file_resize (f, length, err);
+}
+
+/*!
+ * @param f A #HistoryFile.
+ * @param name Name of the file in the history directory.
+ * @param magic File's magic.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Open and map a history file, create it (or reset it if its header
+ * is invalid).
+ */
+static gboolean history_file_open (HistoryFile *f, const gchar *name, guint32 magic, GError **err)
+{
+     HistoryHeader *header;
+     struct stat st;
+
+     f->path = cache_path (CACHE_TYPE_HISTORY, name);
+     f->data = NULL;
+     f->length = 0;
+
+     f->fd = open (f->path, O_RDWR | O_CREAT, 0600);
+     if (f->fd < 0 || fstat (f->fd, &st) != 0)
+     {
+          g_set_error (err, CREAM_HISTORY_ERROR, CREAM_HISTORY_ERROR_IO, "%s: %s", f->path, g_strerror (errno));
+          return FALSE;
+     }
+
+     /* the file is kept mapped, it can not be evicted */
+     quota_pin (f->path);
+
+     f->length = st.st_size;
+     if (!history_file_resize (f, MAX ((gsize) st.st_size, (gsize) sysconf (_SC_PAGESIZE)), err))
+          return FALSE;
+
+     header = HISTORY_HEADER (f);
+     if (st.st_size < sizeof (HistoryHeader) || header->magic != magic || header->version != HISTORY_VERSION)
+     {
+          memset (f->data, 0, f->length);
+          header->magic   = magic;
+          header->version = HISTORY_VERSION;
+     }
+
+     return TRUE;
+}
+
+/*!
+ * @param f A #HistoryFile.
+ *
+ * Unmap and close a history file.
+ */
+static void history_file_close (HistoryFile *f)
+{
+     if (f->data != NULL)
+          munmap (f->data, f->length);
+
+     if (f->fd >= 0)
+          close (f->fd);
+
+     g_free (f->path);
+}
+
+/*!
+ * @param h A #History object.
+ * @param uri URI to look for.
+ * @param hash Hash of \a uri.
+ * @param found Set to \c TRUE if \a uri is already in the table.
+ * @return The index of the bucket containing \a uri, or of the empty
+ * bucket where it should be inserted.
+ */
+static guint32 history_find_bucket (History *h, const gchar *uri, guint32 hash, gboolean *found)
+{
+     HistoryBucket *buckets = HISTORY_BUCKETS (h);
+     HistoryEntry *entries = HISTORY_ENTRIES (h);
+     guint32 mask = HISTORY_HEADER (&h->hash)->extra - 1;
+     guint32 i;
+
+     for (i = hash & mask; buckets[i].entry != 0; i = (i + 1) & mask)
+     {
+          if (buckets[i].hash == hash)
+          {
+               HistoryRecord *rec = HISTORY_RECORD (h, entries[buckets[i].entry - 1].offset);
+
+               if (g_str_equal (HISTORY_RECORD_URI (rec), uri))
+               {
+                    *found = TRUE;
+                    return i;
+               }
+          }
+     }
+
+     *found = FALSE;
+     return i;
+}
+
+/*!
+ * @param h A #History object.
+ * @param id A visit.
+ * @return \c TRUE if \a id is the latest visit of its URI.
+ */
+static gboolean history_is_latest (History *h, guint32 id)
+{
+     HistoryEntry *entry = &HISTORY_ENTRIES (h)[id];
+     gboolean found;
+     guint32 i;
+
+     i = history_find_bucket (h, HISTORY_RECORD_URI (HISTORY_RECORD (h, entry->offset)), entry->hash, &found);
+     return found && HISTORY_BUCKETS (h)[i].entry == id + 1;
+}
+
+/*!
+ * @param h A #History object.
+ * @param size Number of buckets (power of 2).
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Rebuild the hash table from the visit index.
+ */
+static gboolean history_rebuild_hash (History *h, guint64 size, GError **err)
+{
+     HistoryHeader *header;
+     guint64 i, count = HISTORY_HEADER (&h->index)->used;
+
+     while (size < count * 2)
+          size *= 2;
+
+     if (!history_file_reserve (&h->hash, sizeof (HistoryHeader) + size * sizeof (HistoryBucket), err))
+          return FALSE;
+
+     header = HISTORY_HEADER (&h->hash);
+     memset (HISTORY_BUCKETS (h), 0, size * sizeof (HistoryBucket));
+     header->used  = 0;
+     header->extra = size;
+
+     for (i = 0; i < count; ++i)
+     {
+          HistoryEntry *entry = &HISTORY_ENTRIES (h)[i];
+          HistoryRecord *rec = HISTORY_RECORD (h, entry->offset);
+          gboolean found;
+          guint32 b = history_find_bucket (h, HISTORY_RECORD_URI (rec), entry->hash, &found);
+
+          if (!found)
+          {
+               HISTORY_BUCKETS (h)[b].hash = entry->hash;
+               header->used++;
+          }
+
+          HISTORY_BUCKETS (h)[b].entry = i + 1;
+     }
+
+     return TRUE;
+}
+
+/*!
+ * @param h A #History object.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Double the size of the hash table. Buckets are unique, so they are
+ * moved without comparing URIs.
+ */
+static gboolean history_grow_hash (History *h, GError **err)
+{
+     guint64 i, size = HISTORY_HEADER (&h->hash)->extra;
+     HistoryBucket *old = g_memdup (HISTORY_BUCKETS (h), size * sizeof (HistoryBucket));
+     HistoryBucket *buckets;
+     guint32 mask;
+
+     if (!history_file_reserve (&h->hash, sizeof (HistoryHeader) + size * 2 * sizeof (HistoryBucket), err))
+     {
+          g_free (old);
+          return FALSE;
+     }
+
+     HISTORY_HEADER (&h->hash)->extra = size * 2;
+     buckets = HISTORY_BUCKETS (h);
+     mask = size * 2 - 1;
+     memset (buckets, 0, size * 2 * sizeof (HistoryBucket));
+
+     for (i = 0; i < size; ++i)
+     {
+          guint32 b;
+
+          if (old[i].entry == 0)
+               continue;
+
+          for (b = old[i].hash & mask; buckets[b].entry != 0; b = (b + 1) & mask);
+          buckets[b] = old[i];
+     }
+
+     g_free (old);
+     return TRUE;
+}
+
+/*!
+ * @param h A #History object.
+ * @param offset Offset of a #HistoryRecord in the log.
+ * @return Size of the record, padding included, or 0 if it does not
+ * fit in the used part of the log or its strings are not terminated.
+ */
+static guint64 history_record_size (History *h, guint64 offset)
+{
+     guint64 limit = sizeof (HistoryHeader) + HISTORY_HEADER (&h->log)->used;
+     HistoryRecord *rec;
+     guint64 size;
+
+     if (offset < sizeof (HistoryHeader) || offset + sizeof (HistoryRecord) > limit)
+          return 0;
+
+     rec  = HISTORY_RECORD (h, offset);
+     size = sizeof (HistoryRecord) + (guint64) rec->urilen + rec->titlelen + 2;
+
+     if (offset + size > limit
+         || HISTORY_RECORD_URI (rec)[rec->urilen] != '\0'
+         || HISTORY_RECORD_TITLE (rec)[rec->titlelen] != '\0')
+          return 0;
+
+     return HISTORY_ALIGN (size);
+}
+
+/*!
+ * @param h A #History object.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Check the indexes against the log after a crash: forget visits
+ * whose record is not entirely in the log, and index records written
+ * after the last indexed visit. The log is truncated before the first
+ * torn record. The hash table is rebuilt if its size does not fit its
+ * file.
+ */
+static gboolean history_recover (History *h, GError **err)
+{
+     HistoryHeader *lheader = HISTORY_HEADER (&h->log);
+     HistoryHeader *iheader = HISTORY_HEADER (&h->index);
+     guint64 end = sizeof (HistoryHeader), size = 0, buckets;
+     gboolean dirty = FALSE;
+
+     /* the used sizes can not be trusted more than the records */
+     if (lheader->used > h->log.length - sizeof (HistoryHeader))
+          lheader->used = h->log.length - sizeof (HistoryHeader);
+
+     if (iheader->used > (h->index.length - sizeof (HistoryHeader)) / sizeof (HistoryEntry))
+     {
+          iheader->used = (h->index.length - sizeof (HistoryHeader)) / sizeof (HistoryEntry);
+          dirty = TRUE;
+     }
+
+     /* forget visits which are not in the log */
+     while (iheader->used > 0 && (size = history_record_size (h, HISTORY_ENTRIES (h)[iheader->used - 1].offset)) == 0)
+     {
+          iheader->used--;
+          dirty = TRUE;
+     }
+
+     if (iheader->used > 0)
+          end = HISTORY_ENTRIES (h)[iheader->used - 1].offset + size;
+
+     /* index the records which are not in the index */
+     while (end < sizeof (HistoryHeader) + lheader->used)
+     {
+          HistoryRecord *rec = HISTORY_RECORD (h, end);
+          HistoryEntry *entry;
+
+          if ((size = history_record_size (h, end)) == 0)
+          {
+               /* torn write: the next visit overwrites it */
+               lheader->used = end - sizeof (HistoryHeader);
+               dirty = TRUE;
+               break;
+          }
+
+          if (!history_file_reserve (&h->index, sizeof (HistoryHeader) + (iheader->used + 1) * sizeof (HistoryEntry), err))
+               return FALSE;
+
+          iheader = HISTORY_HEADER (&h->index);
+          entry = &HISTORY_ENTRIES (h)[iheader->used++];
+          entry->time   = rec->time;
+          entry->offset = end;
+          entry->hash   = rec->hash;
+          entry->visits = MAX (rec->visits, 1);
+
+          end += size;
+          dirty = TRUE;
+     }
+
+     /* the number of buckets is used as a mask */
+     buckets = HISTORY_HEADER (&h->hash)->extra;
+
+     if (dirty || buckets == 0 || (buckets & (buckets - 1)) != 0 || buckets > G_MAXUINT32
+         || buckets > (h->hash.length - sizeof (HistoryHeader)) / sizeof (HistoryBucket))
+          return history_rebuild_hash (h, HISTORY_HASH_MIN_SIZE, err);
+
+     return TRUE;
+}
+
+/*!
+ * @param a First visit.
+ * @param b Second visit.
+ * @param h A #History object.
+ * @return Comparison of the URIs of both visits.
+ */
+static gint history_compare_uri (gconstpointer a, gconstpointer b, gpointer h)
+{
+     HistoryEntry *entries = HISTORY_ENTRIES ((History *) h);
+     HistoryRecord *ra = HISTORY_RECORD ((History *) h, entries[*(guint32 *) a].offset);
+     HistoryRecord *rb = HISTORY_RECORD ((History *) h, entries[*(guint32 *) b].offset);
+
+     return strcmp (HISTORY_RECORD_URI (ra), HISTORY_RECORD_URI (rb));
+}
+
+/*!
+ * @param h A #History object.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Merge the visits added since the last build into the sorted index.
+ * Only the new visits are sorted, the old index is merged linearly,
+ * and outdated visits are dropped.
+ */
+static gboolean history_merge_sorted (History *h, GError **err)
+{
+     HistoryHeader *sheader = HISTORY_HEADER (&h->sorted);
+     guint64 count = HISTORY_HEADER (&h->index)->used;
+     guint32 *tail, *merged, *old;
+     guint64 ntail = 0, nold = 0, n = 0, i, j;
+
+     if (sheader->extra == count)
+          return TRUE;
+
+     tail = g_new (guint32, count - sheader->extra);
+     for (i = sheader->extra; i < count; ++i)
+     {
+          if (history_is_latest (h, i))
+               tail[ntail++] = i;
+     }
+
+     g_qsort_with_data (tail, ntail, sizeof (guint32), history_compare_uri, h);
+
+     old = g_new (guint32, sheader->used);
+     for (i = 0; i < sheader->used; ++i)
+     {
+          if (history_is_latest (h, HISTORY_SORTED (h)[i]))
+               old[nold++] = HISTORY_SORTED (h)[i];
+     }
+
+     merged = g_new (guint32, nold + ntail);
+     for (i = 0, j = 0; i < nold || j < ntail;)
+     {
+          if (j >= ntail || (i < nold && history_compare_uri (&old[i], &tail[j], h) <= 0))
+               merged[n++] = old[i++];
+          else
+               merged[n++] = tail[j++];
+     }
+
+     g_free (tail);
+     g_free (old);
+
+     if (!history_file_reserve (&h->sorted, sizeof (HistoryHeader) + n * sizeof (guint32), err))
+     {
+          g_free (merged);
+          return FALSE;
+     }
+
+     memcpy (HISTORY_SORTED (h), merged, n * sizeof (guint32));
+     g_free (merged);
+
+     sheader = HISTORY_HEADER (&h->sorted);
+     sheader->used  = n;
+     sheader->extra = count;
+
+     return TRUE;
+}
+
+/*!
+ * @param h A #History object.
+ * @param id A visit.
+ * @param item The #HistoryItem to fill.
+ */
+static void history_fill_item (History *h, guint32 id, HistoryItem *item)
+{
+     HistoryEntry *entry = &HISTORY_ENTRIES (h)[id];
+     HistoryRecord *rec = HISTORY_RECORD (h, entry->offset);
+
+     item->uri    = HISTORY_RECORD_URI (rec);
+     item->title  = HISTORY_RECORD_TITLE (rec);
+     item->time   = entry->time;
+     item->visits = entry->visits;
+}
+
+/* Archive */
+
+/*!
+ * @param r A #HistoryRollover.
+ */
+static void history_rollover_free (HistoryRollover *r)
+{
+     if (r->error)
+          g_error_free (r->error);
+
+     if (r->tail)
+          g_byte_array_free (r->tail, TRUE);
+
+     g_free (r->segment);
+     g_free (r->newlog);
+     g_free (r->head);
+     g_free (r->items);
+     g_free (r->hashes);
+     g_free (r);
+}
+
+/*!
+ * @param h A #History object.
+ * @param r The #HistoryRollover done.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Append the visits recorded during the rollover to the new log, and
+ * replace the log with it. The indexes are reset before, so if we
+ * crash, they are rebuilt from whichever log is found.
+ */
+static gboolean history_rollover_finish (History *h, HistoryRollover *r, GError **err)
+{
+     HistoryHeader header = *HISTORY_HEADER (&h->log);
+     guint64 end = sizeof (HistoryHeader) + header.used;
+     gsize oldlen = h->log.length;
+     gint fd;
+
+     if (r->segment != NULL && !archive_add (h->archive, r->segment, err))
+     {
+          unlink (r->newlog);
+          return FALSE;
+     }
+
+     header.used = r->tail->len - sizeof (HistoryHeader) + (end - r->end);
+
+     if ((fd = open (r->newlog, O_WRONLY)) < 0
+         || pwrite (fd, h->log.data + r->end, end - r->end, r->tail->len) != (gssize) (end - r->end)
+         || pwrite (fd, &header, sizeof (header), 0) != sizeof (header))
+     {
+          g_set_error (err, CREAM_HISTORY_ERROR, CREAM_HISTORY_ERROR_IO, "%s: %s", r->newlog, g_strerror (errno));
+
+          if (fd >= 0)
+               close (fd);
+          unlink (r->newlog);
+          return FALSE;
+     }
+
+     close (fd);
+     quota_account (r->newlog, end - r->end);
+
+     /* the indexes will be rebuilt from the log */
+     HISTORY_HEADER (&h->index)->used  = 0;
+     HISTORY_HEADER (&h->hash)->extra  = 0;
+     HISTORY_HEADER (&h->sorted)->used = HISTORY_HEADER (&h->sorted)->extra = 0;
+
+     if (rename (r->newlog, h->log.path) != 0)
+     {
+          g_set_error (err, CREAM_HISTORY_ERROR, CREAM_HISTORY_ERROR_IO, "%s: %s", h->log.path, g_strerror (errno));
+          unlink (r->newlog);
+
+          /* keep the old log */
+          history_recover (h, NULL);
+          return FALSE;
+     }
+
+     quota_account (h->log.path, -(gint64) oldlen);
+     history_file_close (&h->log);
+
+     return history_file_open (&h->log, "log", HISTORY_MAGIC_LOG, err)
+            && history_recover (h, err);
+}
+
+/*!
+ * @param data The #HistoryRollover.
+ * @return \c FALSE, to remove the source.
+ *
+ * Finish the rollover from the main loop, once the thread is done.
+ */
+static gboolean history_rollover_done (gpointer data)
+{
+     HistoryRollover *r = (HistoryRollover *) data;
+     History *h = r->h;
+     GError *error = NULL;
+
+     if (r->thread != NULL)
+          g_thread_join (r->thread);
+
+     h->rollover = NULL;
+
+     if (r->error != NULL)
+     {
+          error = r->error;
+          r->error = NULL;
+     }
+     else
+          history_rollover_finish (h, r, &error);
+
+     if (error != NULL)
+          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+
+     history_rollover_free (r);
+     return FALSE;
+}
+
+/*!
+ * @param data The #HistoryRollover.
+ * @return \c NULL
+ *
+ * Rollover thread: compress the archived visits into a new segment,
+ * and write the visits kept in a new log.
+ */
+static gpointer history_rollover_thread (gpointer data)
+{
+     HistoryRollover *r = (HistoryRollover *) data;
+
+     if (r->segment == NULL || archive_write (r->segment, r->items, r->hashes, r->n, &r->error))
+     {
+          /* on failure, the new segment only holds visits still in the log */
+          if (g_file_set_contents (r->newlog, (const gchar *) r->tail->data, r->tail->len, &r->error))
+               quota_account (r->newlog, r->tail->len);
+     }
+
+     g_idle_add (history_rollover_done, r);
+     return NULL;
+}
+
+/*!
+ * @param h A #History object.
+ *
+ * Move the oldest half of the log to a new segment of the archive.
+ * Only the latest visit of each URI is kept. The visits are copied,
+ * then compressed and written by a low-priority thread, so the log
+ * can still grow meanwhile.
+ */
+static void history_rollover (History *h)
+{
+     HistoryHeader header = *HISTORY_HEADER (&h->log);
+     guint64 count = HISTORY_HEADER (&h->index)->used;
+     HistoryEntry *entries = HISTORY_ENTRIES (h);
+     HistoryRollover *r;
+     GError *error = NULL;
+     guint64 cut, id, i;
+
+     /* first visit of the newest half */
+     for (id = 0; id < count && entries[id].offset - sizeof (HistoryHeader) < header.used / 2; ++id);
+
+     if (id == 0 || id == count)
+          return;
+
+     cut = entries[id].offset;
+
+     r = g_new0 (HistoryRollover, 1);
+     r->h      = h;
+     r->head   = g_memdup (h->log.data, cut);
+     r->items  = g_new (HistoryItem, id);
+     r->hashes = g_new (guint32, id);
+     r->end    = sizeof (HistoryHeader) + header.used;
+     r->newlog = cache_path (CACHE_TYPE_HISTORY, "log.new");
+
+     for (i = 0; i < id; ++i)
+     {
+          HistoryRecord *rec = (HistoryRecord *) (r->head + entries[i].offset);
+
+          /* older visits, or visits shadowed by a newer one, are dropped,
+           * and so are URIs too long for the archive */
+          if (!history_is_latest (h, i) || rec->urilen > ARCHIVE_URI_MAX)
+               continue;
+
+          r->items[r->n].uri    = HISTORY_RECORD_URI (rec);
+          r->items[r->n].title  = HISTORY_RECORD_TITLE (rec);
+          r->items[r->n].time   = entries[i].time;
+          r->items[r->n].visits = entries[i].visits;
+          r->hashes[r->n]       = entries[i].hash;
+          r->n++;
+     }
+
+     if (r->n > 0)
+          r->segment = archive_next_path (h->archive);
+
+     header.used = r->end - cut;
+     r->tail = g_byte_array_sized_new (sizeof (HistoryHeader) + header.used);
+     g_byte_array_append (r->tail, (const guint8 *) &header, sizeof (HistoryHeader));
+     g_byte_array_append (r->tail, (const guint8 *) h->log.data + cut, header.used);
+
+     if ((r->thread = g_thread_create_full (history_rollover_thread, r, 0, TRUE, FALSE, G_THREAD_PRIORITY_LOW, &error)) == NULL)
+     {
+          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+          history_rollover_free (r);
+          return;
+     }
+
+     h->rollover = r;
+}
+
+/*!
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return A new #History object, or \c NULL on failure.
+ *
+ * Open the history of the current profile.
+ */
+History *history_open (GError **err)
+{
+     History *h = g_new0 (History, 1);
+     gchar *dir = cache_path (CACHE_TYPE_HISTORY, NULL);
+     gchar *newlog;
+
+     h->log.fd = h->index.fd = h->hash.fd = h->sorted.fd = -1;
+
+     if (g_mkdir_with_parents (dir, 0700) != 0)
+     {
+          g_set_error (err, CREAM_HISTORY_ERROR, CREAM_HISTORY_ERROR_IO, "%s: %s", dir, g_strerror (errno));
+          g_free (dir);
+          g_free (h);
+          return NULL;
+     }
+
+     g_free (dir);
+
+     /* left by an interrupted rollover */
+     newlog = cache_path (CACHE_TYPE_HISTORY, "log.new");
+     unlink (newlog);
+     g_free (newlog);
+
+     h->archive = archive_open ();
+     h->strings = g_string_chunk_new (4096);
+
+     if (!history_file_open (&h->log, "log", HISTORY_MAGIC_LOG, err)
+         || !history_file_open (&h->index, "index", HISTORY_MAGIC_INDEX, err)
+         || !history_file_open (&h->hash, "hash", HISTORY_MAGIC_HASH, err)
+         || !history_file_open (&h->sorted, "sorted", HISTORY_MAGIC_SORTED, err)
+         || !history_recover (h, err))
+     {
+          history_close (h);
+          return NULL;
+     }
+
+     /* the sorted index can't be newer than the visit index */
+     if (HISTORY_HEADER (&h->sorted)->extra > HISTORY_HEADER (&h->index)->used)
+          HISTORY_HEADER (&h->sorted)->used = HISTORY_HEADER (&h->sorted)->extra = 0;
+
+     return h;
+}
+
+/*!
+ * @param h A #History object.
+ *
+ * Merge pending visits into the sorted index, and close the history.
+ */
+void history_close (History *h)
+{
+     g_return_if_fail (h != NULL);
+
+     /* wait for the rollover, and finish it now */
+     if (h->rollover != NULL)
+     {
+          HistoryRollover *r = h->rollover;
+
+          g_thread_join (r->thread);
+          r->thread = NULL;
+
+          g_source_remove_by_user_data (r);
+          history_rollover_done (r);
+     }
+
+     if (h->sorted.data != NULL && h->index.data != NULL)
+          history_merge_sorted (h, NULL);
+
+     history_file_close (&h->log);
+     history_file_close (&h->index);
+     history_file_close (&h->hash);
+     history_file_close (&h->sorted);
+
+     if (h->archive)
+          archive_close (h->archive);
+
+     if (h->strings)
+          g_string_chunk_free (h->strings);
+
+     g_free (h);
+}
+
+/*!
+ * @param h A #History object.
+ * @param uri Visited URI.
+ * @param title Page's title, or \c NULL.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Record a visit.
+ */
+gboolean history_add (History *h, const gchar *uri, const gchar *title, GError **err)
+{
+     HistoryHeader *header;
+     HistoryRecord *rec;
+     HistoryEntry *entry;
+     HistoryBucket *bucket;
+     HistoryItem item;
+     guint32 hash, visits = 1, b;
+     gsize urilen, titlelen, reclen;
+     guint64 offset, id;
+     gboolean found;
+
+     g_return_val_if_fail (h != NULL, FALSE);
+     g_return_val_if_fail (uri != NULL, FALSE);
+
+     if (title == NULL)
+          title = "";
+
+     g_string_chunk_clear (h->strings);
+
+     hash     = history_hash (uri);
+     urilen   = strlen (uri);
+     titlelen = strlen (title);
+     reclen   = HISTORY_ALIGN (sizeof (HistoryRecord) + urilen + titlelen + 2);
+
+     /* keep the load factor of the hash table under 1/2 */
+     header = HISTORY_HEADER (&h->hash);
+     if ((header->used + 1) * 2 > header->extra && !history_grow_hash (h, err))
+          return FALSE;
+
+     /* append the record to the log */
+     offset = sizeof (HistoryHeader) + HISTORY_HEADER (&h->log)->used;
+     if (!history_file_reserve (&h->log, offset + reclen, err))
+          return FALSE;
+
+     rec = HISTORY_RECORD (h, offset);
+     memset (rec, 0, reclen);
+     rec->time     = g_get_real_time ();
+     rec->hash     = hash;
+     rec->urilen   = urilen;
+     rec->titlelen = titlelen;
+     memcpy ((gchar *) HISTORY_RECORD_URI (rec), uri, urilen);
+     memcpy ((gchar *) HISTORY_RECORD_TITLE (rec), title, titlelen);
+     HISTORY_HEADER (&h->log)->used += reclen;
+
+     /* index it */
+     id = HISTORY_HEADER (&h->index)->used;
+     if (!history_file_reserve (&h->index, sizeof (HistoryHeader) + (id + 1) * sizeof (HistoryEntry), err))
+          return FALSE;
+
+     b = history_find_bucket (h, uri, hash, &found);
+     bucket = &HISTORY_BUCKETS (h)[b];
+
+     if (found)
+          visits = HISTORY_ENTRIES (h)[bucket->entry - 1].visits + 1;
+     else if (archive_lookup (h->archive, 0, uri, hash, &item))
+          visits = item.visits + 1;
+
+     rec->visits = visits;
+
+     entry = &HISTORY_ENTRIES (h)[id];
+     entry->time   = rec->time;
+     entry->offset = offset;
+     entry->hash   = hash;
+     entry->visits = visits;
+     HISTORY_HEADER (&h->index)->used++;
+
+     if (!found)
+     {
+          bucket->hash = hash;
+          HISTORY_HEADER (&h->hash)->used++;
+     }
+
+     bucket->entry = id + 1;
+
+     if (HISTORY_HEADER (&h->log)->used >= HISTORY_HOT_SIZE && h->rollover == NULL)
+          history_rollover (h);
+
+     if (id + 1 - HISTORY_HEADER (&h->sorted)->extra >= HISTORY_SORT_THRESHOLD)
+          return history_merge_sorted (h, err);
+
+     return TRUE;
+}
+
+/*!
+ * @param h A #History object.
+ * @param uri URI to look for.
+ * @param item The #HistoryItem to fill.
+ * @return \c TRUE if \a uri was visited.
+ *
+ * Get the latest visit of an URI, from the log or else from the archive.
+ */
+gboolean history_lookup (History *h, const gchar *uri, HistoryItem *item)
+{
+     gboolean found;
+     guint32 b, hash;
+
+     g_return_val_if_fail (h != NULL, FALSE);
+     g_return_val_if_fail (uri != NULL, FALSE);
+
+     g_string_chunk_clear (h->strings);
+
+     hash = history_hash (uri);
+     b = history_find_bucket (h, uri, hash, &found);
+
+     if (found && item != NULL)
+          history_fill_item (h, HISTORY_BUCKETS (h)[b].entry - 1, item);
+     else if (!found)
+          found = archive_lookup (h->archive, 0, uri, hash, item);
+
+     return found;
+}
+
+/*!
+ * @param h A #History object.
+ * @param seg Segment the item comes from.
+ * @param item An item read from the archive.
+ * @param hash Hash of its URI.
+ * @return \c TRUE if a newer visit of the URI is in the log or in a newer segment.
+ */
+static gboolean history_is_shadowed (History *h, guint seg, const HistoryItem *item, guint32 hash)
+{
+     gboolean found;
+
+     history_find_bucket (h, item->uri, hash, &found);
+     return found || archive_lookup (h->archive, seg + 1, item->uri, hash, NULL);
+}
+
+/*!
+ * \struct HistoryCandidate
+ * An item read from the archive, with its strings copied.
+ */
+typedef struct
+{
+     HistoryItem item;
+     guint32 hash;
+} HistoryCandidate;
+
+/*!
+ * \struct HistoryColdQuery
+ * State of a query over a segment of the archive.
+ */
+typedef struct
+{
+     History *h;
+     guint seg;
+     const gchar *prefix;     /*!< Prefix of the URIs, or \c NULL */
+     gint64 time;             /*!< Oldest visit */
+     guint n;                 /*!< Maximum number of candidates */
+     GArray *found;           /*!< Array of #HistoryCandidate */
+} HistoryColdQuery;
+
+/*!
+ * @param item An item of the segment.
+ * @param hash Hash of its URI.
+ * @param data The #HistoryColdQuery.
+ * @return \c FALSE to stop the iteration.
+ *
+ * Keep the items matching the query, copying their strings.
+ */
+static gboolean history_cold_query_cb (const HistoryItem *item, guint32 hash, gpointer data)
+{
+     HistoryColdQuery *q = (HistoryColdQuery *) data;
+     HistoryCandidate c;
+     gboolean found;
+
+     if (q->prefix != NULL)
+     {
+          gint cmp = strncmp (item->uri, q->prefix, strlen (q->prefix));
+
+          /* the first block may start before the prefix */
+          if (cmp < 0)
+               return TRUE;
+          else if (cmp > 0)
+               return FALSE;
+
+          /* sorted by URI: shadowed items are checked at once */
+          if (history_is_shadowed (q->h, q->seg, item, hash))
+               return TRUE;
+     }
+     else
+     {
+          if (item->time < q->time)
+               return TRUE;
+
+          /* sorted by time later, shadowed items will be checked then */
+          history_find_bucket (q->h, item->uri, hash, &found);
+          if (found)
+               return TRUE;
+     }
+
+     c.item.uri    = g_string_chunk_insert (q->h->strings, item->uri);
+     c.item.title  = g_string_chunk_insert (q->h->strings, item->title);
+     c.item.time   = item->time;
+     c.item.visits = item->visits;
+     c.hash        = hash;
+     g_array_append_val (q->found, c);
+
+     return (q->prefix == NULL || q->found->len < q->n);
+}
+
+static gint history_compare_candidate_time (gconstpointer a, gconstpointer b)
+{
+     gint64 ta = ((HistoryCandidate *) a)->item.time, tb = ((HistoryCandidate *) b)->item.time;
+
+     return (ta > tb ? -1 : ta < tb);
+}
+
+/*!
+ * @param h A #History object.
+ * @param time Oldest visit to return (microseconds since Epoch).
+ * @param n Maximum number of items.
+ * @param items Array of at least \a n #HistoryItem.
+ * @return Number of items filled.
+ *
+ * Get the pages visited since \a time, most recent first. The archive
+ * is only read if the log does not hold enough visits.
+ */
+guint history_since (History *h, gint64 time, guint n, HistoryItem *items)
+{
+     guint64 id;
+     guint ret = 0, seg;
+
+     g_return_val_if_fail (h != NULL, 0);
+
+     g_string_chunk_clear (h->strings);
+
+     for (id = HISTORY_HEADER (&h->index)->used; id > 0 && ret < n; --id)
+     {
+          if (HISTORY_ENTRIES (h)[id - 1].time < time)
+               return ret;
+
+          if (history_is_latest (h, id - 1))
+               history_fill_item (h, id - 1, &items[ret++]);
+     }
+
+     /* segments are in visit order, newest last */
+     for (seg = archive_segments (h->archive); seg > 0 && ret < n && archive_newest (h->archive, seg - 1) >= time; --seg)
+     {
+          HistoryColdQuery q = { h, seg - 1, NULL, time, n, NULL };
+          guint i;
+
+          q.found = g_array_new (FALSE, FALSE, sizeof (HistoryCandidate));
+          archive_foreach (h->archive, seg - 1, NULL, history_cold_query_cb, &q);
+          g_array_sort (q.found, history_compare_candidate_time);
+
+          for (i = 0; i < q.found->len && ret < n; ++i)
+          {
+               HistoryCandidate *c = &g_array_index (q.found, HistoryCandidate, i);
+
+               if (!archive_lookup (h->archive, seg, c->item.uri, c->hash, NULL))
+                    items[ret++] = c->item;
+          }
+
+          g_array_free (q.found, TRUE);
+     }
+
+     return ret;
+}
+
+/*!
+ * @param h A #History object.
+ * @param n Maximum number of items.
+ * @param items Array of at least \a n #HistoryItem.
+ * @return Number of items filled.
+ *
+ * Get the \a n last visited pages, most recent first.
+ */
+guint history_recent (History *h, guint n, HistoryItem *items)
+{
+     return history_since (h, G_MININT64, n, items);
+}
+
+/*!
+ * @param a First #HistoryItem.
+ * @param b Second #HistoryItem.
+ * @return Comparison of both URIs.
+ */
+static gint history_compare_item (gconstpointer a, gconstpointer b)
+{
+     return strcmp (((HistoryItem *) a)->uri, ((HistoryItem *) b)->uri);
+}
+
+/*!
+ * @param h A #History object.
+ * @param prefix Prefix of the URIs.
+ * @param n Maximum number of items.
+ * @param items Array of at least \a n #HistoryItem.
+ * @return Number of items filled.
+ *
+ * Get the visited pages whose URI starts with \a prefix, sorted by URI.
+ */
+guint history_prefix (History *h, const gchar *prefix, guint n, HistoryItem *items)
+{
+     GArray *found;
+     guint64 lo, hi, i;
+     guint ret, seg;
+
+     g_return_val_if_fail (h != NULL, 0);
+     g_return_val_if_fail (prefix != NULL, 0);
+
+     g_string_chunk_clear (h->strings);
+
+     found = g_array_new (FALSE, FALSE, sizeof (HistoryItem));
+
+     /* binary search in the sorted index */
+     lo = 0;
+     hi = HISTORY_HEADER (&h->sorted)->used;
+
+     while (lo < hi)
+     {
+          guint64 mid = lo + (hi - lo) / 2;
+          HistoryRecord *rec = HISTORY_RECORD (h, HISTORY_ENTRIES (h)[HISTORY_SORTED (h)[mid]].offset);
+
+          if (strcmp (HISTORY_RECORD_URI (rec), prefix) < 0)
+               lo = mid + 1;
+          else
+               hi = mid;
+     }
+
+     for (i = lo; i < HISTORY_HEADER (&h->sorted)->used && found->len < n; ++i)
+     {
+          guint32 id = HISTORY_SORTED (h)[i];
+          HistoryItem item;
+
+          history_fill_item (h, id, &item);
+
+          if (!g_str_has_prefix (item.uri, prefix))
+               break;
+
+          /* a newer visit is in the unsorted tail */
+          if (history_is_latest (h, id))
+               g_array_append_val (found, item);
+     }
+
+     /* linear scan of the visits which are not in the sorted index yet */
+     for (i = HISTORY_HEADER (&h->sorted)->extra; i < HISTORY_HEADER (&h->index)->used; ++i)
+     {
+          HistoryRecord *rec = HISTORY_RECORD (h, HISTORY_ENTRIES (h)[i].offset);
+
+          if (g_str_has_prefix (HISTORY_RECORD_URI (rec), prefix) && history_is_latest (h, i))
+          {
+               HistoryItem item;
+
+               history_fill_item (h, i, &item);
+               g_array_append_val (found, item);
+          }
+     }
+
+     /* the first matches of each segment, which are not shadowed */
+     for (seg = archive_segments (h->archive); seg > 0; --seg)
+     {
+          HistoryColdQuery q = { h, seg - 1, prefix, G_MININT64, n, NULL };
+
+          q.found = g_array_new (FALSE, FALSE, sizeof (HistoryCandidate));
+          archive_foreach (h->archive, seg - 1, prefix, history_cold_query_cb, &q);
+
+          for (i = 0; i < q.found->len; ++i)
+               g_array_append_val (found, g_array_index (q.found, HistoryCandidate, i).item);
+
+          g_array_free (q.found, TRUE);
+     }
+
+     g_array_sort (found, history_compare_item);
+
+     ret = MIN (n, found->len);
+     memcpy (items, found->data, ret * sizeof (HistoryItem));
+     g_array_free (found, TRUE);
+
+     return ret;
+}
+
+/*! @} */
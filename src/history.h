@@ -0,0 +1,77 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __HISTORY_H
+#define __HISTORY_H
+
+/*!
+ * \defgroup history History
+ * Browsing history store.
+ *
+ * The history is an append-only log of visits, stored in the
+ * #CACHE_TYPE_HISTORY directory, with three memory-mapped indexes :
+ * - <code>index</code>: one entry per visit, in visit order ;
+ * - <code>hash</code>: open-addressing table, URI hash to latest visit ;
+ * - <code>sorted</code>: latest visits sorted by URI, for prefix lookups.
+ *
+ * Nothing is read at startup, pages are loaded on demand by the kernel.
+ *
+ * When the log grows over a few megabytes, its oldest half is moved
+ * to a compressed segment of the archive (see \ref archive), in the
+ * background. Queries look in the log first, and only read the archive
+ * when the log does not answer them.
+ *
+ * @{
+ */
+
+#include <glib.h>
+
+typedef struct _History History;
+
+/*!
+ * \struct HistoryItem
+ * A visited page. Strings point into the mapped log (or into buffers of
+ * the history) and stay valid until the next call to a history function.
+ */
+typedef struct
+{
+     const gchar *uri;   /*!< Visited URI */
+     const gchar *title; /*!< Page's title (may be empty) */
+     gint64 time;        /*!< Time of the last visit (microseconds since Epoch) */
+     guint visits;       /*!< Number of visits */
+} HistoryItem;
+
+History *history_open (GError **err);
+void history_close (History *h);
+
+gboolean history_add (History *h, const gchar *uri, const gchar *title, GError **err);
+gboolean history_lookup (History *h, const gchar *uri, HistoryItem *item);
+guint history_recent (History *h, guint n, HistoryItem *items);
+guint history_since (History *h, gint64 time, guint n, HistoryItem *items);
+guint history_prefix (History *h, const gchar *prefix, guint n, HistoryItem *items);
+
+/*! @} */
+
+#endif /* __HISTORY_H */
@@ -58,6 +58,7 @@ static void window_update (GtkVimSplit *obj, Notebook *focus)
      GtkWidget *webview = notebook_get_focus (focus);
 
      cream_browser_set_focused_webview (app, webview);
+     session_focused (focus);
 
      gchar *title = g_strdup_printf ("%s - %s", PACKAGE, webview_get_title (CREAM_WEBVIEW (webview)));
      gtk_window_set_title (GTK_WINDOW (app->gui.window), title);
@@ -85,12 +86,19 @@ void ui_init (void)
      app->gui.vimsplit  = gtk_vim_split_new ();
      app->gui.inputbox  = inputbox_new ();
      app->gui.statusbar = statusbar_new ();
+     app->gui.output    = gtk_label_new (NULL);
+
+     /* shown by ui_output () only */
+     gtk_label_set_selectable (GTK_LABEL (app->gui.output), TRUE);
+     gtk_misc_set_alignment (GTK_MISC (app->gui.output), 0, 0);
+     gtk_widget_set_no_show_all (app->gui.output, TRUE);
 
      statusbar_set_state (CREAM_STATUSBAR (app->gui.statusbar), CREAM_MODE_NORMAL);
 
      gtk_box_pack_start (GTK_BOX (app->gui.box), app->gui.vimsplit, TRUE, TRUE, 0);
      gtk_box_pack_end (GTK_BOX (app->gui.box), app->gui.inputbox, FALSE, TRUE, 0);
      gtk_box_pack_end (GTK_BOX (app->gui.box), app->gui.statusbar, FALSE, TRUE, 0);
+     gtk_box_pack_end (GTK_BOX (app->gui.box), app->gui.output, FALSE, TRUE, 0);
      gtk_container_add (GTK_CONTAINER (app->gui.window), app->gui.box);
 
      g_signal_connect (G_OBJECT (app->gui.window),   "destroy",       G_CALLBACK (window_destroy),   NULL);
@@ -106,4 +114,44 @@ void ui_show (void)
      gtk_widget_show_all (app->gui.window);
 }
 
+static GString *output_capture = NULL;
+
+/*!
+ * @param text Output of a command, or \c NULL to hide the previous one.
+ *
+ * Show the output of a command above the statusbar, until the next
+ * command. While captured, the output is appended to the capture buffer
+ * instead.
+ */
+void ui_output (const gchar *text)
+{
+     if (output_capture != NULL)
+     {
+          if (text != NULL)
+               g_string_append (output_capture, text);
+          return;
+     }
+
+     if (text == NULL)
+     {
+          gtk_widget_hide (app->gui.output);
+          return;
+     }
+
+     gtk_label_set_text (GTK_LABEL (app->gui.output), text);
+     gtk_widget_show (app->gui.output);
+}
+
+/*!
+ * @param buf Buffer receiving the output of the commands, or \c NULL
+ * to show it again.
+ *
+ * Capture the output of the commands run on behalf of a client of the
+ * control socket.
+ */
+void ui_output_capture (GString *buf)
+{
+     output_capture = buf;
+}
+
 /*! @} */
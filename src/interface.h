@@ -34,6 +34,8 @@
 
 void ui_init (void);
 void ui_show (void);
+void ui_output (const gchar *text);
+void ui_output_capture (GString *buf);
 
 /*! @} */
 
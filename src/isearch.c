@@ -0,0 +1,192 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+
+/*!
+ * \addtogroup isearch
+ * @{
+ */
+
+static WebView *webview = NULL;    /*!< Searched webview, or \c NULL */
+static gchar *text = NULL;         /*!< Text looked for, or \c NULL */
+static gchar *pending = NULL;      /*!< Text to look for at the next frame, or \c NULL */
+static gboolean forward = TRUE;    /*!< Direction of the search */
+static gboolean found = FALSE;     /*!< \a text was found */
+static guint frame_source = 0;
+static guint mark_source = 0;
+
+/*!
+ * @param data Unused.
+ * @return \c FALSE to remove the source.
+ *
+ * Highlight and count the matches of the current text.
+ */
+static gboolean isearch_mark (gpointer data)
+{
+     guint n;
+
+     mark_source = 0;
+
+     if (webview == NULL)
+          return FALSE;
+
+     n = cream_module_search_mark (CREAM_MODULE (webview_get_module (webview)), webview_get_child (webview), text, ISEARCH_MARK_MAX);
+     statusbar_set_matches (CREAM_STATUSBAR (app->gui.statusbar), n, n >= ISEARCH_MARK_MAX);
+
+     return FALSE;
+}
+
+/*!
+ * Look for the pending text, from the current match if it extends the
+ * previous text, and schedule the highlighting of its matches.
+ */
+static void isearch_run (void)
+{
+     gboolean resume = (found && text != NULL && g_str_has_prefix (pending, text));
+
+     g_free (text);
+     text    = pending;
+     pending = NULL;
+
+     found = cream_module_search_incremental (CREAM_MODULE (webview_get_module (webview)), webview_get_child (webview),
+                                              text, forward, resume);
+
+     if (!found)
+     {
+          cream_module_search_mark (CREAM_MODULE (webview_get_module (webview)), webview_get_child (webview), NULL, 0);
+          statusbar_set_matches (CREAM_STATUSBAR (app->gui.statusbar), 0, FALSE);
+          return;
+     }
+
+     mark_source = g_idle_add_full (G_PRIORITY_LOW, isearch_mark, NULL, NULL);
+}
+
+/*!
+ * @param data Unused.
+ * @return \c FALSE to remove the source.
+ *
+ * Look for the last text typed during the frame.
+ */
+static gboolean isearch_frame (gpointer data)
+{
+     frame_source = 0;
+
+     if (webview != NULL && pending != NULL)
+          isearch_run ();
+
+     return FALSE;
+}
+
+/*!
+ * @param w A #WebView object.
+ * @param str Text to look for.
+ * @param fwd Search forward or backward.
+ *
+ * Look for \a str in \a w at the next frame. The counting of the
+ * previous matches is cancelled.
+ */
+void isearch_update (WebView *w, const gchar *str, gboolean fwd)
+{
+     g_return_if_fail (CREAM_IS_WEBVIEW (w));
+
+     if (w != webview || fwd != forward)
+          isearch_stop ();
+
+     if (webview == NULL)
+     {
+          webview = w;
+          g_object_add_weak_pointer (G_OBJECT (webview), (gpointer *) &webview);
+          forward = fwd;
+     }
+
+     if (mark_source != 0)
+          g_source_remove (mark_source);
+     mark_source = 0;
+
+     g_free (pending);
+     pending = g_strdup (str);
+
+     /* after the pending events (G_PRIORITY_DEFAULT) */
+     if (frame_source == 0)
+          frame_source = g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, KEYBINDS_FRAME, isearch_frame, NULL, NULL);
+}
+
+/*!
+ * @param w A #WebView object.
+ * @param str Text validated.
+ * @param fwd Search forward or backward.
+ * @return \c TRUE if \a str was found.
+ *
+ * End the incremental search on the current match of \a str, looking
+ * for it if it was not done yet.
+ */
+gboolean isearch_finish (WebView *w, const gchar *str, gboolean fwd)
+{
+     gboolean ret;
+
+     if (w != webview || fwd != forward || text == NULL || !g_str_equal (str, text) || pending != NULL)
+     {
+          isearch_update (w, str, fwd);
+          isearch_run ();
+     }
+
+     ret = found;
+     isearch_stop ();
+
+     return ret;
+}
+
+/*!
+ * Cancel the pending searches, and remove the highlights.
+ */
+void isearch_stop (void)
+{
+     if (frame_source != 0)
+          g_source_remove (frame_source);
+
+     if (mark_source != 0)
+          g_source_remove (mark_source);
+
+     frame_source = 0;
+     mark_source  = 0;
+
+     g_free (text);
+     g_free (pending);
+     text    = NULL;
+     pending = NULL;
+     found   = FALSE;
+
+     if (webview == NULL)
+          return;
+
+     cream_module_search_mark (CREAM_MODULE (webview_get_module (webview)), webview_get_child (webview), NULL, 0);
+     statusbar_set_matches (CREAM_STATUSBAR (app->gui.statusbar), -1, FALSE);
+
+     g_object_remove_weak_pointer (G_OBJECT (webview), (gpointer *) &webview);
+     webview = NULL;
+}
+
+/*! @} */
@@ -0,0 +1,55 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef __ISEARCH_H
+#define __ISEARCH_H
+
+/*!
+ * \defgroup isearch Incremental search
+ * Find in page while the text is typed.
+ *
+ * In search mode (#CREAM_MODE_SEARCH), the typed text is looked for at
+ * most once per frame (#KEYBINDS_FRAME), after the pending keys: the
+ * keys typed meanwhile only replace the text to look for. When the text
+ * extends the previous one, the search resumes from the current match.
+ * The matches are then highlighted and counted in the statusbar, from a
+ * low priority idle source which is cancelled as soon as the text
+ * changes.
+ *
+ * @{
+ */
+
+#include <gtk/gtk.h>
+
+#include "WebView.h"
+
+#define ISEARCH_MARK_MAX           1000      /*!< Maximum number of matches highlighted */
+
+void isearch_update (WebView *w, const gchar *text, gboolean forward);
+gboolean isearch_finish (WebView *w, const gchar *text, gboolean forward);
+void isearch_stop (void);
+
+/*! @} */
+
+#endif /* __ISEARCH_H */
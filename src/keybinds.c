@@ -30,58 +30,646 @@
  * @{
  */
 
-static GSList *keys = NULL;
+#define CREAM_KEYBINDS_ERROR       (cream_keybinds_error_quark ())
+
+typedef enum
+{
+     CREAM_KEYBINDS_ERROR_KEY,
+     CREAM_KEYBINDS_ERROR_FAILED
+} CreamKeybindsError;
+
+static GQuark cream_keybinds_error_quark (void)
+{
+     static GQuark domain = 0;
+
+     if (!domain)
+          domain = g_quark_from_string ("cream.keybinds");
+
+     return domain;
+}
+
+#define KEYBINDS_MODES             7         /*!< Number of #CreamMode */
+#define KEYBINDS_REGISTERS         36        /*!< Macro registers: a-z, 0-9 */
+#define KEYBINDS_COUNT_MAX         99999     /*!< Largest count */
+#define KEYBINDS_NAME_MAX          32        /*!< Longest key name in a command */
+
+/*!
+ * \struct KeyNode
+ * Node of the trie: a key sequence.
+ */
+typedef struct
+{
+     gint bind;          /*!< Binding of the sequence, or -1 */
+     guint children;     /*!< Number of longer sequences */
+} KeyNode;
+
+/*!
+ * \struct KeyEdge
+ * Transition of the trie, in an open-addressing table.
+ */
+typedef struct
+{
+     guint32 node;       /*!< Parent node + 1, or 0 if the slot is empty */
+     guint32 keyval;     /*!< Key value */
+     guint32 mods;       /*!< Modifiers */
+     guint32 child;      /*!< Child node */
+} KeyEdge;
+
+/*!
+ * \struct KeyTrie
+ * Compiled bindings, one root per #CreamMode.
+ */
+typedef struct
+{
+     GArray *nodes;                /*!< Array of #KeyNode */
+     KeyEdge *edges;
+     guint mask;                   /*!< Size of \a edges - 1 */
+     guint roots[KEYBINDS_MODES];
+} KeyTrie;
+
+static GPtrArray *keys = NULL;
+static KeyTrie *trie = NULL;
+
+/* current sequence */
+static guint current = 0;          /*!< Current node + 1, or 0 */
+static guint timeout_ms = KEYBINDS_TIMEOUT;
+static guint timeout_source = 0;
+static guint32 current_time = 0;   /*!< Time of the last key of the sequence */
+static guint count = 0;            /*!< Count typed before the sequence, or 0 */
+
+/* coalescing */
+static struct key_t *coalesced = NULL;  /*!< Binding run in the current frame, or \c NULL */
+static guint coalesced_keyval = 0;
+static guint coalesced_mods = 0;
+static guint coalesced_repeats = 0;     /*!< Presses merged since the last run */
+static guint32 coalesced_time = 0;      /*!< Time of the first merged press */
+static guint frame_source = 0;
+
+/* macros */
+static GPtrArray *macros[KEYBINDS_REGISTERS] = { NULL };
+static GPtrArray *recording = NULL;     /*!< Keys recorded, or \c NULL */
+static gint recording_reg = -1;
+static gint last_replayed = -1;
+static gboolean replaying = FALSE;
+static guint macro_pending = 0;         /*!< \c q or \c @, waiting for a register */
+
+/* Trie */
+
+static inline guint keybinds_edge_hash (guint32 node, guint32 keyval, guint32 mods)
+{
+     guint32 h = node * 0x9E3779B1U;
+
+     h = (h ^ keyval) * 0x85EBCA6BU;
+     h = (h ^ mods) * 0xC2B2AE35U;
+
+     return h ^ (h >> 16);
+}
+
+/*!
+ * @param t A #KeyTrie.
+ * @param node A node.
+ * @param keyval Key value.
+ * @param mods Modifiers.
+ * @return The slot of the edge, or the empty slot where it should be inserted.
+ */
+static KeyEdge *keybinds_trie_edge (KeyTrie *t, guint node, guint keyval, guint mods)
+{
+     guint i;
+
+     for (i = keybinds_edge_hash (node, keyval, mods) & t->mask; t->edges[i].node != 0; i = (i + 1) & t->mask)
+     {
+          KeyEdge *e = &t->edges[i];
+
+          if (e->node == node + 1 && e->keyval == keyval && e->mods == mods)
+               return e;
+     }
+
+     return &t->edges[i];
+}
+
+/*!
+ * @param t A #KeyTrie.
+ * @return A new node.
+ */
+static guint keybinds_trie_node (KeyTrie *t)
+{
+     KeyNode n = { -1, 0 };
+
+     g_array_append_val (t->nodes, n);
+     return t->nodes->len - 1;
+}
+
+#define KEYBINDS_NODE(t,i)         (&g_array_index ((t)->nodes, KeyNode, (i)))
+
+/*!
+ * @param t A #KeyTrie.
+ */
+static void keybinds_trie_free (KeyTrie *t)
+{
+     g_array_free (t->nodes, TRUE);
+     g_free (t->edges);
+     g_free (t);
+}
+
+/*!
+ * @return A new #KeyTrie.
+ *
+ * Compile the bindings. When two bindings have the same sequence in a
+ * mode, the first one wins.
+ */
+static KeyTrie *keybinds_trie_build (void)
+{
+     KeyTrie *t = g_new0 (KeyTrie, 1);
+     guint i, m, size, total = 0;
+
+     for (i = 0; i < keys->len; ++i)
+          total += ((struct key_t *) g_ptr_array_index (keys, i))->nkeys * KEYBINDS_MODES;
+
+     /* keep the load factor under 1/2 */
+     for (size = 16; size < total * 2; size *= 2);
+
+     t->nodes = g_array_new (FALSE, FALSE, sizeof (KeyNode));
+     t->edges = g_new0 (KeyEdge, size);
+     t->mask  = size - 1;
+
+     for (m = 0; m < KEYBINDS_MODES; ++m)
+          t->roots[m] = keybinds_trie_node (t);
+
+     for (i = 0; i < keys->len; ++i)
+     {
+          struct key_t *keybind = g_ptr_array_index (keys, i);
+
+          for (m = 0; m < KEYBINDS_MODES; ++m)
+          {
+               guint node = t->roots[m], k;
+
+               if (!(keybind->statemask & (1 << m)))
+                    continue;
+
+               for (k = 0; k < keybind->nkeys; ++k)
+               {
+                    KeyEdge *e = keybinds_trie_edge (t, node, keybind->keys[k], keybind->mods[k]);
+
+                    if (e->node == 0)
+                    {
+                         e->node   = node + 1;
+                         e->keyval = keybind->keys[k];
+                         e->mods   = keybind->mods[k];
+                         e->child  = keybinds_trie_node (t);
+
+                         KEYBINDS_NODE (t, node)->children++;
+                    }
+
+                    node = e->child;
+               }
+
+               if (KEYBINDS_NODE (t, node)->bind < 0)
+                    KEYBINDS_NODE (t, node)->bind = i;
+          }
+     }
+
+     return t;
+}
+
+/* Dispatch */
+
+#define KEYBINDS_SEQUENCE_MODES    (CREAM_MODE_NORMAL | CREAM_MODE_EMBED | CREAM_MODE_CARET)
+
+/*!
+ * @param keybind The binding to run.
+ * @param time Time of the key which triggered the binding.
+ * @param repeats Number of presses merged in this run.
+ *
+ * Call the lua callback of a binding, with the focused #WebView, the
+ * count typed before the sequence (\c nil if none) and the number of
+ * presses, and record its latency. The delay of replayed keys is
+ * meaningless, only their run time is recorded.
+ */
+static void keybinds_dispatch (struct key_t *keybind, guint32 time, guint repeats)
+{
+     guint n = count;
+     gint64 start;
+
+     count = 0;
+
+     lua_pushwebview (app->luavm, CREAM_WEBVIEW (cream_browser_get_focused_webview (app)));
+
+     if (n > 0)
+          lua_pushinteger (app->luavm, n);
+     else
+          lua_pushnil (app->luavm);
+
+     lua_pushinteger (app->luavm, repeats);
+
+     if (!replaying)
+          latency_record_event (&keybind->stats->delay, time);
+
+     start = g_get_monotonic_time ();
+     luaL_callnamed (app->luavm, keybind->func, 3, 0, keybind->stats->name);
+     latency_record (&keybind->stats->run, g_get_monotonic_time () - start);
+}
+
+/*!
+ * Forget the current sequence (but not the count).
+ */
+static void keybinds_reset (void)
+{
+     if (timeout_source != 0)
+          g_source_remove (timeout_source);
+
+     timeout_source = 0;
+     current = 0;
+}
+
+/*!
+ * @param data Unused.
+ * @return \c FALSE, to remove the source.
+ *
+ * No key completed an ambiguous sequence in time: run its binding.
+ */
+static gboolean keybinds_timeout (gpointer data)
+{
+     KeyNode *node = KEYBINDS_NODE (trie, current - 1);
+
+     timeout_source = 0;
+     current = 0;
+
+     if (node->bind >= 0)
+          keybinds_dispatch (g_ptr_array_index (keys, node->bind), current_time, 1);
+
+     return FALSE;
+}
+
+/* Coalescing */
+
+/*!
+ * @param data Unused.
+ * @return \c TRUE while presses are merged.
+ *
+ * Once per frame, after the pending events: run the coalesced binding
+ * once for all the presses merged since its last run. The frame ends
+ * when no press was merged.
+ */
+static gboolean keybinds_frame (gpointer data)
+{
+     guint n = coalesced_repeats;
+
+     if (n == 0)
+     {
+          frame_source = 0;
+          coalesced = NULL;
+          return FALSE;
+     }
+
+     coalesced_repeats = 0;
+     keybinds_dispatch (coalesced, coalesced_time, n);
+
+     return TRUE;
+}
+
+/*!
+ * Run the presses merged in the current frame now, before another key.
+ */
+static void keybinds_flush (void)
+{
+     struct key_t *keybind = coalesced;
+     guint n = coalesced_repeats;
+
+     if (frame_source != 0)
+          g_source_remove (frame_source);
+
+     frame_source = 0;
+     coalesced = NULL;
+     coalesced_repeats = 0;
+
+     if (keybind != NULL && n > 0)
+          keybinds_dispatch (keybind, coalesced_time, n);
+}
+
+/*!
+ * @param keybind A coalescible binding.
+ * @param ekey The key which triggered it.
+ * @param mods Modifiers of the key.
+ *
+ * The first press runs the binding at once. Next presses of the same
+ * binding (auto-repeat) are merged, and run once per frame with their
+ * number. The frame source has a lower priority than the events, so all
+ * the queued presses are merged when the callback is slower than the
+ * auto-repeat.
+ */
+static void keybinds_coalesce (struct key_t *keybind, GdkEventKey *ekey, guint mods)
+{
+     if (coalesced == keybind)
+     {
+          if (coalesced_repeats++ == 0)
+               coalesced_time = ekey->time;
+          return;
+     }
+
+     keybinds_flush ();
+
+     coalesced = keybind;
+     coalesced_keyval = ekey->keyval;
+     coalesced_mods = mods;
+     frame_source = g_timeout_add_full (GDK_PRIORITY_REDRAW - 1, KEYBINDS_FRAME, keybinds_frame, NULL, NULL);
+
+     keybinds_dispatch (keybind, ekey->time, 1);
+}
+
+/* Macros */
+
+/*!
+ * @param keyval A key value.
+ * @return The register named by the key (<code>a-z</code>, <code>0-9</code>), or -1.
+ */
+static gint keybinds_register (guint keyval)
+{
+     if (keyval >= GDK_KEY_a && keyval <= GDK_KEY_z)
+          return keyval - GDK_KEY_a;
+     else if (keyval >= GDK_KEY_0 && keyval <= GDK_KEY_9)
+          return 26 + keyval - GDK_KEY_0;
+
+     return -1;
+}
+
+/*!
+ * @param reg A register.
+ *
+ * Start to record the keys in a register.
+ */
+static void keybinds_record_start (gint reg)
+{
+     if (recording != NULL)
+          g_ptr_array_free (recording, TRUE);
+
+     recording = g_ptr_array_new_with_free_func ((GDestroyNotify) gdk_event_free);
+     recording_reg = reg;
+
+     statusbar_set_state (CREAM_STATUSBAR (app->gui.statusbar), app->mode);
+}
+
+/*!
+ * Stop to record, and save the macro in its register.
+ */
+static void keybinds_record_stop (void)
+{
+     if (macros[recording_reg] != NULL)
+          g_ptr_array_free (macros[recording_reg], TRUE);
+
+     macros[recording_reg] = recording;
+     recording = NULL;
+     recording_reg = -1;
+
+     statusbar_set_state (CREAM_STATUSBAR (app->gui.statusbar), app->mode);
+}
+
+/*!
+ * @param reg A register.
+ * @param times Number of replays.
+ *
+ * Replay a macro. Its keys are sent at once to the window, without
+ * going back to the main loop, and the window is not redrawn until
+ * the end. A macro can not replay another one.
+ */
+static void keybinds_replay (gint reg, guint times)
+{
+     GdkWindow *window = gtk_widget_get_window (app->gui.window);
+     GPtrArray *events = macros[reg];
+     guint i, n;
+
+     if (events == NULL || replaying)
+          return;
+
+     replaying = TRUE;
+     last_replayed = reg;
+     gdk_window_freeze_updates (window);
+
+     for (n = 0; n < times; ++n)
+     {
+          for (i = 0; i < events->len; ++i)
+               gtk_main_do_event ((GdkEvent *) g_ptr_array_index (events, i));
+     }
+
+     /* do not leave a sequence half-typed */
+     keybinds_reset ();
+     count = 0;
+
+     gdk_window_thaw_updates (window);
+     replaying = FALSE;
+}
+
+/*!
+ * @param event A key event.
+ *
+ * Save a key in the macro being recorded, if any.
+ */
+static void keybinds_record (GdkEvent *event)
+{
+     if (recording != NULL && !replaying)
+          g_ptr_array_add (recording, gdk_event_copy (event));
+}
+
+/*!
+ * @param event A key event.
+ * @param mods Its modifiers.
+ * @param mode Index of the current mode.
+ * @return \c TRUE if the key was a count digit, or a macro command.
+ *
+ * Handle the keys which are not bindings: the count typed before a
+ * sequence, <code>q&lt;reg&gt;</code> to record a macro (and
+ * <code>q</code> to stop), <code>@&lt;reg&gt;</code> to replay it
+ * (and <code>@@</code> to replay the last one). Bindings on these
+ * keys win.
+ */
+static gboolean keybinds_special (GdkEvent *ev, guint mods, gint mode)
+{
+     GdkEventKey *event = &ev->key;
+     gboolean bound = (keybinds_trie_edge (trie, trie->roots[mode], event->keyval, mods)->node != 0);
+
+     /* register of a macro command */
+     if (macro_pending != 0)
+     {
+          gint reg = (event->keyval == GDK_KEY_at && macro_pending == GDK_KEY_at ? last_replayed : keybinds_register (event->keyval));
+          guint pending = macro_pending, times = MAX (count, 1);
+
+          macro_pending = 0;
+          count = 0;
+
+          if (reg >= 0 && pending == GDK_KEY_q)
+               keybinds_record_start (reg);
+          else if (reg >= 0 && pending == GDK_KEY_at)
+               keybinds_replay (reg, times);
+
+          return TRUE;
+     }
+
+     /* Shift is needed to type some keys, like @ */
+     if ((mods & ~GDK_SHIFT_MASK) != 0 || (bound && count == 0))
+          return FALSE;
+
+     /* count */
+     if ((event->keyval >= GDK_KEY_1 && event->keyval <= GDK_KEY_9) || (event->keyval == GDK_KEY_0 && count > 0))
+     {
+          count = MIN (count * 10 + event->keyval - GDK_KEY_0, KEYBINDS_COUNT_MAX);
+          keybinds_record (ev);
+          return TRUE;
+     }
+
+     if (bound)
+          return FALSE;
+
+     /* macros */
+     if (event->keyval == GDK_KEY_q && recording != NULL && !replaying)
+     {
+          keybinds_record_stop ();
+          count = 0;
+          return TRUE;
+     }
+     else if ((event->keyval == GDK_KEY_q && recording == NULL) || event->keyval == GDK_KEY_at)
+     {
+          macro_pending = event->keyval;
+          return TRUE;
+     }
+
+     return FALSE;
+}
 
 /*!
  * @param window The toplevel window on which we get the signal.
  * @param event The keyboard event.
  * @return \c TRUE if the event was handled.
  *
- * Get pressed key, add it to a buffer. When the buffer match to
- * a registered command, execute the lua callback.
+ * Follow the pressed key in the trie of the current mode. A complete
+ * sequence runs its lua callback, a prefix waits for the next key.
+ * A sequence which is both waits for #KEYBINDS_TIMEOUT, or for a key
+ * which does not continue it. A key which does not continue the
+ * current sequence starts a new one.
+ *
+ * While a macro is recorded, every key is saved, even the ones sent
+ * to the focused widget.
  *
  * \see \ref keybinds_add
  */
 static gboolean keybinds_callback (GtkWindow *window, GdkEvent *event)
 {
-     static GString *command = NULL;
-
      guint modifiers = gtk_accelerator_get_default_mod_mask ();
      GdkEventKey ekey = event->key;
-     GSList *tmp;
+     guint mods = ekey.state & modifiers;
+     KeyEdge *e = NULL;
+     KeyNode *node;
+     gint mode;
 
-     /* Escape is the default key to clear the buffer */
-     if (g_str_equal ("Escape", gdk_keyval_name (ekey.keyval)) && command)
-          g_string_free (command, TRUE), command = NULL;
-
-     /* initialize buffer */
-     if (command == NULL) command = g_string_new ("");
+     /* Escape is the default key to clear the sequence */
+     if (ekey.keyval == GDK_KEY_Escape)
+     {
+          keybinds_reset ();
+          count = 0;
+          macro_pending = 0;
+     }
 
-     /* get key */
      if (ekey.is_modifier)
+          return FALSE;
+
+     /* another key: run the merged presses first, to keep the order */
+     if (coalesced != NULL && (ekey.keyval != coalesced_keyval || mods != coalesced_mods))
+          keybinds_flush ();
+
+     /* hint mode takes all the keys */
+     if (app->mode == CREAM_MODE_HINT)
      {
+          keybinds_record (event);
+          return hints_keypress (&ekey);
+     }
+
+     if (keys == NULL || !(app->mode & KEYBINDS_SEQUENCE_MODES)
+         || (mode = g_bit_nth_lsf (app->mode, -1)) < 0 || mode >= KEYBINDS_MODES)
+     {
+          keybinds_record (event);
           return FALSE;
      }
-     else if (app->mode & (CREAM_MODE_NORMAL | CREAM_MODE_EMBED | CREAM_MODE_CARET))
-          command = g_string_append (command, gdk_keyval_name (ekey.keyval));
 
-     /* check for keybind */
-     for (tmp = keys; tmp != NULL; tmp = tmp->next)
+     /* bindings changed since the last key */
+     if (trie == NULL)
+     {
+          trie = keybinds_trie_build ();
+          current = 0;
+     }
+
+     if (current == 0 && keybinds_special (event, mods, mode))
+          return TRUE;
+
+     keybinds_record (event);
+
+     if (current != 0)
      {
-          struct key_t *keybind = (struct key_t *) tmp->data;
+          e = keybinds_trie_edge (trie, current - 1, ekey.keyval, mods);
 
-          if (g_string_equal (command, keybind->cmd) && (ekey.state & modifiers) == keybind->modmask && (app->mode & keybind->statemask))
+          /* dead end: run the pending binding, and start again from the root */
+          if (e->node == 0)
           {
-               /* call lua callback */
-               lua_pushwebview (app->luavm, CREAM_WEBVIEW (cream_browser_get_focused_webview (app)));
-               luaL_callfunction (app->luavm, keybind->func, 1, 0);
-               /* free current buffer */
-               g_string_free (command, TRUE), command = NULL;
-               return TRUE;
+               gint bind = KEYBINDS_NODE (trie, current - 1)->bind;
+
+               keybinds_reset ();
+
+               if (bind >= 0)
+                    keybinds_dispatch (g_ptr_array_index (keys, bind), ekey.time, 1);
+               count = 0;
+
+               /* the callback may have changed the mode */
+               if (trie == NULL || !(app->mode & KEYBINDS_SEQUENCE_MODES))
+                    return TRUE;
+
+               mode = MAX (g_bit_nth_lsf (app->mode, -1), 0);
           }
      }
 
-     return FALSE;
+     if (current == 0)
+     {
+          e = keybinds_trie_edge (trie, trie->roots[mode], ekey.keyval, mods);
+
+          if (e->node == 0)
+          {
+               count = 0;
+               return FALSE;
+          }
+     }
+
+     keybinds_reset ();
+     node = KEYBINDS_NODE (trie, e->child);
+
+     /* complete sequence */
+     if (node->children == 0)
+     {
+          struct key_t *keybind = g_ptr_array_index (keys, node->bind);
+
+          /* only a single key can be repeated */
+          if (keybind->coalesce && keybind->nkeys == 1 && count == 0 && !replaying)
+               keybinds_coalesce (keybind, &ekey, mods);
+          else
+               keybinds_dispatch (keybind, ekey.time, 1);
+
+          return TRUE;
+     }
+
+     /* prefix of longer sequences */
+     current = e->child + 1;
+     current_time = ekey.time;
+
+     if (node->bind >= 0 && timeout_ms > 0)
+          timeout_source = g_timeout_add (timeout_ms, keybinds_timeout, NULL);
+
+     return TRUE;
+}
+
+/*!
+ * @return The register being recorded (<code>a-z</code>, <code>0-9</code>), or 0.
+ */
+gchar keybinds_recording (void)
+{
+     if (recording == NULL)
+          return 0;
+
+     return (recording_reg < 26 ? 'a' + recording_reg : '0' + recording_reg - 26);
 }
 
 /*! Initialize keybindings */
@@ -90,25 +678,174 @@ void keybinds_init (void)
      g_signal_connect (G_OBJECT (app->gui.window), "key-press-event", G_CALLBACK (keybinds_callback), NULL);
 }
 
+/*!
+ * @param cmd Command.
+ * @param len Number of key values found.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return Array of key values (must be freed), or \c NULL on failure.
+ *
+ * Split a command into key values. A command is made of key names
+ * (<code>"Escape"</code>, <code>"colon"</code>) or characters
+ * (<code>"gg"</code>, <code>"/"</code>); the longest key name is
+ * preferred. Names between angle brackets (<code>"g&lt;at&gt;"</code>)
+ * are never split.
+ */
+static guint *keybinds_parse (const gchar *cmd, guint *len, GError **err)
+{
+     GArray *ret = g_array_new (FALSE, FALSE, sizeof (guint));
+     const gchar *p = cmd;
+
+     while (*p)
+     {
+          const gchar *end;
+          guint keyval;
+          gsize n;
+
+          /* <name> */
+          if (*p == '<' && (end = strchr (p + 1, '>')) != NULL && end > p + 1)
+          {
+               gchar *name = g_strndup (p + 1, end - p - 1);
+
+               keyval = gdk_keyval_from_name (name);
+               g_free (name);
+
+               if (keyval == GDK_KEY_VoidSymbol || keyval == 0)
+               {
+                    g_set_error (err, CREAM_KEYBINDS_ERROR, CREAM_KEYBINDS_ERROR_KEY, _("%s: Unknown key '%.*s'"), cmd, (gint) (end - p - 1), p + 1);
+                    g_array_free (ret, TRUE);
+                    return NULL;
+               }
+
+               g_array_append_val (ret, keyval);
+               p = end + 1;
+               continue;
+          }
+
+          /* longest key name */
+          for (n = MIN (strlen (p), KEYBINDS_NAME_MAX); n >= 2; --n)
+          {
+               gchar *name = g_strndup (p, n);
+
+               keyval = gdk_keyval_from_name (name);
+               g_free (name);
+
+               if (keyval != GDK_KEY_VoidSymbol && keyval != 0)
+                    break;
+          }
+
+          /* or a character */
+          if (n < 2)
+          {
+               gunichar c = g_utf8_get_char_validated (p, -1);
+
+               if (c == (gunichar) -1 || c == (gunichar) -2)
+               {
+                    g_set_error (err, CREAM_KEYBINDS_ERROR, CREAM_KEYBINDS_ERROR_KEY, _("%s: Invalid UTF-8"), cmd);
+                    g_array_free (ret, TRUE);
+                    return NULL;
+               }
+
+               n = g_utf8_next_char (p) - p;
+               keyval = gdk_unicode_to_keyval (c);
+          }
+
+          g_array_append_val (ret, keyval);
+          p += n;
+     }
+
+     *len = ret->len;
+     return (guint *) g_array_free (ret, FALSE);
+}
+
+/*!
+ * @param keyvals Key values of a command.
+ * @param len Number of key values.
+ * @param modmask Modifier keys of the binding.
+ * @return Modifiers of each key (must be freed).
+ *
+ * The modifiers of the binding apply to its last key. An uppercase
+ * letter is typed with Shift, wherever it is in the sequence.
+ */
+static guint *keybinds_mods (const guint *keyvals, guint len, guint modmask)
+{
+     guint *mods = g_new (guint, len);
+     guint k;
+
+     for (k = 0; k < len; ++k)
+     {
+          mods[k] = (gdk_keyval_to_lower (keyvals[k]) != keyvals[k] ? GDK_SHIFT_MASK : 0);
+
+          if (k == len - 1)
+               mods[k] |= modmask;
+     }
+
+     return mods;
+}
 
 /*!
  * @param statemask Browser's mode in which the keybind is affected.
  * @param modmask Modifier keys.
  * @param cmd Command.
  * @param lua_func Reference on a lua function.
+ * @param coalesce \c TRUE to merge the auto-repeated presses of a frame.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
  *
- * Add a key binding.
+ * Add a key binding. The modifiers apply to the last key of the
+ * command. The trie is compiled again on the next key press.
  */
-void keybinds_add (int statemask, int modmask, const char *cmd, int lua_func)
+gboolean keybinds_add (int statemask, int modmask, const char *cmd, int lua_func, gboolean coalesce, GError **err)
 {
-     struct key_t *keybind = g_new0 (struct key_t, 1);
+     struct key_t *keybind;
+     guint *keyvals, len = 0;
 
+     g_return_val_if_fail (cmd != NULL, FALSE);
+
+     if ((keyvals = keybinds_parse (cmd, &len, err)) == NULL)
+          return FALSE;
+
+     if (len == 0)
+     {
+          g_set_error (err, CREAM_KEYBINDS_ERROR, CREAM_KEYBINDS_ERROR_KEY, _("Empty key binding"));
+          g_free (keyvals);
+          return FALSE;
+     }
+
+     keybind = g_new0 (struct key_t, 1);
      keybind->statemask = statemask;
      keybind->modmask   = modmask;
      keybind->cmd       = g_string_new (cmd);
      keybind->func      = lua_func;
+     keybind->keys      = keyvals;
+     keybind->mods      = keybinds_mods (keyvals, len, modmask);
+     keybind->nkeys     = len;
+     keybind->coalesce  = coalesce;
+     keybind->stats     = latency_stats_new (cmd);
+
+     if (keys == NULL)
+          keys = g_ptr_array_new ();
+
+     g_ptr_array_add (keys, keybind);
 
-     keys = g_slist_append (keys, keybind);
+     if (trie != NULL)
+     {
+          keybinds_reset ();
+          keybinds_trie_free (trie);
+          trie = NULL;
+     }
+
+     return TRUE;
+}
+
+/*!
+ * @param timeout Delay in milliseconds, 0 to wait forever.
+ *
+ * Set the delay before running a binding whose sequence is also the
+ * prefix of longer ones.
+ */
+void keybinds_set_timeout (guint timeout)
+{
+     timeout_ms = timeout;
 }
 
 /*! @} */
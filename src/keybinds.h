@@ -30,9 +30,22 @@
  * \defgroup keybinds Key Bindings
  * Key bindings functions.
  *
+ * Bindings are compiled into a trie per #CreamMode, keyed by key value
+ * and modifiers, so each key press is a single lookup whatever the
+ * number of bindings. The trie is rebuilt on the first key press after
+ * keybinds_add().
+ *
+ * A count can be typed before a sequence (<code>5j</code>), it is given
+ * to the lua callback. Keys can be recorded in a register with
+ * <code>q&lt;reg&gt;</code> (until <code>q</code>), and replayed with
+ * <code>[count]@&lt;reg&gt;</code> in a single batch.
+ *
  * @{
  */
 
+#define KEYBINDS_TIMEOUT           1000      /*!< Default delay (ms) before running an ambiguous binding */
+#define KEYBINDS_FRAME             16        /*!< Delay (ms) between two runs of a coalesced binding */
+
 /*!
  * \struct key_t
  * Keybind structure.
@@ -43,10 +56,19 @@ struct key_t
      int modmask;   /*!< Modifier keys */
      GString *cmd;  /*!< Command */
      int func;      /*!< Lua function to call */
+
+     guint *keys;   /*!< Key values of the command */
+     guint *mods;   /*!< Modifiers of each key */
+     guint nkeys;   /*!< Number of key values */
+
+     gboolean coalesce;   /*!< Merge the repeated presses of a frame */
+     LatencyStats *stats; /*!< Latency of the binding */
 };
 
 void keybinds_init (void);
-void keybinds_add (int statemask, int modmask, const char *cmd, int lua_func);
+gboolean keybinds_add (int statemask, int modmask, const char *cmd, int lua_func, gboolean coalesce, GError **err);
+void keybinds_set_timeout (guint timeout);
+gchar keybinds_recording (void);
 
 /*! @} */
 
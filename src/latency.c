@@ -0,0 +1,220 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+
+/*!
+ * \addtogroup latency
+ * @{
+ */
+
+static GPtrArray *stats = NULL;
+
+/*!
+ * @param name Name of the handler.
+ * @return A new #LatencyStats, which is never freed.
+ *
+ * Create the histograms of a key handler, and register them for
+ * latency_report().
+ */
+LatencyStats *latency_stats_new (const gchar *name)
+{
+     LatencyStats *s = g_new0 (LatencyStats, 1);
+
+     s->name = g_strdup (name);
+
+     if (stats == NULL)
+          stats = g_ptr_array_new ();
+
+     g_ptr_array_add (stats, s);
+     return s;
+}
+
+/*!
+ * @param usec A duration.
+ * @return Its bucket.
+ *
+ * Durations under 8 microseconds have their own bucket, then each power
+ * of 2 is split in 4 buckets.
+ */
+static guint latency_bucket (guint32 usec)
+{
+     guint msb;
+
+     if (usec < 8)
+          return usec;
+
+     msb = g_bit_storage (usec) - 1;
+     return 8 + (msb - 3) * 4 + ((usec >> (msb - 2)) & 3);
+}
+
+/*!
+ * @param bucket A bucket.
+ * @return The largest duration of the bucket.
+ */
+static gint64 latency_bucket_max (guint bucket)
+{
+     guint msb, sub;
+
+     if (bucket < 8)
+          return bucket;
+
+     msb = (bucket - 8) / 4 + 3;
+     sub = (bucket - 8) % 4;
+
+     return ((gint64) (5 + sub) << (msb - 2)) - 1;
+}
+
+/*!
+ * @param h A #LatencyHistogram.
+ * @param usec Duration to record, in microseconds.
+ */
+void latency_record (LatencyHistogram *h, gint64 usec)
+{
+     gint max;
+
+     usec = CLAMP (usec, 0, G_MAXINT32);
+
+     g_atomic_int_inc (&h->buckets[latency_bucket (usec)]);
+     g_atomic_int_inc (&h->count);
+
+     do
+          max = g_atomic_int_get (&h->max);
+     while (usec > max && !g_atomic_int_compare_and_exchange (&h->max, max, usec));
+}
+
+/*!
+ * @param h A #LatencyHistogram.
+ * @param time Timestamp of a #GdkEvent (milliseconds).
+ *
+ * Record the delay since an event. X and Wayland servers timestamp
+ * events with the monotonic clock, delays which do not make sense
+ * (negative, or longer than #LATENCY_DELAY_MAX) are ignored.
+ */
+void latency_record_event (LatencyHistogram *h, guint32 time)
+{
+     gint32 delay;
+
+     if (time == GDK_CURRENT_TIME)
+          return;
+
+     delay = (gint32) ((guint32) (g_get_monotonic_time () / 1000) - time);
+
+     if (delay >= 0 && delay <= LATENCY_DELAY_MAX)
+          latency_record (h, (gint64) delay * 1000);
+}
+
+/*!
+ * @param h A #LatencyHistogram.
+ * @param p A percentile (between 0 and 1).
+ * @return Upper bound of the percentile, in microseconds, or -1 if
+ * nothing was recorded.
+ */
+gint64 latency_percentile (LatencyHistogram *h, gdouble p)
+{
+     gint64 total = g_atomic_int_get (&h->count), rank, seen = 0;
+     gint64 max = g_atomic_int_get (&h->max);
+     guint i;
+
+     if (total == 0)
+          return -1;
+
+     rank = MAX ((gint64) (p * total + 0.5), 1);
+
+     for (i = 0; i < LATENCY_BUCKETS; ++i)
+     {
+          seen += g_atomic_int_get (&h->buckets[i]);
+
+          if (seen >= rank)
+               return MIN (latency_bucket_max (i), max);
+     }
+
+     return max;
+}
+
+/*!
+ * @param out String to append to.
+ * @param usec A duration, or -1.
+ */
+static void latency_append (GString *out, gint64 usec)
+{
+     if (usec < 0)
+          g_string_append_printf (out, " %8s", "-");
+     else if (usec < 10000)
+          g_string_append_printf (out, " %6" G_GINT64_FORMAT "us", usec);
+     else
+          g_string_append_printf (out, " %6" G_GINT64_FORMAT "ms", usec / 1000);
+}
+
+static gint latency_compare (gconstpointer a, gconstpointer b)
+{
+     LatencyStats *sa = *(LatencyStats **) a, *sb = *(LatencyStats **) b;
+     gint64 pa = latency_percentile (&sa->run, 0.99), pb = latency_percentile (&sb->run, 0.99);
+
+     return (pa > pb ? -1 : pa < pb);
+}
+
+/*!
+ * @return The table of the handlers which were run, slowest first (must be freed).
+ */
+GString *latency_report (void)
+{
+     GString *out = g_string_new (NULL);
+     GPtrArray *sorted = g_ptr_array_new ();
+     guint i;
+
+     g_string_append_printf (out, "%-16s %6s %8s %8s %8s  %8s %8s %8s",
+                             _("Key"), _("Count"), _("delay50"), _("delay99"), _("delaymax"), _("run50"), _("run99"), _("runmax"));
+
+     for (i = 0; stats != NULL && i < stats->len; ++i)
+     {
+          LatencyStats *s = g_ptr_array_index (stats, i);
+
+          if (g_atomic_int_get (&s->run.count) > 0)
+               g_ptr_array_add (sorted, s);
+     }
+
+     g_ptr_array_sort (sorted, latency_compare);
+
+     for (i = 0; i < sorted->len; ++i)
+     {
+          LatencyStats *s = g_ptr_array_index (sorted, i);
+
+          g_string_append_printf (out, "\n%-16s %6d", s->name, g_atomic_int_get (&s->run.count));
+
+          latency_append (out, latency_percentile (&s->delay, 0.5));
+          latency_append (out, latency_percentile (&s->delay, 0.99));
+          latency_append (out, (s->delay.count ? g_atomic_int_get (&s->delay.max) : -1));
+          g_string_append_c (out, ' ');
+          latency_append (out, latency_percentile (&s->run, 0.5));
+          latency_append (out, latency_percentile (&s->run, 0.99));
+          latency_append (out, g_atomic_int_get (&s->run.max));
+     }
+
+     g_ptr_array_free (sorted, TRUE);
+     return out;
+}
+
+/*! @} */
@@ -0,0 +1,79 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __LATENCY_H
+#define __LATENCY_H
+
+/*!
+ * \defgroup latency Latency
+ * Latency histograms of the key handlers.
+ *
+ * Each key binding (and the inputbox) has two histograms: the delay
+ * between the key event and its dispatch, and the time spent in the
+ * handler (the lua callback for a binding). Histograms are log-bucketed,
+ * 4 buckets per power of 2 microseconds, and updated with atomic
+ * operations only, so they can be recorded from any thread.
+ *
+ * @{
+ */
+
+#include <glib.h>
+
+#define LATENCY_BUCKETS            120       /*!< Buckets of a histogram, up to 2^31 microseconds */
+#define LATENCY_DELAY_MAX          60000     /*!< Longest delay (ms) accepted from an event's timestamp */
+
+/*!
+ * \struct LatencyHistogram
+ * Log-bucketed histogram of durations, in microseconds.
+ */
+typedef struct
+{
+     volatile gint count;
+     volatile gint max;
+     volatile gint buckets[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+/*!
+ * \struct LatencyStats
+ * Histograms of a key handler.
+ */
+typedef struct
+{
+     gchar *name;                  /*!< Name of the handler */
+     LatencyHistogram delay;       /*!< Delay from the key event to the dispatch */
+     LatencyHistogram run;         /*!< Time spent in the handler */
+} LatencyStats;
+
+LatencyStats *latency_stats_new (const gchar *name);
+
+void latency_record (LatencyHistogram *h, gint64 usec);
+void latency_record_event (LatencyHistogram *h, guint32 time);
+gint64 latency_percentile (LatencyHistogram *h, gdouble p);
+
+GString *latency_report (void);
+
+/*! @} */
+
+#endif /* __LATENCY_H */
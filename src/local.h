@@ -101,7 +101,11 @@ gchar *find_file (guint type, const gchar *filename);
 char *str_replace (const char *search, const char *replace, const char *string);
 
 /* command.c */
+typedef void (*CommandForeachFunc) (const gchar *cmd, const gchar *desc, gpointer data);
+
 gboolean run_command (const char *cmd, GError **err);
+gboolean command_register (const gchar *cmd, const gchar *desc, int lua_func, GError **err);
+void command_foreach (CommandForeachFunc func, gpointer data);
 
 /*! @} */
 
@@ -23,6 +23,8 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <sys/stat.h>
+
 #include "local.h"
 
 extern int luaL_module_register (lua_State *L);
@@ -33,6 +35,9 @@ extern int luaL_webview_register (lua_State *L);
 extern int luaL_notebook_register (lua_State *L);
 extern int luaL_widgets_register (lua_State *L);
 extern int luaL_keybinds_register (lua_State *L);
+extern int luaL_history_register (lua_State *L);
+extern int luaL_command_register (lua_State *L);
+extern int luaL_async_register (lua_State *L);
 
 /*!
  * \addtogroup lua
@@ -58,6 +63,73 @@ static GQuark cream_lua_error_quark (void)
      return domain;
 }
 
+/*!
+ * \struct LuaWatchdog
+ * Budget of the running callback.
+ */
+static struct
+{
+     guint depth;                  /*!< Nested callbacks */
+     gboolean armed;               /*!< The budget of the outermost callback is checked */
+     gboolean exceeded;            /*!< The budget is exceeded, until the outermost callback returns */
+     const gchar *name;            /*!< Name of the outermost callback, or \c NULL */
+     gint64 start;                 /*!< Start of the outermost callback (monotonic, usec) */
+     guint64 count;                /*!< Instructions run (by steps of #LUA_WATCHDOG_STEP) */
+     guint64 instructions;         /*!< Instructions budget, 0 for none */
+     gint64 time;                  /*!< Time budget (usec), 0 for none */
+} watchdog = { 0, FALSE, FALSE, NULL, 0, 0, LUA_WATCHDOG_INSTRUCTIONS, LUA_WATCHDOG_TIME * 1000 };
+
+static char lua_objects_key = 0;   /*!< Registry key of the userdata of the bound objects */
+
+/*!
+ * @param L The lua VM state.
+ *
+ * Create the cache of the bound objects: a table with weak values,
+ * indexed by the C pointers of the objects.
+ */
+static void lua_objects_init (lua_State *L)
+{
+     lua_pushlightuserdata (L, &lua_objects_key);
+     lua_newtable (L);
+
+     lua_newtable (L);
+     lua_pushliteral (L, "v");
+     lua_setfield (L, -2, "__mode");
+     lua_setmetatable (L, -2);
+
+     lua_rawset (L, LUA_REGISTRYINDEX);
+}
+
+/*!
+ * @param data Unused.
+ * @param where The destroyed object.
+ *
+ * Invalidate the userdata of a destroyed object: its methods will
+ * raise an error.
+ */
+static void lua_object_destroyed (gpointer data, GObject *where)
+{
+     lua_State *L = app->luavm;
+
+     if (L == NULL)
+          return;
+
+     lua_pushlightuserdata (L, &lua_objects_key);
+     lua_rawget (L, LUA_REGISTRYINDEX);
+
+     lua_pushlightuserdata (L, where);
+     lua_rawget (L, -2);
+     if (lua_type (L, -1) == LUA_TUSERDATA)
+          *(gpointer *) lua_touserdata (L, -1) = NULL;
+     lua_pop (L, 1);
+
+     lua_pushlightuserdata (L, where);
+     lua_pushnil (L);
+     lua_rawset (L, -3);
+
+     lua_pop (L, 1);
+}
+
 /*!
  * @param L The lua VM state.
  * @return Number of return value in lua.
@@ -87,6 +159,664 @@ int luaL_error_handler (lua_State *L)
      return 1;
 }
 
+/*!
+ * \struct LuaBytecodeHeader
+ * Header of a cached chunk, followed by the path of its source file and
+ * by the bytecode. The chunk is stale when the source's modification
+ * time or size, or the version of lua, differ.
+ */
+typedef struct
+{
+     gchar magic[8];               /*!< #LUA_BYTECODE_MAGIC */
+     gint64 mtime;                 /*!< Modification time of the source */
+     gint64 size;                  /*!< Size of the source */
+     gchar version[32];            /*!< Lua release which dumped the chunk */
+     guint32 path_len;             /*!< Length of the source's path */
+} LuaBytecodeHeader;
+
+#define LUA_BYTECODE_MAGIC    "CREAMLC"
+
+/* LuaJIT and Lua do not share their bytecode */
+#ifdef HAVE_LUAJIT
+#    define LUA_BYTECODE_RELEASE  LUAJIT_VERSION
+#else
+#    define LUA_BYTECODE_RELEASE  LUA_RELEASE
+#endif
+
+/*!
+ * @param file Path of a lua file.
+ * @return Path of its cached bytecode (must be freed).
+ */
+static gchar *lua_bytecode_path (const gchar *file)
+{
+     gchar *sum = g_compute_checksum_for_string (G_CHECKSUM_MD5, file, -1);
+     gchar *name = g_build_filename ("bytecode", sum, NULL);
+     gchar *ret = cache_path (CACHE_TYPE_NONE, name);
+
+     g_free (name);
+     g_free (sum);
+     return ret;
+}
+
+static int lua_bytecode_writer (lua_State *L, const void *p, size_t sz, void *ud)
+{
+     g_string_append_len ((GString *) ud, p, sz);
+     return 0;
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param path Path of the cached bytecode.
+ * @param file Path of the source file.
+ * @param st Status of the source file.
+ *
+ * Dump the function on top of the stack, compiled from \a file, to the
+ * cache. The file is written by the cache's writer thread.
+ */
+static void lua_bytecode_save (lua_State *L, const gchar *path, const gchar *file, struct stat *st)
+{
+     GString *data = g_string_new (NULL);
+     LuaBytecodeHeader h;
+
+     memset (&h, 0, sizeof (h));
+     memcpy (h.magic, LUA_BYTECODE_MAGIC, sizeof (h.magic));
+     g_strlcpy (h.version, LUA_BYTECODE_RELEASE, sizeof (h.version));
+     h.mtime    = st->st_mtime;
+     h.size     = st->st_size;
+     h.path_len = strlen (file);
+
+     g_string_append_len (data, (const gchar *) &h, sizeof (h));
+     g_string_append_len (data, file, h.path_len);
+
+     if (lua_dump (L, lua_bytecode_writer, data) != 0)
+     {
+          g_string_free (data, TRUE);
+          return;
+     }
+
+     cache_rewrite (path, data);
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param file Path of the file to load.
+ * @return 0 on success, an error code of luaL_loadfile() otherwise.
+ *
+ * Same as luaL_loadfile(), but the chunk is loaded from the mapped
+ * bytecode cache when it is up to date, without running the parser.
+ * Otherwise, the compiled chunk is saved to the cache.
+ */
+static int lua_loadfile_cached (lua_State *L, const gchar *file)
+{
+     GMappedFile *map;
+     struct stat st;
+     gchar *path;
+     int s;
+
+     if (stat (file, &st) != 0)
+          return luaL_loadfile (L, file);
+
+     path = lua_bytecode_path (file);
+
+     if ((map = g_mapped_file_new (path, FALSE, NULL)) != NULL)
+     {
+          const gchar *data = g_mapped_file_get_contents (map);
+          gsize len = g_mapped_file_get_length (map);
+          const LuaBytecodeHeader *h = (const LuaBytecodeHeader *) data;
+
+          if (len > sizeof (*h)
+              && memcmp (h->magic, LUA_BYTECODE_MAGIC, sizeof (h->magic)) == 0
+              && strncmp (h->version, LUA_BYTECODE_RELEASE, sizeof (h->version)) == 0
+              && h->mtime == st.st_mtime && h->size == st.st_size
+              && h->path_len == strlen (file) && len > sizeof (*h) + h->path_len
+              && memcmp (data + sizeof (*h), file, h->path_len) == 0)
+          {
+               gsize offset = sizeof (*h) + h->path_len;
+
+               s = luaL_loadbuffer (L, data + offset, len - offset, file);
+               g_mapped_file_unref (map);
+
+               if (s == 0)
+               {
+                    g_free (path);
+                    return 0;
+               }
+
+               /* corrupted: compile the source again */
+               lua_pop (L, 1);
+          }
+          else
+               g_mapped_file_unref (map);
+     }
+
+     if ((s = luaL_loadfile (L, file)) == 0)
+          lua_bytecode_save (L, path, file, &st);
+
+     g_free (path);
+     return s;
+}
+
+/*!
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Loader of lua modules for <code>require</code>, replacing the one of
+ * lua: modules are searched in <code>package.path</code>, and loaded
+ * through the bytecode cache.
+ */
+static int lua_loader_cached (lua_State *L)
+{
+     const gchar *name = luaL_checkstring (L, 1);
+     gchar *sub, **templates, *file = NULL;
+     GString *tried;
+     int i;
+
+     lua_getglobal (L, "package");
+     lua_getfield (L, -1, "path");
+     if (!lua_isstring (L, -1))
+          luaL_error (L, _("'package.path' must be a string"));
+
+     sub       = g_strdelimit (g_strdup (name), ".", G_DIR_SEPARATOR);
+     templates = g_strsplit (lua_tostring (L, -1), ";", -1);
+     tried     = g_string_new (NULL);
+
+     lua_pop (L, 2);
+
+     for (i = 0; templates[i] != NULL && file == NULL; ++i)
+     {
+          gchar **parts;
+
+          if (templates[i][0] == '\0')
+               continue;
+
+          parts = g_strsplit (templates[i], "?", -1);
+          file  = g_strjoinv (sub, parts);
+          g_strfreev (parts);
+
+          if (!g_file_test (file, G_FILE_TEST_IS_REGULAR))
+          {
+               g_string_append_printf (tried, "\n\tno file '%s'", file);
+               g_free (file);
+               file = NULL;
+          }
+     }
+
+     g_strfreev (templates);
+     g_free (sub);
+
+     if (file == NULL)
+     {
+          lua_pushlstring (L, tried->str, tried->len);
+          g_string_free (tried, TRUE);
+          return 1;
+     }
+
+     g_string_free (tried, TRUE);
+
+     if (lua_loadfile_cached (L, file) != 0)
+     {
+          lua_pushfstring (L, "error loading module '%s' from file '%s':\n\t%s", name, file, lua_tostring (L, -1));
+          g_free (file);
+          return lua_error (L);
+     }
+
+     g_free (file);
+     return 1;
+}
+
+/*!
+ * @param L The lua VM state.
+ *
+ * Abort the callback when it exceeds its budget. The error ends the task
+ * running the callback (see lua_async_run()). Once exceeded, the error
+ * is raised again at each check, until the outermost callback returns:
+ * catching it (with <code>pcall</code>, or in an outer task) does not
+ * give the callback more time.
+ */
+static void lua_watchdog_check (lua_State *L)
+{
+     gint64 elapsed = g_get_monotonic_time () - watchdog.start;
+     lua_Debug where;
+
+     if (!watchdog.exceeded)
+     {
+          watchdog.count += lua_gethookcount (L);
+
+          if ((watchdog.instructions == 0 || watchdog.count < watchdog.instructions)
+              && (watchdog.time == 0 || elapsed < watchdog.time))
+               return;
+
+          watchdog.exceeded = TRUE;
+     }
+
+     if (lua_getstack (L, 0, &where) && lua_getinfo (L, "Sl", &where))
+          lua_pushfstring (L, "%s:%d: ", where.short_src, where.currentline);
+     else
+          lua_pushliteral (L, "");
+
+     lua_pushfstring (L, _("%s aborted after %f instructions and %d ms"),
+                      (watchdog.name ? watchdog.name : _("callback")), (lua_Number) watchdog.count, (int) (elapsed / 1000));
+     lua_concat (L, 2);
+     lua_error (L);
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param ar Unused.
+ *
+ * Count hook, shared by the watchdog and the profiler.
+ */
+static void lua_hook (lua_State *L, lua_Debug *ar)
+{
+     if (luaprof_running ())
+          luaprof_sample (L);
+
+     if (watchdog.armed)
+          lua_watchdog_check (L);
+}
+
+/*!
+ * @param L The lua VM state.
+ *
+ * Set the count hook if the watchdog is armed or the profiler running,
+ * remove it otherwise (no overhead).
+ */
+void lua_hook_update (lua_State *L)
+{
+     if (luaprof_running ())
+          lua_sethook (L, lua_hook, LUA_MASKCOUNT, LUAPROF_STEP);
+     else if (watchdog.armed)
+          lua_sethook (L, lua_hook, LUA_MASKCOUNT, LUA_WATCHDOG_STEP);
+     else
+          lua_sethook (L, NULL, 0, 0);
+}
+
+/*!
+ * @param instructions Instructions budget of a callback, 0 for none.
+ * @param ms Time budget of a callback (milliseconds), 0 for none.
+ *
+ * Set the budget of the lua callbacks.
+ */
+void lua_watchdog_set_budget (guint64 instructions, guint ms)
+{
+     watchdog.instructions = instructions;
+     watchdog.time         = (gint64) ms * 1000;
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param name Name of the callback, or \c NULL.
+ *
+ * Start the budget of a callback. Nested callbacks share the budget of
+ * the outermost one.
+ */
+void lua_watchdog_start (lua_State *L, const gchar *name)
+{
+     if (watchdog.depth++ > 0 || (watchdog.instructions == 0 && watchdog.time == 0))
+          return;
+
+     watchdog.armed    = TRUE;
+     watchdog.exceeded = FALSE;
+     watchdog.name     = name;
+     watchdog.start = g_get_monotonic_time ();
+     watchdog.count = 0;
+
+     lua_hook_update (L);
+}
+
+/*!
+ * @param L The lua VM state.
+ *
+ * End the budget of a callback.
+ */
+void lua_watchdog_stop (lua_State *L)
+{
+     g_return_if_fail (watchdog.depth > 0);
+
+     if (--watchdog.depth == 0 && watchdog.armed)
+     {
+          watchdog.armed    = FALSE;
+          watchdog.exceeded = FALSE;
+          lua_hook_update (L);
+     }
+}
+
+#define LUA_TASK_POOL         8    /*!< Idle tasks kept for the next callbacks */
+
+/*!
+ * \struct _LuaTask
+ * A callback running in its own coroutine, so it can wait for
+ * asynchronous operations without blocking the main loop.
+ */
+struct _LuaTask
+{
+     lua_State *L;                 /*!< The coroutine */
+     int ref;                      /*!< Reference on the coroutine */
+     const gchar *name;            /*!< Name of the callback, or \c NULL */
+     gchar *saved;                 /*!< Copy of \a name, made when the task waits */
+     gboolean running;             /*!< \c FALSE while the task is idle */
+     LuaAsync *waiting;            /*!< Operation the task waits for */
+     LuaTask *next;                /*!< Next idle task */
+};
+
+static GHashTable *lua_tasks = NULL;    /*!< Tasks by coroutine, idle ones included */
+static LuaTask *lua_idle = NULL;        /*!< Idle tasks, reused by lua_async_run() */
+static guint lua_nidle = 0;
+static GList *lua_pending = NULL;       /*!< Pending #LuaAsync */
+
+/*!
+ * @param task A #LuaTask.
+ *
+ * Free a task and its coroutine.
+ */
+static void lua_task_free (LuaTask *task)
+{
+     g_hash_table_remove (lua_tasks, task->L);
+
+     if (task->waiting != NULL)
+          task->waiting->task = NULL;
+
+     luaL_unref (app->luavm, LUA_REGISTRYINDEX, task->ref);
+     g_free (task->saved);
+     g_slice_free (LuaTask, task);
+}
+
+/*!
+ * @param task A finished #LuaTask.
+ * @param reusable \c TRUE if its function returned.
+ *
+ * Keep a finished task for the next callback, so a callback which
+ * does not wait allocates nothing. A coroutine which failed can not
+ * be resumed again, it is freed.
+ */
+static void lua_task_release (LuaTask *task, gboolean reusable)
+{
+     if (!reusable || lua_nidle >= LUA_TASK_POOL)
+     {
+          lua_task_free (task);
+          return;
+     }
+
+     if (task->waiting != NULL)
+          task->waiting->task = NULL;
+
+     g_free (task->saved);
+     task->saved   = NULL;
+     task->name    = NULL;
+     task->running = FALSE;
+     task->waiting = NULL;
+     lua_settop (task->L, 0);
+
+     task->next = lua_idle;
+     lua_idle   = task;
+     lua_nidle++;
+}
+
+/*!
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Push the traceback of a task (light userdata), in protected mode:
+ * the <code>debug</code> library may be missing.
+ */
+static int lua_task_traceback (lua_State *L)
+{
+     LuaTask *task = lua_touserdata (L, 1);
+
+     lua_getglobal (L, "debug");
+     lua_getfield (L, -1, "traceback");
+     lua_rawgeti (L, LUA_REGISTRYINDEX, task->ref);
+     lua_pushliteral (L, "error while running function");
+     lua_call (L, 2, 1);
+
+     return 1;
+}
+
+/*!
+ * @param task A #LuaTask which failed, with the error on its stack.
+ *
+ * Report the error of a task, with the traceback of its coroutine if
+ * it can be built.
+ */
+static void lua_task_error (LuaTask *task)
+{
+     lua_State *L = app->luavm;
+     GError *err;
+
+     err = g_error_new (CREAM_LUA_ERROR, CREAM_LUA_ERROR_FAILED, "%s", lua_tostring (task->L, -1));
+     CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, err);
+
+     lua_pushcfunction (L, lua_task_traceback);
+     lua_pushlightuserdata (L, task);
+
+     if (lua_pcall (L, 1, 1, 0) == 0 && lua_isstring (L, -1))
+          warn ("%s\nerror: %s", lua_tostring (L, -1), err->message);
+     else
+          warn ("%s", err->message);
+
+     lua_pop (L, 1);
+     g_error_free (err);
+}
+
+/*!
+ * @param task A #LuaTask.
+ * @param nargs Number of values passed to the coroutine.
+ * @param nreturns Number of return values to move to \a from.
+ * @param from State to move the return values to, or \c NULL.
+ * @return \c TRUE if the task returned, \c FALSE if it failed or waits.
+ *
+ * Run a task until it returns, fails or waits, within the budget of a
+ * callback. The task is freed unless it waits.
+ */
+static gboolean lua_task_resume (LuaTask *task, int nargs, int nreturns, lua_State *from)
+{
+     int s;
+
+     task->waiting = NULL;
+
+     /* the hook of a coroutine is set when it runs */
+     lua_watchdog_start (task->L, task->name);
+     lua_hook_update (task->L);
+     s = lua_resume (task->L, nargs);
+     lua_watchdog_stop (task->L);
+
+     if (s == LUA_YIELD)
+     {
+          if (task->waiting != NULL)
+               return FALSE;
+
+          lua_pushliteral (task->L, "attempt to yield from a callback");
+          s = LUA_ERRRUN;
+     }
+
+     if (s != 0)
+          lua_task_error (task);
+     else if (from != NULL)
+     {
+          lua_settop (task->L, nreturns);
+          lua_xmove (task->L, from, nreturns);
+     }
+
+     lua_task_release (task, (s == 0));
+     return (s == 0);
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param ref The function's reference.
+ * @param nargs Number of arguments.
+ * @param nreturns Number of return values.
+ * @param name Name of the callback, reported if it exceeds its budget (or \c NULL).
+ *
+ * Call a function as a task (see lua_async_run()). Nothing is left on
+ * the stack if the function failed or waits.
+ */
+void luaL_callnamed (lua_State *L, int ref, int nargs, int nreturns, const gchar *name)
+{
+     if (ref)
+     {
+          lua_rawgeti (L, LUA_REGISTRYINDEX, ref);
+
+          /* Move function before arguments */
+          lua_insert (L, - nargs - 1);
+
+          lua_async_run (L, nargs, nreturns, name);
+     }
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param nargs Number of arguments, on the stack after the function.
+ * @param nreturns Number of return values.
+ * @param name Name of the task, reported if it exceeds its budget (or \c NULL).
+ * @return \c TRUE if the function returned, \c FALSE otherwise.
+ *
+ * Call a function in a coroutine, until it returns or waits for an
+ * asynchronous operation (see lua_async_new()). Each run of the
+ * coroutine has the budget of a callback (see lua_watchdog_start()).
+ * The function and its arguments are popped, and replaced by its
+ * return values if it returned. The coroutines of the finished tasks
+ * are reused.
+ */
+gboolean lua_async_run (lua_State *L, int nargs, int nreturns, const gchar *name)
+{
+     LuaTask *task = lua_idle;
+
+     if (task != NULL)
+     {
+          lua_idle = task->next;
+          lua_nidle--;
+     }
+     else
+     {
+          task = g_slice_new0 (LuaTask);
+          task->L   = lua_newthread (L);
+          task->ref = luaL_ref (L, LUA_REGISTRYINDEX);
+          g_hash_table_insert (lua_tasks, task->L, task);
+     }
+
+     task->running = TRUE;
+     task->name    = name;
+
+     lua_xmove (L, task->L, nargs + 1);
+     return lua_task_resume (task, nargs, nreturns, L);
+}
+
+/*!
+ * @param L The lua VM state, in a C function.
+ * @return \c TRUE if \a L runs a task, which can wait.
+ *
+ * Lua 5.1 cannot yield across a C function: the task cannot wait when
+ * the caller runs inside <code>pcall</code> for instance.
+ */
+gboolean lua_async_yieldable (lua_State *L)
+{
+     LuaTask *task;
+     lua_Debug ar;
+     int level;
+
+     if (lua_tasks == NULL || (task = g_hash_table_lookup (lua_tasks, L)) == NULL || !task->running)
+          return FALSE;
+
+     /* level 0 is the caller */
+     for (level = 1; lua_getstack (L, level, &ar); ++level)
+     {
+          lua_getinfo (L, "S", &ar);
+
+          if (g_str_equal (ar.what, "C"))
+               return FALSE;
+     }
+
+     return TRUE;
+}
+
+/*!
+ * @param L The lua VM state, running a task.
+ * @return A new #LuaAsync.
+ *
+ * Prepare the running task to wait for an asynchronous operation: the
+ * caller starts the operation, then returns <code>lua_yield (L, 0)</code>.
+ * On completion, the operation pushes its results on
+ * lua_async_state() and calls lua_async_resume(). Raise an error if
+ * the task cannot wait (see lua_async_yieldable()).
+ */
+LuaAsync *lua_async_new (lua_State *L)
+{
+     LuaTask *task;
+     LuaAsync *async;
+
+     if (!lua_async_yieldable (L))
+          luaL_error (L, "cannot wait outside of a callback, or inside pcall (see async.run)");
+
+     task = g_hash_table_lookup (lua_tasks, L);
+
+     /* the name of the callback may not outlive its first run */
+     if (task->saved == NULL && task->name != NULL)
+          task->name = task->saved = g_strdup (task->name);
+
+     /* a previous yield failed (across a metamethod) */
+     if (task->waiting != NULL)
+          task->waiting->task = NULL;
+
+     async = g_slice_new (LuaAsync);
+     async->task        = task;
+     async->cancellable = g_cancellable_new ();
+
+     task->waiting = async;
+     lua_pending = g_list_prepend (lua_pending, async);
+
+     return async;
+}
+
+/*!
+ * @param async A #LuaAsync.
+ * @return The coroutine to push the results on, or \c NULL if the task
+ * cannot be resumed anymore (then only free \a async).
+ */
+lua_State *lua_async_state (LuaAsync *async)
+{
+     if (async->task == NULL || async->task->waiting != async)
+          return NULL;
+
+     return async->task->L;
+}
+
+/*!
+ * @param async A completed #LuaAsync.
+ * @param nargs Number of results, pushed on lua_async_state().
+ *
+ * Resume the task waiting for \a async, with the results as the return
+ * values of the operation, and free \a async.
+ */
+void lua_async_resume (LuaAsync *async, int nargs)
+{
+     LuaTask *task = async->task;
+
+     if (lua_async_state (async) == NULL)
+     {
+          lua_async_free (async);
+          return;
+     }
+
+     lua_async_free (async);
+     lua_task_resume (task, nargs, 0, NULL);
+}
+
+/*!
+ * @param async A #LuaAsync.
+ *
+ * Free an operation, without resuming its task.
+ */
+void lua_async_free (LuaAsync *async)
+{
+     if (async->task != NULL && async->task->waiting == async)
+          async->task->waiting = NULL;
+
+     lua_pending = g_list_remove (lua_pending, async);
+     g_object_unref (async->cancellable);
+     g_slice_free (LuaAsync, async);
+}
+
 /*!
  * @param err \class{GError} pointer in order to follow possible errors.
  * @return \c TRUE on success, \c FALSE otherwise.
@@ -107,6 +837,9 @@ gboolean lua_ctx_init (GError **err)
      /* open libraries */
      luaL_openlibs (luavm);
 
+     lua_objects_init (luavm);
+     lua_tasks = g_hash_table_new (g_direct_hash, g_direct_equal);
+
      luaL_clipboard_register (luavm);
      lua_pop (luavm, 1);
 
@@ -128,6 +861,15 @@ gboolean lua_ctx_init (GError **err)
      luaL_keybinds_register (luavm);
      lua_pop (luavm, 1);
 
+     luaL_history_register (luavm);
+     lua_pop (luavm, 1);
+
+     luaL_command_register (luavm);
+     lua_pop (luavm, 1);
+
+     luaL_async_register (luavm);
+     lua_pop (luavm, 1);
+
      /* get package.path */
      lua_getglobal (luavm, "package");
      if (!lua_istable (luavm, 1))
@@ -192,6 +934,15 @@ gboolean lua_ctx_init (GError **err)
 
      lua_setfield (luavm, 1, "path"); /* package.path = "concatenated string" */
 
+     /* replace the loader of lua files (see lua_loader_cached ()) */
+     lua_getfield (luavm, 1, "loaders");
+     if (lua_istable (luavm, -1))
+     {
+          lua_pushcfunction (luavm, lua_loader_cached);
+          lua_rawseti (luavm, -2, 2);
+     }
+     lua_pop (luavm, 1);
+
      lua_pop (luavm, 1);
 
      return TRUE;
@@ -202,7 +953,8 @@ gboolean lua_ctx_init (GError **err)
  * @param err \class{GError} pointer in order to follow possible errors.
  * @return \c TRUE on success, \c FALSE otherwise.
  *
- * Parse a lua file.
+ * Parse a lua file (or load it from the bytecode cache, see
+ * lua_loadfile_cached ()), and run it.
  */
 gboolean lua_ctx_parse (const char *file, GError **err)
 {
@@ -211,7 +963,7 @@ gboolean lua_ctx_parse (const char *file, GError **err)
 
      g_return_val_if_fail (file, FALSE);
 
-     s = luaL_loadfile (luavm, file);
+     s = lua_loadfile_cached (luavm, file);
      if (s == 0)
      {
           lua_pushcfunction (luavm, luaL_error_handler);
@@ -236,159 +988,86 @@ gboolean lua_ctx_parse (const char *file, GError **err)
 /*! Close the lua VM state */
 void lua_ctx_close (void)
 {
-     lua_close (app->luavm);
-}
-
-/* Used for __index and __newindex */
+     GList *l, *tasks = g_list_copy (lua_pending);
 
-/*!
- * @param L The lua VM state.
- * @param l Table of functions to add.
- *
- * Register member's setters or getters.
- */
-void luaI_add (lua_State *L, const luaI_reg *l)
-{
-     for (; l->name; ++l)
+     /* pending operations complete without resuming their task */
+     for (l = tasks; l != NULL; l = l->next)
      {
-          lua_pushstring (L, l->name);
-          lua_pushlightuserdata (L, (void*) l);
-          lua_settable (L, -3);
+          LuaAsync *async = l->data;
+
+          async->task = NULL;
+          g_cancellable_cancel (async->cancellable);
      }
-}
 
-/*!
- * @param L The lua VM state.
- * @return Number of return value in lua.
- */
-static int luaI_call (lua_State *L)
-{
-     /* for get: stack has userdara, index, lightuserdata
-      * for set: stack has userdata, index, value, lightuserdata
-      */
-     luaI_reg *m = (luaI_reg*) lua_touserdata (L, -1);   /* member info */
-     lua_pop (L, 1);                                   /* drop lightuserdata */
-     luaL_checktype (L, 1, LUA_TUSERDATA);
-     return m->func (L, (void *)((char *) lua_touserdata (L, 1) + m->offset));
+     g_list_free (tasks);
+
+     tasks = g_hash_table_get_values (lua_tasks);
+     g_list_foreach (tasks, (GFunc) lua_task_free, NULL);
+     g_list_free (tasks);
+
+     g_hash_table_destroy (lua_tasks);
+     lua_tasks = NULL;
+     lua_idle  = NULL;
+     lua_nidle = 0;
+
+     lua_close (app->luavm);
+     app->luavm = NULL;
 }
 
 /*!
  * @param L The lua VM state.
- * @return Number of return value in lua.
+ * @param obj The object to push.
+ * @param size Size of the userdata, starting with the pointer to \a obj.
+ * @param tname Lua type of the object.
+ * @return The userdata of \a obj.
  *
- * __index handler.
+ * Push the userdata of an object. Each object has a single userdata,
+ * created on its first push, and kept as long as it is referenced in
+ * lua. When the object is destroyed, the pointer at the start of its
+ * userdata is set to \c NULL.
  */
-int luaI_index (lua_State *L)
+gpointer lua_pushobject (lua_State *L, GObject *obj, size_t size, const char *tname)
 {
-     /* stack has userdata, index */
-     lua_pushvalue (L, 2);                   /* dup index */
-     lua_rawget (L, lua_upvalueindex (1));   /* lookup member by name */
-     if (!lua_islightuserdata (L, -1))
+     static GQuark quark = 0;
+     gpointer ud;
+
+     lua_pushlightuserdata (L, &lua_objects_key);
+     lua_rawget (L, LUA_REGISTRYINDEX);
+
+     lua_pushlightuserdata (L, obj);
+     lua_rawget (L, -2);
+
+     if (lua_type (L, -1) == LUA_TUSERDATA)
      {
-          lua_pop (L, 1);                         /* drop value */
-          lua_pushvalue (L, 2);                   /* dup index */
-          lua_gettable (L, lua_upvalueindex (2)); /* else try methods */
-          if (lua_isnil (L, -1))                  /* invalid member */
-               luaL_error (L, _("cannot get member '%s'"), lua_tostring (L, 2));
-          return 1;
+          lua_remove (L, -2);
+          return lua_touserdata (L, -1);
      }
 
-     return luaI_call (L);
-}
+     lua_pop (L, 1);
 
-/*!
- * @param L The lua VM state.
- * @return Number of return value in lua.
- *
- * __newindex handler.
- */
-int luaI_newindex (lua_State *L)
-{
-     /* stack has userdata, index, value */
-     lua_pushvalue (L, 2);                   /* dup index */
-     lua_rawget (L, lua_upvalueindex (1));   /* lookup member by name */
-     if (!lua_islightuserdata (L, -1))       /* invalid member */
-          luaL_error (L, _("cannot set member '%s'"), lua_tostring (L, 2));
-     return luaI_call (L);
-}
+     ud = lua_newuserdata (L, size);
+     memset (ud, 0, size);
+     *(gpointer *) ud = obj;
 
-/*!
- * @param L The lua VM state.
- * @param v C data.
- * @return Number of return value in lua.
- *
- * Int getter.
- */
-int luaI_getint (lua_State *L, gpointer v)
-{
-     lua_pushnumber (L, *(int *) v);
-     return 1;
-}
-
-/*!
- * @param L The lua VM state.
- * @param v C data.
- * @return Number of return value in lua.
- *
- * Boolean getter.
- */
-int luaI_getbool (lua_State *L, gpointer v)
-{
-     lua_pushboolean (L, *(gboolean *) v);
-     return 1;
-}
+     luaL_getmetatable (L, tname);
+     lua_setmetatable (L, -2);
 
-/*!
- * @param L The lua VM state.
- * @param v C data.
- * @return Number of return value in lua.
- *
- * String getter.
- */
-int luaI_getstring (lua_State *L, gpointer v)
-{
-     lua_pushstring (L, (char *) v);
-     return 1;
-}
+     lua_pushlightuserdata (L, obj);
+     lua_pushvalue (L, -2);
+     lua_rawset (L, -4);
+     lua_remove (L, -2);
 
-/*!
- * @param L The lua VM state.
- * @param v C data.
- * @return Number of return value in lua.
- *
- * Int setter.
- */
-int luaI_setint (lua_State *L, gpointer v)
-{
-     *(int *) v = luaL_checkint (L, 3);
-     return 0;
-}
+     /* watch the object once, whatever the number of userdata collected */
+     if (quark == 0)
+          quark = g_quark_from_static_string ("cream-lua-object");
 
-/*!
- * @param L The lua VM state.
- * @param v C data.
- * @return Number of return value in lua.
- *
- * Boolean setter.
- */
-int luaI_setbool (lua_State *L, gpointer v)
-{
-     *(gboolean *) v = luaL_checkboolean (L, 3);
-     return 0;
-}
+     if (g_object_get_qdata (obj, quark) == NULL)
+     {
+          g_object_weak_ref (obj, lua_object_destroyed, NULL);
+          g_object_set_qdata (obj, quark, GINT_TO_POINTER (1));
+     }
 
-/*!
- * @param L The lua VM state.
- * @param v C data.
- * @return Number of return value in lua.
- *
- * Int setter.
- */
-int luaI_setstring (lua_State *L, gpointer v)
-{
-     char **str = (char **) v;
-     *str = g_strdup (luaL_checkstring (L, 3));
-     return 0;
+     return ud;
 }
 
 /*! @} */
@@ -29,7 +29,12 @@
 #include <lua.h>
 #include <lualib.h>
 #include <lauxlib.h>
+#ifdef HAVE_LUAJIT
+#    include <luajit.h>
+#endif
 #include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
 #include <err.h>
 
 /*!
@@ -41,6 +46,35 @@
 
 int luaL_error_handler (lua_State *L);
 
+#define LUA_WATCHDOG_INSTRUCTIONS  100000000 /*!< Default instructions budget of a callback */
+#define LUA_WATCHDOG_TIME          1000      /*!< Default time budget (ms) of a callback */
+#define LUA_WATCHDOG_STEP          10000     /*!< Instructions between two checks of the budget */
+
+void lua_hook_update (lua_State *L);
+void lua_watchdog_set_budget (guint64 instructions, guint ms);
+void lua_watchdog_start (lua_State *L, const gchar *name);
+void lua_watchdog_stop (lua_State *L);
+
+typedef struct _LuaTask LuaTask;
+
+/*!
+ * \struct LuaAsync
+ * A task waiting for an asynchronous operation (see lua_async_new()).
+ */
+typedef struct
+{
+     LuaTask *task;                /*!< The waiting task, \c NULL once it cannot be resumed */
+     GCancellable *cancellable;    /*!< Cancelled when the lua VM is closed */
+} LuaAsync;
+
+void luaL_callnamed (lua_State *L, int ref, int nargs, int nreturns, const gchar *name);
+gboolean lua_async_run (lua_State *L, int nargs, int nreturns, const gchar *name);
+gboolean lua_async_yieldable (lua_State *L);
+LuaAsync *lua_async_new (lua_State *L);
+lua_State *lua_async_state (LuaAsync *async);
+void lua_async_resume (LuaAsync *async, int nargs);
+void lua_async_free (LuaAsync *async);
+
 /*!
  * @param L The lua VM state.
  * @param idx Index of the stack.
@@ -62,33 +96,11 @@ static inline int luaL_checkfunction (lua_State *L, int idx)
  * @param nargs Number of arguments.
  * @param nreturns Number of return values.
  *
- * Call a function (using lua_call()).
+ * Call a function (see luaL_callnamed()).
  */
 static inline void luaL_callfunction (lua_State *L, int ref, int nargs, int nreturns)
 {
-     if (ref)
-     {
-          int errfunc;
-
-          lua_rawgeti (L, LUA_REGISTRYINDEX, ref);
-
-          /* Move function before arguments */
-          lua_insert (L, - nargs - 1);
-
-          /* push error handler and move it before args and function */
-          lua_pushcfunction (L, luaL_error_handler);
-          lua_insert (L, - nargs - 2);
-          errfunc = lua_gettop (L) - nargs - 1;
-
-          if (lua_pcall (L, nargs, nreturns, - nargs - 2))
-          {
-               warn ("%s", lua_tostring (L, -1));
-               lua_pop (L, 2);
-               return;
-          }
-
-          lua_remove (L, errfunc);
-     }
+     luaL_callnamed (L, ref, nargs, nreturns, NULL);
 }
 
 /*!
@@ -144,6 +156,7 @@ gboolean lua_ctx_parse (const char *file, GError **err);
 void lua_ctx_close (void);
 
 /* push objects */
+gpointer lua_pushobject (lua_State *L, GObject *obj, size_t size, const char *tname);
 extern void lua_pushwebview (lua_State *L, WebView *w);
 extern void lua_pushnotebook (lua_State *L, Notebook *n);
 
@@ -162,7 +175,7 @@ typedef struct
      size_t offset;           /*!< offset of member with its type. */
 } luaI_reg;
 
-void luaI_add (lua_State *L, const luaI_reg *l);
+void luaI_dispatch (lua_State *L, int metatable, int methods, const luaI_reg *getters, const luaI_reg *setters);
 int luaI_index (lua_State *L);
 int luaI_newindex (lua_State *L);
 
@@ -180,7 +193,8 @@ int luaI_setstring (lua_State *L, gpointer v);
  * @param name Package's name.
  * @param lua_type Lua type's name.
  *
- * Register a package in lua.
+ * Register a package in lua. The handlers of the members are set by
+ * luaI_dispatch().
  */
 #define LUAL_REGISTER_DECL(name,lua_type)                        \
 int luaL_##name##_register (lua_State *L)                        \
@@ -198,18 +212,9 @@ int luaL_##name##_register (lua_State *L)                        \
      lua_pushvalue (L, methods);                                 \
      lua_rawset (L, metatable);                                  \
                                                                  \
-     lua_pushliteral (L, "__index");                             \
-     lua_pushvalue (L, metatable);                               \
-     luaI_add (L, cream_##name##_getters);                       \
-     lua_pushvalue (L, methods);                                 \
-     lua_pushcclosure (L, luaI_index, 2);                        \
-     lua_rawset (L, metatable);                                  \
-                                                                 \
-     lua_pushliteral (L, "__newindex");                          \
-     lua_newtable (L);                                           \
-     luaI_add (L, cream_##name##_setters);                       \
-     lua_pushcclosure (L, luaI_newindex, 1);                     \
-     lua_rawset (L, metatable);                                  \
+     luaI_dispatch (L, metatable, methods,                       \
+                    cream_##name##_getters,                      \
+                    cream_##name##_setters);                     \
                                                                  \
      lua_pop (L, 1);                                             \
      return 1;                                                   \
@@ -34,8 +34,7 @@
 
 typedef struct
 {
-     Notebook *n;
-     int self;
+     Notebook *n;   /*!< Bound object, \c NULL once destroyed (see lua_pushobject()) */
 } luaL_Notebook;
 
 static luaL_Notebook *lua_cast_notebook (lua_State *L, int index)
@@ -51,7 +50,7 @@ static luaL_Notebook *lua_check_notebook (lua_State *L, int index)
      luaL_checktype (L, index, LUA_TUSERDATA);
      ret = (luaL_Notebook *) luaL_checkudata (L, index, LUA_TNOTEBOOK);
      if (!ret) luaL_typerror (L, index, LUA_TNOTEBOOK);
-     if (!ret->self) luaL_error (L, _("%s not referenced."), LUA_TNOTEBOOK);
+     if (!ret->n) luaL_error (L, _("%s not referenced."), LUA_TNOTEBOOK);
      return ret;
 }
 
@@ -61,19 +60,11 @@ static luaL_Notebook *lua_check_notebook (lua_State *L, int index)
  * @param L The lua VM state.
  * @param n The #Notebook object to push in lua.
  *
- * Push a #Notebook object in lua.
+ * Push a #Notebook object in lua (always the same userdata).
  */
 void lua_pushnotebook (lua_State *L, Notebook *n)
 {
-     luaL_Notebook *ret = (luaL_Notebook *) lua_newuserdata (L, sizeof (luaL_Notebook));
-     ret->n = n;
-
-     /* create a self reference */
-     ret->self = luaL_ref (L, LUA_REGISTRYINDEX);
-     lua_rawgeti (L, LUA_REGISTRYINDEX, ret->self);
-
-     luaL_getmetatable (L, LUA_TNOTEBOOK);
-     lua_setmetatable (L, -2);
+     lua_pushobject (L, G_OBJECT (n), sizeof (luaL_Notebook), LUA_TNOTEBOOK);
 }
 
 /* methods */
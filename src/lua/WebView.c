@@ -34,8 +34,7 @@
 
 typedef struct
 {
-     WebView *w;
-     int self;
+     WebView *w;    /*!< Bound object, \c NULL once destroyed (see lua_pushobject()) */
 } luaL_WebView;
 
 static luaL_WebView *lua_cast_webview (lua_State *L, int index)
@@ -51,7 +50,7 @@ static luaL_WebView *lua_check_webview (lua_State *L, int index)
      luaL_checktype (L, index, LUA_TUSERDATA);
      ret = (luaL_WebView *) luaL_checkudata (L, index, LUA_TWEBVIEW);
      if (!ret) luaL_typerror (L, index, LUA_TWEBVIEW);
-     if (!ret->self) luaL_error (L, _("%s not referenced."), LUA_TWEBVIEW);
+     if (!ret->w) luaL_error (L, _("%s not referenced."), LUA_TWEBVIEW);
      return ret;
 }
 
@@ -60,19 +59,11 @@ static luaL_WebView *lua_check_webview (lua_State *L, int index)
  * @param L The lua VM state.
  * @param w The #WebView object to push in lua.
  *
- * Push a #WebView object in lua.
+ * Push a #WebView object in lua (always the same userdata).
  */
 void lua_pushwebview (lua_State *L, WebView *w)
 {
-     luaL_WebView *ret = (luaL_WebView *) lua_newuserdata (L, sizeof (luaL_WebView));
-     ret->w = w;
-
-     /* create a self reference */
-     ret->self = luaL_ref (L, LUA_REGISTRYINDEX);
-     lua_rawgeti (L, LUA_REGISTRYINDEX, ret->self);
-
-     luaL_getmetatable (L, LUA_TWEBVIEW);
-     lua_setmetatable (L, -2);
+     lua_pushobject (L, G_OBJECT (w), sizeof (luaL_WebView), LUA_TWEBVIEW);
 }
 
 /* methods */
@@ -168,14 +159,34 @@ static int luaL_webview_close (lua_State *L)
 {
      luaL_WebView *obj = lua_check_webview (L, 1);
 
-     /* delete self reference */
-     luaL_unref (L, LUA_REGISTRYINDEX, obj->self);
-     obj->self = 0;
-
      notebook_close (CREAM_NOTEBOOK (obj->w->notebook), gtk_notebook_page_num (GTK_NOTEBOOK (obj->w->notebook), GTK_WIDGET (obj->w)));
      return 0;
 }
 
+/*!
+ * \fn static int luaL_webview_hints (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Enter hint mode.
+ * \code function WebView:hints (alphabet) \endcode
+ */
+static int luaL_webview_hints (lua_State *L)
+{
+     luaL_WebView *obj = lua_check_webview (L, 1);
+     const gchar *alphabet = luaL_optstring (L, 2, NULL);
+     GError *error = NULL;
+
+     if (!hints_start (obj->w, alphabet, &error))
+     {
+          lua_pushstring (L, error->message);
+          g_error_free (error);
+          return lua_error (L);
+     }
+
+     return 0;
+}
+
 static const luaL_reg cream_webview_methods[] =
 {
      { "uri",       luaL_webview_uri },
@@ -184,6 +195,7 @@ static const luaL_reg cream_webview_methods[] =
      { "close",     luaL_webview_close },
      { "useragent", luaL_webview_useragent },
      { "raise",     luaL_webview_raise },
+     { "hints",     luaL_webview_hints },
      { NULL, NULL }
 };
 
@@ -0,0 +1,475 @@
+/*
+ * Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <sys/wait.h>
+
+#include "../local.h"
+
+/*!
+ * \defgroup lua-async Async
+ * \ingroup lua
+ * Package 'async' of the lua API.
+ *
+ * Callbacks run as tasks (see lua_async_run()). The functions of this
+ * package start an operation and suspend the task; the main loop goes
+ * on, and the task is resumed with the results once the operation
+ * completes.
+ *
+ * @{
+ */
+
+#define ASYNC_BUFFER_SIZE     4096
+
+/*!
+ * \struct AsyncSpawn
+ * A process whose output is read.
+ */
+typedef struct
+{
+     LuaAsync *async;
+     GString *output;         /*!< Standard output of the process */
+     gint status;             /*!< Exit status */
+     guint pending;           /*!< Number of events to wait for (end of output, exit) */
+} AsyncSpawn;
+
+/*!
+ * \struct AsyncRequest
+ * A request on a socket.
+ */
+typedef struct
+{
+     LuaAsync *async;
+     GSocketClient *client;
+     GSocketConnection *conn;
+     gchar *data;             /*!< Data to send */
+     gsize len;               /*!< Length of \a data */
+     gsize written;           /*!< Bytes of \a data already sent */
+     GString *response;       /*!< Data received */
+     gchar buffer[ASYNC_BUFFER_SIZE];
+} AsyncRequest;
+
+/*!
+ * \fn static int luaL_async_run (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Run a function as a task, until it returns or waits.
+ * \code function async.run (func, ...) \endcode
+ */
+static int luaL_async_run (lua_State *L)
+{
+     luaL_checktype (L, 1, LUA_TFUNCTION);
+     lua_async_run (L, lua_gettop (L) - 1, 0, NULL);
+     return 0;
+}
+
+/*!
+ * @param async The #LuaAsync of the task.
+ * @return \c FALSE to stop the timeout.
+ *
+ * Resume a sleeping task.
+ */
+static gboolean async_sleep_cb (LuaAsync *async)
+{
+     lua_async_resume (async, 0);
+     return FALSE;
+}
+
+/*!
+ * \fn static int luaL_async_sleep (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Wait for a delay.
+ * \code function async.sleep (ms) \endcode
+ */
+static int luaL_async_sleep (lua_State *L)
+{
+     guint ms = MAX (luaL_checkint (L, 1), 0);
+
+     g_timeout_add (ms, (GSourceFunc) async_sleep_cb, lua_async_new (L));
+     return lua_yield (L, 0);
+}
+
+/*!
+ * @param spawn An #AsyncSpawn.
+ *
+ * Resume the task with the output and the exit status of the process,
+ * once both are known.
+ */
+static void async_spawn_done (AsyncSpawn *spawn)
+{
+     lua_State *L;
+
+     if (--spawn->pending > 0)
+          return;
+
+     if ((L = lua_async_state (spawn->async)) != NULL)
+     {
+          lua_pushlstring (L, spawn->output->str, spawn->output->len);
+          lua_pushinteger (L, WIFEXITED (spawn->status) ? WEXITSTATUS (spawn->status) : -1);
+          lua_async_resume (spawn->async, 2);
+     }
+     else
+          lua_async_free (spawn->async);
+
+     g_string_free (spawn->output, TRUE);
+     g_slice_free (AsyncSpawn, spawn);
+}
+
+/*!
+ * @param channel Standard output of the process.
+ * @param cond Unused.
+ * @param spawn An #AsyncSpawn.
+ * @return \c FALSE at the end of the output.
+ *
+ * Read the available output of the process.
+ */
+static gboolean async_spawn_output_cb (GIOChannel *channel, GIOCondition cond, AsyncSpawn *spawn)
+{
+     gchar buffer[ASYNC_BUFFER_SIZE];
+     GIOStatus s;
+     gsize len;
+
+     while ((s = g_io_channel_read_chars (channel, buffer, sizeof (buffer), &len, NULL)) == G_IO_STATUS_NORMAL)
+          g_string_append_len (spawn->output, buffer, len);
+
+     if (s == G_IO_STATUS_AGAIN)
+          return TRUE;
+
+     async_spawn_done (spawn);
+     return FALSE;
+}
+
+/*!
+ * @param pid The process.
+ * @param status Exit status of the process.
+ * @param spawn An #AsyncSpawn.
+ *
+ * Get the exit status of the process.
+ */
+static void async_spawn_exit_cb (GPid pid, gint status, AsyncSpawn *spawn)
+{
+     g_spawn_close_pid (pid);
+
+     spawn->status = status;
+     async_spawn_done (spawn);
+}
+
+/*!
+ * \fn static int luaL_async_spawn (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Spawn a process, and wait for its output and its exit status.
+ * \code function async.spawn (command) \endcode
+ */
+static int luaL_async_spawn (lua_State *L)
+{
+     const gchar *cmd = luaL_checkstring (L, 1);
+     LuaAsync *async = lua_async_new (L);
+     GError *error = NULL;
+     GIOChannel *channel;
+     AsyncSpawn *spawn;
+     gchar **argv = NULL;
+     gint out;
+     GPid pid;
+
+     if (!g_shell_parse_argv (cmd, NULL, &argv, &error)
+         || !g_spawn_async_with_pipes (NULL, argv, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+                                       NULL, NULL, &pid, NULL, &out, NULL, &error))
+     {
+          g_strfreev (argv);
+          lua_async_free (async);
+          lua_pushfstring (L, "spawn: %s", error->message);
+          g_error_free (error);
+          return lua_error (L);
+     }
+
+     g_strfreev (argv);
+
+     spawn = g_slice_new (AsyncSpawn);
+     spawn->async   = async;
+     spawn->output  = g_string_new (NULL);
+     spawn->status  = 0;
+     spawn->pending = 2;
+
+     channel = g_io_channel_unix_new (out);
+     g_io_channel_set_encoding (channel, NULL, NULL);
+     g_io_channel_set_flags (channel, G_IO_FLAG_NONBLOCK, NULL);
+     g_io_channel_set_close_on_unref (channel, TRUE);
+     g_io_add_watch (channel, G_IO_IN | G_IO_HUP | G_IO_ERR, (GIOFunc) async_spawn_output_cb, spawn);
+     g_io_channel_unref (channel);
+
+     g_child_watch_add (pid, (GChildWatchFunc) async_spawn_exit_cb, spawn);
+
+     return lua_yield (L, 0);
+}
+
+/*!
+ * @param file The file read.
+ * @param res Result of the operation.
+ * @param async The #LuaAsync of the task.
+ *
+ * Resume the task with the content of the file.
+ */
+static void async_read_cb (GFile *file, GAsyncResult *res, LuaAsync *async)
+{
+     GError *error = NULL;
+     gchar *contents;
+     gsize len;
+     lua_State *L;
+
+     if (!g_file_load_contents_finish (file, res, &contents, &len, NULL, &error))
+          contents = NULL;
+
+     g_object_unref (file);
+
+     if ((L = lua_async_state (async)) == NULL)
+          lua_async_free (async);
+     else if (contents == NULL)
+     {
+          lua_pushnil (L);
+          lua_pushstring (L, error->message);
+          lua_async_resume (async, 2);
+     }
+     else
+     {
+          lua_pushlstring (L, contents, len);
+          lua_async_resume (async, 1);
+     }
+
+     if (error != NULL)
+          g_error_free (error);
+
+     g_free (contents);
+}
+
+/*!
+ * \fn static int luaL_async_read (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Read a file.
+ * \code function async.read (path) \endcode
+ */
+static int luaL_async_read (lua_State *L)
+{
+     const gchar *path = luaL_checkstring (L, 1);
+     LuaAsync *async = lua_async_new (L);
+     GFile *file = g_file_new_for_path (path);
+
+     g_file_load_contents_async (file, async->cancellable, (GAsyncReadyCallback) async_read_cb, async);
+     return lua_yield (L, 0);
+}
+
+/*!
+ * @param req An #AsyncRequest.
+ * @param error The error which ended the request, or \c NULL.
+ *
+ * Resume the task with the response, or the error.
+ */
+static void async_request_done (AsyncRequest *req, GError *error)
+{
+     lua_State *L;
+
+     if ((L = lua_async_state (req->async)) == NULL)
+          lua_async_free (req->async);
+     else if (error != NULL)
+     {
+          lua_pushnil (L);
+          lua_pushstring (L, error->message);
+          lua_async_resume (req->async, 2);
+     }
+     else
+     {
+          lua_pushlstring (L, req->response->str, req->response->len);
+          lua_async_resume (req->async, 1);
+     }
+
+     if (error != NULL)
+          g_error_free (error);
+
+     if (req->conn != NULL)
+          g_object_unref (req->conn);
+
+     g_object_unref (req->client);
+     g_string_free (req->response, TRUE);
+     g_free (req->data);
+     g_slice_free (AsyncRequest, req);
+}
+
+/*!
+ * @param stream Input stream of the connection.
+ * @param res Result of the operation.
+ * @param req An #AsyncRequest.
+ *
+ * Read the response until the peer closes the connection.
+ */
+static void async_request_read_cb (GInputStream *stream, GAsyncResult *res, AsyncRequest *req)
+{
+     GError *error = NULL;
+     gssize len = g_input_stream_read_finish (stream, res, &error);
+
+     if (len <= 0)
+     {
+          async_request_done (req, error);
+          return;
+     }
+
+     g_string_append_len (req->response, req->buffer, len);
+
+     g_input_stream_read_async (stream, req->buffer, sizeof (req->buffer), G_PRIORITY_DEFAULT,
+                                req->async->cancellable, (GAsyncReadyCallback) async_request_read_cb, req);
+}
+
+/*!
+ * @param stream Output stream of the connection.
+ * @param res Result of the operation, or \c NULL to start writing.
+ * @param req An #AsyncRequest.
+ *
+ * Send the data, then shut the writing side down and read the response.
+ */
+static void async_request_write_cb (GOutputStream *stream, GAsyncResult *res, AsyncRequest *req)
+{
+     GError *error = NULL;
+
+     if (res != NULL)
+     {
+          gssize len = g_output_stream_write_finish (stream, res, &error);
+
+          if (len < 0)
+          {
+               async_request_done (req, error);
+               return;
+          }
+
+          req->written += len;
+     }
+
+     if (req->written < req->len)
+     {
+          g_output_stream_write_async (stream, req->data + req->written, req->len - req->written, G_PRIORITY_DEFAULT,
+                                       req->async->cancellable, (GAsyncReadyCallback) async_request_write_cb, req);
+          return;
+     }
+
+     /* the peer reads until the end of the request */
+     if (!g_socket_shutdown (g_socket_connection_get_socket (req->conn), FALSE, TRUE, &error))
+     {
+          async_request_done (req, error);
+          return;
+     }
+
+     g_input_stream_read_async (g_io_stream_get_input_stream (G_IO_STREAM (req->conn)), req->buffer, sizeof (req->buffer),
+                                G_PRIORITY_DEFAULT, req->async->cancellable, (GAsyncReadyCallback) async_request_read_cb, req);
+}
+
+/*!
+ * @param client The socket client.
+ * @param res Result of the operation.
+ * @param req An #AsyncRequest.
+ *
+ * Send the request once connected.
+ */
+static void async_request_connect_cb (GSocketClient *client, GAsyncResult *res, AsyncRequest *req)
+{
+     GError *error = NULL;
+
+     if ((req->conn = g_socket_client_connect_finish (client, res, &error)) == NULL)
+     {
+          async_request_done (req, error);
+          return;
+     }
+
+     async_request_write_cb (g_io_stream_get_output_stream (G_IO_STREAM (req->conn)), NULL, req);
+}
+
+/*!
+ * \fn static int luaL_async_request (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Send data on a socket, and read the response until the connection is
+ * closed. The address is the path of an UNIX socket, or
+ * <code>host:port</code>.
+ * \code function async.request (address, data) \endcode
+ */
+static int luaL_async_request (lua_State *L)
+{
+     const gchar *address = luaL_checkstring (L, 1);
+     AsyncRequest *req;
+     const gchar *data;
+     size_t len;
+
+     data = luaL_optlstring (L, 2, "", &len);
+
+     req = g_slice_new (AsyncRequest);
+     req->async    = lua_async_new (L);
+     req->client   = g_socket_client_new ();
+     req->conn     = NULL;
+     req->data     = g_memdup (data, len);
+     req->len      = len;
+     req->written  = 0;
+     req->response = g_string_new (NULL);
+
+     if (g_path_is_absolute (address))
+     {
+          GSocketAddress *addr = g_unix_socket_address_new (address);
+
+          g_socket_client_connect_async (req->client, G_SOCKET_CONNECTABLE (addr), req->async->cancellable,
+                                         (GAsyncReadyCallback) async_request_connect_cb, req);
+          g_object_unref (addr);
+     }
+     else
+          g_socket_client_connect_to_host_async (req->client, address, 0, req->async->cancellable,
+                                                 (GAsyncReadyCallback) async_request_connect_cb, req);
+
+     return lua_yield (L, 0);
+}
+
+static const luaL_reg cream_async_functions[] =
+{
+     { "run",     luaL_async_run },
+     { "sleep",   luaL_async_sleep },
+     { "spawn",   luaL_async_spawn },
+     { "read",    luaL_async_read },
+     { "request", luaL_async_request },
+     { NULL, NULL }
+};
+
+/*!
+ * \fn int luaL_async_register (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Register package in the lua VM state.
+ */
+int luaL_async_register (lua_State *L)
+{
+     luaL_register (L, "async", cream_async_functions);
+     return 1;
+}
+
+/*! @} */
@@ -47,15 +47,13 @@ static GtkClipboard **lua_check_clipboard (lua_State *L, int index)
      luaL_checktype (L, index, LUA_TUSERDATA);
      ret = (GtkClipboard **) luaL_checkudata (L, index, LUA_TCLIPBOARD);
      if (!ret) luaL_typerror (L, index, LUA_TCLIPBOARD);
+     if (!*ret) luaL_error (L, _("%s not referenced."), LUA_TCLIPBOARD);
      return ret;
 }
 
 static void lua_pushclipboard (lua_State *L, GtkClipboard *c)
 {
-     GtkClipboard **ret = (GtkClipboard **) lua_newuserdata (L, sizeof (GtkClipboard*));
-     *ret = c;
-     luaL_getmetatable (L, LUA_TCLIPBOARD);
-     lua_setmetatable (L, -2);
+     lua_pushobject (L, G_OBJECT (c), sizeof (GtkClipboard *), LUA_TCLIPBOARD);
 }
 
 /* methods */
@@ -109,22 +107,86 @@ static int luaL_clipboard_set (lua_State *L)
      return 0;
 }
 
+/*!
+ * \struct ClipboardRequest
+ * A task waiting for the text of a clipboard.
+ */
+typedef struct
+{
+     LuaAsync *async;
+     gchar *txt;              /*!< Text received */
+} ClipboardRequest;
+
+/*!
+ * @param req A #ClipboardRequest.
+ * @return \c FALSE to remove the source.
+ *
+ * Resume the task with the text of the clipboard.
+ */
+static gboolean lua_clipboard_resume_cb (ClipboardRequest *req)
+{
+     lua_State *L = lua_async_state (req->async);
+
+     if (L == NULL)
+          lua_async_free (req->async);
+     else if (req->txt != NULL)
+     {
+          lua_pushstring (L, req->txt);
+          lua_async_resume (req->async, 1);
+     }
+     else
+          lua_async_resume (req->async, 0);
+
+     g_free (req->txt);
+     g_slice_free (ClipboardRequest, req);
+     return FALSE;
+}
+
+/*!
+ * @param clip Unused.
+ * @param txt Text of the clipboard, or \c NULL.
+ * @param req A #ClipboardRequest.
+ *
+ * Receive the text of the clipboard. When the browser owns the
+ * clipboard, it is received before the task waits: the task is resumed
+ * from an idle source.
+ */
+static void lua_clipboard_text_cb (GtkClipboard *clip, const gchar *txt, ClipboardRequest *req)
+{
+     req->txt = g_strdup (txt);
+     g_idle_add ((GSourceFunc) lua_clipboard_resume_cb, req);
+}
+
 /*!
  * \fn static int luaL_clipboard_get (lua_State *L)
  * @param L The lua VM state.
  * @return Number of return value in lua.
  *
- * Get text from the clipboard.
+ * Get text from the clipboard. When the task can wait (see
+ * lua_async_yieldable()), it waits for the text without blocking the
+ * main loop.
  * \code function Clipboard:get () \endcode
  */
 static int luaL_clipboard_get (lua_State *L)
 {
      GtkClipboard **c = lua_check_clipboard (L, 1);
-     gchar *txt = gtk_clipboard_wait_for_text (*c);
+     gchar *txt;
+
+     if (lua_async_yieldable (L))
+     {
+          ClipboardRequest *req = g_slice_new (ClipboardRequest);
+
+          req->async = lua_async_new (L);
+          req->txt   = NULL;
+
+          gtk_clipboard_request_text (*c, (GtkClipboardTextReceivedFunc) lua_clipboard_text_cb, req);
+          return lua_yield (L, 0);
+     }
 
-     if (txt)
+     if ((txt = gtk_clipboard_wait_for_text (*c)) != NULL)
      {
           lua_pushstring (L, txt);
+          g_free (txt);
           return 1;
      }
 
@@ -0,0 +1,103 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "../local.h"
+
+/*!
+ * \defgroup lua-command Commands
+ * \ingroup lua
+ * Package 'command' of the lua API.
+ *
+ * @{
+ */
+
+/*!
+ * \fn static int luaL_command_add (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Register a command.
+ * \code command.register (name, func, description) \endcode
+ */
+static int luaL_command_add (lua_State *L)
+{
+     const gchar *name = luaL_checkstring (L, 1);
+     int lua_func      = luaL_checkfunction (L, 2);
+     const gchar *desc = luaL_optstring (L, 3, NULL);
+     GError *error     = NULL;
+
+     if (!command_register (name, desc, lua_func, &error))
+     {
+          luaL_unref (L, LUA_REGISTRYINDEX, lua_func);
+          lua_pushstring (L, error->message);
+          g_error_free (error);
+          return lua_error (L);
+     }
+
+     return 0;
+}
+
+/*!
+ * \fn static int luaL_command_run (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Run a command.
+ * \code command.run (line) \endcode
+ */
+static int luaL_command_run (lua_State *L)
+{
+     GError *error = NULL;
+
+     if (!run_command (luaL_checkstring (L, 1), &error))
+     {
+          lua_pushstring (L, error->message);
+          g_error_free (error);
+          return lua_error (L);
+     }
+
+     return 0;
+}
+
+static const luaL_reg cream_command_functions[] =
+{
+     { "register", luaL_command_add },
+     { "run",      luaL_command_run },
+     { NULL, NULL }
+};
+
+/*!
+ * \fn int luaL_command_register (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Register package in the lua VM state.
+ */
+int luaL_command_register (lua_State *L)
+{
+     luaL_register (L, "command", cream_command_functions);
+     return 1;
+}
+
+/*! @} */
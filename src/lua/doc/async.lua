@@ -0,0 +1,38 @@
+--- API for waiting without blocking the browser
+-- Callbacks (key bindings, commands) run as tasks: the functions of this
+-- package suspend the task until their operation completes, while the
+-- browser goes on. A task cannot wait inside <code>pcall</code>, and
+-- the functions raise an error outside of a task.
+-- @author David Delassus &lt;david.jose.delassus@gmail.com&gt;
+
+module ("cream.async")
+
+--- Run a function as a new task, until it returns or waits
+-- @param func Function to run
+-- @param ... Arguments of the function
+-- @class function
+-- @name run
+
+--- Wait for a delay
+-- @param ms Delay in milliseconds
+-- @class function
+-- @name sleep
+
+--- Run a program and wait for its end
+-- @param cmd The command to run
+-- @return The standard output of the program, and its exit status (-1 if it was killed).
+-- @class function
+-- @name spawn
+
+--- Read a file
+-- @param path Path of the file
+-- @return The content of the file, or <code>nil</code> and an error message.
+-- @class function
+-- @name read
+
+--- Send data on a socket, and read the response until the connection is closed
+-- @param address Path of an UNIX socket, or <code>host:port</code>
+-- @param data Data to send (optional)
+-- @return The response, or <code>nil</code> and an error message.
+-- @class function
+-- @name request
@@ -10,6 +10,8 @@ module ("cream.clipboard")
 -- @name cream.clipboard
 
 --- Get text from clipboard
+-- In a callback, the task waits for the text (see <code>cream.async</code>).
+-- Elsewhere, and inside <code>pcall</code>, the text is read synchronously.
 -- @param clip The clipboard object
 -- @return Text from the clipboard or <code>nil</code> if none.
 -- @class function
@@ -0,0 +1,20 @@
+--- Commands of the inputbox
+-- @author David Delassus &lt;david.jose.delassus@gmail.com&gt;
+
+module ("cream.commands")
+
+--- Register a command
+-- The command is run from the inputbox (<code>:name arg1 arg2</code>) or the
+-- control socket, and completed with <code>Tab</code>. Internal commands can not be
+-- replaced, registering a lua command again replaces it.
+-- @param name Name of the command
+-- @param func Function to call with the arguments of the command, as strings.
+-- A returned string is shown as the output of the command.
+-- @param desc Description shown by the completion (optional)
+-- @class function
+-- @name register
+
+--- Run a command
+-- @param line Command line, without the leading colon
+-- @class function
+-- @name run
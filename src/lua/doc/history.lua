@@ -0,0 +1,48 @@
+--- API for browsing history
+-- @author David Delassus &lt;david.jose.delassus@gmail.com&gt;
+
+module ("cream.history")
+
+--- History item
+-- @field uri Visited URI
+-- @field title Page's title
+-- @field time Time of the last visit (seconds since Epoch, as <code>os.time ()</code>)
+-- @field visits Number of visits
+-- @class table
+-- @name item
+
+--- Record a visit
+-- @param uri Visited URI
+-- @param title Page's title (optional)
+-- @class function
+-- @name add
+
+--- Get the latest visit of an URI
+-- @param uri URI to look for
+-- @return An <code>item</code>, or <code>nil</code> if the URI was never visited.
+-- @class function
+-- @name lookup
+
+--- Get the last visited pages, most recent first
+-- @param n Maximum number of items (default: 10)
+-- @param since Oldest visit to return, in seconds since Epoch (optional)
+-- @return A list of <code>item</code>
+-- @class function
+-- @name recent
+
+--- Get the visited pages whose URI starts with a prefix, sorted by URI
+-- @param prefix Prefix of the URIs
+-- @param n Maximum number of items (default: 10)
+-- @return A list of <code>item</code>
+-- @class function
+-- @name prefix
+
+--- Search the visited pages by words of their title or URI
+-- All the words must be found (case insensitive). Pages with the words in
+-- their title come first, then the most visited, then the most recent.
+-- @param query Words to find, separated by spaces
+-- @param n Maximum number of results (default: 10)
+-- @return A list of tables with the fields <code>uri</code>, <code>title</code>,
+-- <code>score</code> (words found in the title, counted twice, and in the URI) and <code>visits</code>
+-- @class function
+-- @name search
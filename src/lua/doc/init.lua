@@ -16,6 +16,7 @@ module ("cream")
 -- @field embed <code>EMBED</code> mode (focus on a plugin like flashplayer)
 -- @field caret <code>CARET</code> mode (caret browsing)
 -- @field normal Normal mode
+-- @field hint <code>HINT</code> mode (following a link with the keyboard)
 -- @field all Mask for all states
 -- @class table
 -- @name state
@@ -11,3 +11,11 @@ module ("cream.inputbox")
 
 --- Give focus to the inputbox
 function focus () end
+
+--- Set the limits of the commands history
+-- Duplicated commands are collapsed to their most recent occurrence,
+-- and the oldest commands are dropped when a limit is reached.
+-- @param count Maximum number of commands (default: 500)
+-- @param bytes Maximum size of the commands, in bytes (default: 65536)
+-- @class function
+-- @name history_limit
@@ -4,13 +4,36 @@
 module ("cream.keys")
 
 --- Add a keybinding
+-- The command is a sequence of key names (<code>"Escape"</code>, <code>"colon"</code>)
+-- or characters (<code>"gg"</code>, <code>"/"</code>), the longest key name is preferred.
+-- Use angle brackets to force a key name (<code>"g&lt;at&gt;"</code>).
+-- The modifiers apply to the last key of the sequence, and uppercase letters are
+-- typed with Shift (<code>"gT"</code> with <code>{ "Shift" }</code> is <code>g</code>, then Shift-<code>T</code>).
 -- @param statelist List of state where the keybind is affected
 -- @param modlist List of modifiers key (ie. <code>{ "Shift", "Control" }</code>)
 -- @param command Command
--- @param callback Function to call when the keybind is activated
+-- @param callback Function to call when the keybind is activated, with the focused
+-- webview, the count typed before the command (<code>nil</code> if none) and the
+-- number of presses
+-- @param options Table of options (optional). With <code>coalesce = true</code>, the
+-- auto-repeated presses of a single key are merged: the callback runs at most once
+-- per frame, with the number of presses it handles (for scrolling bindings).
 -- @class function
 -- @name map
 
+--- Macros
+-- Type <code>q</code> and a register (<code>a-z</code>, <code>0-9</code>) to record the
+-- next keys, and <code>q</code> again to stop. Type <code>@</code> and the register to
+-- replay them (<code>@@</code> replays the last macro), with a count to replay them
+-- several times. Keybindings on <code>q</code> or <code>@</code> disable this.
+-- @class table
+-- @name macros
+
+--- Set the delay before running a keybinding whose command is also the beginning of longer ones
+-- @param ms Delay in milliseconds (default: 1000), 0 to wait for the next key
+-- @class function
+-- @name timeout
+
 --- All modifier keys mask
 -- @field Shift Shift
 -- @field Lock CapsLock
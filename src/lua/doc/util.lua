@@ -26,6 +26,53 @@ module ("cream.util")
 -- @class function
 -- @name quit
 
+--- Sync cache files on disk after each write (slower, but safer on crash)
+-- @param enable <code>true</code> to enable, <code>false</code> to disable
+-- @class function
+-- @name cache_sync
+
+--- Set the disk budget of a cache category
+-- When a category goes over its budget, its oldest files are removed in
+-- the background (files in use are kept).
+-- @param category <code>"commands"</code>, <code>"history"</code>, <code>"session"</code>, <code>"cookies"</code> or <code>"other"</code>
+-- @param bytes New budget, in bytes
+-- @class function
+-- @name cache_quota
+
+--- Get the disk usage of the cache
+-- @return A table indexed by category, whose values have the fields <code>used</code> and <code>budget</code> (in bytes)
+-- @class function
+-- @name cache_stats
+
+--- Get the most frequently and recently used URIs or commands
+-- Answered from a precomputed index, suitable for quick-open menus.
+-- @param kind <code>"uri"</code> (default) or <code>"command"</code>
+-- @param prefix Prefix of the URIs (scheme and <code>www.</code> ignored) or commands (default: "")
+-- @param count Maximum number of results (default: 10, at most 16)
+-- @return A table of items, best first, with the fields <code>key</code> and <code>score</code> (decayed number of uses)
+-- @class function
+-- @name frecency
+
+--- Set the budget of the callbacks (keybindings, commands)
+-- A callback exceeding its budget is aborted with an error, which names
+-- the binding or command and the line running. Nested callbacks share the
+-- budget of the outermost one.
+-- @param instructions Maximum number of instructions, 0 for none (default: 100000000)
+-- @param ms Maximum running time in milliseconds, 0 for none (default: 1000)
+-- @class function
+-- @name watchdog
+
+--- Filter a list of strings with a fuzzy pattern
+-- A string matches when it contains all the characters of the pattern in
+-- order, ignoring the case of ASCII letters. Matches at the start of
+-- words (camelCase included), and runs of consecutive characters, score
+-- higher.
+-- @param pattern Characters to look for
+-- @param list A list of strings
+-- @return The matching strings, best first
+-- @class function
+-- @name fuzzy
+
 --- Join all tables given as parameters
 -- This will iterate all tables and insert all their keys into a new table
 -- @param args A list of tables to join
@@ -0,0 +1,106 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "../local.h"
+
+/*!
+ * \defgroup lua-ffi FFI
+ * \ingroup lua
+ * Functions called by the <code>cream.ffi</code> package, through the
+ * FFI of LuaJIT (see lua/lib/cream/ffi.lua for their declarations).
+ *
+ * Unlike the lua C functions, they can be called from JIT-compiled
+ * code: keep them small, and keep their declarations in sync.
+ *
+ * @{
+ */
+
+/*!
+ * @param w A #WebView object.
+ * @return The current URI of \a w.
+ */
+const gchar *cream_ffi_webview_uri (WebView *w)
+{
+     return webview_get_uri (w);
+}
+
+/*!
+ * @param w A #WebView object.
+ * @return The title of the page loaded in \a w.
+ */
+const gchar *cream_ffi_webview_title (WebView *w)
+{
+     return webview_get_title (w);
+}
+
+/*!
+ * @return The browser's mode (see #CreamMode).
+ */
+gint cream_ffi_state (void)
+{
+     return app->mode;
+}
+
+/*!
+ * @param state The new browser's mode (see #CreamMode).
+ */
+void cream_ffi_statusbar_set_state (gint state)
+{
+     statusbar_set_state (CREAM_STATUSBAR (app->gui.statusbar), state);
+}
+
+/*!
+ * @param link URL to print in statusbar.
+ */
+void cream_ffi_statusbar_set_link (const gchar *link)
+{
+     statusbar_set_link (CREAM_STATUSBAR (app->gui.statusbar), link);
+}
+
+/*!
+ * @param can_go_back If not 0, we can go back in history.
+ * @param can_go_forward If not 0, we can go forward in history.
+ */
+void cream_ffi_statusbar_set_history (gint can_go_back, gint can_go_forward)
+{
+     statusbar_set_history (CREAM_STATUSBAR (app->gui.statusbar), can_go_back, can_go_forward);
+}
+
+/*!
+ * @param scroll Scrolling percent (0 to 100).
+ */
+void cream_ffi_statusbar_set_scroll (gdouble scroll)
+{
+     statusbar_set_scroll (CREAM_STATUSBAR (app->gui.statusbar), scroll / 100.0);
+}
+
+/*!
+ * @param progress Loading percent (0 to 100).
+ */
+void cream_ffi_statusbar_set_progress (gdouble progress)
+{
+     statusbar_set_progress (CREAM_STATUSBAR (app->gui.statusbar), progress / 100.0);
+}
+
+/*! @} */
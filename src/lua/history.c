@@ -0,0 +1,246 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "../local.h"
+
+/*!
+ * \defgroup lua-history History
+ * \ingroup lua
+ * Package 'history' of the lua API.
+ *
+ * @{
+ */
+
+#define HISTORY_MAX_ITEMS     1024
+
+/*!
+ * @param L The lua VM state.
+ * @param item A #HistoryItem.
+ *
+ * Push a table describing \a item on the stack.
+ */
+static void lua_pushhistoryitem (lua_State *L, HistoryItem *item)
+{
+     lua_createtable (L, 0, 4);
+
+     lua_pushstring (L, item->uri);
+     lua_setfield (L, -2, "uri");
+
+     lua_pushstring (L, item->title);
+     lua_setfield (L, -2, "title");
+
+     /* seconds since Epoch, as os.time () */
+     lua_pushnumber (L, (lua_Number) item->time / G_USEC_PER_SEC);
+     lua_setfield (L, -2, "time");
+
+     lua_pushinteger (L, item->visits);
+     lua_setfield (L, -2, "visits");
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param items Array of #HistoryItem.
+ * @param n Number of items.
+ *
+ * Push an array of item tables on the stack.
+ */
+static void lua_pushhistoryitems (lua_State *L, HistoryItem *items, guint n)
+{
+     guint i;
+
+     lua_createtable (L, n, 0);
+
+     for (i = 0; i < n; ++i)
+     {
+          lua_pushhistoryitem (L, &items[i]);
+          lua_rawseti (L, -2, i + 1);
+     }
+}
+
+/*!
+ * @param L The lua VM state.
+ * @return The history of the current profile.
+ */
+static History *lua_check_history (lua_State *L)
+{
+     if (app->history == NULL)
+          luaL_error (L, "history is not available");
+
+     return app->history;
+}
+
+/*!
+ * \fn static int luaL_history_add (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Record a visit.
+ * \code history.add (uri, title) \endcode
+ */
+static int luaL_history_add (lua_State *L)
+{
+     const gchar *uri   = luaL_checkstring (L, 1);
+     const gchar *title = luaL_optstring (L, 2, NULL);
+     GError *error = NULL;
+
+     if (!history_add (lua_check_history (L), uri, title, &error))
+     {
+          lua_pushstring (L, error->message);
+          g_error_free (error);
+          return lua_error (L);
+     }
+
+     return 0;
+}
+
+/*!
+ * \fn static int luaL_history_lookup (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Get the latest visit of an URI.
+ * \code history.lookup (uri) \endcode
+ */
+static int luaL_history_lookup (lua_State *L)
+{
+     const gchar *uri = luaL_checkstring (L, 1);
+     HistoryItem item;
+
+     if (!history_lookup (lua_check_history (L), uri, &item))
+          return 0;
+
+     lua_pushhistoryitem (L, &item);
+     return 1;
+}
+
+/*!
+ * \fn static int luaL_history_recent (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Get the last visited pages.
+ * \code history.recent (n, since) \endcode
+ */
+static int luaL_history_recent (lua_State *L)
+{
+     guint n = CLAMP (luaL_optint (L, 1, 10), 0, HISTORY_MAX_ITEMS);
+     HistoryItem items[HISTORY_MAX_ITEMS];
+
+     if (lua_isnoneornil (L, 2))
+          n = history_recent (lua_check_history (L), n, items);
+     else
+          n = history_since (lua_check_history (L), luaL_checknumber (L, 2) * G_USEC_PER_SEC, n, items);
+
+     lua_pushhistoryitems (L, items, n);
+     return 1;
+}
+
+/*!
+ * \fn static int luaL_history_prefix (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Get the visited pages whose URI starts with a prefix.
+ * \code history.prefix (prefix, n) \endcode
+ */
+static int luaL_history_prefix (lua_State *L)
+{
+     const gchar *prefix = luaL_checkstring (L, 1);
+     guint n = CLAMP (luaL_optint (L, 2, 10), 0, HISTORY_MAX_ITEMS);
+     HistoryItem items[HISTORY_MAX_ITEMS];
+
+     n = history_prefix (lua_check_history (L), prefix, n, items);
+
+     lua_pushhistoryitems (L, items, n);
+     return 1;
+}
+
+/*!
+ * \fn static int luaL_history_search (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Get the visited pages containing all the words of a query, best first.
+ * \code history.search (query, n) \endcode
+ */
+static int luaL_history_search (lua_State *L)
+{
+     const gchar *query = luaL_checkstring (L, 1);
+     guint i, n = CLAMP (luaL_optint (L, 2, 10), 0, HISTORY_MAX_ITEMS);
+     SearchResult results[HISTORY_MAX_ITEMS];
+
+     if (app->search == NULL)
+          luaL_error (L, "search is not available");
+
+     n = search_query (app->search, query, n, results);
+
+     lua_createtable (L, n, 0);
+
+     for (i = 0; i < n; ++i)
+     {
+          lua_createtable (L, 0, 4);
+
+          lua_pushstring (L, results[i].uri);
+          lua_setfield (L, -2, "uri");
+
+          lua_pushstring (L, results[i].title);
+          lua_setfield (L, -2, "title");
+
+          lua_pushinteger (L, results[i].score);
+          lua_setfield (L, -2, "score");
+
+          lua_pushinteger (L, results[i].visits);
+          lua_setfield (L, -2, "visits");
+
+          lua_rawseti (L, -2, i + 1);
+     }
+
+     search_results_clear (results, n);
+     return 1;
+}
+
+static const luaL_reg cream_history_functions[] =
+{
+     { "add",    luaL_history_add },
+     { "lookup", luaL_history_lookup },
+     { "recent", luaL_history_recent },
+     { "prefix", luaL_history_prefix },
+     { "search", luaL_history_search },
+     { NULL, NULL }
+};
+
+/*!
+ * \fn int luaL_history_register (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Register package in the lua VM state.
+ */
+int luaL_history_register (lua_State *L)
+{
+     luaL_register (L, "history", cream_history_functions);
+     return 1;
+}
+
+/*! @} */
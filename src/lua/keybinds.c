@@ -39,7 +39,7 @@
  * @return Number of return value in lua.
  *
  * Add a keybind.
- * \code keys.add (accelerator, mode, func) \endcode
+ * \code keys.add (accelerator, mode, func, coalesce) \endcode
  */
 static int luaL_keybinds_add (lua_State *L)
 {
@@ -47,14 +47,39 @@ static int luaL_keybinds_add (lua_State *L)
      int modmask     = luaL_checkint (L, 2);
      const char *cmd = luaL_checkstring (L, 3);
      int lua_func    = luaL_checkfunction (L, 4);
+     gboolean coalesce = lua_toboolean (L, 5);
+     GError *error   = NULL;
 
-     keybinds_add (statemask, modmask, cmd, lua_func);
+     if (!keybinds_add (statemask, modmask, cmd, lua_func, coalesce, &error))
+     {
+          luaL_unref (L, LUA_REGISTRYINDEX, lua_func);
+          lua_pushstring (L, error->message);
+          g_error_free (error);
+          return lua_error (L);
+     }
+
+     return 0;
+}
+
+/*!
+ * \fn static int luaL_keybinds_timeout (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Set the delay before running a binding which is also the prefix of
+ * longer ones.
+ * \code keys.timeout (ms) \endcode
+ */
+static int luaL_keybinds_timeout (lua_State *L)
+{
+     keybinds_set_timeout (MAX (luaL_checkint (L, 1), 0));
      return 0;
 }
 
 static const luaL_reg cream_keybinds_functions[] =
 {
-     { "add", luaL_keybinds_add },
+     { "add",     luaL_keybinds_add },
+     { "timeout", luaL_keybinds_timeout },
      { NULL, NULL }
 };
 
@@ -0,0 +1,15 @@
+-- Asynchronous operations
+-- @author David Delassus &lt;david.jose.delassus@gmail.com&gt;
+
+local capi =
+{
+     async = async
+}
+
+module ("cream.async")
+
+run     = capi.async.run
+sleep   = capi.async.sleep
+spawn   = capi.async.spawn
+read    = capi.async.read
+request = capi.async.request
@@ -1,22 +1,22 @@
 --- Register commands
 -- @author David Delassus &lt;david.jose.delassus@gmail.com&gt;
 
+local assert = assert
+local loadstring = loadstring
+local tostring = tostring
 local capi =
 {
-     commands = { register = command_register, modify = command_modify, set_func = command_set_func }
+     command = command
 }
 
 module ("cream.commands")
 
-function register (command, nargs, return, func)
-     capi.commands.register (command, nargs, return)
-     if func ~= nil then
-          capi.commands.set_func (command, func)
-     end
+function register (name, func, desc)
+     capi.command.register (name, func, desc)
 end
 
-function modify (command, binding, func)
-     capi.commands.modify (command, binding, func)
+function run (line)
+     capi.command.run (line)
 end
 
 -- default callbacks
@@ -27,10 +27,9 @@ end
 
 local function get (var)
      local f = assert (loadstring ("return " .. var))
-     return f()
+     return tostring (f())
 end
 
 -- Register default commands
-register ("set", 2, false, set)
-register ("get", 1, true, get)
-
+register ("set", set, "Set a lua variable")
+register ("get", get, "Show a lua variable")
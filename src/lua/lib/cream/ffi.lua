@@ -0,0 +1,80 @@
+-- FFI fast paths (LuaJIT only)
+-- @author David Delassus &lt;david.jose.delassus@gmail.com&gt;
+
+local error = error
+local getmetatable = getmetatable
+local require = require
+local capi =
+{
+     webview = WebView
+}
+
+module ("cream.ffi")
+
+local ffi = require ("ffi")
+
+-- see src/lua/ffi.c
+ffi.cdef [[
+     const char *cream_ffi_webview_uri (void *w);
+     const char *cream_ffi_webview_title (void *w);
+     int cream_ffi_state (void);
+     void cream_ffi_statusbar_set_state (int state);
+     void cream_ffi_statusbar_set_link (const char *link);
+     void cream_ffi_statusbar_set_history (int can_go_back, int can_go_forward);
+     void cream_ffi_statusbar_set_scroll (double scroll);
+     void cream_ffi_statusbar_set_progress (double progress);
+]]
+
+local C = ffi.C
+local cast = ffi.cast
+local tostr = ffi.string
+
+-- The userdata of a WebView starts with the pointer to the object,
+-- NULL once it is destroyed (see lua_pushobject ())
+local function webview (w)
+     if getmetatable (w) ~= capi.webview then
+          error ("WebView expected")
+     end
+
+     local p = cast ("void **", w)[0]
+     if p == nil then
+          error ("WebView not referenced.")
+     end
+
+     return p
+end
+
+local function string (s)
+     if s ~= nil then
+          return tostr (s)
+     end
+end
+
+-- Replace the hot bindings of the cream package with FFI calls
+function install (cream)
+     capi.webview.uri = function (w)
+          return string (C.cream_ffi_webview_uri (webview (w)))
+     end
+
+     capi.webview.title = function (w)
+          return string (C.cream_ffi_webview_title (webview (w)))
+     end
+
+     cream.state.current = function (state)
+          if state then
+               C.cream_ffi_statusbar_set_state (state)
+          else
+               return C.cream_ffi_state ()
+          end
+     end
+
+     cream.statusbar.set_state = C.cream_ffi_statusbar_set_state
+     cream.statusbar.set_link = function (link)
+          C.cream_ffi_statusbar_set_link (link)
+     end
+     cream.statusbar.set_history = function (can_go_back, can_go_forward)
+          C.cream_ffi_statusbar_set_history (can_go_back and 1 or 0, can_go_forward and 1 or 0)
+     end
+     cream.statusbar.set_scroll = C.cream_ffi_statusbar_set_scroll
+     cream.statusbar.set_progress = C.cream_ffi_statusbar_set_progress
+end
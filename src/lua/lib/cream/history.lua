@@ -0,0 +1,15 @@
+-- History
+-- @author David Delassus &lt;david.jose.delassus@gmail.com&gt;
+
+local capi =
+{
+     history = history
+}
+
+module ("cream.history")
+
+add    = capi.history.add
+lookup = capi.history.lookup
+recent = capi.history.recent
+prefix = capi.history.prefix
+search = capi.history.search
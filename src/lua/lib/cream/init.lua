@@ -6,12 +6,17 @@ require ("cream.clipboard")
 require ("cream.util")
 require ("cream.keys")
 require ("cream.tab")
+require ("cream.history")
+require ("cream.command")
+require ("cream.async")
 
+local require = require
 local capi =
 {
      widgets = widgets,
      util = util,
-     bit = bit
+     bit = bit,
+     jit = jit
 }
 
 module ("cream")
@@ -22,8 +27,19 @@ bit = capi.bit
 -- inputbox functions
 inputbox =
 {
-     text  = capi.widgets.inputbox_text,
-     focus = capi.widgets.inputbox_focus
+     text          = capi.widgets.inputbox_text,
+     focus         = capi.widgets.inputbox_focus,
+     history_limit = capi.widgets.inputbox_history_limit
+}
+
+-- statusbar functions
+statusbar =
+{
+     set_state    = capi.widgets.statusbar_set_state,
+     set_link     = capi.widgets.statusbar_set_link,
+     set_history  = capi.widgets.statusbar_set_history,
+     set_scroll   = capi.widgets.statusbar_set_scroll,
+     set_progress = capi.widgets.statusbar_set_progress
 }
 
 -- browser's mode
@@ -35,10 +51,16 @@ state =
      embed   = 0x08,
      caret   = 0x10,
      normal  = 0x20,
-     all     = 0x3F
+     hint    = 0x40,
+     all     = 0x7F
 }
 
 function state.current (...)
-     capi.util.state (...)
+     return capi.util.state (...)
+end
+
+-- call the hot bindings through the FFI with LuaJIT
+if capi.jit then
+     require ("cream.ffi").install (_M)
 end
 
@@ -33,7 +33,7 @@ local modkeys =
 
 module ("cream.keys")
 
-function map (states, modifiers, cmd, callback)
+function map (states, modifiers, cmd, callback, options)
      statemask = #states == 1 and states[1] or capi.bit.bor (unpack (states))
      modmask = 0
 
@@ -49,6 +49,10 @@ function map (states, modifiers, cmd, callback)
           modmask = modkeys[modifiers[1]]
      end
 
-     capi.keys.add (statemask, modmask, cmd, callback)
+     capi.keys.add (statemask, modmask, cmd, callback, options and options.coalesce)
+end
+
+function timeout (ms)
+     capi.keys.timeout (ms)
 end
 
@@ -39,6 +39,30 @@ function quit (...)
      capi.util.quit (...)
 end
 
+function cache_sync (enable)
+     capi.util.cache_sync (enable)
+end
+
+function cache_quota (category, bytes)
+     capi.util.cache_quota (category, bytes)
+end
+
+function cache_stats ()
+     return capi.util.cache_stats ()
+end
+
+function frecency (kind, prefix, count)
+     return capi.util.frecency (kind or "uri", prefix or "", count)
+end
+
+function watchdog (instructions, ms)
+     capi.util.watchdog (instructions or 0, ms or 0)
+end
+
+function fuzzy (pattern, list)
+     return capi.util.fuzzy (pattern or "", list or { })
+end
+
 function table.join (...)
      local ret = { }
 
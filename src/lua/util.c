@@ -109,11 +109,216 @@ static int luaL_util_quit (lua_State *L)
      return 0;
 }
 
+/*!
+ * \fn static int luaL_util_cache_sync (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Sync cache files on disk after each write.
+ * \code function cache_sync (enable) \endcode
+ */
+static int luaL_util_cache_sync (lua_State *L)
+{
+     luaL_checktype (L, 1, LUA_TBOOLEAN);
+     cache_set_sync (lua_toboolean (L, 1));
+     return 0;
+}
+
+/*!
+ * \fn static int luaL_util_frecency (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Get the best URIs or commands starting with a prefix, ranked by frecency.
+ * Each item is a table with the fields <code>key</code> and <code>score</code>.
+ * \code function frecency (kind = "uri" | "command", prefix = "", count = 10) \endcode
+ */
+static int luaL_util_frecency (lua_State *L)
+{
+     static const gchar *kinds[] = { "uri", "command", NULL };
+     const FrecencyItem *items[FRECENCY_TOP_K];
+     Frecency *f;
+     gint64 now = g_get_real_time ();
+     guint i, n;
+
+     f = (luaL_checkoption (L, 1, "uri", kinds) == 0 ? app->frecency.uris : app->frecency.commands);
+     n = frecency_query (f, luaL_optstring (L, 2, ""), CLAMP (luaL_optint (L, 3, 10), 0, FRECENCY_TOP_K), items);
+
+     lua_createtable (L, n, 0);
+
+     for (i = 0; i < n; ++i)
+     {
+          lua_createtable (L, 0, 2);
+
+          lua_pushstring (L, items[i]->key);
+          lua_setfield (L, -2, "key");
+
+          lua_pushnumber (L, frecency_score (items[i], now));
+          lua_setfield (L, -2, "score");
+
+          lua_rawseti (L, -2, i + 1);
+     }
+
+     return 1;
+}
+
+/*!
+ * \fn static int luaL_util_cache_quota (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Set the budget of a cache category, in bytes.
+ * \code function cache_quota (category = "commands" | "history" | "session" | "cookies" | "other", bytes) \endcode
+ */
+static int luaL_util_cache_quota (lua_State *L)
+{
+     CacheType type;
+     lua_Number bytes;
+
+     if (!quota_category_from_name (luaL_checkstring (L, 1), &type))
+          return luaL_argerror (L, 1, "unknown cache category");
+
+     bytes = luaL_checknumber (L, 2);
+     luaL_argcheck (L, bytes >= 1, 2, "budget must be positive");
+
+     quota_set_budget (type, (gint64) bytes);
+     return 0;
+}
+
+/*!
+ * \fn static int luaL_util_cache_stats (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Get the usage of the cache, a table indexed by category whose values
+ * have the fields <code>used</code> and <code>budget</code> (in bytes).
+ * \code function cache_stats () \endcode
+ */
+static int luaL_util_cache_stats (lua_State *L)
+{
+     CacheType type;
+
+     lua_createtable (L, 0, CACHE_TYPE_NONE + 1);
+
+     for (type = 0; type <= CACHE_TYPE_NONE; ++type)
+     {
+          gint64 used, budget;
+
+          quota_get_usage (type, &used, &budget);
+
+          lua_createtable (L, 0, 2);
+
+          lua_pushnumber (L, used);
+          lua_setfield (L, -2, "used");
+
+          lua_pushnumber (L, budget);
+          lua_setfield (L, -2, "budget");
+
+          lua_setfield (L, -2, quota_category_name (type));
+     }
+
+     return 1;
+}
+
+static gint luaL_util_fuzzy_compare (gconstpointer a, gconstpointer b)
+{
+     const gint *ma = a, *mb = b;
+
+     /* best score first, then the order of the list */
+     if (ma[0] != mb[0])
+          return (ma[0] > mb[0] ? -1 : 1);
+
+     return ma[1] - mb[1];
+}
+
+/*!
+ * \fn static int luaL_util_fuzzy (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Get the strings of a list containing the characters of a pattern in
+ * order (ignoring the case of ASCII letters), best match first (see
+ * \ref fuzzy).
+ * \code function fuzzy (pattern, list) \endcode
+ */
+static int luaL_util_fuzzy (lua_State *L)
+{
+     gchar *pattern = g_ascii_strdown (luaL_checkstring (L, 1), -1);
+     guint64 mask = fuzzy_mask (pattern);
+     GArray *matches;
+     guint i, n;
+
+     luaL_checktype (L, 2, LUA_TTABLE);
+     n = lua_objlen (L, 2);
+
+     /* pairs of (score, index) */
+     matches = g_array_new (FALSE, FALSE, sizeof (gint) * 2);
+
+     for (i = 1; i <= n; ++i)
+     {
+          const gchar *str;
+          gint m[2];
+
+          lua_rawgeti (L, 2, i);
+          str = lua_tostring (L, -1);
+          lua_pop (L, 1);
+
+          if (str == NULL)
+               continue;
+
+          if ((fuzzy_mask (str) & mask) == mask && fuzzy_match (pattern, str, &m[0]))
+          {
+               m[1] = i;
+               g_array_append_val (matches, m);
+          }
+     }
+
+     g_array_sort (matches, luaL_util_fuzzy_compare);
+
+     lua_createtable (L, matches->len, 0);
+
+     for (i = 0; i < matches->len; ++i)
+     {
+          lua_rawgeti (L, 2, ((gint *) matches->data)[i * 2 + 1]);
+          lua_rawseti (L, -2, i + 1);
+     }
+
+     g_array_free (matches, TRUE);
+     g_free (pattern);
+     return 1;
+}
+
+/*!
+ * \fn static int luaL_util_watchdog (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Set the budget of the callbacks (keybindings, commands), 0 for none.
+ * \code function watchdog (instructions, ms) \endcode
+ */
+static int luaL_util_watchdog (lua_State *L)
+{
+     lua_Number instructions = luaL_checknumber (L, 1);
+     lua_Number ms = luaL_checknumber (L, 2);
+
+     luaL_argcheck (L, instructions >= 0, 1, "budget must be positive");
+     luaL_argcheck (L, ms >= 0, 2, "budget must be positive");
+
+     lua_watchdog_set_budget ((guint64) instructions, (guint) ms);
+     return 0;
+}
+
 static const luaL_reg cream_util_functions[] =
 {
-     { "state", luaL_util_state },
-     { "spawn", luaL_util_spawn },
-     { "quit",  luaL_util_quit },
+     { "state",      luaL_util_state },
+     { "spawn",      luaL_util_spawn },
+     { "quit",       luaL_util_quit },
+     { "cache_sync", luaL_util_cache_sync },
+     { "frecency",   luaL_util_frecency },
+     { "cache_quota", luaL_util_cache_quota },
+     { "cache_stats", luaL_util_cache_stats },
+     { "fuzzy",      luaL_util_fuzzy },
+     { "watchdog",   luaL_util_watchdog },
      { NULL, NULL }
 };
 
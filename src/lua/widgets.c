@@ -81,6 +81,23 @@ static int luaL_inputbox_focus (lua_State *L)
      return 0;
 }
 
+/*!
+ * \fn static int luaL_inputbox_history_limit (lua_State *L)
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * Set the limits of the commands history.
+ * \code function inputbox.history_limit (count, bytes) \endcode
+ */
+static int luaL_inputbox_history_limit (lua_State *L)
+{
+     guint count = luaL_checkint (L, 1);
+     gsize bytes = luaL_optint (L, 2, INPUTBOX_HISTORY_BYTES);
+
+     inputbox_set_history_limit (CREAM_INPUTBOX (app->gui.inputbox), count, bytes);
+     return 0;
+}
+
 /*! @} */
 
 /*!
@@ -203,6 +220,7 @@ static const luaL_reg cream_widgets_functions[] =
 {
      { "inputbox_text",          luaL_inputbox_text },
      { "inputbox_focus",         luaL_inputbox_focus },
+     { "inputbox_history_limit", luaL_inputbox_history_limit },
      { "notebook_get_focused",   luaL_notebook_get_focused },
      { "statusbar_set_state",    luaL_statusbar_set_state },
      { "statusbar_set_link",     luaL_statusbar_set_link },
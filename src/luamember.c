@@ -0,0 +1,367 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+
+/*!
+ * \addtogroup lua
+ * @{
+ */
+
+#define LUAI_SEEDS       64        /*!< Seeds tried for a table size before doubling it */
+
+/*!
+ * \struct luaI_slot
+ * Getter and setter of a member name.
+ */
+typedef struct
+{
+     const gchar *key;             /*!< Interned member name, or \c NULL */
+     const luaI_reg *getter;
+     const luaI_reg *setter;
+} luaI_slot;
+
+/*!
+ * \struct luaI_table
+ * Perfect hash table of the members of a bound type, by the address of
+ * their interned name. The names are kept alive by the environment of
+ * the userdata holding the table.
+ */
+typedef struct
+{
+     guint64 seed;                 /*!< Multiplier of the hash (odd) */
+     guint shift;                  /*!< 64 minus the log2 of the number of slots */
+     luaI_slot slots[1];
+} luaI_table;
+
+/* the high bits of the product depend on all the bits of the address */
+static inline guint luaI_hash (const gchar *key, guint64 seed, guint shift)
+{
+     return (guint) (((guint64) (gsize) key * seed) >> shift);
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param t The #luaI_table of the type.
+ * @return The slot of the member indexed (stack index 2), or \c NULL.
+ *
+ * Lua strings are interned: the name used in a script is the string
+ * registered, so its address is enough to find the member.
+ */
+static inline const luaI_slot *luaI_lookup (lua_State *L, const luaI_table *t)
+{
+     const gchar *key;
+     const luaI_slot *s;
+
+     if (lua_type (L, 2) != LUA_TSTRING)
+          return NULL;
+
+     key = lua_tostring (L, 2);
+     s   = &t->slots[luaI_hash (key, t->seed, t->shift)];
+
+     return (s->key == key ? s : NULL);
+}
+
+/*!
+ * @param members Array of #luaI_slot.
+ * @param key Interned name.
+ * @return The slot of the name, added if needed.
+ */
+static luaI_slot *luaI_member (GArray *members, const gchar *key)
+{
+     luaI_slot s = { key, NULL, NULL };
+     guint i;
+
+     for (i = 0; i < members->len; ++i)
+     {
+          if (g_array_index (members, luaI_slot, i).key == key)
+               return &g_array_index (members, luaI_slot, i);
+     }
+
+     g_array_append_val (members, s);
+     return &g_array_index (members, luaI_slot, members->len - 1);
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param l Table of getters or setters.
+ * @param anchor Stack index of the table keeping the names alive.
+ * @param members Array of #luaI_slot.
+ * @param setters \c TRUE if \a l are setters.
+ */
+static void luaI_add (lua_State *L, const luaI_reg *l, int anchor, GArray *members, gboolean setters)
+{
+     for (; l->name; ++l)
+     {
+          luaI_slot *s;
+
+          lua_pushstring (L, l->name);
+          s = luaI_member (members, lua_tostring (L, -1));
+
+          if (setters)
+               s->setter = l;
+          else
+               s->getter = l;
+
+          lua_pushboolean (L, TRUE);
+          lua_rawset (L, anchor);
+     }
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param metatable Stack index of the type's metatable.
+ * @param methods Stack index of the type's methods.
+ * @param getters Getters of the type.
+ * @param setters Setters of the type.
+ *
+ * Set the <code>__index</code> and <code>__newindex</code> handlers of a
+ * bound type. Without getters, <code>__index</code> is the methods
+ * table. Otherwise, the getters and setters are put in a perfect hash
+ * table, so luaI_index() and luaI_newindex() find them with a single
+ * probe. The seed and size of the table are searched once, here.
+ */
+void luaI_dispatch (lua_State *L, int metatable, int methods, const luaI_reg *getters, const luaI_reg *setters)
+{
+     GArray *members = g_array_new (FALSE, FALSE, sizeof (luaI_slot));
+     guint8 *used = NULL;
+     luaI_table *t;
+     guint64 seed = 0;
+     guint i, size = 2, shift = 63, attempt;
+     gboolean found = FALSE;
+     int anchor, table;
+
+     lua_newtable (L);
+     anchor = lua_gettop (L);
+
+     luaI_add (L, getters, anchor, members, FALSE);
+     luaI_add (L, setters, anchor, members, TRUE);
+
+     while (size < members->len * 2)
+     {
+          size <<= 1;
+          shift--;
+     }
+
+     while (!found)
+     {
+          used = g_realloc (used, size);
+
+          for (attempt = 0; attempt < LUAI_SEEDS && !found; ++attempt)
+          {
+               seed  = G_GUINT64_CONSTANT (0x9E3779B97F4A7C15) + attempt * 2;
+               found = TRUE;
+               memset (used, 0, size);
+
+               for (i = 0; i < members->len && found; ++i)
+               {
+                    guint h = luaI_hash (g_array_index (members, luaI_slot, i).key, seed, shift);
+
+                    found = !used[h];
+                    used[h] = 1;
+               }
+          }
+
+          if (!found)
+          {
+               size <<= 1;
+               shift--;
+          }
+     }
+
+     t = lua_newuserdata (L, sizeof (luaI_table) + (size - 1) * sizeof (luaI_slot));
+     table = lua_gettop (L);
+     memset (t, 0, sizeof (luaI_table) + (size - 1) * sizeof (luaI_slot));
+
+     t->seed  = seed;
+     t->shift = shift;
+
+     for (i = 0; i < members->len; ++i)
+     {
+          luaI_slot *s = &g_array_index (members, luaI_slot, i);
+          t->slots[luaI_hash (s->key, seed, shift)] = *s;
+     }
+
+     /* the names live as long as the table */
+     lua_pushvalue (L, anchor);
+     lua_setfenv (L, table);
+
+     lua_pushliteral (L, "__index");
+     if (getters[0].name == NULL)
+     {
+          /* methods only, looked up without a C call */
+          lua_pushvalue (L, methods);
+     }
+     else
+     {
+          lua_pushvalue (L, table);
+          lua_pushvalue (L, methods);
+          lua_pushcclosure (L, luaI_index, 2);
+     }
+     lua_rawset (L, metatable);
+
+     lua_pushliteral (L, "__newindex");
+     lua_pushvalue (L, table);
+     lua_pushcclosure (L, luaI_newindex, 1);
+     lua_rawset (L, metatable);
+
+     lua_pop (L, 2);
+
+     g_free (used);
+     g_array_free (members, TRUE);
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param m Getter or setter.
+ * @return Number of return value in lua.
+ */
+static inline int luaI_call (lua_State *L, const luaI_reg *m)
+{
+     /* for get: stack has userdata, index
+      * for set: stack has userdata, index, value
+      */
+     luaL_checktype (L, 1, LUA_TUSERDATA);
+     return m->func (L, (void *) ((char *) lua_touserdata (L, 1) + m->offset));
+}
+
+/*!
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * __index handler: a getter, else a method.
+ */
+int luaI_index (lua_State *L)
+{
+     /* stack has userdata, index */
+     const luaI_slot *s = luaI_lookup (L, lua_touserdata (L, lua_upvalueindex (1)));
+
+     if (s != NULL && s->getter != NULL)
+          return luaI_call (L, s->getter);
+
+     /* methods may be replaced from lua, they are not cached */
+     lua_pushvalue (L, 2);
+     lua_gettable (L, lua_upvalueindex (2));
+     if (lua_isnil (L, -1))                  /* invalid member */
+          luaL_error (L, _("cannot get member '%s'"), lua_tostring (L, 2));
+     return 1;
+}
+
+/*!
+ * @param L The lua VM state.
+ * @return Number of return value in lua.
+ *
+ * __newindex handler.
+ */
+int luaI_newindex (lua_State *L)
+{
+     /* stack has userdata, index, value */
+     const luaI_slot *s = luaI_lookup (L, lua_touserdata (L, lua_upvalueindex (1)));
+
+     if (s == NULL || s->setter == NULL)     /* invalid member */
+          luaL_error (L, _("cannot set member '%s'"), lua_tostring (L, 2));
+     return luaI_call (L, s->setter);
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param v C data.
+ * @return Number of return value in lua.
+ *
+ * Int getter.
+ */
+int luaI_getint (lua_State *L, gpointer v)
+{
+     lua_pushnumber (L, *(int *) v);
+     return 1;
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param v C data.
+ * @return Number of return value in lua.
+ *
+ * Boolean getter.
+ */
+int luaI_getbool (lua_State *L, gpointer v)
+{
+     lua_pushboolean (L, *(gboolean *) v);
+     return 1;
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param v C data.
+ * @return Number of return value in lua.
+ *
+ * String getter.
+ */
+int luaI_getstring (lua_State *L, gpointer v)
+{
+     lua_pushstring (L, (char *) v);
+     return 1;
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param v C data.
+ * @return Number of return value in lua.
+ *
+ * Int setter.
+ */
+int luaI_setint (lua_State *L, gpointer v)
+{
+     *(int *) v = luaL_checkint (L, 3);
+     return 0;
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param v C data.
+ * @return Number of return value in lua.
+ *
+ * Boolean setter.
+ */
+int luaI_setbool (lua_State *L, gpointer v)
+{
+     *(gboolean *) v = luaL_checkboolean (L, 3);
+     return 0;
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param v C data.
+ * @return Number of return value in lua.
+ *
+ * Int setter.
+ */
+int luaI_setstring (lua_State *L, gpointer v)
+{
+     char **str = (char **) v;
+     *str = g_strdup (luaL_checkstring (L, 3));
+     return 0;
+}
+
+/*! @} */
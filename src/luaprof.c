@@ -0,0 +1,198 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+
+/*!
+ * \addtogroup luaprof
+ * @{
+ */
+
+#define CREAM_LUAPROF_ERROR        (cream_luaprof_error_quark ())
+
+typedef enum
+{
+     CREAM_LUAPROF_ERROR_RUNNING,
+     CREAM_LUAPROF_ERROR_STOPPED
+} CreamLuaprofError;
+
+static GQuark cream_luaprof_error_quark (void)
+{
+     static GQuark domain = 0;
+
+     if (!domain)
+          domain = g_quark_from_string ("cream.luaprof");
+
+     return domain;
+}
+
+static GHashTable *stacks = NULL;  /*!< Number of samples by folded stack, \c NULL when stopped */
+static gint64 next_sample = 0;     /*!< Time of the next sample (monotonic, usec) */
+static guint nsamples = 0;
+
+/*!
+ * @return \c TRUE if the profiler runs.
+ */
+gboolean luaprof_running (void)
+{
+     return (stacks != NULL);
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE if the profiler already runs.
+ *
+ * Start sampling the lua code.
+ */
+gboolean luaprof_start (lua_State *L, GError **err)
+{
+     if (stacks != NULL)
+     {
+          g_set_error (err, CREAM_LUAPROF_ERROR, CREAM_LUAPROF_ERROR_RUNNING, _("The profiler is already running"));
+          return FALSE;
+     }
+
+     stacks      = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+     next_sample = 0;
+     nsamples    = 0;
+
+     lua_hook_update (L);
+     return TRUE;
+}
+
+/*!
+ * @param L The lua VM state.
+ * @param path File to write the samples to.
+ * @param samples Set to the number of samples, or \c NULL.
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Stop sampling, and write one line per stack: its frames from the
+ * outermost one, separated by <code>;</code>, and its number of samples.
+ */
+gboolean luaprof_stop (lua_State *L, const gchar *path, guint *samples, GError **err)
+{
+     GHashTableIter iter;
+     gpointer key, value;
+     GString *data;
+     gboolean ret;
+
+     if (stacks == NULL)
+     {
+          g_set_error (err, CREAM_LUAPROF_ERROR, CREAM_LUAPROF_ERROR_STOPPED, _("The profiler is not running"));
+          return FALSE;
+     }
+
+     data = g_string_new (NULL);
+
+     g_hash_table_iter_init (&iter, stacks);
+     while (g_hash_table_iter_next (&iter, &key, &value))
+          g_string_append_printf (data, "%s %u\n", (gchar *) key, GPOINTER_TO_UINT (value));
+
+     g_hash_table_destroy (stacks);
+     stacks = NULL;
+
+     lua_hook_update (L);
+
+     if (samples != NULL)
+          *samples = nsamples;
+
+     ret = g_file_set_contents (path, data->str, data->len, err);
+     g_string_free (data, TRUE);
+
+     return ret;
+}
+
+/*!
+ * @param frame String to append the frame to.
+ * @param L The lua VM state.
+ * @param ar Frame of the stack.
+ *
+ * Append a frame: <code>function\@source:line</code>, or
+ * <code>function\@[C]</code> for C functions.
+ */
+static void luaprof_frame (GString *frame, lua_State *L, lua_Debug *ar)
+{
+     const gchar *name;
+
+     lua_getinfo (L, "Snl", ar);
+
+     if (ar->name != NULL)
+          name = ar->name;
+     else if (g_str_equal (ar->what, "main"))
+          name = "(main)";
+     else
+          name = "?";
+
+     if (g_str_equal (ar->what, "C"))
+          g_string_append_printf (frame, "%s@[C]", name);
+     else
+          g_string_append_printf (frame, "%s@%s:%d", name, ar->short_src, ar->currentline);
+}
+
+/*!
+ * @param L The lua VM state.
+ *
+ * Called by the count hook: record the current stack, if a sample is
+ * due.
+ */
+void luaprof_sample (lua_State *L)
+{
+     lua_Debug ar[LUAPROF_DEPTH];
+     gint64 now = g_get_monotonic_time ();
+     GString *stack;
+     gint depth, i;
+
+     if (now < next_sample)
+          return;
+
+     next_sample = now + LUAPROF_INTERVAL;
+
+     for (depth = 0; depth < LUAPROF_DEPTH && lua_getstack (L, depth, &ar[depth]); ++depth);
+
+     if (depth == 0)
+          return;
+
+     stack = g_string_new (NULL);
+
+     for (i = depth - 1; i >= 0; --i)
+     {
+          luaprof_frame (stack, L, &ar[i]);
+
+          if (i > 0)
+               g_string_append_c (stack, ';');
+     }
+
+     /* no spaces: the count follows the last one */
+     g_strdelimit (stack->str, " ", '_');
+
+     i = GPOINTER_TO_UINT (g_hash_table_lookup (stacks, stack->str));
+     g_hash_table_insert (stacks, g_string_free (stack, FALSE), GUINT_TO_POINTER (i + 1));
+
+     nsamples++;
+}
+
+/*! @} */
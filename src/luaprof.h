@@ -0,0 +1,55 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef __LUAPROF_H
+#define __LUAPROF_H
+
+/*!
+ * \defgroup luaprof Lua profiler
+ * \ingroup lua
+ * Sampling profiler of the lua code.
+ *
+ * While the profiler runs, a count hook checks the clock every
+ * #LUAPROF_STEP instructions, and records the lua stack once per
+ * #LUAPROF_INTERVAL. Samples are aggregated by stack, each frame being
+ * a function and its current line, and written in the folded format of
+ * flamegraph.pl. The hook is removed when the profiler stops.
+ *
+ * @{
+ */
+
+#include "lua.h"
+
+#define LUAPROF_STEP               1000      /*!< Instructions between two checks of the clock */
+#define LUAPROF_INTERVAL           1000      /*!< Time (usec) between two samples */
+#define LUAPROF_DEPTH              64        /*!< Frames recorded in a sample, from the innermost one */
+
+gboolean luaprof_start (lua_State *L, GError **err);
+gboolean luaprof_stop (lua_State *L, const gchar *path, guint *samples, GError **err);
+gboolean luaprof_running (void);
+void luaprof_sample (lua_State *L);
+
+/*! @} */
+
+#endif /* __LUAPROF_H */
@@ -211,6 +211,47 @@ gboolean cream_module_search (CreamModule *self, GtkWidget *webview, const gchar
      return iface->search (self, webview, text, forward);
 }
 
+/*!
+ * \public \memberof CreamModule
+ * @param self The module to use.
+ * @param webview A webview.
+ * @param text Text to look for.
+ * @param forward Search forward or backward.
+ * @param resume \c TRUE to start from the current match, \c FALSE to start from the top (or the bottom).
+ * @return \c TRUE on success, \c FALSE otherwise.
+ *
+ * Looks for a specified string inside webview, while it is typed. When
+ * \a text extends the previous one, the current match is kept if it
+ * still matches.
+ */
+gboolean cream_module_search_incremental (CreamModule *self, GtkWidget *webview, const gchar *text, gboolean forward, gboolean resume)
+{
+     CreamModuleIface *iface;
+     g_return_val_if_fail (CREAM_IS_MODULE (self), FALSE);
+     iface = CREAM_MODULE_GET_INTERFACE (self);
+     g_return_val_if_fail (iface->search_incremental != NULL, FALSE);
+     return iface->search_incremental (self, webview, text, forward, resume);
+}
+
+/*!
+ * \public \memberof CreamModule
+ * @param self The module to use.
+ * @param webview A webview.
+ * @param text Text to highlight, or \c NULL to remove the highlights.
+ * @param limit Maximum number of matches to highlight.
+ * @return Number of matches highlighted.
+ *
+ * Highlight the matches of a specified string inside webview.
+ */
+guint cream_module_search_mark (CreamModule *self, GtkWidget *webview, const gchar *text, guint limit)
+{
+     CreamModuleIface *iface;
+     g_return_val_if_fail (CREAM_IS_MODULE (self), 0);
+     iface = CREAM_MODULE_GET_INTERFACE (self);
+     g_return_val_if_fail (iface->search_mark != NULL, 0);
+     return iface->search_mark (self, webview, text, limit);
+}
+
 /*!
  * \public \memberof CreamModule
  * @param self The module to use.
@@ -243,4 +284,183 @@ void cream_module_useragent (CreamModule *self, const gchar *ua)
      iface->useragent (self, ua);
 }
 
+/*!
+ * \public \memberof CreamModule
+ * @param self The module to use.
+ * @param webview A webview.
+ * @param items Array of #CreamModuleHistoryItem to fill with the back/forward list, or \c NULL.
+ * @param current Position of the current item in the list.
+ * @param length Length of the list.
+ * @return \c FALSE if the module has no back/forward list.
+ *
+ * Get the back/forward list of a webview. The items are appended to
+ * \a items, and must be freed with cream_module_history_clear().
+ */
+gboolean cream_module_get_history (CreamModule *self, GtkWidget *webview, GArray *items, guint *current, guint *length)
+{
+     CreamModuleIface *iface;
+     g_return_val_if_fail (CREAM_IS_MODULE (self), FALSE);
+     iface = CREAM_MODULE_GET_INTERFACE (self);
+     g_return_val_if_fail (iface->get_history != NULL, FALSE);
+     return iface->get_history (self, webview, items, current, length);
+}
+
+/*!
+ * \public \memberof CreamModule
+ * @param self The module to use.
+ * @param webview A webview.
+ * @param items Array of #CreamModuleHistoryItem.
+ * @param current Position of the item to load.
+ *
+ * Replace the back/forward list of a webview, and load its current item.
+ */
+void cream_module_set_history (CreamModule *self, GtkWidget *webview, GArray *items, guint current)
+{
+     CreamModuleIface *iface;
+     g_return_if_fail (CREAM_IS_MODULE (self));
+     g_return_if_fail (current < items->len);
+     iface = CREAM_MODULE_GET_INTERFACE (self);
+     g_return_if_fail (iface->set_history != NULL);
+     iface->set_history (self, webview, items, current);
+}
+
+/*!
+ * @param items Array of #CreamModuleHistoryItem.
+ *
+ * Free the items' strings and empty the array.
+ */
+void cream_module_history_clear (GArray *items)
+{
+     guint i;
+
+     for (i = 0; i < items->len; ++i)
+     {
+          CreamModuleHistoryItem *item = &g_array_index (items, CreamModuleHistoryItem, i);
+
+          g_free (item->uri);
+          g_free (item->title);
+     }
+
+     g_array_set_size (items, 0);
+}
+
+/*!
+ * \public \memberof CreamModule
+ * @param self The module to use.
+ * @param webview A webview.
+ * @param alphabet Characters of the labels.
+ * @return Number of hints shown.
+ *
+ * Label the clickable elements visible in a webview (see
+ * cream_module_hints_labels()).
+ */
+guint cream_module_hints_show (CreamModule *self, GtkWidget *webview, const gchar *alphabet)
+{
+     CreamModuleIface *iface;
+     g_return_val_if_fail (CREAM_IS_MODULE (self), 0);
+     iface = CREAM_MODULE_GET_INTERFACE (self);
+     g_return_val_if_fail (iface->hints_show != NULL, 0);
+     return iface->hints_show (self, webview, alphabet);
+}
+
+/*!
+ * \public \memberof CreamModule
+ * @param self The module to use.
+ * @param webview A webview.
+ * @param prefix Characters typed.
+ * @return Number of hints whose label starts with \a prefix.
+ *
+ * Hide the hints whose label does not start with \a prefix.
+ */
+guint cream_module_hints_filter (CreamModule *self, GtkWidget *webview, const gchar *prefix)
+{
+     CreamModuleIface *iface;
+     g_return_val_if_fail (CREAM_IS_MODULE (self), 0);
+     iface = CREAM_MODULE_GET_INTERFACE (self);
+     g_return_val_if_fail (iface->hints_filter != NULL, 0);
+     return iface->hints_filter (self, webview, prefix);
+}
+
+/*!
+ * \public \memberof CreamModule
+ * @param self The module to use.
+ * @param webview A webview.
+ * @return \c TRUE if an editable element was focused.
+ *
+ * Activate the first hint left by cream_module_hints_filter(), and
+ * hide the hints.
+ */
+gboolean cream_module_hints_follow (CreamModule *self, GtkWidget *webview)
+{
+     CreamModuleIface *iface;
+     g_return_val_if_fail (CREAM_IS_MODULE (self), FALSE);
+     iface = CREAM_MODULE_GET_INTERFACE (self);
+     g_return_val_if_fail (iface->hints_follow != NULL, FALSE);
+     return iface->hints_follow (self, webview);
+}
+
+/*!
+ * \public \memberof CreamModule
+ * @param self The module to use.
+ * @param webview A webview.
+ *
+ * Hide the hints.
+ */
+void cream_module_hints_hide (CreamModule *self, GtkWidget *webview)
+{
+     CreamModuleIface *iface;
+     g_return_if_fail (CREAM_IS_MODULE (self));
+     iface = CREAM_MODULE_GET_INTERFACE (self);
+     g_return_if_fail (iface->hints_hide != NULL);
+     iface->hints_hide (self, webview);
+}
+
+/*!
+ * @param n Number of labels.
+ * @param alphabet Characters of the labels (at least 2).
+ * @return A \c NULL terminated array of \a n labels (must be freed with g_strfreev()).
+ *
+ * Generate the shortest labels such that none is the prefix of another:
+ * the shortest label is split in as many labels as characters in the
+ * alphabet, until there are enough. So \a n labels use the fewest
+ * keystrokes, and a hint is known as soon as its label is typed.
+ * The shortest labels come first.
+ */
+gchar **cream_module_hints_labels (guint n, const gchar *alphabet)
+{
+     GPtrArray *labels = g_ptr_array_new ();
+     guint i, first = 0, len = strlen (alphabet);
+     gchar **ret;
+
+     g_return_val_if_fail (len >= 2, NULL);
+
+     g_ptr_array_add (labels, g_strdup (""));
+
+     /* the labels after first are the leaves */
+     while (first == 0 || labels->len - first < n)
+     {
+          gchar *prefix = g_ptr_array_index (labels, first++);
+
+          for (i = 0; i < len; ++i)
+               g_ptr_array_add (labels, g_strdup_printf ("%s%c", prefix, alphabet[i]));
+     }
+
+     ret = g_new (gchar *, n + 1);
+
+     for (i = 0; i < labels->len; ++i)
+     {
+          gchar *label = g_ptr_array_index (labels, i);
+
+          if (i >= first && i - first < n)
+               ret[i - first] = label;
+          else
+               g_free (label);
+     }
+
+     ret[n] = NULL;
+     g_ptr_array_free (labels, TRUE);
+
+     return ret;
+}
+
 /*! @} */
@@ -49,6 +49,16 @@ G_BEGIN_DECLS
 typedef struct _CreamModule CreamModule;
 typedef struct _CreamModuleIface CreamModuleIface;
 
+/*!
+ * \struct CreamModuleHistoryItem
+ * An item of a webview's back/forward list.
+ */
+typedef struct
+{
+     gchar *uri;    /*!< Item's URI */
+     gchar *title;  /*!< Item's title, or \c NULL */
+} CreamModuleHistoryItem;
+
 /*!
  * \class CreamModule
  * Virtual module class.
@@ -70,9 +80,17 @@ struct _CreamModuleIface
      gboolean (*can_go_forward) (CreamModule *self, GtkWidget *);
      void (*forward) (CreamModule *self, GtkWidget *);
      gboolean (*search) (CreamModule *self, GtkWidget *, const gchar *, gboolean);
+     gboolean (*search_incremental) (CreamModule *self, GtkWidget *, const gchar *, gboolean, gboolean);
+     guint (*search_mark) (CreamModule *self, GtkWidget *, const gchar *, guint);
      void (*proxy) (CreamModule *self, const gchar *);
      void (*useragent) (CreamModule *self, const gchar *);
      void (*load_favicon) (CreamModule *self, GtkWidget *);
+     gboolean (*get_history) (CreamModule *self, GtkWidget *, GArray *, guint *, guint *);
+     void (*set_history) (CreamModule *self, GtkWidget *, GArray *, guint);
+     guint (*hints_show) (CreamModule *self, GtkWidget *, const gchar *);
+     guint (*hints_filter) (CreamModule *self, GtkWidget *, const gchar *);
+     gboolean (*hints_follow) (CreamModule *self, GtkWidget *);
+     void (*hints_hide) (CreamModule *self, GtkWidget *);
 };
 
 GType cream_module_get_type (void);
@@ -86,8 +104,18 @@ void cream_module_backward (CreamModule *self, GtkWidget *webview);
 gboolean cream_module_can_go_forward (CreamModule *self, GtkWidget *webview);
 void cream_module_forward (CreamModule *self, GtkWidget *webview);
 gboolean cream_module_search (CreamModule *self, GtkWidget *webview, const gchar *text, gboolean forward);
+gboolean cream_module_search_incremental (CreamModule *self, GtkWidget *webview, const gchar *text, gboolean forward, gboolean resume);
+guint cream_module_search_mark (CreamModule *self, GtkWidget *webview, const gchar *text, guint limit);
 void cream_module_proxy (CreamModule *self, const gchar *uri);
 void cream_module_useragent (CreamModule *self, const gchar *ua);
+gboolean cream_module_get_history (CreamModule *self, GtkWidget *webview, GArray *items, guint *current, guint *length);
+void cream_module_set_history (CreamModule *self, GtkWidget *webview, GArray *items, guint current);
+void cream_module_history_clear (GArray *items);
+guint cream_module_hints_show (CreamModule *self, GtkWidget *webview, const gchar *alphabet);
+guint cream_module_hints_filter (CreamModule *self, GtkWidget *webview, const gchar *prefix);
+gboolean cream_module_hints_follow (CreamModule *self, GtkWidget *webview);
+void cream_module_hints_hide (CreamModule *self, GtkWidget *webview);
+gchar **cream_module_hints_labels (guint n, const gchar *alphabet);
 
 /*!
  * \def CREAM_DEFINE_MODULE (ctype, fn_prefix)
@@ -108,8 +136,18 @@ void cream_module_useragent (CreamModule *self, const gchar *ua);
      static gboolean fn_prefix##_can_go_forward (CreamModule *self, GtkWidget *webview);                                \
      static void fn_prefix##_forward (CreamModule *self, GtkWidget *webview);                                           \
      static gboolean fn_prefix##_search (CreamModule *self, GtkWidget *webview, const gchar *text, gboolean forward);   \
+     static gboolean fn_prefix##_search_incremental (CreamModule *self, GtkWidget *webview, const gchar *text,          \
+                                                     gboolean forward, gboolean resume);                                \
+     static guint fn_prefix##_search_mark (CreamModule *self, GtkWidget *webview, const gchar *text, guint limit);      \
      static void fn_prefix##_proxy (CreamModule *self, const gchar *uri);                                               \
      static void fn_prefix##_useragent (CreamModule *self, const gchar *ua);                                            \
+     static gboolean fn_prefix##_get_history (CreamModule *self, GtkWidget *webview, GArray *items,                     \
+                                              guint *current, guint *length);                                           \
+     static void fn_prefix##_set_history (CreamModule *self, GtkWidget *webview, GArray *items, guint current);         \
+     static guint fn_prefix##_hints_show (CreamModule *self, GtkWidget *webview, const gchar *alphabet);                \
+     static guint fn_prefix##_hints_filter (CreamModule *self, GtkWidget *webview, const gchar *prefix);                \
+     static gboolean fn_prefix##_hints_follow (CreamModule *self, GtkWidget *webview);                                  \
+     static void fn_prefix##_hints_hide (CreamModule *self, GtkWidget *webview);                                        \
                                                                                                                         \
      enum { PROP_0, PROP_NAME };                                                                                        \
      enum                                                                                                               \
@@ -173,8 +211,16 @@ void cream_module_useragent (CreamModule *self, const gchar *ua);
           iface->can_go_forward = fn_prefix##_can_go_forward;                                                           \
           iface->forward        = fn_prefix##_forward;                                                                  \
           iface->search         = fn_prefix##_search;                                                                   \
+          iface->search_incremental = fn_prefix##_search_incremental;                                                   \
+          iface->search_mark    = fn_prefix##_search_mark;                                                              \
           iface->proxy          = fn_prefix##_proxy;                                                                    \
           iface->useragent      = fn_prefix##_useragent;                                                                \
+          iface->get_history    = fn_prefix##_get_history;                                                              \
+          iface->set_history    = fn_prefix##_set_history;                                                              \
+          iface->hints_show     = fn_prefix##_hints_show;                                                               \
+          iface->hints_filter   = fn_prefix##_hints_filter;                                                             \
+          iface->hints_follow   = fn_prefix##_hints_follow;                                                             \
+          iface->hints_hide     = fn_prefix##_hints_hide;                                                               \
      }                                                                                                                  \
                                                                                                                         \
      static void fn_prefix##_class_init (ctype##Class *klass)                                                           \
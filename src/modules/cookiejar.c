@@ -0,0 +1,428 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "../local.h"
+
+#include <time.h>
+
+/*!
+ * \addtogroup cookiejar
+ *
+ * @{
+ */
+
+/*!
+ * \struct CookieShard
+ * Cookies of a registrable domain.
+ *
+ * Each line of the journal is either a stored cookie
+ * (<code>domain, path, name, value, expires, flags</code>), or the
+ * deletion of a cookie (<code>domain, path, name</code>), separated by
+ * tabulations.
+ */
+typedef struct
+{
+     gchar *path;                  /*!< Path to the journal */
+     gboolean loaded;              /*!< \c TRUE once the journal was read */
+     GHashTable *cookies;          /*!< Journal lines of the stored cookies, by key */
+     guint lines;                  /*!< Number of lines in the journal */
+} CookieShard;
+
+static void cream_cookie_jar_finalize (GObject *obj);
+static void cream_cookie_jar_changed (SoupCookieJar *jar, SoupCookie *old_cookie, SoupCookie *new_cookie);
+
+G_DEFINE_TYPE (CreamCookieJar, cream_cookie_jar, SOUP_TYPE_COOKIE_JAR)
+
+static void cookie_shard_free (CookieShard *shard)
+{
+     g_hash_table_destroy (shard->cookies);
+     g_free (shard->path);
+     g_free (shard);
+}
+
+/*!
+ * @param klass The #CreamCookieJar class structure.
+ * Initialize #CreamCookieJar class.
+ */
+static void cream_cookie_jar_class_init (CreamCookieJarClass *klass)
+{
+     G_OBJECT_CLASS (klass)->finalize = cream_cookie_jar_finalize;
+     SOUP_COOKIE_JAR_CLASS (klass)->changed = cream_cookie_jar_changed;
+}
+
+/*!
+ * @param self The #CreamCookieJar instance structure.
+ * Initialize #CreamCookieJar instance. No shard is loaded.
+ */
+static void cream_cookie_jar_init (CreamCookieJar *self)
+{
+     self->shards  = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) cookie_shard_free);
+     self->loading = FALSE;
+}
+
+static void cream_cookie_jar_finalize (GObject *obj)
+{
+     g_hash_table_destroy (CREAM_COOKIE_JAR (obj)->shards);
+
+     G_OBJECT_CLASS (cream_cookie_jar_parent_class)->finalize (obj);
+}
+
+/*!
+ * \public \memberof CreamCookieJar
+ * @return A new #CreamCookieJar object.
+ */
+SoupCookieJar *cream_cookie_jar_new (void)
+{
+     return g_object_new (CREAM_TYPE_COOKIE_JAR, NULL);
+}
+
+/* Serialization */
+
+/*!
+ * Second-level labels used as public suffixes under a country code
+ * (<code>co.uk</code>, <code>com.au</code>, ...).
+ */
+static const gchar *cookie_jar_suffixes[] =
+{
+     "ac", "co", "com", "edu", "gob", "gov", "gv", "ltd", "me", "mil",
+     "ne", "net", "nic", "nom", "or", "org", "plc", "sch",
+     NULL
+};
+
+/*!
+ * @param label A label of a host name.
+ * @param len Length of \a label.
+ * @return \c TRUE if \a label is a public second-level label.
+ */
+static gboolean cookie_jar_is_suffix (const gchar *label, gsize len)
+{
+     guint i;
+
+     for (i = 0; cookie_jar_suffixes[i] != NULL; ++i)
+          if (strlen (cookie_jar_suffixes[i]) == len && strncmp (cookie_jar_suffixes[i], label, len) == 0)
+               return TRUE;
+
+     return FALSE;
+}
+
+/*!
+ * @param host A host name, or a cookie's domain.
+ * @return \c TRUE if \a host is in lowercase, and can be used in a path.
+ */
+static gboolean cookie_jar_is_normal (const gchar *host)
+{
+     for (; *host; ++host)
+          if (g_ascii_isupper (*host) || *host == G_DIR_SEPARATOR)
+               return FALSE;
+
+     return TRUE;
+}
+
+/*!
+ * @param host A host name, or a cookie's domain, in lowercase.
+ * @return Registrable domain of \a host, in place.
+ *
+ * Keep the last two labels of the host, or the last three when the
+ * top-level domain is a country code and the second-level label a
+ * known public suffix (see #cookie_jar_suffixes).
+ */
+static const gchar *cookie_jar_domain (const gchar *host)
+{
+     const gchar *p, *q;
+
+     while (*host == '.')
+          ++host;
+
+     if (g_hostname_is_ip_address (host) || (p = strrchr (host, '.')) == NULL)
+          return host;
+
+     for (q = p; q > host && q[-1] != '.'; --q);
+
+     if (q > host && strlen (p + 1) == 2 && cookie_jar_is_suffix (q, p - q))
+          for (--q; q > host && q[-1] != '.'; --q);
+
+     return q;
+}
+
+/*!
+ * @param cookie A #SoupCookie.
+ * @return Key of the cookie in its shard (must be freed).
+ */
+static gchar *cookie_jar_key (SoupCookie *cookie)
+{
+     return g_strjoin ("\t", cookie->domain, cookie->path ? cookie->path : "/", cookie->name, NULL);
+}
+
+/*!
+ * @param cookie A #SoupCookie.
+ * @return Journal line of the cookie (must be freed), or \c NULL if it
+ * must not be stored.
+ */
+static gchar *cookie_jar_serialize (SoupCookie *cookie)
+{
+     gchar *key, *ret;
+
+     /* session cookie */
+     if (cookie->expires == NULL)
+          return NULL;
+
+     /* fields can not hold separators */
+     if (strpbrk (cookie->domain, "\t\r\n") != NULL || strpbrk (cookie->name, "\t\r\n") != NULL
+         || strpbrk (cookie->value, "\t\r\n") != NULL || (cookie->path && strpbrk (cookie->path, "\t\r\n") != NULL))
+          return NULL;
+
+     key = cookie_jar_key (cookie);
+
+     ret = g_strdup_printf ("%s\t%s\t%ld\t%s%s", key, cookie->value,
+                            (long) soup_date_to_time_t (cookie->expires),
+                            cookie->secure ? "s" : "",
+                            cookie->http_only ? "h" : "");
+     g_free (key);
+
+     return ret;
+}
+
+/*!
+ * @param line A journal line.
+ * @return A new #SoupCookie, or \c NULL if it expired.
+ */
+static SoupCookie *cookie_jar_parse (const gchar *line)
+{
+     gchar **fields = g_strsplit (line, "\t", 6);
+     SoupCookie *cookie = NULL;
+
+     if (g_strv_length (fields) == 6)
+     {
+          gint64 expires = g_ascii_strtoll (fields[4], NULL, 10) - time (NULL);
+
+          if (expires > 0)
+          {
+               cookie = soup_cookie_new (fields[2], fields[3], fields[0], fields[1], MIN (expires, G_MAXINT));
+               soup_cookie_set_secure (cookie, strchr (fields[5], 's') != NULL);
+               soup_cookie_set_http_only (cookie, strchr (fields[5], 'h') != NULL);
+          }
+     }
+
+     g_strfreev (fields);
+     return cookie;
+}
+
+/* Shards */
+
+/*!
+ * @param record A journal line (not nul-terminated).
+ * @param len Length of the line.
+ * @param data The #CookieShard.
+ * @return \c TRUE, to read the whole journal.
+ */
+static gboolean cookie_shard_replay (const gchar *record, gsize len, gpointer data)
+{
+     CookieShard *shard = data;
+     gchar *line = g_strndup (record, len);
+     gchar **fields = g_strsplit (line, "\t", 6);
+     guint n = g_strv_length (fields);
+
+     shard->lines++;
+
+     if (n >= 3)
+     {
+          gchar *key = g_strjoin ("\t", fields[0], fields[1], fields[2], NULL);
+
+          if (n == 6)
+          {
+               g_hash_table_replace (shard->cookies, key, line);
+               line = NULL;
+          }
+          else
+          {
+               g_hash_table_remove (shard->cookies, key);
+               g_free (key);
+          }
+     }
+
+     g_strfreev (fields);
+     g_free (line);
+
+     return TRUE;
+}
+
+/*!
+ * @param shard A #CookieShard.
+ *
+ * Rewrite the journal if it holds too many stale lines.
+ */
+static void cookie_shard_compact (CookieShard *shard)
+{
+     GHashTableIter iter;
+     gpointer line;
+     GString *data;
+
+     if (shard->lines <= 2 * g_hash_table_size (shard->cookies) + COOKIE_JAR_COMPACT_SLACK)
+          return;
+
+     data = g_string_new (NULL);
+
+     g_hash_table_iter_init (&iter, shard->cookies);
+     while (g_hash_table_iter_next (&iter, NULL, &line))
+          g_string_append_printf (data, "%s\r\n", (gchar *) line);
+
+     cache_rewrite (shard->path, data);
+     shard->lines = g_hash_table_size (shard->cookies);
+}
+
+/*!
+ * @param jar A #CreamCookieJar.
+ * @param shard A #CookieShard, not loaded yet.
+ * @param skip Key of a cookie not to load (already in the jar), or \c NULL.
+ *
+ * Read the shard's journal, and add its cookies to the jar.
+ */
+static void cookie_shard_load (CreamCookieJar *jar, CookieShard *shard, const gchar *skip)
+{
+     GError *error = NULL;
+     GHashTableIter iter;
+     gpointer key, line;
+
+     shard->loaded = TRUE;
+
+     if (!cache_foreach (shard->path, cookie_shard_replay, shard, &error))
+          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+
+     jar->loading = TRUE;
+
+     g_hash_table_iter_init (&iter, shard->cookies);
+     while (g_hash_table_iter_next (&iter, &key, &line))
+     {
+          SoupCookie *cookie;
+
+          if (skip != NULL && g_str_equal (key, skip))
+               continue;
+
+          if ((cookie = cookie_jar_parse (line)) != NULL)
+               soup_cookie_jar_add_cookie (SOUP_COOKIE_JAR (jar), cookie);
+          else
+               g_hash_table_iter_remove (&iter);
+     }
+
+     jar->loading = FALSE;
+
+     cookie_shard_compact (shard);
+}
+
+/*!
+ * @param jar A #CreamCookieJar.
+ * @param host A host name, or a cookie's domain.
+ * @param skip See cookie_shard_load().
+ * @return The loaded shard of \a host.
+ */
+static CookieShard *cream_cookie_jar_get_shard (CreamCookieJar *jar, const gchar *host, const gchar *skip)
+{
+     gchar *normal = NULL;
+     const gchar *domain;
+     CookieShard *shard;
+
+     /* hosts of requests are already in lowercase */
+     if (!cookie_jar_is_normal (host))
+     {
+          host = normal = g_ascii_strdown (host, -1);
+          g_strdelimit (normal, G_DIR_SEPARATOR_S, '_');
+     }
+
+     domain = cookie_jar_domain (host);
+
+     if ((shard = g_hash_table_lookup (jar->shards, domain)) == NULL)
+     {
+          shard = g_new0 (CookieShard, 1);
+          shard->path    = cache_path (CACHE_TYPE_COOKIES, domain);
+          shard->cookies = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+          g_hash_table_insert (jar->shards, g_strdup (domain), shard);
+     }
+
+     g_free (normal);
+
+     if (!shard->loaded)
+          cookie_shard_load (jar, shard, skip);
+
+     return shard;
+}
+
+/*!
+ * \public \memberof CreamCookieJar
+ * @param jar A #CreamCookieJar object.
+ * @param host Host of a request.
+ *
+ * Load the cookies of the registrable domain of \a host, if they are
+ * not loaded yet. Its parent domains share the same shard. Called when
+ * a request is queued.
+ */
+void cream_cookie_jar_load (CreamCookieJar *jar, const gchar *host)
+{
+     g_return_if_fail (CREAM_IS_COOKIE_JAR (jar));
+     g_return_if_fail (host != NULL);
+
+     cream_cookie_jar_get_shard (jar, host, NULL);
+}
+
+/*!
+ * @param jar A #SoupCookieJar.
+ * @param old_cookie The replaced or deleted cookie, or \c NULL.
+ * @param new_cookie The new cookie, or \c NULL.
+ *
+ * Append the change to the journal of the cookie's shard.
+ */
+static void cream_cookie_jar_changed (SoupCookieJar *jar, SoupCookie *old_cookie, SoupCookie *new_cookie)
+{
+     CreamCookieJar *self = CREAM_COOKIE_JAR (jar);
+     SoupCookie *cookie = (new_cookie ? new_cookie : old_cookie);
+     CookieShard *shard;
+     gchar *key, *line;
+
+     if (self->loading || cookie == NULL)
+          return;
+
+     key   = cookie_jar_key (cookie);
+     shard = cream_cookie_jar_get_shard (self, cookie->domain, key);
+
+     if (new_cookie != NULL && (line = cookie_jar_serialize (new_cookie)) != NULL)
+     {
+          cache_appendto (shard->path, line);
+          g_hash_table_replace (shard->cookies, key, line);
+          shard->lines++;
+     }
+     else if (g_hash_table_remove (shard->cookies, key))
+     {
+          /* deleted, or replaced by a session cookie */
+          cache_appendto (shard->path, key);
+          g_free (key);
+          shard->lines++;
+     }
+     else
+          g_free (key);
+
+     cookie_shard_compact (shard);
+}
+
+/*! @} */
@@ -0,0 +1,89 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __MOD_COOKIEJAR_H
+#define __MOD_COOKIEJAR_H
+
+#include <glib.h>
+
+#include <libsoup/soup.h>
+
+/*!
+ * \defgroup cookiejar Cookie jar
+ * \ingroup mod-webkit
+ *
+ * Persistent cookie jar, stored in the #CACHE_TYPE_COOKIES directory.
+ *
+ * Cookies are sharded by registrable domain (one file per domain, e.g.
+ * <code>example.com</code> for <code>www.example.com</code>), and a
+ * shard is loaded the first time a request is queued for its domain.
+ * Changes are appended to the shard's journal by the cache writer, and
+ * the journal is rewritten when it holds too many stale lines.
+ *
+ * Session cookies are not stored.
+ *
+ * @{
+ */
+
+G_BEGIN_DECLS
+
+#define CREAM_TYPE_COOKIE_JAR            (cream_cookie_jar_get_type ())
+#define CREAM_COOKIE_JAR(obj)            (G_TYPE_CHECK_INSTANCE_CAST (obj, CREAM_TYPE_COOKIE_JAR, CreamCookieJar))
+#define CREAM_IS_COOKIE_JAR(obj)         (G_TYPE_CHECK_INSTANCE_TYPE (obj, CREAM_TYPE_COOKIE_JAR))
+#define CREAM_COOKIE_JAR_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST (klass, CREAM_TYPE_COOKIE_JAR, CreamCookieJarClass))
+
+#define COOKIE_JAR_COMPACT_SLACK         64        /*!< Stale journal lines allowed before rewriting a shard */
+
+typedef struct _CreamCookieJar CreamCookieJar;
+typedef struct _CreamCookieJarClass CreamCookieJarClass;
+
+/*!
+ * \class CreamCookieJar
+ * \extends SoupCookieJar
+ * Cookie jar sharded by registrable domain.
+ */
+struct _CreamCookieJar
+{
+     SoupCookieJar parent;
+
+     GHashTable *shards;           /*!< Shards by registrable domain */
+     gboolean loading;             /*!< \c TRUE while a shard is loaded */
+};
+
+struct _CreamCookieJarClass
+{
+     SoupCookieJarClass parent;
+};
+
+GType cream_cookie_jar_get_type (void);
+
+SoupCookieJar *cream_cookie_jar_new (void);
+void cream_cookie_jar_load (CreamCookieJar *jar, const gchar *host);
+
+G_END_DECLS
+
+/*! @} */
+
+#endif /* __MOD_COOKIEJAR_H */
@@ -89,6 +89,16 @@ static gboolean cream_module_dummy_search (CreamModule *self, GtkWidget *webview
      return FALSE;
 }
 
+static gboolean cream_module_dummy_search_incremental (CreamModule *self, GtkWidget *webview, const gchar *text, gboolean forward, gboolean resume)
+{
+     return FALSE;
+}
+
+static guint cream_module_dummy_search_mark (CreamModule *self, GtkWidget *webview, const gchar *text, guint limit)
+{
+     return 0;
+}
+
 static void cream_module_dummy_proxy (CreamModule *self, const gchar *uri)
 {
      return;
@@ -99,4 +109,49 @@ static void cream_module_dummy_useragent (CreamModule *self, const gchar *ua)
      return;
 }
 
+static gboolean cream_module_dummy_get_history (CreamModule *self, GtkWidget *webview, GArray *items, guint *current, guint *length)
+{
+     *current = 0;
+     *length  = 1;
+
+     if (items != NULL)
+     {
+          CreamModuleHistoryItem item;
+
+          item.uri   = g_strdup (gtk_label_get_text (GTK_LABEL (webview)));
+          item.title = NULL;
+          g_array_append_val (items, item);
+     }
+
+     return TRUE;
+}
+
+static void cream_module_dummy_set_history (CreamModule *self, GtkWidget *webview, GArray *items, guint current)
+{
+     UriScheme u;
+
+     if (uri_scheme_parse (&u, g_array_index (items, CreamModuleHistoryItem, current).uri))
+          cream_module_dummy_load_uri (self, webview, &u);
+}
+
+static guint cream_module_dummy_hints_show (CreamModule *self, GtkWidget *webview, const gchar *alphabet)
+{
+     return 0;
+}
+
+static guint cream_module_dummy_hints_filter (CreamModule *self, GtkWidget *webview, const gchar *prefix)
+{
+     return 0;
+}
+
+static gboolean cream_module_dummy_hints_follow (CreamModule *self, GtkWidget *webview)
+{
+     return FALSE;
+}
+
+static void cream_module_dummy_hints_hide (CreamModule *self, GtkWidget *webview)
+{
+     return;
+}
+
 /*! @} */
@@ -37,9 +37,111 @@ static void cream_module_webkit_notify_favicon_cb (WebKitWebView *webview, GPara
 static void cream_module_webkit_notify_progress_cb (WebKitWebView *webview, GParamSpec *pspec, CreamModuleWebKit *self);
 static gboolean cream_module_webkit_button_press_event_cb (WebKitWebView *webview, GdkEventButton *event, CreamModuleWebKit *self);
 static gboolean cream_module_webkit_signal_download_cb (WebKitWebView *webview, WebKitDownload *download, CreamModuleWebKit *self);
+static void cream_module_webkit_request_queued_cb (SoupSession *session, SoupMessage *msg, CreamModuleWebKit *self);
+static JSValueRef cream_module_webkit_eval (GtkWidget *webview, const gchar *script, JSContextRef *ctx);
 
 CREAM_DEFINE_MODULE (CreamModuleWebKit, cream_module_webkit)
 
+/*!
+ * Maximum number of hints shown in a page.
+ */
+#define CREAM_MODULE_WEBKIT_HINTS_MAX        4096
+
+/*!
+ * Hints of a page. The script evaluates to a new object, held from C
+ * (see #CreamModuleWebKitHints) and never stored in the page, which
+ * could replace it otherwise. collect() enumerates
+ * the clickable elements with a single query and reads all their boxes
+ * before any change to the document, draw() adds all the labels at
+ * once, and filter() only looks at the hints matched by the previous
+ * prefix when the prefix grows.
+ */
+#define CREAM_MODULE_WEBKIT_HINTS_SCRIPT                                                                 \
+     "({"                                                                                                \
+     "  elems: [], rects: [], labels: [], nodes: [], matched: [], prefix: '', layer: null,"              \
+     "  selector: 'a[href], area[href], button, select, textarea, input:not([type=hidden]),"             \
+     "             [onclick], [tabindex], [role=link], [role=button], [contenteditable=true]',"          \
+     "  collect: function () {"                                                                          \
+     "    var all = document.querySelectorAll (this.selector), w = window.innerWidth,"                   \
+     "        h = window.innerHeight, i, r;"                                                             \
+     "    this.hide (); this.elems = []; this.rects = [];"                                               \
+     "    for (i = 0; i < all.length; ++i) {"                                                            \
+     "      r = all[i].getClientRects ()[0];"                                                            \
+     "      if (!r || r.width == 0 || r.height == 0 || r.bottom < 0 || r.right < 0"                      \
+     "          || r.top > h || r.left > w) continue;"                                                   \
+     "      this.elems.push (all[i]); this.rects.push (r);"                                              \
+     "    }"                                                                                             \
+     "    return this.elems.length;"                                                                     \
+     "  },"                                                                                              \
+     "  draw: function (labels) {"                                                                       \
+     "    var frag = document.createDocumentFragment (), sx = window.scrollX, sy = window.scrollY,"      \
+     "        style = document.createElement ('style'), i, n;"                                           \
+     "    style.textContent = '#__cream_hints span { position: absolute; z-index: 2147483647;"           \
+     "      background: #ffd76e; color: #000; border: 1px solid #c38a22; padding: 0 2px;"                \
+     "      font: bold 11px monospace; text-transform: uppercase; }';"                                   \
+     "    this.labels = labels.split (' '); this.nodes = []; this.matched = []; this.prefix = '';"       \
+     "    /* fewer labels than elements: the extra ones get no hint */"                                  \
+     "    this.elems = this.elems.slice (0, this.labels.length);"                                        \
+     "    this.rects = this.rects.slice (0, this.labels.length);"                                        \
+     "    this.layer = document.createElement ('div');"                                                  \
+     "    this.layer.id = '__cream_hints';"                                                              \
+     "    this.layer.appendChild (style);"                                                               \
+     "    for (i = 0; i < this.elems.length; ++i) {"                                                     \
+     "      n = document.createElement ('span');"                                                        \
+     "      n.textContent = this.labels[i];"                                                             \
+     "      n.style.left = (this.rects[i].left + sx) + 'px';"                                            \
+     "      n.style.top = (this.rects[i].top + sy) + 'px';"                                              \
+     "      frag.appendChild (n); this.nodes.push (n); this.matched.push (i);"                           \
+     "    }"                                                                                             \
+     "    this.layer.appendChild (frag);"                                                                \
+     "    document.documentElement.appendChild (this.layer);"                                            \
+     "    return this.nodes.length;"                                                                     \
+     "  },"                                                                                              \
+     "  filter: function (prefix) {"                                                                     \
+     "    var from = this.matched, keep = [], i, k;"                                                     \
+     "    if (prefix.indexOf (this.prefix) != 0) {"                                                      \
+     "      from = [];"                                                                                  \
+     "      for (i = 0; i < this.nodes.length; ++i) from.push (i);"                                      \
+     "    }"                                                                                             \
+     "    for (i = 0; i < from.length; ++i) {"                                                           \
+     "      k = from[i];"                                                                                \
+     "      if (this.labels[k].indexOf (prefix) == 0) keep.push (k);"                                    \
+     "      this.nodes[k].style.display = (this.labels[k].indexOf (prefix) == 0 ? '' : 'none');"         \
+     "    }"                                                                                             \
+     "    this.matched = keep; this.prefix = prefix;"                                                    \
+     "    return keep.length;"                                                                           \
+     "  },"                                                                                              \
+     "  follow: function () {"                                                                           \
+     "    var e = this.elems[this.matched[0]], ev, editable;"                                            \
+     "    this.hide ();"                                                                                 \
+     "    if (!e) return false;"                                                                         \
+     "    editable = e.isContentEditable || e.tagName == 'TEXTAREA' || e.tagName == 'SELECT'"            \
+     "               || (e.tagName == 'INPUT' && /^(text|password|search|email|url|tel|number|)$/i.test (e.type));" \
+     "    if (editable) { e.focus (); return true; }"                                                    \
+     "    ev = document.createEvent ('MouseEvents');"                                                    \
+     "    ev.initMouseEvent ('click', true, true, window, 1, 0, 0, 0, 0,"                                \
+     "                       false, false, false, false, 0, null);"                                      \
+     "    e.dispatchEvent (ev);"                                                                         \
+     "    return false;"                                                                                 \
+     "  },"                                                                                              \
+     "  hide: function () {"                                                                             \
+     "    if (this.layer && this.layer.parentNode) this.layer.parentNode.removeChild (this.layer);"      \
+     "    this.layer = null; this.nodes = []; this.matched = [];"                                        \
+     "  }"                                                                                               \
+     "})"
+
+/*!
+ * \struct CreamModuleWebKitHints
+ * Hints object of a webview, protected from the garbage collector.
+ */
+typedef struct
+{
+     JSGlobalContextRef ctx;       /*!< Context the object was created in */
+     JSObjectRef hints;            /*!< Object of #CREAM_MODULE_WEBKIT_HINTS_SCRIPT */
+} CreamModuleWebKitHints;
+
+#define CREAM_MODULE_WEBKIT_HINTS_KEY        "cream-webkit-hints"
+
 /*!
  * @param self The #CreamModuleWebKit structure.
  * Initialize #CreamModuleWebKit.
@@ -49,6 +151,12 @@ static void cream_module_webkit_init (CreamModuleWebKit *self)
      self->wsession  = webkit_get_default_session ();
      self->wsettings = webkit_web_settings_new ();
      self->wfavicons = webkit_get_icon_database ();
+     self->wcookies  = cream_cookie_jar_new ();
+
+     soup_session_add_feature (self->wsession, SOUP_SESSION_FEATURE (self->wcookies));
+     g_signal_connect (G_OBJECT (self->wsession), "request-queued",
+                       G_CALLBACK (cream_module_webkit_request_queued_cb),
+                       self);
 
      g_object_set (G_OBJECT (self->wsettings), "enable-developer-extras", TRUE, NULL);
 
@@ -141,6 +249,38 @@ static gboolean cream_module_webkit_search (CreamModule *self, GtkWidget *webvie
      return webkit_web_view_search_text (WEBKIT_WEB_VIEW (webview), text, FALSE, forward, TRUE);
 }
 
+static gboolean cream_module_webkit_search_incremental (CreamModule *self, GtkWidget *webview, const gchar *text, gboolean forward, gboolean resume)
+{
+     JSContextRef ctx;
+
+     /* WebKit searches after the selection: shrink it to where the current
+      * match starts, or drop it to search from the top (the scripts run in
+      * the page's global scope, they must not declare anything) */
+     if (!resume)
+          cream_module_webkit_eval (webview, "window.getSelection ().removeAllRanges ();", &ctx);
+     else if (forward)
+          cream_module_webkit_eval (webview, "(function (s) { if (s.rangeCount) s.collapseToStart (); }) (window.getSelection ());", &ctx);
+     else
+          cream_module_webkit_eval (webview, "(function (s) { if (s.rangeCount) s.collapseToEnd (); }) (window.getSelection ());", &ctx);
+
+     return webkit_web_view_search_text (WEBKIT_WEB_VIEW (webview), text, FALSE, forward, TRUE);
+}
+
+static guint cream_module_webkit_search_mark (CreamModule *self, GtkWidget *webview, const gchar *text, guint limit)
+{
+     guint n = 0;
+
+     webkit_web_view_unmark_text_matches (WEBKIT_WEB_VIEW (webview));
+
+     if (text != NULL)
+     {
+          n = webkit_web_view_mark_text_matches (WEBKIT_WEB_VIEW (webview), text, FALSE, limit);
+          webkit_web_view_set_highlight_text_matches (WEBKIT_WEB_VIEW (webview), TRUE);
+     }
+
+     return n;
+}
+
 static void cream_module_webkit_proxy (CreamModule *self, const gchar *uri)
 {
      CreamModuleWebKit *mod = CREAM_MODULE_WEBKIT (self);
@@ -165,6 +305,231 @@ static void cream_module_webkit_useragent (CreamModule *self, const gchar *ua)
      g_object_set (G_OBJECT (mod->wsettings), "user-agent", ua, NULL);
 }
 
+static gboolean cream_module_webkit_get_history (CreamModule *self, GtkWidget *webview, GArray *items, guint *current, guint *length)
+{
+     WebKitWebBackForwardList *list = webkit_web_view_get_back_forward_list (WEBKIT_WEB_VIEW (webview));
+     gint back    = webkit_web_back_forward_list_get_back_length (list);
+     gint forward = webkit_web_back_forward_list_get_forward_length (list);
+     gint i;
+
+     /* nothing loaded yet */
+     if (webkit_web_back_forward_list_get_current_item (list) == NULL)
+          return FALSE;
+
+     *current = back;
+     *length  = back + 1 + forward;
+
+     for (i = -back; items != NULL && i <= forward; ++i)
+     {
+          WebKitWebHistoryItem *hitem = webkit_web_back_forward_list_get_nth_item (list, i);
+          CreamModuleHistoryItem item;
+
+          item.uri   = g_strdup (webkit_web_history_item_get_uri (hitem));
+          item.title = g_strdup (webkit_web_history_item_get_title (hitem));
+          g_array_append_val (items, item);
+     }
+
+     return TRUE;
+}
+
+static void cream_module_webkit_set_history (CreamModule *self, GtkWidget *webview, GArray *items, guint current)
+{
+     WebKitWebBackForwardList *list = webkit_web_view_get_back_forward_list (WEBKIT_WEB_VIEW (webview));
+     WebKitWebHistoryItem *load = NULL;
+     guint i;
+
+     webkit_web_back_forward_list_clear (list);
+
+     for (i = 0; i < items->len; ++i)
+     {
+          CreamModuleHistoryItem *item = &g_array_index (items, CreamModuleHistoryItem, i);
+          WebKitWebHistoryItem *hitem = webkit_web_history_item_new_with_data (item->uri, item->title ? item->title : "");
+
+          webkit_web_back_forward_list_add_item (list, hitem);
+
+          if (i == current)
+               load = hitem;
+
+          g_object_unref (hitem);
+     }
+
+     webkit_web_view_go_to_back_forward_item (WEBKIT_WEB_VIEW (webview), load);
+}
+
+/*!
+ * @param webview A \class{WebKitWebView} object.
+ * @param script Script to evaluate.
+ * @param ctx Set to the JavaScript context of the main frame.
+ * @return Result of the script, or \c NULL on exception.
+ *
+ * Run a script in the main frame, and get its result
+ * (webkit_web_view_execute_script() does not return one).
+ */
+static JSValueRef cream_module_webkit_eval (GtkWidget *webview, const gchar *script, JSContextRef *ctx)
+{
+     JSStringRef js = JSStringCreateWithUTF8CString (script);
+     JSValueRef exception = NULL, ret;
+
+     *ctx = webkit_web_frame_get_global_context (webkit_web_view_get_main_frame (WEBKIT_WEB_VIEW (webview)));
+     ret  = JSEvaluateScript (*ctx, js, NULL, NULL, 0, &exception);
+
+     JSStringRelease (js);
+
+     return (exception == NULL ? ret : NULL);
+}
+
+/*!
+ * @param h A #CreamModuleWebKitHints.
+ *
+ * Release a hints object.
+ */
+static void cream_module_webkit_hints_free (CreamModuleWebKitHints *h)
+{
+     JSValueUnprotect (h->ctx, h->hints);
+     JSGlobalContextRelease (h->ctx);
+     g_slice_free (CreamModuleWebKitHints, h);
+}
+
+/*!
+ * @param webview A \class{WebKitWebView} object.
+ * @param method Method of the hints object to call.
+ * @param arg String argument of the method, or \c NULL.
+ * @param ctx Set to the JavaScript context of the hints object.
+ * @return Result of the method, or \c NULL if the hints are not shown,
+ * or on exception.
+ *
+ * Call a method of the hints object of the webview.
+ */
+static JSValueRef cream_module_webkit_hints_call (GtkWidget *webview, const gchar *method, const gchar *arg, JSContextRef *ctx)
+{
+     CreamModuleWebKitHints *h = g_object_get_data (G_OBJECT (webview), CREAM_MODULE_WEBKIT_HINTS_KEY);
+     JSValueRef func, args[1], exception = NULL, ret;
+     JSStringRef js;
+
+     if (h == NULL)
+          return NULL;
+
+     *ctx = h->ctx;
+
+     js   = JSStringCreateWithUTF8CString (method);
+     func = JSObjectGetProperty (h->ctx, h->hints, js, NULL);
+     JSStringRelease (js);
+
+     if (func == NULL || !JSValueIsObject (h->ctx, func) || !JSObjectIsFunction (h->ctx, (JSObjectRef) func))
+          return NULL;
+
+     if (arg != NULL)
+     {
+          js      = JSStringCreateWithUTF8CString (arg);
+          args[0] = JSValueMakeString (h->ctx, js);
+          JSStringRelease (js);
+     }
+
+     ret = JSObjectCallAsFunction (h->ctx, (JSObjectRef) func, h->hints, (arg != NULL ? 1 : 0), args, &exception);
+
+     return (exception == NULL ? ret : NULL);
+}
+
+/*!
+ * @param ctx A JavaScript context.
+ * @param value A value, or \c NULL.
+ * @param max Maximum count.
+ * @return \a value as a count, between 0 and \a max.
+ */
+static guint cream_module_webkit_to_count (JSContextRef ctx, JSValueRef value, guint max)
+{
+     gdouble n;
+
+     if (value == NULL || !JSValueIsNumber (ctx, value))
+          return 0;
+
+     n = JSValueToNumber (ctx, value, NULL);
+
+     /* NaN too */
+     if (!(n > 0))
+          return 0;
+
+     return (n < max ? (guint) n : max);
+}
+
+static guint cream_module_webkit_hints_show (CreamModule *self, GtkWidget *webview, const gchar *alphabet)
+{
+     CreamModuleWebKitHints *h;
+     JSContextRef ctx;
+     JSValueRef ret;
+     JSStringRef js;
+     gchar **labels, *joined;
+     guint n, collected;
+
+     /* hide the previous hints, if any */
+     cream_module_webkit_hints_call (webview, "hide", NULL, &ctx);
+
+     ret = cream_module_webkit_eval (webview, CREAM_MODULE_WEBKIT_HINTS_SCRIPT, &ctx);
+     if (ret == NULL || !JSValueIsObject (ctx, ret))
+          return 0;
+
+     h = g_slice_new (CreamModuleWebKitHints);
+     h->ctx   = JSGlobalContextRetain ((JSGlobalContextRef) ctx);
+     h->hints = (JSObjectRef) ret;
+     JSValueProtect (h->ctx, h->hints);
+
+     g_object_set_data_full (G_OBJECT (webview), CREAM_MODULE_WEBKIT_HINTS_KEY, h, (GDestroyNotify) cream_module_webkit_hints_free);
+
+     ret = cream_module_webkit_hints_call (webview, "collect", NULL, &ctx);
+     n   = cream_module_webkit_to_count (ctx, ret, CREAM_MODULE_WEBKIT_HINTS_MAX);
+
+     /* no more labels than elements collected */
+     js  = JSStringCreateWithUTF8CString ("elems");
+     ret = JSObjectGetProperty (ctx, h->hints, js, NULL);
+     JSStringRelease (js);
+
+     if (ret == NULL || !JSValueIsObject (ctx, ret))
+          return 0;
+
+     js        = JSStringCreateWithUTF8CString ("length");
+     collected = cream_module_webkit_to_count (ctx, JSObjectGetProperty (ctx, (JSObjectRef) ret, js, NULL), CREAM_MODULE_WEBKIT_HINTS_MAX);
+     JSStringRelease (js);
+
+     if ((n = MIN (n, collected)) == 0)
+          return 0;
+
+     /* the alphabet is made of alphanumeric characters (see hints_start ()) */
+     labels = cream_module_hints_labels (n, alphabet);
+     joined = g_strjoinv (" ", labels);
+
+     ret = cream_module_webkit_hints_call (webview, "draw", joined, &ctx);
+     n   = cream_module_webkit_to_count (ctx, ret, n);
+
+     g_strfreev (labels);
+     g_free (joined);
+
+     return n;
+}
+
+static guint cream_module_webkit_hints_filter (CreamModule *self, GtkWidget *webview, const gchar *prefix)
+{
+     JSContextRef ctx;
+     JSValueRef ret = cream_module_webkit_hints_call (webview, "filter", prefix, &ctx);
+
+     return cream_module_webkit_to_count (ctx, ret, CREAM_MODULE_WEBKIT_HINTS_MAX);
+}
+
+static gboolean cream_module_webkit_hints_follow (CreamModule *self, GtkWidget *webview)
+{
+     JSContextRef ctx;
+     JSValueRef ret = cream_module_webkit_hints_call (webview, "follow", NULL, &ctx);
+
+     return (ret != NULL && JSValueToBoolean (ctx, ret));
+}
+
+static void cream_module_webkit_hints_hide (CreamModule *self, GtkWidget *webview)
+{
+     JSContextRef ctx;
+
+     cream_module_webkit_hints_call (webview, "hide", NULL, &ctx);
+     g_object_set_data (G_OBJECT (webview), CREAM_MODULE_WEBKIT_HINTS_KEY, NULL);
+}
+
 /*!
  * \defgroup mod-webkit-signals Signals
  * \ingroup mod-webkit
@@ -298,4 +663,21 @@ static gboolean cream_module_webkit_signal_download_cb (WebKitWebView *webview,
      return ret;
 }
 
+/*!
+ * @param session The \class{SoupSession} of the module.
+ * @param msg The queued \class{SoupMessage}.
+ * @param self A #CreamModuleWebKit object.
+ *
+ * This function handles the signal "request-queued" which is emitted when a
+ * new request is queued on the session.
+ * Load the cookies of the request's domain, before they are sent.
+ */
+static void cream_module_webkit_request_queued_cb (SoupSession *session, SoupMessage *msg, CreamModuleWebKit *self)
+{
+     SoupURI *uri = soup_message_get_uri (msg);
+
+     if (uri != NULL && uri->host != NULL)
+          cream_cookie_jar_load (CREAM_COOKIE_JAR (self->wcookies), uri->host);
+}
+
 /*! @} */
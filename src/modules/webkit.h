@@ -29,10 +29,12 @@
 #include <glib.h>
 
 #include <webkit/webkit.h>
+#include <JavaScriptCore/JavaScript.h>
 #include <libsoup/soup.h>
 
 #include "../modules.h"
 #include "../Statusbar.h"
+#include "cookiejar.h"
 
 /*!
  * \defgroup mod-webkit Module WebKit
@@ -64,6 +66,7 @@ struct _CreamModuleWebKit
      gchar *name;
 
      SoupSession *wsession;
+     SoupCookieJar *wcookies;
      WebKitWebSettings *wsettings;
      WebKitIconDatabase *wfavicons;
 };
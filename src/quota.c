@@ -0,0 +1,590 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+
+#include <sys/stat.h>
+
+/*!
+ * \addtogroup quota
+ * @{
+ */
+
+#define QUOTA_CATEGORIES           (CACHE_TYPE_NONE + 1)
+
+/*!
+ * \struct QuotaEntry
+ * A file which may be evicted.
+ */
+typedef struct
+{
+     gchar *path;
+     time_t mtime;
+     gint64 size;
+} QuotaEntry;
+
+static const gchar *names[QUOTA_CATEGORIES] = { "commands", "history", "session", "cookies", "other" };
+
+static gint64 budgets[QUOTA_CATEGORIES] =
+{
+     QUOTA_BUDGET_COMMANDS,
+     QUOTA_BUDGET_HISTORY,
+     QUOTA_BUDGET_SESSION,
+     QUOTA_BUDGET_COOKIES,
+     QUOTA_BUDGET_NONE
+};
+
+static GStaticMutex lock = G_STATIC_MUTEX_INIT;
+static gint64 usage[QUOTA_CATEGORIES] = { 0 };
+static gboolean dirty = FALSE;
+static gboolean scanned = FALSE;
+static GHashTable *pinned = NULL;
+static gchar *root = NULL;
+
+static GThread *collector = NULL;
+static GAsyncQueue *wakeups = NULL;
+static gboolean wakeup_pending = FALSE;
+
+/* values pushed to the collector */
+#define QUOTA_WAKEUP               GINT_TO_POINTER (1)
+#define QUOTA_QUIT                 GINT_TO_POINTER (2)
+
+/*!
+ * @param path Path to a cache file.
+ * @param type Category of the file.
+ * @return \c FALSE if the file is not in the profile's cache.
+ *
+ * Find the category of a file from the first component of its path,
+ * relative to the profile's cache directory.
+ */
+static gboolean quota_category (const gchar *path, CacheType *type)
+{
+     gsize len = strlen (root);
+     CacheType i;
+
+     if (strncmp (path, root, len) != 0 || path[len] != G_DIR_SEPARATOR)
+          return FALSE;
+
+     path += len + 1;
+     *type = CACHE_TYPE_NONE;
+
+     for (i = 0; i < CACHE_TYPE_NONE; ++i)
+     {
+          gsize n = strlen (names[i]);
+
+          if (strncmp (path, names[i], n) == 0 && (path[n] == '\0' || path[n] == G_DIR_SEPARATOR))
+          {
+               *type = i;
+               break;
+          }
+     }
+
+     return TRUE;
+}
+
+/*!
+ * Wake the collector up, unless it is already.
+ * Must be called with the lock held.
+ */
+static void quota_wakeup (void)
+{
+     if (wakeups != NULL && !wakeup_pending)
+     {
+          wakeup_pending = TRUE;
+          g_async_queue_push (wakeups, QUOTA_WAKEUP);
+     }
+}
+
+/*!
+ * @param path Path to the file.
+ * @param delta Bytes added to the file (negative if removed).
+ *
+ * Account a change of a file's size. Can be called from any thread.
+ */
+void quota_account (const gchar *path, gint64 delta)
+{
+     CacheType type;
+
+     if (delta == 0)
+          return;
+
+     g_static_mutex_lock (&lock);
+
+     /* root is set by quota_init (), after the first writes maybe */
+     if (root == NULL || !quota_category (path, &type))
+     {
+          g_static_mutex_unlock (&lock);
+          return;
+     }
+
+     usage[type] = MAX (usage[type] + delta, 0);
+     dirty = TRUE;
+
+     if (usage[type] > budgets[type])
+          quota_wakeup ();
+
+     g_static_mutex_unlock (&lock);
+}
+
+/*!
+ * @param path Path to the file.
+ *
+ * Protect a file from eviction (because it is kept opened, or mapped).
+ */
+void quota_pin (const gchar *path)
+{
+     g_return_if_fail (path != NULL);
+
+     g_static_mutex_lock (&lock);
+
+     if (pinned == NULL)
+          pinned = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+     g_hash_table_insert (pinned, g_strdup (path), GINT_TO_POINTER (TRUE));
+
+     g_static_mutex_unlock (&lock);
+}
+
+/*!
+ * @param type Category of the cache.
+ * @param bytes New budget, in bytes.
+ *
+ * Change the budget of a category. The collector is woken up if the
+ * category is now over budget.
+ */
+void quota_set_budget (CacheType type, gint64 bytes)
+{
+     g_return_if_fail (type <= CACHE_TYPE_NONE);
+     g_return_if_fail (bytes > 0);
+
+     g_static_mutex_lock (&lock);
+
+     budgets[type] = bytes;
+
+     if (usage[type] > budgets[type])
+          quota_wakeup ();
+
+     g_static_mutex_unlock (&lock);
+}
+
+/*!
+ * @param type Category of the cache.
+ * @param used Bytes used by the category (can be \c NULL).
+ * @param budget Budget of the category (can be \c NULL).
+ */
+void quota_get_usage (CacheType type, gint64 *used, gint64 *budget)
+{
+     g_return_if_fail (type <= CACHE_TYPE_NONE);
+
+     g_static_mutex_lock (&lock);
+
+     if (used)   *used   = usage[type];
+     if (budget) *budget = budgets[type];
+
+     g_static_mutex_unlock (&lock);
+}
+
+/*!
+ * @param type Category of the cache.
+ * @return Name of the category.
+ */
+const gchar *quota_category_name (CacheType type)
+{
+     g_return_val_if_fail (type <= CACHE_TYPE_NONE, NULL);
+     return names[type];
+}
+
+/*!
+ * @param name Name of a category.
+ * @param type Category found.
+ * @return \c FALSE if \a name is not a category.
+ */
+gboolean quota_category_from_name (const gchar *name, CacheType *type)
+{
+     CacheType i;
+
+     g_return_val_if_fail (name != NULL, FALSE);
+
+     for (i = 0; i <= CACHE_TYPE_NONE; ++i)
+     {
+          if (g_str_equal (name, names[i]))
+          {
+               *type = i;
+               return TRUE;
+          }
+     }
+
+     return FALSE;
+}
+
+/*!
+ * @return \c TRUE if the usage file was found.
+ *
+ * Load the usage saved by the previous run, lines of the form
+ * <code>category bytes</code>.
+ */
+static gboolean quota_load (void)
+{
+     gchar *path = cache_path (CACHE_TYPE_NONE, "quota");
+     gchar *content = NULL;
+     gchar **lines;
+     gint i;
+
+     if (!g_file_get_contents (path, &content, NULL, NULL))
+     {
+          g_free (path);
+          return FALSE;
+     }
+
+     lines = g_strsplit (content, "\n", -1);
+
+     for (i = 0; lines[i] != NULL; ++i)
+     {
+          gchar **fields = g_strsplit (lines[i], " ", 2);
+          CacheType type;
+
+          if (g_strv_length (fields) == 2 && quota_category_from_name (fields[0], &type))
+               usage[type] = MAX (g_ascii_strtoll (fields[1], NULL, 10), 0);
+
+          g_strfreev (fields);
+     }
+
+     g_strfreev (lines);
+     g_free (content);
+     g_free (path);
+
+     return TRUE;
+}
+
+/*!
+ * Save the usage of each category, if it changed since the last save.
+ */
+void quota_save (void)
+{
+     GString *content;
+     gchar *path;
+     CacheType i;
+
+     g_static_mutex_lock (&lock);
+
+     if (root == NULL || !dirty)
+     {
+          g_static_mutex_unlock (&lock);
+          return;
+     }
+
+     content = g_string_new (NULL);
+
+     for (i = 0; i <= CACHE_TYPE_NONE; ++i)
+          g_string_append_printf (content, "%s %" G_GINT64_FORMAT "\n", names[i], usage[i]);
+
+     dirty = FALSE;
+     g_static_mutex_unlock (&lock);
+
+     path = cache_path (CACHE_TYPE_NONE, "quota");
+     g_mkdir_with_parents (root, 0700);
+
+     if (!g_file_set_contents (path, content->str, content->len, NULL))
+     {
+          /* try again next time */
+          g_static_mutex_lock (&lock);
+          dirty = TRUE;
+          g_static_mutex_unlock (&lock);
+     }
+
+     g_free (path);
+     g_string_free (content, TRUE);
+}
+
+/*!
+ * @param path Directory to walk.
+ * @param sizes Bytes found in each category.
+ *
+ * Sum the size of every file under a directory.
+ */
+static void quota_scan_dir (const gchar *path, gint64 *sizes)
+{
+     GDir *dir = g_dir_open (path, 0, NULL);
+     const gchar *name;
+
+     if (dir == NULL)
+          return;
+
+     while ((name = g_dir_read_name (dir)) != NULL)
+     {
+          gchar *file = g_build_filename (path, name, NULL);
+          struct stat st;
+          CacheType type;
+
+          if (lstat (file, &st) == 0)
+          {
+               if (S_ISDIR (st.st_mode))
+                    quota_scan_dir (file, sizes);
+               else if (S_ISREG (st.st_mode) && quota_category (file, &type))
+                    sizes[type] += st.st_size;
+          }
+
+          g_free (file);
+     }
+
+     g_dir_close (dir);
+}
+
+/*!
+ * Walk the profile's cache to find the usage of each category.
+ * Only done when the usage file is missing.
+ */
+static void quota_scan (void)
+{
+     gint64 sizes[QUOTA_CATEGORIES] = { 0 };
+     CacheType i;
+
+     quota_scan_dir (root, sizes);
+
+     g_static_mutex_lock (&lock);
+
+     for (i = 0; i <= CACHE_TYPE_NONE; ++i)
+          usage[i] = sizes[i];
+
+     dirty = TRUE;
+     g_static_mutex_unlock (&lock);
+}
+
+/*!
+ * @param path Path to the file.
+ * @return \c TRUE if the file must not be evicted.
+ */
+static gboolean quota_is_pinned (const gchar *path)
+{
+     gboolean ret;
+
+     g_static_mutex_lock (&lock);
+     ret = (pinned != NULL && g_hash_table_lookup (pinned, path) != NULL);
+     g_static_mutex_unlock (&lock);
+
+     return ret;
+}
+
+static gint quota_entry_cmp (gconstpointer a, gconstpointer b)
+{
+     const QuotaEntry *ea = a, *eb = b;
+
+     if (ea->mtime != eb->mtime)
+          return (ea->mtime < eb->mtime ? -1 : 1);
+
+     return strcmp (ea->path, eb->path);
+}
+
+/*!
+ * @param path Directory to walk.
+ * @param type Category to evict.
+ * @param entries Array of #QuotaEntry to fill.
+ *
+ * List the files of a category which are not pinned.
+ */
+static void quota_list_dir (const gchar *path, CacheType type, GArray *entries)
+{
+     GDir *dir = g_dir_open (path, 0, NULL);
+     const gchar *name;
+
+     if (dir == NULL)
+          return;
+
+     while ((name = g_dir_read_name (dir)) != NULL)
+     {
+          gchar *file = g_build_filename (path, name, NULL);
+          CacheType ftype;
+          struct stat st;
+
+          if (lstat (file, &st) != 0 || !quota_category (file, &ftype) || ftype != type)
+          {
+               g_free (file);
+               continue;
+          }
+
+          if (S_ISDIR (st.st_mode))
+          {
+               /* other categories are sub-directories of the root */
+               if (type != CACHE_TYPE_NONE)
+                    quota_list_dir (file, type, entries);
+               g_free (file);
+          }
+          else if (S_ISREG (st.st_mode) && !quota_is_pinned (file))
+          {
+               QuotaEntry e = { file, st.st_mtime, st.st_size };
+               g_array_append_val (entries, e);
+          }
+          else
+               g_free (file);
+     }
+
+     g_dir_close (dir);
+}
+
+/*!
+ * @param type Category over budget.
+ *
+ * Remove the oldest files of a category, until its usage is below
+ * #QUOTA_LOW_WATER percent of its budget. The files are removed by the
+ * cache's writer, after the writes already queued.
+ */
+static void quota_evict (CacheType type)
+{
+     GArray *entries = g_array_new (FALSE, FALSE, sizeof (QuotaEntry));
+     gint64 excess;
+     gchar *path;
+     guint i;
+
+     g_static_mutex_lock (&lock);
+     excess = usage[type] - budgets[type] / 100 * QUOTA_LOW_WATER;
+     g_static_mutex_unlock (&lock);
+
+     path = (type == CACHE_TYPE_NONE ? g_strdup (root) : g_build_filename (root, names[type], NULL));
+     quota_list_dir (path, type, entries);
+
+     g_array_sort (entries, quota_entry_cmp);
+
+     for (i = 0; i < entries->len; ++i)
+     {
+          QuotaEntry *e = &g_array_index (entries, QuotaEntry, i);
+
+          if (excess > 0)
+          {
+               cache_unlink (e->path);
+               excess -= e->size;
+          }
+
+          g_free (e->path);
+     }
+
+     g_array_free (entries, TRUE);
+     g_free (path);
+}
+
+/*!
+ * @param data Unused.
+ * @return \c NULL
+ *
+ * Collector thread: check the usage every #QUOTA_CHECK_DELAY seconds,
+ * or when a category goes over its budget.
+ */
+static gpointer quota_collector (gpointer data)
+{
+     while (TRUE)
+     {
+          gpointer msg;
+          GTimeVal timeout;
+          CacheType i;
+
+          if (!scanned)
+          {
+               quota_scan ();
+               scanned = TRUE;
+          }
+
+          for (i = 0; i <= CACHE_TYPE_NONE; ++i)
+          {
+               gint64 used, budget;
+
+               quota_get_usage (i, &used, &budget);
+
+               if (used > budget)
+                    quota_evict (i);
+          }
+
+          quota_save ();
+
+          g_get_current_time (&timeout);
+          g_time_val_add (&timeout, QUOTA_CHECK_DELAY * G_USEC_PER_SEC);
+
+          msg = g_async_queue_timed_pop (wakeups, &timeout);
+
+          if (msg == QUOTA_QUIT)
+               break;
+
+          g_static_mutex_lock (&lock);
+          wakeup_pending = FALSE;
+          g_static_mutex_unlock (&lock);
+     }
+
+     return NULL;
+}
+
+/*!
+ * Load the saved usage and start the collector.
+ */
+void quota_init (void)
+{
+     GError *error = NULL;
+     gchar *path;
+
+     if (root != NULL)
+          return;
+
+     /* the writes are not accounted yet */
+     scanned = quota_load ();
+
+     path = cache_path (CACHE_TYPE_NONE, "quota");
+     quota_pin (path);
+     g_free (path);
+
+     path = cache_path (CACHE_TYPE_NONE, NULL);
+
+     g_static_mutex_lock (&lock);
+     root = path;
+     wakeups = g_async_queue_new ();
+     g_static_mutex_unlock (&lock);
+
+     if ((collector = g_thread_create_full (quota_collector, NULL, 0, TRUE, FALSE, G_THREAD_PRIORITY_LOW, &error)) == NULL)
+     {
+          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+
+          g_static_mutex_lock (&lock);
+          g_async_queue_unref (wakeups);
+          wakeups = NULL;
+          g_static_mutex_unlock (&lock);
+     }
+}
+
+/*!
+ * Stop the collector. Must be called before cache_close(), which saves
+ * the usage once the last writes are done.
+ */
+void quota_close (void)
+{
+     if (collector == NULL)
+          return;
+
+     g_async_queue_push (wakeups, QUOTA_QUIT);
+     g_thread_join (collector);
+     collector = NULL;
+
+     g_static_mutex_lock (&lock);
+     g_async_queue_unref (wakeups);
+     wakeups = NULL;
+     g_static_mutex_unlock (&lock);
+}
+
+/*! @} */
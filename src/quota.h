@@ -0,0 +1,73 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __QUOTA_H
+#define __QUOTA_H
+
+/*!
+ * \defgroup quota Quota
+ * \ingroup cache
+ * Byte budgets of the cache categories.
+ *
+ * The usage of each category is accounted when files are written (by
+ * the cache's writer, or by the history store), and saved in the
+ * <code>quota</code> file of the profile: directories are only walked
+ * once, when this file is missing.
+ *
+ * When a category goes over its budget, a low-priority thread removes
+ * its oldest files (by modification time) until it is back under
+ * #QUOTA_LOW_WATER percent of the budget. Files in use can not be
+ * removed (see quota_pin()).
+ *
+ * @{
+ */
+
+#include <glib.h>
+#include "cache.h"
+
+#define QUOTA_BUDGET_COMMANDS      (1 << 20)           /*!< Default budget of #CACHE_TYPE_COMMANDS */
+#define QUOTA_BUDGET_HISTORY       (512 << 20)         /*!< Default budget of #CACHE_TYPE_HISTORY */
+#define QUOTA_BUDGET_SESSION       (8 << 20)           /*!< Default budget of #CACHE_TYPE_SESSION */
+#define QUOTA_BUDGET_COOKIES       (32 << 20)          /*!< Default budget of #CACHE_TYPE_COOKIES */
+#define QUOTA_BUDGET_NONE          (64 << 20)          /*!< Default budget of #CACHE_TYPE_NONE */
+
+#define QUOTA_LOW_WATER            90                  /*!< Usage to reach when evicting, in percent of the budget */
+#define QUOTA_CHECK_DELAY          60                  /*!< Seconds between two checks of the usage */
+
+void quota_init (void);
+void quota_close (void);
+void quota_save (void);
+
+void quota_account (const gchar *path, gint64 delta);
+void quota_pin (const gchar *path);
+
+void quota_set_budget (CacheType type, gint64 bytes);
+void quota_get_usage (CacheType type, gint64 *used, gint64 *budget);
+const gchar *quota_category_name (CacheType type);
+gboolean quota_category_from_name (const gchar *name, CacheType *type);
+
+/*! @} */
+
+#endif /* __QUOTA_H */
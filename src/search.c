@@ -0,0 +1,864 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+
+/*!
+ * \addtogroup search
+ * @{
+ */
+
+#define SEARCH_MAGIC               0x58444943     /* "CIDX" */
+#define SEARCH_VERSION             1
+#define SEARCH_JOURNAL_HEADER      "#search "     /*!< First line of the journal, followed by its generation */
+
+/*!
+ * \struct SearchDoc
+ * A document: a journal line, <code>URI\\ttitle</code>.
+ */
+typedef struct
+{
+     const gchar *str;             /*!< Line (not nul-terminated) */
+     gsize len;                    /*!< Length of the line */
+     gsize urilen;                 /*!< Length of the URI */
+} SearchDoc;
+
+/*!
+ * \struct SearchList
+ * Sorted documents identifiers of a trigram, read in place from the
+ * saved index until documents are added to it.
+ */
+typedef struct
+{
+     guint32 *ids;                 /*!< Identifiers */
+     guint32 len;                  /*!< Number of identifiers */
+     guint32 size;                 /*!< Allocated identifiers, 0 if \a ids points to the saved index */
+} SearchList;
+
+struct _SearchIndex
+{
+     gchar *path;                  /*!< Path to the journal */
+     gchar *idxpath;               /*!< Path to the saved index */
+     gboolean loaded;              /*!< \c TRUE once the journal was read */
+     gboolean broken;              /*!< \c TRUE if the journal could not be read */
+     guint32 generation;           /*!< Generation of the journal, changed on compaction */
+
+     CacheReader *journal;         /*!< Mapped journal */
+     GStringChunk *chunk;          /*!< Documents added since startup */
+     GArray *docs;                 /*!< Documents (#SearchDoc), by identifier */
+
+     guint32 *slots;               /*!< Latest document of each URI (identifier + 1), by URI's hash */
+     guint nslots;
+     guint nlive;                  /*!< Number of URIs */
+
+     GHashTable *postings;         /*!< Lists of documents (#SearchList), by trigram */
+     GMappedFile *index;           /*!< Mapped saved index */
+     guint indexed;                /*!< Documents in the saved index */
+};
+
+static void search_list_free (SearchList *list)
+{
+     if (list->size != 0)
+          g_free (list->ids);
+
+     g_slice_free (SearchList, list);
+}
+
+/*!
+ * @param list A #SearchList.
+ * @param id A document, more recent than the ones of the list.
+ *
+ * Add a document to a list, copying it out of the saved index first.
+ */
+static void search_list_append (SearchList *list, guint32 id)
+{
+     if (list->len == list->size || list->size == 0)
+     {
+          guint32 size = MAX (list->len * 2, 4);
+          guint32 *ids = g_new (guint32, size);
+
+          if (list->len != 0)
+               memcpy (ids, list->ids, list->len * sizeof (guint32));
+
+          if (list->size != 0)
+               g_free (list->ids);
+
+          list->ids  = ids;
+          list->size = size;
+     }
+
+     list->ids[list->len++] = id;
+}
+
+/*!
+ * @return A new #SearchIndex, read on first use.
+ */
+SearchIndex *search_open (void)
+{
+     SearchIndex *s = g_new0 (SearchIndex, 1);
+
+     s->path     = cache_path (CACHE_TYPE_HISTORY, "search");
+     s->idxpath  = cache_path (CACHE_TYPE_HISTORY, "search.idx");
+     quota_pin (s->path);
+     s->chunk    = g_string_chunk_new (4096);
+     s->docs     = g_array_new (FALSE, FALSE, sizeof (SearchDoc));
+     s->postings = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) search_list_free);
+
+     return s;
+}
+
+/* Documents */
+
+static guint32 search_hash (const gchar *str, gsize len)
+{
+     guint32 h = 2166136261u;
+     gsize i;
+
+     for (i = 0; i < len; ++i)
+     {
+          h ^= (guchar) str[i];
+          h *= 16777619u;
+     }
+
+     return h;
+}
+
+#define SEARCH_DOC(s,id)      (&g_array_index ((s)->docs, SearchDoc, (id)))
+
+/*!
+ * @param s A #SearchIndex.
+ * @param uri An URI (not nul-terminated).
+ * @param len Length of the URI.
+ * @return The slot of the URI, empty if it is unknown.
+ */
+static guint search_slot (SearchIndex *s, const gchar *uri, gsize len)
+{
+     guint i = search_hash (uri, len) & (s->nslots - 1);
+
+     while (s->slots[i] != 0)
+     {
+          SearchDoc *d = SEARCH_DOC (s, s->slots[i] - 1);
+
+          if (d->urilen == len && memcmp (d->str, uri, len) == 0)
+               break;
+
+          i = (i + 1) & (s->nslots - 1);
+     }
+
+     return i;
+}
+
+/*!
+ * @param s A #SearchIndex.
+ * @param id A document.
+ *
+ * Set a document as the latest one of its URI.
+ */
+static void search_set_latest (SearchIndex *s, guint32 id)
+{
+     SearchDoc *d = SEARCH_DOC (s, id);
+     guint i;
+
+     /* keep the table half empty */
+     if ((s->nlive + 1) * 2 > s->nslots)
+     {
+          guint32 *old = s->slots;
+          guint j, n = s->nslots;
+
+          s->nslots = (n ? n * 2 : 1024);
+          s->slots  = g_new0 (guint32, s->nslots);
+
+          for (j = 0; j < n; ++j)
+          {
+               if (old[j] != 0)
+               {
+                    SearchDoc *o = SEARCH_DOC (s, old[j] - 1);
+                    s->slots[search_slot (s, o->str, o->urilen)] = old[j];
+               }
+          }
+
+          g_free (old);
+     }
+
+     i = search_slot (s, d->str, d->urilen);
+
+     if (s->slots[i] == 0)
+          s->nlive++;
+
+     s->slots[i] = id + 1;
+}
+
+static gboolean search_is_live (SearchIndex *s, guint32 id)
+{
+     SearchDoc *d = SEARCH_DOC (s, id);
+     return s->slots[search_slot (s, d->str, d->urilen)] == id + 1;
+}
+
+/* Trigrams */
+
+static gint search_compare_id (gconstpointer a, gconstpointer b)
+{
+     guint32 ia = *(const guint32 *) a, ib = *(const guint32 *) b;
+     return (ia < ib ? -1 : (ia > ib ? 1 : 0));
+}
+
+/*!
+ * @param str A text.
+ * @param len Length of the text.
+ * @param trigrams Array filled with the sorted trigrams of the text.
+ *
+ * Get the distinct trigrams of a text, in lower case. Trigrams
+ * containing blanks are skipped, as words never contain any.
+ */
+static void search_trigrams (const gchar *str, gsize len, GArray *trigrams)
+{
+     guint32 *t;
+     gsize i, j;
+
+     g_array_set_size (trigrams, 0);
+
+     for (i = 0; i + 3 <= len; ++i)
+     {
+          guchar a = g_ascii_tolower (str[i]);
+          guchar b = g_ascii_tolower (str[i + 1]);
+          guchar c = g_ascii_tolower (str[i + 2]);
+          guint32 tri;
+
+          if (g_ascii_isspace (a) || g_ascii_isspace (b) || g_ascii_isspace (c))
+               continue;
+
+          tri = (a << 16) | (b << 8) | c;
+          g_array_append_val (trigrams, tri);
+     }
+
+     if (trigrams->len == 0)
+          return;
+
+     g_array_sort (trigrams, search_compare_id);
+
+     t = (guint32 *) trigrams->data;
+     for (i = 1, j = 1; i < trigrams->len; ++i)
+     {
+          if (t[i] != t[j - 1])
+               t[j++] = t[i];
+     }
+
+     g_array_set_size (trigrams, j);
+}
+
+/*!
+ * @param s A #SearchIndex.
+ * @param id A document, more recent than all the indexed ones.
+ * @param trigrams A temporary array.
+ *
+ * Add a document to the lists of its trigrams.
+ */
+static void search_index_doc (SearchIndex *s, guint32 id, GArray *trigrams)
+{
+     SearchDoc *d = SEARCH_DOC (s, id);
+     guint i;
+
+     search_trigrams (d->str, d->len, trigrams);
+
+     for (i = 0; i < trigrams->len; ++i)
+     {
+          gpointer key = GUINT_TO_POINTER (g_array_index (trigrams, guint32, i));
+          SearchList *list = g_hash_table_lookup (s->postings, key);
+
+          if (list == NULL)
+          {
+               list = g_slice_new0 (SearchList);
+               g_hash_table_insert (s->postings, key, list);
+          }
+
+          search_list_append (list, id);
+     }
+}
+
+/* Persistence */
+
+/*!
+ * @param s A #SearchIndex.
+ *
+ * Read the saved index, if it matches the journal. The file is mapped
+ * privately and the lists point into it, so nothing is copied before a
+ * document is added to them (compaction rewrites them in place).
+ */
+static void search_load_index (SearchIndex *s)
+{
+     GMappedFile *file = g_mapped_file_new (s->idxpath, TRUE, NULL);
+     guint32 *p, *end;
+     guint32 i, n, indexed;
+
+     if (file == NULL)
+          return;
+
+     p   = (guint32 *) g_mapped_file_get_contents (file);
+     end = p + g_mapped_file_get_length (file) / sizeof (guint32);
+
+     if (end - p < 5 || p[0] != SEARCH_MAGIC || p[1] != SEARCH_VERSION || p[2] != s->generation || p[3] > s->docs->len)
+     {
+          g_mapped_file_unref (file);
+          return;
+     }
+
+     indexed = p[3];
+     n = p[4];
+     p += 5;
+
+     for (i = 0; i < n; ++i)
+     {
+          SearchList *list;
+
+          /* truncated or corrupted */
+          if (end - p < 2 || (guint32) (end - p - 2) < p[1] || p[1] == 0 || p[2 + p[1] - 1] >= indexed)
+          {
+               g_hash_table_remove_all (s->postings);
+               g_mapped_file_unref (file);
+               return;
+          }
+
+          list = g_slice_new0 (SearchList);
+          list->ids = p + 2;
+          list->len = p[1];
+          g_hash_table_insert (s->postings, GUINT_TO_POINTER (p[0]), list);
+
+          p += 2 + p[1];
+     }
+
+     s->indexed = indexed;
+     s->index   = file;
+}
+
+/*!
+ * @param s A #SearchIndex.
+ *
+ * Read the journal and the saved index, then index the documents
+ * added since the index was saved.
+ */
+static void search_load (SearchIndex *s)
+{
+     GError *error = NULL;
+     GArray *trigrams;
+     SearchDoc doc;
+     const gchar *record;
+     gsize len;
+     guint32 i;
+
+     if (s->loaded)
+          return;
+
+     s->loaded = TRUE;
+
+     if ((s->journal = cache_reader_new (s->path, &error)) == NULL)
+     {
+          CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
+          s->broken = TRUE;
+          return;
+     }
+
+     if (!cache_reader_next (s->journal, &record, &len)
+         || len <= strlen (SEARCH_JOURNAL_HEADER)
+         || strncmp (record, SEARCH_JOURNAL_HEADER, strlen (SEARCH_JOURNAL_HEADER)) != 0)
+     {
+          /* new (or unreadable) journal */
+          GString *data = g_string_new (NULL);
+
+          s->generation = g_random_int ();
+          g_string_printf (data, SEARCH_JOURNAL_HEADER "%u\r\n", s->generation);
+          cache_rewrite (s->path, data);
+          return;
+     }
+
+     s->generation = g_ascii_strtoull (record + strlen (SEARCH_JOURNAL_HEADER), NULL, 10);
+
+     while (cache_reader_next (s->journal, &record, &len))
+     {
+          const gchar *tab = memchr (record, '\t', len);
+
+          doc.str    = record;
+          doc.len    = len;
+          doc.urilen = (tab ? tab - record : len);
+          g_array_append_val (s->docs, doc);
+     }
+
+     search_load_index (s);
+
+     trigrams = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+     for (i = s->indexed; i < s->docs->len; ++i)
+          search_index_doc (s, i, trigrams);
+
+     g_array_free (trigrams, TRUE);
+
+     for (i = 0; i < s->docs->len; ++i)
+          search_set_latest (s, i);
+}
+
+/*!
+ * @param s A #SearchIndex.
+ *
+ * Save the lists of trigrams. The file is written by the cache's
+ * writer thread.
+ */
+static void search_save (SearchIndex *s)
+{
+     GHashTableIter iter;
+     gpointer key, value;
+     GString *data = g_string_new (NULL);
+     guint32 header[5];
+
+     header[0] = SEARCH_MAGIC;
+     header[1] = SEARCH_VERSION;
+     header[2] = s->generation;
+     header[3] = s->docs->len;
+     header[4] = g_hash_table_size (s->postings);
+     g_string_append_len (data, (const gchar *) header, sizeof (header));
+
+     g_hash_table_iter_init (&iter, s->postings);
+     while (g_hash_table_iter_next (&iter, &key, &value))
+     {
+          SearchList *list = value;
+          guint32 entry[2];
+
+          entry[0] = GPOINTER_TO_UINT (key);
+          entry[1] = list->len;
+
+          g_string_append_len (data, (const gchar *) entry, sizeof (entry));
+          g_string_append_len (data, (const gchar *) list->ids, list->len * sizeof (guint32));
+     }
+
+     cache_rewrite (s->idxpath, data);
+}
+
+/*!
+ * @param s A #SearchIndex.
+ *
+ * Drop the replaced documents from the journal and from the lists of
+ * trigrams. The journal gets a new generation, so an index saved
+ * before is not used with it.
+ */
+static void search_compact (SearchIndex *s)
+{
+     GArray *docs = g_array_sized_new (FALSE, FALSE, sizeof (SearchDoc), s->nlive);
+     guint32 *map = g_new (guint32, s->docs->len);
+     GString *data = g_string_new (NULL);
+     GHashTableIter iter;
+     gpointer value;
+     guint32 i, j, k;
+
+     s->generation++;
+     g_string_printf (data, SEARCH_JOURNAL_HEADER "%u\r\n", s->generation);
+
+     for (i = 0; i < s->docs->len; ++i)
+     {
+          SearchDoc *d = SEARCH_DOC (s, i);
+
+          if (!search_is_live (s, i))
+          {
+               map[i] = G_MAXUINT32;
+               continue;
+          }
+
+          map[i] = docs->len;
+          g_array_append_val (docs, *d);
+
+          g_string_append_len (data, d->str, d->len);
+          g_string_append (data, "\r\n");
+     }
+
+     /* identifiers keep their order */
+     g_hash_table_iter_init (&iter, s->postings);
+     while (g_hash_table_iter_next (&iter, NULL, &value))
+     {
+          SearchList *list = value;
+          guint32 *ids = list->ids;
+
+          for (j = 0, k = 0; j < list->len; ++j)
+          {
+               if (map[ids[j]] != G_MAXUINT32)
+                    ids[k++] = map[ids[j]];
+          }
+
+          if (k == 0)
+               g_hash_table_iter_remove (&iter);
+          else
+               list->len = k;
+     }
+
+     cache_rewrite (s->path, data);
+
+     g_array_free (s->docs, TRUE);
+     s->docs = docs;
+
+     /* every document is the latest of its URI */
+     memset (s->slots, 0, s->nslots * sizeof (guint32));
+     s->nlive = 0;
+
+     for (i = 0; i < s->docs->len; ++i)
+          search_set_latest (s, i);
+
+     g_free (map);
+}
+
+/*!
+ * @param s A #SearchIndex.
+ *
+ * Save the index if needed, and free it.
+ */
+void search_close (SearchIndex *s)
+{
+     g_return_if_fail (s != NULL);
+
+     if (s->loaded && !s->broken)
+     {
+          if (s->docs->len - s->nlive > s->nlive + SEARCH_SNAPSHOT_SLACK)
+          {
+               search_compact (s);
+               search_save (s);
+          }
+          else if (s->docs->len >= s->indexed + SEARCH_SNAPSHOT_SLACK)
+               search_save (s);
+     }
+
+     g_hash_table_destroy (s->postings);
+     g_array_free (s->docs, TRUE);
+
+     if (s->index != NULL)
+          g_mapped_file_unref (s->index);
+     g_string_chunk_free (s->chunk);
+     g_free (s->slots);
+
+     if (s->journal != NULL)
+          cache_reader_unref (s->journal);
+
+     g_free (s->path);
+     g_free (s->idxpath);
+     g_free (s);
+}
+
+/*!
+ * @param s A #SearchIndex.
+ * @param uri Page's URI.
+ * @param title Page's title (may be \c NULL).
+ *
+ * Index a page. Nothing is done if its latest document has the same title.
+ */
+void search_add (SearchIndex *s, const gchar *uri, const gchar *title)
+{
+     GArray *trigrams;
+     SearchDoc doc;
+     gchar *record;
+     gsize len;
+
+     g_return_if_fail (s != NULL);
+     g_return_if_fail (uri != NULL);
+
+     /* can not be journaled */
+     if (*uri == '\0' || strpbrk (uri, "\t\r\n") != NULL)
+          return;
+
+     search_load (s);
+
+     if (s->broken)
+          return;
+
+     len    = strlen (uri);
+     record = g_strconcat (uri, "\t", title ? title : "", NULL);
+     g_strdelimit (record + len + 1, "\t\r\n", ' ');
+
+     if (s->nslots > 0)
+     {
+          guint32 latest = s->slots[search_slot (s, uri, len)];
+
+          if (latest != 0)
+          {
+               SearchDoc *d = SEARCH_DOC (s, latest - 1);
+
+               if (d->len == strlen (record) && memcmp (d->str, record, d->len) == 0)
+               {
+                    g_free (record);
+                    return;
+               }
+          }
+     }
+
+     doc.str    = g_string_chunk_insert (s->chunk, record);
+     doc.len    = strlen (record);
+     doc.urilen = len;
+     g_array_append_val (s->docs, doc);
+
+     trigrams = g_array_new (FALSE, FALSE, sizeof (guint32));
+     search_index_doc (s, s->docs->len - 1, trigrams);
+     g_array_free (trigrams, TRUE);
+
+     search_set_latest (s, s->docs->len - 1);
+
+     cache_appendto (s->path, record);
+     g_free (record);
+}
+
+/* Queries */
+
+/*!
+ * @param candidates Sorted identifiers, filtered in place.
+ * @param list A #SearchList.
+ *
+ * Keep the candidates found in \a list. The list is searched by
+ * galloping, as it is usually much longer than the candidates.
+ */
+static void search_intersect (GArray *candidates, SearchList *list)
+{
+     guint32 *a = (guint32 *) candidates->data;
+     guint32 *b = list->ids;
+     guint i, j = 0, k = 0;
+
+     for (i = 0; i < candidates->len && j < list->len; ++i)
+     {
+          if (b[j] < a[i])
+          {
+               guint lo = j, hi, step = 1;
+
+               /* b[lo] < a[i] <= b[hi] */
+               while (lo + step < list->len && b[lo + step] < a[i])
+               {
+                    lo += step;
+                    step <<= 1;
+               }
+
+               hi = MIN (lo + step, list->len);
+
+               while (lo + 1 < hi)
+               {
+                    guint mid = lo + (hi - lo) / 2;
+
+                    if (b[mid] < a[i])
+                         lo = mid;
+                    else
+                         hi = mid;
+               }
+
+               j = hi;
+          }
+
+          if (j < list->len && b[j] == a[i])
+               a[k++] = a[i];
+     }
+
+     g_array_set_size (candidates, k);
+}
+
+static gint search_compare_lists (gconstpointer a, gconstpointer b)
+{
+     guint la = (*(SearchList **) a)->len, lb = (*(SearchList **) b)->len;
+     return (la < lb ? -1 : (la > lb ? 1 : 0));
+}
+
+/*!
+ * @param text A text (not nul-terminated).
+ * @param len Length of the text.
+ * @param word A word, in lower case.
+ * @param wlen Length of the word.
+ * @return \c TRUE if \a text contains \a word, ignoring case.
+ */
+static gboolean search_contains (const gchar *text, gsize len, const gchar *word, gsize wlen)
+{
+     gsize i;
+
+     for (i = 0; i + wlen <= len; ++i)
+     {
+          if (g_ascii_tolower (text[i]) == word[0] && g_ascii_strncasecmp (text + i, word, wlen) == 0)
+               return TRUE;
+     }
+
+     return FALSE;
+}
+
+/*!
+ * @param d A #SearchDoc.
+ * @param words Words to find, in lower case.
+ * @return Number of words found in the title, counted twice, and in
+ * the URI, or 0 if a word is missing.
+ *
+ * The document is compared in place, nothing is allocated.
+ */
+static guint search_match (SearchDoc *d, gchar **words)
+{
+     const gchar *title = d->str + d->urilen;
+     gsize titlelen = d->len - d->urilen;
+     guint i, score = 0;
+
+     for (i = 0; words[i] != NULL; ++i)
+     {
+          gsize wlen = strlen (words[i]);
+
+          if (search_contains (title, titlelen, words[i], wlen))
+               score += 2;
+          else if (search_contains (d->str, d->urilen, words[i], wlen))
+               score += 1;
+          else
+               return 0;
+     }
+
+     return score;
+}
+
+/*!
+ * @param s A #SearchIndex.
+ * @param query Words to find (case insensitive), separated by blanks.
+ * @param n Maximum number of results.
+ * @param results Array of at least \a n results to fill, best first
+ * (must be cleared with search_results_clear()).
+ * @return Number of results.
+ *
+ * Find the pages containing all the words of a query, in their title or
+ * their URI. Documents are looked up by the words of at least
+ * #SEARCH_MIN_WORD characters, shorter ones only filter them: a query
+ * without such a word finds nothing rather than reading every document.
+ * The candidates are checked from the most recent one, until \a n
+ * results are found, then these results are ranked.
+ */
+guint search_query (SearchIndex *s, const gchar *query, guint n, SearchResult *results)
+{
+     GPtrArray *lists = g_ptr_array_new ();
+     GArray *trigrams = g_array_new (FALSE, FALSE, sizeof (guint32));
+     GArray *candidates = NULL;
+     SearchList *first;
+     gchar *lower, **words;
+     guint32 k;
+     guint i, j, ret = 0;
+
+     g_return_val_if_fail (s != NULL, 0);
+     g_return_val_if_fail (query != NULL, 0);
+
+     search_load (s);
+
+     lower = g_ascii_strdown (query, -1);
+     words = g_strsplit_set (g_strstrip (lower), " \t", -1);
+
+     /* drop empty words */
+     for (i = 0, j = 0; words[i] != NULL; ++i)
+     {
+          if (*words[i] != '\0')
+               words[j++] = words[i];
+          else
+               g_free (words[i]);
+     }
+
+     words[j] = NULL;
+
+     if (j == 0 || n == 0)
+          goto out;
+
+     /* lists of the words' trigrams, a missing one means no result */
+     for (i = 0; words[i] != NULL; ++i)
+     {
+          search_trigrams (words[i], strlen (words[i]), trigrams);
+
+          for (j = 0; j < trigrams->len; ++j)
+          {
+               SearchList *list = g_hash_table_lookup (s->postings, GUINT_TO_POINTER (g_array_index (trigrams, guint32, j)));
+
+               if (list == NULL)
+                    goto out;
+
+               g_ptr_array_add (lists, list);
+          }
+     }
+
+     /* only words shorter than a trigram */
+     if (lists->len == 0)
+          goto out;
+
+     g_ptr_array_sort (lists, search_compare_lists);
+     first = g_ptr_array_index (lists, 0);
+
+     candidates = g_array_sized_new (FALSE, FALSE, sizeof (guint32), first->len);
+     g_array_append_vals (candidates, first->ids, first->len);
+
+     for (i = 1; i < lists->len && candidates->len > 0; ++i)
+          search_intersect (candidates, g_ptr_array_index (lists, i));
+
+     /* check and rank the candidates, most recent first */
+     for (k = candidates->len; k > 0 && ret < n; --k)
+     {
+          guint32 id = g_array_index (candidates, guint32, k - 1);
+          SearchDoc *d = SEARCH_DOC (s, id);
+          HistoryItem item;
+          gchar *uri;
+          guint score, visits = 0;
+
+          if (!search_is_live (s, id) || (score = search_match (d, words)) == 0)
+               continue;
+
+          uri = g_strndup (d->str, d->urilen);
+
+          if (app->history && history_lookup (app->history, uri, &item))
+               visits = item.visits;
+
+          ret++;
+
+          /* on ties, the most recent stays first */
+          for (j = ret - 1; j > 0 && (results[j - 1].score < score
+                                      || (results[j - 1].score == score && results[j - 1].visits < visits)); --j)
+               results[j] = results[j - 1];
+
+          results[j].uri    = uri;
+          results[j].title  = g_strndup (d->str + d->urilen + 1, MAX (d->len, d->urilen + 1) - d->urilen - 1);
+          results[j].score  = score;
+          results[j].visits = visits;
+     }
+
+out:
+     if (candidates != NULL)
+          g_array_free (candidates, TRUE);
+
+     g_array_free (trigrams, TRUE);
+     g_ptr_array_free (lists, TRUE);
+     g_strfreev (words);
+     g_free (lower);
+
+     return ret;
+}
+
+/*!
+ * @param results Array of #SearchResult.
+ * @param n Number of results.
+ *
+ * Free the strings of the results.
+ */
+void search_results_clear (SearchResult *results, guint n)
+{
+     guint i;
+
+     for (i = 0; i < n; ++i)
+     {
+          g_free (results[i].uri);
+          g_free (results[i].title);
+          results[i].uri = results[i].title = NULL;
+     }
+}
+
+/*! @} */
@@ -0,0 +1,81 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __SEARCH_H
+#define __SEARCH_H
+
+/*!
+ * \defgroup search Search
+ * Full-text search over the titles and URIs of visited pages.
+ *
+ * Each (URI, title) pair is a document, appended to the
+ * <code>search</code> journal of the #CACHE_TYPE_HISTORY directory when
+ * a page gets a new title. A newer document for the same URI replaces
+ * the previous one.
+ *
+ * Documents are indexed by trigrams (three lower-case bytes), each
+ * trigram mapping to the sorted list of the documents containing it.
+ * A query is a list of words which must all be found: the lists of the
+ * trigrams of its words of at least #SEARCH_MIN_WORD characters are
+ * intersected, then the candidates are checked against all the words,
+ * from the most recent one until enough are found, and ranked (words in
+ * the title first, then the number of visits, then the most recent).
+ *
+ * The lists are saved in <code>search.idx</code> on exit, so only the
+ * documents added since are indexed again. Nothing is read before the
+ * first query or document.
+ *
+ * @{
+ */
+
+#include <glib.h>
+
+#define SEARCH_SNAPSHOT_SLACK      1024      /*!< New documents before saving the index again */
+#define SEARCH_MIN_WORD            3         /*!< Length of a trigram, shorter query words are not looked up */
+
+typedef struct _SearchIndex SearchIndex;
+
+/*!
+ * \struct SearchResult
+ * A document found by search_query().
+ */
+typedef struct
+{
+     gchar *uri;         /*!< Page's URI */
+     gchar *title;       /*!< Page's title (may be empty) */
+     guint score;        /*!< Words found in the title, counted twice, and in the URI */
+     guint visits;       /*!< Number of visits */
+} SearchResult;
+
+SearchIndex *search_open (void);
+void search_close (SearchIndex *s);
+
+void search_add (SearchIndex *s, const gchar *uri, const gchar *title);
+guint search_query (SearchIndex *s, const gchar *query, guint n, SearchResult *results);
+void search_results_clear (SearchResult *results, guint n);
+
+/*! @} */
+
+#endif /* __SEARCH_H */
@@ -0,0 +1,1007 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "local.h"
+
+/*!
+ * \addtogroup session
+ * @{
+ */
+
+#define CREAM_SESSION_ERROR        (cream_session_error_quark ())
+
+typedef enum
+{
+     CREAM_SESSION_ERROR_CORRUPTED,
+     CREAM_SESSION_ERROR_FAILED
+} CreamSessionError;
+
+static GQuark cream_session_error_quark (void)
+{
+     static GQuark domain = 0;
+
+     if (!domain)
+          domain = g_quark_from_string ("cream.session");
+
+     return domain;
+}
+
+#define SESSION_MAGIC              0x53534843     /* "CHSS" */
+#define SESSION_VERSION            1
+#define SESSION_MAX_DEPTH          64             /*!< Maximum depth of the layout */
+
+/*!
+ * \enum SessionRecordType
+ * Type of a session record.
+ */
+typedef enum
+{
+     SESSION_RECORD_SNAPSHOT = 1,  /*!< focus, layout */
+     SESSION_RECORD_TAB_OPEN,      /*!< notebook, tab, URI */
+     SESSION_RECORD_TAB_CLOSE,     /*!< tab */
+     SESSION_RECORD_NAVIGATE,      /*!< tab, current, length, URI, title */
+     SESSION_RECORD_SPLIT,         /*!< focused notebook, new notebook, orientation */
+     SESSION_RECORD_VIEW_CLOSE,    /*!< notebook */
+     SESSION_RECORD_FOCUS          /*!< notebook, tab */
+} SessionRecordType;
+
+/*!
+ * \enum SessionNodeType
+ * Type of a node of the layout, in a snapshot.
+ */
+typedef enum
+{
+     SESSION_NODE_NONE,            /*!< empty layout */
+     SESSION_NODE_PANED,           /*!< orientation, child1, child2 */
+     SESSION_NODE_NOTEBOOK         /*!< notebook, current page, tabs (tab, current, items) */
+} SessionNodeType;
+
+typedef struct _SessionNode SessionNode;
+
+/*!
+ * \struct SessionTab
+ * A tab, while restoring a session.
+ */
+typedef struct
+{
+     guint id;
+     GArray *items;                /*!< Back/forward list (#CreamModuleHistoryItem) */
+     guint current;                /*!< Current item */
+     SessionNode *notebook;        /*!< Notebook containing the tab */
+} SessionTab;
+
+/*!
+ * \struct _SessionNode
+ * A node of the layout, while restoring a session: either a paned,
+ * or a notebook.
+ */
+struct _SessionNode
+{
+     SessionNode *parent;
+     SessionNode *child[2];        /*!< Children of a paned */
+     GtkOrientation orientation;   /*!< Orientation of a paned */
+
+     guint id;                     /*!< Notebook's identifier */
+     GList *tabs;                  /*!< Notebook's tabs */
+     SessionTab *focus;            /*!< Notebook's current tab */
+};
+
+/*!
+ * \struct SessionModel
+ * The session being restored.
+ */
+typedef struct
+{
+     SessionNode *root;
+     SessionNode *focus;
+
+     GHashTable *notebooks;        /*!< Notebooks by identifier */
+     GHashTable *tabs;             /*!< Tabs by identifier */
+     GPtrArray *nodes;             /*!< Every node allocated */
+} SessionModel;
+
+/*!
+ * \struct SessionReader
+ * Cursor over a mapped session file.
+ */
+typedef struct
+{
+     const gchar *p;
+     const gchar *end;
+     gboolean error;               /*!< \c TRUE if a read went past the end */
+} SessionReader;
+
+static gchar *path = NULL;
+static gboolean recording = FALSE;
+static guint deltas = 0;
+static guint checkpoint_source = 0;
+
+/* Encoding */
+
+static void session_put_u32 (GString *buf, guint32 v)
+{
+     g_string_append_len (buf, (const gchar *) &v, sizeof (v));
+}
+
+static void session_put_str (GString *buf, const gchar *str)
+{
+     guint32 len = (str != NULL ? strlen (str) : 0);
+
+     session_put_u32 (buf, len);
+
+     if (len > 0)
+          g_string_append_len (buf, str, len);
+}
+
+/*!
+ * @param buf Buffer to fill.
+ * @param type Type of the record.
+ * @return Position of the record in \a buf, for session_record_end().
+ *
+ * Start a record: its type, and its size (set by session_record_end()).
+ */
+static gsize session_record_begin (GString *buf, SessionRecordType type)
+{
+     gsize start = buf->len;
+
+     session_put_u32 (buf, type);
+     session_put_u32 (buf, 0);
+
+     return start;
+}
+
+static void session_record_end (GString *buf, gsize start)
+{
+     guint32 size = buf->len - start - 2 * sizeof (guint32);
+     memcpy (buf->str + start + sizeof (guint32), &size, sizeof (size));
+}
+
+static gboolean session_checkpoint_cb (gpointer data)
+{
+     checkpoint_source = 0;
+     session_checkpoint ();
+     return FALSE;
+}
+
+/*!
+ * @param buf A record built with session_record_begin().
+ *
+ * Append a delta record to the session file. When there are too many
+ * deltas, a new snapshot is written once the main loop is idle: the
+ * deltas are recorded before the widgets are changed.
+ */
+static void session_append (GString *buf)
+{
+     session_record_end (buf, 0);
+     cache_write (path, buf->str, buf->len);
+     g_string_free (buf, TRUE);
+
+     if (++deltas >= SESSION_CHECKPOINT_DELTAS && checkpoint_source == 0)
+          checkpoint_source = g_idle_add (session_checkpoint_cb, NULL);
+}
+
+static guint32 session_get_u32 (SessionReader *r)
+{
+     guint32 v = 0;
+
+     if (r->error || r->end - r->p < (gssize) sizeof (v))
+     {
+          r->error = TRUE;
+          return 0;
+     }
+
+     memcpy (&v, r->p, sizeof (v));
+     r->p += sizeof (v);
+     return v;
+}
+
+static gchar *session_get_str (SessionReader *r)
+{
+     guint32 len = session_get_u32 (r);
+     gchar *ret;
+
+     if (r->error || r->end - r->p < (gssize) len)
+     {
+          r->error = TRUE;
+          return NULL;
+     }
+
+     ret = g_strndup (r->p, len);
+     r->p += len;
+     return ret;
+}
+
+/* Snapshot */
+
+/*!
+ * @param buf Buffer to fill.
+ * @param w A #WebView.
+ *
+ * Write a tab and its back/forward list.
+ */
+static void session_put_tab (GString *buf, WebView *w)
+{
+     GArray *items = g_array_new (FALSE, FALSE, sizeof (CreamModuleHistoryItem));
+     guint i, current = 0, length = 0;
+
+     if (!cream_module_get_history (CREAM_MODULE (w->mod), w->child, items, &current, &length) && w->uri != NULL)
+     {
+          CreamModuleHistoryItem item;
+
+          item.uri   = g_strdup (w->uri);
+          item.title = g_strdup (w->title);
+          g_array_append_val (items, item);
+     }
+
+     session_put_u32 (buf, w->id);
+     session_put_u32 (buf, current);
+     session_put_u32 (buf, items->len);
+
+     for (i = 0; i < items->len; ++i)
+     {
+          session_put_str (buf, g_array_index (items, CreamModuleHistoryItem, i).uri);
+          session_put_str (buf, g_array_index (items, CreamModuleHistoryItem, i).title);
+     }
+
+     cream_module_history_clear (items);
+     g_array_free (items, TRUE);
+}
+
+/*!
+ * @param buf Buffer to fill.
+ * @param node A node of the #GtkVimSplit layout.
+ *
+ * Write the layout, depth first.
+ */
+static void session_put_node (GString *buf, GtkWidget *node)
+{
+     if (GTK_IS_PANED (node))
+     {
+          session_put_u32 (buf, SESSION_NODE_PANED);
+          session_put_u32 (buf, gtk_orientable_get_orientation (GTK_ORIENTABLE (node)));
+          session_put_node (buf, gtk_paned_get_child1 (GTK_PANED (node)));
+          session_put_node (buf, gtk_paned_get_child2 (GTK_PANED (node)));
+     }
+     else if (CREAM_IS_NOTEBOOK (node))
+     {
+          gint i, n = gtk_notebook_get_n_pages (GTK_NOTEBOOK (node));
+
+          session_put_u32 (buf, SESSION_NODE_NOTEBOOK);
+          session_put_u32 (buf, CREAM_NOTEBOOK (node)->id);
+          session_put_u32 (buf, MAX (gtk_notebook_get_current_page (GTK_NOTEBOOK (node)), 0));
+          session_put_u32 (buf, n);
+
+          for (i = 0; i < n; ++i)
+               session_put_tab (buf, CREAM_WEBVIEW (gtk_notebook_get_nth_page (GTK_NOTEBOOK (node), i)));
+     }
+     else
+          session_put_u32 (buf, SESSION_NODE_NONE);
+}
+
+/*!
+ * Replace the session file with a snapshot of the current layout.
+ * The file is written by the cache's writer thread.
+ */
+void session_checkpoint (void)
+{
+     GtkWidget *focus = gtk_vim_split_get_focus (GTK_VIM_SPLIT (app->gui.vimsplit));
+     GString *buf;
+     gsize start;
+
+     g_return_if_fail (path != NULL);
+
+     buf = g_string_new (NULL);
+     session_put_u32 (buf, SESSION_MAGIC);
+     session_put_u32 (buf, SESSION_VERSION);
+
+     start = session_record_begin (buf, SESSION_RECORD_SNAPSHOT);
+     session_put_u32 (buf, focus ? CREAM_NOTEBOOK (focus)->id : 0);
+     session_put_node (buf, gtk_bin_get_child (GTK_BIN (app->gui.vimsplit)));
+     session_record_end (buf, start);
+
+     cache_rewrite (path, buf);
+     deltas = 0;
+}
+
+/*!
+ * Start to record the session: write a snapshot of the current layout,
+ * then a delta for each change. This replaces the last session, so it
+ * is only called once the last session was restored.
+ */
+void session_start (void)
+{
+     g_free (path);
+     path = cache_path (CACHE_TYPE_SESSION, "session");
+     quota_pin (path);
+
+     recording = TRUE;
+     session_checkpoint ();
+}
+
+/* Deltas */
+
+/*!
+ * @param nb The #Notebook containing the tab.
+ * @param w The new #WebView.
+ * @param uri URI to load.
+ *
+ * Record a new tab.
+ */
+void session_tab_opened (Notebook *nb, WebView *w, const gchar *uri)
+{
+     GString *buf;
+
+     if (!recording)
+          return;
+
+     buf = g_string_sized_new (64);
+     session_record_begin (buf, SESSION_RECORD_TAB_OPEN);
+     session_put_u32 (buf, nb->id);
+     session_put_u32 (buf, w->id);
+     session_put_str (buf, uri);
+     session_append (buf);
+}
+
+/*!
+ * @param w The closed #WebView.
+ *
+ * Record the closing of a tab.
+ */
+void session_tab_closed (WebView *w)
+{
+     GString *buf;
+
+     if (!recording)
+          return;
+
+     buf = g_string_sized_new (16);
+     session_record_begin (buf, SESSION_RECORD_TAB_CLOSE);
+     session_put_u32 (buf, w->id);
+     session_append (buf);
+}
+
+/*!
+ * @param w A #WebView.
+ *
+ * Record the current URI and title of a tab, and its position in the
+ * back/forward list.
+ */
+void session_navigated (WebView *w)
+{
+     guint current = 0, length = 1;
+     GString *buf;
+
+     if (!recording || w->uri == NULL)
+          return;
+
+     if (!cream_module_get_history (CREAM_MODULE (w->mod), w->child, NULL, &current, &length))
+     {
+          current = 0;
+          length  = 1;
+     }
+
+     buf = g_string_sized_new (128);
+     session_record_begin (buf, SESSION_RECORD_NAVIGATE);
+     session_put_u32 (buf, w->id);
+     session_put_u32 (buf, current);
+     session_put_u32 (buf, length);
+     session_put_str (buf, w->uri);
+     session_put_str (buf, w->title);
+     session_append (buf);
+}
+
+/*!
+ * @param focus The split #Notebook, or \c NULL if the layout is empty.
+ * @param nb The new #Notebook.
+ * @param o Split orientation.
+ *
+ * Record a split.
+ */
+void session_split (Notebook *focus, Notebook *nb, GtkOrientation o)
+{
+     GString *buf;
+
+     if (!recording)
+          return;
+
+     buf = g_string_sized_new (20);
+     session_record_begin (buf, SESSION_RECORD_SPLIT);
+     session_put_u32 (buf, focus ? focus->id : 0);
+     session_put_u32 (buf, nb->id);
+     session_put_u32 (buf, o);
+     session_append (buf);
+}
+
+/*!
+ * @param nb The closed #Notebook.
+ *
+ * Record the closing of a view.
+ */
+void session_view_closed (Notebook *nb)
+{
+     GString *buf;
+
+     if (!recording)
+          return;
+
+     buf = g_string_sized_new (12);
+     session_record_begin (buf, SESSION_RECORD_VIEW_CLOSE);
+     session_put_u32 (buf, nb->id);
+     session_append (buf);
+}
+
+/*!
+ * @param nb The focused #Notebook.
+ *
+ * Record the focus.
+ */
+void session_focused (Notebook *nb)
+{
+     GtkWidget *w = notebook_get_focus (nb);
+     GString *buf;
+
+     if (!recording)
+          return;
+
+     buf = g_string_sized_new (16);
+     session_record_begin (buf, SESSION_RECORD_FOCUS);
+     session_put_u32 (buf, nb->id);
+     session_put_u32 (buf, w ? CREAM_WEBVIEW (w)->id : 0);
+     session_append (buf);
+}
+
+/* Restore */
+
+static void session_tab_free (SessionTab *tab)
+{
+     cream_module_history_clear (tab->items);
+     g_array_free (tab->items, TRUE);
+     g_free (tab);
+}
+
+static void session_node_free (SessionNode *n)
+{
+     g_list_free (n->tabs);
+     g_free (n);
+}
+
+static SessionNode *session_model_node (SessionModel *m)
+{
+     SessionNode *n = g_new0 (SessionNode, 1);
+     g_ptr_array_add (m->nodes, n);
+     return n;
+}
+
+/*!
+ * @param m A #SessionModel.
+ * @param id Notebook's identifier.
+ * @return The notebook, created (detached from the layout) if needed.
+ */
+static SessionNode *session_model_notebook (SessionModel *m, guint id)
+{
+     SessionNode *n = g_hash_table_lookup (m->notebooks, GUINT_TO_POINTER (id));
+
+     if (n == NULL)
+     {
+          n = session_model_node (m);
+          n->id = id;
+          g_hash_table_insert (m->notebooks, GUINT_TO_POINTER (id), n);
+     }
+
+     return n;
+}
+
+/*!
+ * @param tab A #SessionTab.
+ *
+ * Remove a tab from its notebook.
+ */
+static void session_tab_unlink (SessionTab *tab)
+{
+     SessionNode *nb = tab->notebook;
+
+     nb->tabs = g_list_remove (nb->tabs, tab);
+
+     if (nb->focus == tab)
+          nb->focus = (nb->tabs ? nb->tabs->data : NULL);
+}
+
+/*!
+ * @param m A #SessionModel.
+ * @param nb Notebook containing the tab.
+ * @param id Tab's identifier.
+ * @return A new tab, without items.
+ */
+static SessionTab *session_model_tab (SessionModel *m, SessionNode *nb, guint id)
+{
+     SessionTab *tab = g_hash_table_lookup (m->tabs, GUINT_TO_POINTER (id));
+
+     if (tab != NULL)
+          session_tab_unlink (tab);
+
+     tab = g_new0 (SessionTab, 1);
+
+     tab->id       = id;
+     tab->items    = g_array_new (FALSE, TRUE, sizeof (CreamModuleHistoryItem));
+     tab->notebook = nb;
+
+     /* replaces a previous tab with the same identifier */
+     g_hash_table_insert (m->tabs, GUINT_TO_POINTER (id), tab);
+
+     nb->tabs  = g_list_append (nb->tabs, tab);
+     nb->focus = tab;
+
+     return tab;
+}
+
+/*!
+ * @param tab A #SessionTab.
+ * @return \c TRUE if the tab can be restored.
+ */
+static gboolean session_tab_is_valid (SessionTab *tab)
+{
+     return tab->current < tab->items->len && g_array_index (tab->items, CreamModuleHistoryItem, tab->current).uri != NULL;
+}
+
+/*!
+ * @param m A #SessionModel.
+ * @param old A node of the layout.
+ * @param new The node replacing it.
+ */
+static void session_model_replace (SessionModel *m, SessionNode *old, SessionNode *new)
+{
+     SessionNode *p = old->parent;
+
+     if (p == NULL)
+          m->root = new;
+     else
+          p->child[p->child[0] == old ? 0 : 1] = new;
+
+     new->parent = p;
+     old->parent = NULL;
+}
+
+/*!
+ * @param n A node of the layout.
+ * @return The first notebook in \a n.
+ */
+static SessionNode *session_model_first (SessionNode *n)
+{
+     while (n->child[0] != NULL)
+          n = n->child[0];
+
+     return n;
+}
+
+/*!
+ * @param m A #SessionModel.
+ * @param n A notebook.
+ *
+ * Remove a notebook from the layout, as gtk_vim_split_close() does.
+ */
+static void session_model_detach (SessionModel *m, SessionNode *n)
+{
+     SessionNode *p = n->parent;
+
+     if (p == NULL)
+     {
+          if (m->root == n)
+               m->root = m->focus = NULL;
+          return;
+     }
+
+     session_model_replace (m, p, p->child[p->child[0] == n ? 1 : 0]);
+     n->parent = NULL;
+
+     if (m->focus == n)
+          m->focus = session_model_first (m->root);
+}
+
+/*!
+ * @param m A #SessionModel.
+ * @param target The split notebook, or \c NULL.
+ * @param n The new notebook.
+ * @param o Split orientation.
+ *
+ * Split a notebook, as gtk_vim_split_add() does.
+ */
+static void session_model_split (SessionModel *m, SessionNode *target, SessionNode *n, GtkOrientation o)
+{
+     SessionNode *p;
+
+     if (m->root == NULL || target == NULL || (target->parent == NULL && m->root != target))
+     {
+          if (m->root == NULL)
+               m->root = n;
+     }
+     else
+     {
+          p = session_model_node (m);
+          p->orientation = o;
+
+          session_model_replace (m, target, p);
+          p->child[0] = target;
+          p->child[1] = n;
+          target->parent = n->parent = p;
+     }
+
+     m->focus = n;
+}
+
+/*!
+ * @param m A #SessionModel.
+ * @param r Cursor on the node.
+ * @param depth Depth of the node.
+ * @return The node read.
+ *
+ * Read a node of the layout from a snapshot.
+ */
+static SessionNode *session_read_node (SessionModel *m, SessionReader *r, guint depth)
+{
+     SessionNode *n = NULL;
+     guint32 i, j, ntabs, page;
+
+     if (depth > SESSION_MAX_DEPTH)
+     {
+          r->error = TRUE;
+          return NULL;
+     }
+
+     switch (session_get_u32 (r))
+     {
+          case SESSION_NODE_PANED:
+               n = session_model_node (m);
+               n->orientation = session_get_u32 (r);
+               n->child[0] = session_read_node (m, r, depth + 1);
+               n->child[1] = session_read_node (m, r, depth + 1);
+
+               if (n->child[0] == NULL || n->child[1] == NULL)
+               {
+                    r->error = TRUE;
+                    return NULL;
+               }
+
+               n->child[0]->parent = n->child[1]->parent = n;
+               break;
+
+          case SESSION_NODE_NOTEBOOK:
+               n = session_model_notebook (m, session_get_u32 (r));
+               page  = session_get_u32 (r);
+               ntabs = session_get_u32 (r);
+
+               for (i = 0; i < ntabs && !r->error; ++i)
+               {
+                    SessionTab *tab = session_model_tab (m, n, session_get_u32 (r));
+                    guint32 nitems;
+
+                    tab->current = session_get_u32 (r);
+                    nitems = session_get_u32 (r);
+
+                    for (j = 0; j < nitems && !r->error; ++j)
+                    {
+                         CreamModuleHistoryItem item;
+
+                         item.uri   = session_get_str (r);
+                         item.title = session_get_str (r);
+                         g_array_append_val (tab->items, item);
+                    }
+               }
+
+               n->focus = g_list_nth_data (n->tabs, page);
+               break;
+
+          default:
+               break;
+     }
+
+     return n;
+}
+
+/*!
+ * @param m A #SessionModel.
+ * @param type Type of the record.
+ * @param r Cursor on the record's content.
+ *
+ * Apply a record to the model.
+ */
+static void session_model_apply (SessionModel *m, SessionRecordType type, SessionReader *r)
+{
+     SessionNode *nb;
+     SessionTab *tab;
+     guint32 a, b, c;
+
+     switch (type)
+     {
+          case SESSION_RECORD_SNAPSHOT:
+               a = session_get_u32 (r);
+               m->root = session_read_node (m, r, 0);
+               m->focus = g_hash_table_lookup (m->notebooks, GUINT_TO_POINTER (a));
+               break;
+
+          case SESSION_RECORD_TAB_OPEN:
+               a = session_get_u32 (r);
+               b = session_get_u32 (r);
+
+               if (!r->error)
+               {
+                    CreamModuleHistoryItem item;
+
+                    tab = session_model_tab (m, session_model_notebook (m, a), b);
+                    item.uri   = session_get_str (r);
+                    item.title = NULL;
+                    g_array_append_val (tab->items, item);
+               }
+               break;
+
+          case SESSION_RECORD_TAB_CLOSE:
+               if ((tab = g_hash_table_lookup (m->tabs, GUINT_TO_POINTER (session_get_u32 (r)))) != NULL)
+                    session_tab_unlink (tab);
+               break;
+
+          case SESSION_RECORD_NAVIGATE:
+               tab = g_hash_table_lookup (m->tabs, GUINT_TO_POINTER (session_get_u32 (r)));
+               a = session_get_u32 (r);
+               b = session_get_u32 (r);
+
+               /* a navigation adds one item at most */
+               if (tab != NULL && !r->error && a < b && b <= tab->items->len + 1)
+               {
+                    CreamModuleHistoryItem *item;
+
+                    /* drop the items which are not in the list anymore */
+                    for (c = b; c < tab->items->len; ++c)
+                    {
+                         g_free (g_array_index (tab->items, CreamModuleHistoryItem, c).uri);
+                         g_free (g_array_index (tab->items, CreamModuleHistoryItem, c).title);
+                    }
+
+                    g_array_set_size (tab->items, b);
+                    tab->current = a;
+
+                    item = &g_array_index (tab->items, CreamModuleHistoryItem, a);
+                    g_free (item->uri);
+                    g_free (item->title);
+                    item->uri   = session_get_str (r);
+                    item->title = session_get_str (r);
+               }
+               break;
+
+          case SESSION_RECORD_SPLIT:
+               a = session_get_u32 (r);
+               b = session_get_u32 (r);
+               c = session_get_u32 (r);
+
+               if (!r->error)
+               {
+                    nb = g_hash_table_lookup (m->notebooks, GUINT_TO_POINTER (a));
+                    session_model_split (m, nb, session_model_notebook (m, b), c);
+               }
+               break;
+
+          case SESSION_RECORD_VIEW_CLOSE:
+               if ((nb = g_hash_table_lookup (m->notebooks, GUINT_TO_POINTER (session_get_u32 (r)))) != NULL)
+                    session_model_detach (m, nb);
+               break;
+
+          case SESSION_RECORD_FOCUS:
+               nb  = g_hash_table_lookup (m->notebooks, GUINT_TO_POINTER (session_get_u32 (r)));
+               tab = g_hash_table_lookup (m->tabs, GUINT_TO_POINTER (session_get_u32 (r)));
+
+               if (nb != NULL && (nb->parent != NULL || m->root == nb))
+               {
+                    m->focus = nb;
+
+                    if (tab != NULL && tab->notebook == nb)
+                         nb->focus = tab;
+               }
+               break;
+
+          default:
+               break;
+     }
+}
+
+/*!
+ * @param n A node of the layout.
+ * @return A notebook without valid tabs, or \c NULL.
+ */
+static SessionNode *session_model_find_empty (SessionNode *n)
+{
+     GList *l;
+
+     if (n == NULL)
+          return NULL;
+
+     if (n->child[0] != NULL)
+     {
+          SessionNode *ret = session_model_find_empty (n->child[0]);
+          return (ret != NULL ? ret : session_model_find_empty (n->child[1]));
+     }
+
+     for (l = n->tabs; l != NULL; l = l->next)
+     {
+          if (session_tab_is_valid (l->data))
+               return NULL;
+     }
+
+     return n;
+}
+
+/*!
+ * @param m A #SessionModel.
+ * @param n A node of the layout.
+ * @param notebooks List of the notebooks created.
+ * @param focus The notebook to focus.
+ * @return The widget of the node.
+ *
+ * Create the widgets of the layout.
+ */
+static GtkWidget *session_build (SessionModel *m, SessionNode *n, GList **notebooks, GtkWidget **focus)
+{
+     GtkWidget *nb;
+     GList *l;
+     gint page = 0, npages = 0;
+
+     if (n->child[0] != NULL)
+     {
+          GtkWidget *paned = gtk_paned_new (n->orientation);
+
+          gtk_paned_pack1 (GTK_PANED (paned), session_build (m, n->child[0], notebooks, focus), TRUE, TRUE);
+          gtk_paned_pack2 (GTK_PANED (paned), session_build (m, n->child[1], notebooks, focus), TRUE, TRUE);
+
+          return paned;
+     }
+
+     nb = notebook_new ();
+
+     for (l = n->tabs; l != NULL; l = l->next)
+     {
+          SessionTab *tab = l->data;
+          GArray *items;
+          guint i, current = 0;
+
+          if (!session_tab_is_valid (tab))
+               continue;
+
+          /* skip the unknown items of the back/forward list */
+          items = g_array_new (FALSE, FALSE, sizeof (CreamModuleHistoryItem));
+
+          for (i = 0; i < tab->items->len; ++i)
+          {
+               CreamModuleHistoryItem *item = &g_array_index (tab->items, CreamModuleHistoryItem, i);
+
+               if (i == tab->current)
+                    current = items->len;
+
+               if (item->uri != NULL)
+                    g_array_append_val (items, *item);
+          }
+
+          notebook_tabrestore (CREAM_NOTEBOOK (nb), items, current);
+          g_array_free (items, TRUE);
+
+          if (tab == n->focus)
+               page = npages;
+          npages++;
+     }
+
+     gtk_notebook_set_current_page (GTK_NOTEBOOK (nb), page);
+     *notebooks = g_list_append (*notebooks, nb);
+
+     if (*focus == NULL || n == m->focus)
+          *focus = nb;
+
+     return nb;
+}
+
+/*!
+ * @param err \class{GError} pointer in order to follow possible errors.
+ * @return \c TRUE if a session was restored, \c FALSE otherwise.
+ *
+ * Restore the last session, if any. The #GtkVimSplit must be empty.
+ */
+gboolean session_restore (GError **err)
+{
+     GError *error = NULL;
+     GMappedFile *file;
+     SessionModel m;
+     SessionReader r;
+     SessionNode *n;
+     gchar *fpath = cache_path (CACHE_TYPE_SESSION, "session");
+     gboolean ret = FALSE;
+
+     file = g_mapped_file_new (fpath, FALSE, &error);
+     g_free (fpath);
+
+     if (file == NULL)
+     {
+          if (g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+               g_error_free (error);
+          else
+               g_propagate_error (err, error);
+
+          return FALSE;
+     }
+
+     r.p     = g_mapped_file_get_contents (file);
+     r.end   = r.p + g_mapped_file_get_length (file);
+     r.error = FALSE;
+
+     if (session_get_u32 (&r) != SESSION_MAGIC || session_get_u32 (&r) != SESSION_VERSION)
+     {
+          g_set_error (err, CREAM_SESSION_ERROR, CREAM_SESSION_ERROR_CORRUPTED, _("Invalid session file"));
+          g_mapped_file_unref (file);
+          return FALSE;
+     }
+
+     m.root      = NULL;
+     m.focus     = NULL;
+     m.notebooks = g_hash_table_new (g_direct_hash, g_direct_equal);
+     m.tabs      = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) session_tab_free);
+     m.nodes     = g_ptr_array_new_with_free_func ((GDestroyNotify) session_node_free);
+
+     /* replay the records, a truncated one ends the session */
+     while (r.p < r.end)
+     {
+          SessionRecordType type = session_get_u32 (&r);
+          guint32 size = session_get_u32 (&r);
+          SessionReader rec;
+
+          if (r.error || r.end - r.p < (gssize) size)
+               break;
+
+          rec.p     = r.p;
+          rec.end   = r.p + size;
+          rec.error = FALSE;
+          r.p += size;
+
+          session_model_apply (&m, type, &rec);
+     }
+
+     while ((n = session_model_find_empty (m.root)) != NULL)
+          session_model_detach (&m, n);
+
+     if (m.root != NULL)
+     {
+          GList *notebooks = NULL;
+          GtkWidget *root, *focus = NULL;
+
+          root = session_build (&m, m.root, &notebooks, &focus);
+          gtk_vim_split_set_root (GTK_VIM_SPLIT (app->gui.vimsplit), root, notebooks, focus);
+          g_list_free (notebooks);
+
+          ui_show ();
+          ret = TRUE;
+     }
+
+     g_hash_table_destroy (m.notebooks);
+     g_hash_table_destroy (m.tabs);
+     g_ptr_array_free (m.nodes, TRUE);
+     g_mapped_file_unref (file);
+
+     return ret;
+}
+
+/*! @} */
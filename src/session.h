@@ -0,0 +1,69 @@
+/*
+* Copyright © 2011, David Delassus <david.jose.delassus@gmail.com>
+*
+* Permission is hereby granted, free of charge, to any person
+* obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use,
+* copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following
+* conditions:
+*
+* The above copyright notice and this permission notice shall be
+* included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+* OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+* HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+* WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __SESSION_H
+#define __SESSION_H
+
+/*!
+ * \defgroup session Session
+ * Save and restore the browsing session.
+ *
+ * The session is stored in the #CACHE_TYPE_SESSION directory, as a
+ * binary snapshot of the #GtkVimSplit layout (notebooks, their tabs with
+ * back/forward lists, and focus), followed by small delta records
+ * appended on each change (tab opened/closed, navigation, split, focus).
+ * Every #SESSION_CHECKPOINT_DELTAS records, the file is replaced by a
+ * new snapshot.
+ *
+ * On restore, the snapshot and the deltas are replayed in memory, then
+ * the layout is built in one pass.
+ *
+ * The session is only recorded when the browser starts without an URL,
+ * after restoring the last one: a launch with an URL keeps it.
+ *
+ * @{
+ */
+
+#include <gtk/gtk.h>
+
+#include "Notebook.h"
+#include "WebView.h"
+
+#define SESSION_CHECKPOINT_DELTAS       1024      /*!< Delta records before writing a new snapshot */
+
+gboolean session_restore (GError **err);
+void session_start (void);
+void session_checkpoint (void);
+
+void session_tab_opened (Notebook *nb, WebView *w, const gchar *uri);
+void session_tab_closed (WebView *w);
+void session_navigated (WebView *w);
+void session_split (Notebook *focus, Notebook *nb, GtkOrientation o);
+void session_view_closed (Notebook *nb);
+void session_focused (Notebook *nb);
+
+/*! @} */
+
+#endif /* __SESSION_H */
@@ -127,9 +127,14 @@ static gboolean control_client_socket (GIOChannel *channel)
 
      if (line)
      {
+          /* send the output of the command back to the client */
+          ui_output_capture (result);
+
           if (!run_command (line, &error))
                CREAM_BROWSER_GET_CLASS (app)->error (app, FALSE, error);
 
+          ui_output_capture (NULL);
+
           if (error != NULL)
           {
                result = g_string_append (result, error->message);